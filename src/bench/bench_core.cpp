@@ -0,0 +1,88 @@
+#include "bench_global.hpp"
+#include "DMemPool.hpp"
+#include "DSharedPtr.hpp"
+
+static void mempool_small(dint64 n)
+{
+    DMemPool *pool = DMemPool::instance();
+
+    for (dint64 i = 0; i < n; ++i) {
+        MemoryChunk *chunk = pool->getMemory(16);
+        bench_escape(chunk);
+        DFree(chunk);
+    }
+}
+
+static void mempool_read(dint64 n)
+{
+    DMemPool *pool = DMemPool::instance();
+
+    for (dint64 i = 0; i < n; ++i) {
+        MemoryChunk *chunk = pool->getMemory(4096);
+        bench_escape(chunk);
+        DFree(chunk);
+    }
+}
+
+/**
+ * @brief 一次持有多个chunk再释放，block中会同时有多个chunk，更接近socket读写队列的用法
+ */
+static void mempool_batch(dint64 n)
+{
+    DMemPool *pool = DMemPool::instance();
+    MemoryChunk *chunks[64];
+
+    for (dint64 i = 0; i < n; i += 64) {
+        int count = DMin(n - i, 64);
+        for (int j = 0; j < count; ++j) {
+            chunks[j] = pool->getMemory(4096);
+        }
+        for (int j = 0; j < count; ++j) {
+            DFree(chunks[j]);
+        }
+    }
+}
+
+static DSharedPtr<MemoryChunk> shared_chunk;
+
+static void sharedptr_chunk_copy(dint64 n)
+{
+    for (dint64 i = 0; i < n; ++i) {
+        DSharedPtr<MemoryChunk> copy(shared_chunk);
+        bench_escape(copy.get());
+    }
+}
+
+static DSharedPtr<int> shared_int(new int(0));
+
+static void sharedptr_copy(dint64 n)
+{
+    for (dint64 i = 0; i < n; ++i) {
+        DSharedPtr<int> copy(shared_int);
+        bench_escape(&copy);
+    }
+}
+
+static void sharedptr_create(dint64 n)
+{
+    for (dint64 i = 0; i < n; ++i) {
+        DSharedPtr<int> ptr(new int(0));
+        bench_escape(&ptr);
+    }
+}
+
+void bench_core()
+{
+    shared_chunk = DSharedPtr<MemoryChunk>(DMemPool::instance()->getMemory(4096));
+
+    bench_run("mempool/get+free 16B", mempool_small, 1000000);
+    bench_run("mempool/get+free 4KB", mempool_read, 1000000);
+    bench_run("mempool/get+free 4KB x64", mempool_batch, 1000000);
+    bench_run_threads("mempool/get+free 4KB", mempool_read, 200000, 4);
+    bench_run_threads("mempool/get+free 4KB x64", mempool_batch, 200000, 4);
+
+    bench_run("sharedptr/chunk copy+destroy", sharedptr_chunk_copy, 10000000);
+    bench_run_threads("sharedptr/chunk copy+destroy", sharedptr_chunk_copy, 2000000, 4);
+    bench_run("sharedptr/copy+destroy", sharedptr_copy, 10000000);
+    bench_run("sharedptr/create+destroy", sharedptr_create, 1000000);
+}
@@ -0,0 +1,200 @@
+#include "bench_global.hpp"
+#include "DDateTime.hpp"
+#include "DThread.hpp"
+
+#include <new>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#define BENCH_THROW_NOTHING     noexcept
+#else
+#define BENCH_THROW_BAD_ALLOC   throw(std::bad_alloc)
+#define BENCH_THROW_NOTHING     throw()
+#endif
+
+// 每个线程的分配次数，只由所属线程修改
+static __thread duint64 alloc_count = 0;
+
+static const char *bench_filter = NULL;
+
+/**
+ * 替换全局的operator new/delete来统计分配次数。DMemPool、DSharedPtr、容器都经过这里，
+ * 所以没有链接tcmalloc(它在同一个目标文件里定义了operator new)
+ */
+void *operator new(size_t size) BENCH_THROW_BAD_ALLOC
+{
+    alloc_count++;
+
+    void *p = malloc(size == 0 ? 1 : size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void *operator new[](size_t size) BENCH_THROW_BAD_ALLOC
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) BENCH_THROW_NOTHING
+{
+    free(p);
+}
+
+void operator delete[](void *p) BENCH_THROW_NOTHING
+{
+    free(p);
+}
+
+static dint64 bench_now()
+{
+    struct timespec now = DDateTime::monotonic();
+    return (dint64)now.tv_sec * 1000 * 1000 * 1000 + now.tv_nsec;
+}
+
+static void bench_report(const char *name, int threads, dint64 n, dint64 cost, duint64 allocs)
+{
+    double ns = (double)cost / n;
+    double per_op = (double)allocs / ((double)n * threads);
+
+    printf("%-40s %4d %12.1f ns/op %10.2f allocs/op %12lld ops\n",
+           name, threads, ns, per_op, (long long)n);
+    fflush(stdout);
+}
+
+void bench_set_filter(const char *filter)
+{
+    bench_filter = filter;
+}
+
+bool bench_matched(const char *name)
+{
+    return bench_filter == NULL || strstr(name, bench_filter) != NULL;
+}
+
+void bench_run(const char *name, bench_func func, dint64 n)
+{
+    if (!bench_matched(name)) {
+        return;
+    }
+
+    // 预热，让内存池和缓存进入稳定状态
+    func(DMax(n / 10, 1));
+
+    dint64 best = -1;
+    duint64 allocs = 0;
+
+    for (int i = 0; i < BENCH_ROUNDS; ++i) {
+        duint64 begin_allocs = alloc_count;
+        dint64 begin = bench_now();
+
+        func(n);
+
+        dint64 cost = bench_now() - begin;
+        if (best < 0 || cost < best) {
+            best = cost;
+            allocs = alloc_count - begin_allocs;
+        }
+    }
+
+    bench_report(name, 1, n, best, allocs);
+}
+
+/**
+ * @brief 所有线程创建完成后在barrier上同时开始，线程创建的时间不计入耗时
+ */
+class bench_thread : public DThread
+{
+public:
+    bench_thread(bench_func func, dint64 n, pthread_barrier_t *barrier)
+        : allocs(0)
+        , m_func(func)
+        , m_n(n)
+        , m_barrier(barrier)
+    {
+    }
+
+    virtual ~bench_thread() {}
+
+protected:
+    virtual void run()
+    {
+        m_func(DMax(m_n / 10, 1));
+
+        pthread_barrier_wait(m_barrier);
+
+        duint64 begin_allocs = alloc_count;
+        m_func(m_n);
+        allocs = alloc_count - begin_allocs;
+    }
+
+public:
+    duint64 allocs;
+
+private:
+    bench_func m_func;
+    dint64 m_n;
+    pthread_barrier_t *m_barrier;
+};
+
+void bench_run_threads(const char *name, bench_func func, dint64 n, int threads)
+{
+    if (!bench_matched(name)) {
+        return;
+    }
+
+    dint64 best = -1;
+    duint64 allocs = 0;
+
+    for (int i = 0; i < BENCH_ROUNDS; ++i) {
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, threads + 1);
+
+        std::vector<bench_thread*> workers;
+        for (int j = 0; j < threads; ++j) {
+            bench_thread *worker = new bench_thread(func, n, &barrier);
+            worker->setThreadName("bench");
+            worker->start();
+            workers.push_back(worker);
+        }
+
+        pthread_barrier_wait(&barrier);
+        dint64 begin = bench_now();
+
+        duint64 round_allocs = 0;
+        for (int j = 0; j < threads; ++j) {
+            workers.at(j)->wait();
+            round_allocs += workers.at(j)->allocs;
+        }
+
+        dint64 cost = bench_now() - begin;
+        if (best < 0 || cost < best) {
+            best = cost;
+            allocs = round_allocs;
+        }
+
+        for (int j = 0; j < threads; ++j) {
+            DFree(workers.at(j));
+        }
+        pthread_barrier_destroy(&barrier);
+    }
+
+    bench_report(name, threads, n, best, allocs);
+}
+
+void bench_escape(void *p)
+{
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+duint64 bench_allocs()
+{
+    return alloc_count;
+}
@@ -0,0 +1,41 @@
+#ifndef BENCH_GLOBAL_HPP
+#define BENCH_GLOBAL_HPP
+
+#include "DGlobal.hpp"
+
+/**
+ * @brief 被测的操作，执行n次。准备工作放在用例的setup中，不计入耗时
+ */
+typedef void (*bench_func)(dint64 n);
+
+// 每个用例重复的轮数，取耗时最少的一轮，减少调度和频率变化的干扰
+#define BENCH_ROUNDS    5
+
+/**
+ * @brief 只运行名字中包含filter的用例，为NULL时全部运行
+ */
+void bench_set_filter(const char *filter);
+bool bench_matched(const char *name);
+
+/**
+ * @brief 单线程执行n次，输出每次操作的耗时(ns/op)和operator new的次数(allocs/op)
+ */
+void bench_run(const char *name, bench_func func, dint64 n);
+
+/**
+ * @brief threads个线程同时各执行n次，耗时为墙上时间除以每个线程的次数，
+ *        分配次数为所有线程的总和除以总次数
+ */
+void bench_run_threads(const char *name, bench_func func, dint64 n, int threads);
+
+/**
+ * @brief 阻止编译器把没有使用的结果优化掉
+ */
+void bench_escape(void *p);
+
+/**
+ * @brief 当前线程调用operator new的累计次数
+ */
+duint64 bench_allocs();
+
+#endif // BENCH_GLOBAL_HPP
@@ -0,0 +1,179 @@
+#include "bench_global.hpp"
+#include "kernel_global.hpp"
+#include "kernel_errno.hpp"
+#include "kernel_request.hpp"
+#include "flv_muxer.hpp"
+#include "lms_gop_cache.hpp"
+#include "lms_timestamp.hpp"
+#include "lms_config.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+// 消息环的大小，按25fps视频和43fps音频可以覆盖60秒，大于gop cache保留的时长
+#define BENCH_MESSAGES      4096
+
+static CommonMessage *ring_msgs[BENCH_MESSAGES];
+static dint64 message_seq = 0;
+
+static dint64 video_time = 0;
+static dint64 audio_time = 0;
+static dint64 video_frames = 0;
+
+/**
+ * @brief 从消息环中取下一个消息，按时间戳交错生成音视频。视频每40ms一帧、50帧一个关键帧，音频每23ms一帧
+ */
+static CommonMessage *next_message()
+{
+    CommonMessage *msg = ring_msgs[message_seq++ % BENCH_MESSAGES];
+
+    if (video_time <= audio_time) {
+        msg->type = CommonMessageVideo;
+        msg->keyframe = (video_frames++ % 50) == 0;
+        msg->payload_length = 8192;
+        msg->dts = video_time;
+        video_time += 40;
+    } else {
+        msg->type = CommonMessageAudio;
+        msg->keyframe = false;
+        msg->payload_length = 256;
+        msg->dts = audio_time;
+        audio_time += 23;
+    }
+
+    return msg;
+}
+
+static void init_messages()
+{
+    for (int i = 0; i < BENCH_MESSAGES; ++i) {
+        MemoryChunk *chunk = DMemPool::instance()->getMemory(8192);
+        memset(chunk->data, 0, 8192);
+        chunk->length = 8192;
+
+        ring_msgs[i] = new CommonMessage();
+        ring_msgs[i]->payload = DSharedPtr<MemoryChunk>(chunk);
+    }
+}
+
+static void free_messages()
+{
+    for (int i = 0; i < BENCH_MESSAGES; ++i) {
+        ring_msgs[i]->release();
+    }
+}
+
+static void flv_encode(dint64 n)
+{
+    flv_muxer muxer;
+
+    for (dint64 i = 0; i < n; ++i) {
+        std::list<DSharedPtr<MemoryChunk> > tags = muxer.encode(next_message());
+        bench_escape(&tags);
+    }
+}
+
+static void gop_add(dint64 n)
+{
+    lms_gop_cache *gop = new lms_gop_cache();
+
+    for (dint64 i = 0; i < n; ++i) {
+        gop->add(next_message());
+    }
+
+    DFree(gop);
+}
+
+static lms_gop_cache *dump_gop;
+
+static void gop_dump(dint64 n)
+{
+    std::deque<CommonMessage*> msgs;
+
+    for (dint64 i = 0; i < n; ++i) {
+        CommonMessage *metadata = NULL;
+        CommonMessage *video_sh = NULL;
+        CommonMessage *audio_sh = NULL;
+
+        dump_gop->dump(msgs, 0, metadata, video_sh, audio_sh);
+
+        for (int j = 0; j < (int)msgs.size(); ++j) {
+            msgs.at(j)->release();
+        }
+        msgs.clear();
+    }
+}
+
+static void timestamp_correct(int type, dint64 n)
+{
+    lms_timestamp jitter;
+    jitter.set_correct_type(type);
+
+    for (dint64 i = 0; i < n; ++i) {
+        dint64 dts = jitter.correct(next_message());
+        bench_escape(&dts);
+    }
+}
+
+static void timestamp_simple(dint64 n)
+{
+    timestamp_correct(LmsTimeStamp::simple, n);
+}
+
+static void timestamp_middle(dint64 n)
+{
+    timestamp_correct(LmsTimeStamp::middle, n);
+}
+
+static void timestamp_high(dint64 n)
+{
+    timestamp_correct(LmsTimeStamp::high, n);
+}
+
+static kernel_request config_req;
+
+static void config_get_server(dint64 n)
+{
+    lms_config *config = lms_config::instance();
+
+    for (dint64 i = 0; i < n; ++i) {
+        lms_server_config_struct *server = config->get_server(&config_req);
+        DFree(server);
+    }
+}
+
+void bench_lms()
+{
+    init_messages();
+
+    bench_run("flv/encode", flv_encode, 1000000);
+
+    bench_run("gop/add", gop_add, 1000000);
+
+    if (bench_matched("gop/dump")) {
+        dump_gop = new lms_gop_cache();
+        for (int i = 0; i < 1000; ++i) {
+            dump_gop->add(next_message());
+        }
+        bench_run("gop/dump", gop_dump, 20000);
+        DFree(dump_gop);
+    }
+
+    bench_run("timestamp/correct simple", timestamp_simple, 10000000);
+    bench_run("timestamp/correct middle", timestamp_middle, 10000000);
+    bench_run("timestamp/correct high", timestamp_high, 10000000);
+
+    if (bench_matched("config/get_server")) {
+        // 和lms一样从../conf/读取配置，需要在bin目录下运行
+        if (lms_config::instance()->parse_file() == ERROR_SUCCESS) {
+            config_req.vhost = "test.com";
+            config_req.app = "live";
+            config_req.stream = "123";
+            bench_run("config/get_server", config_get_server, 100000);
+        } else {
+            printf("%-40s skipped, load ../conf/lms.conf failed\n", "config/get_server");
+        }
+    }
+
+    free_messages();
+}
@@ -0,0 +1,282 @@
+#include "bench_global.hpp"
+#include "DTcpSocket.hpp"
+#include "DStream.hpp"
+#include "kernel_errno.hpp"
+#include "rtmp_chunk.hpp"
+#include "rtmp_packet.hpp"
+#include "rtmp_amf.hpp"
+
+#include <string.h>
+
+#define BENCH_CHUNK_SIZE    4096
+
+/**
+ * @brief 不关联fd的socket。写队列一直处于EAGAIN状态，由用例取走；读队列由用例直接填充
+ */
+class bench_socket : public DTcpSocket
+{
+public:
+    bench_socket()
+        : DTcpSocket(NULL)
+    {
+        m_write_eagain = true;
+    }
+
+    virtual ~bench_socket() {}
+
+public:
+    /**
+     * @brief 清空写队列，out不为NULL时把数据拷贝出来
+     */
+    void drain(DStream *out)
+    {
+        for (int i = 0; i < (int)m_write_chunks.size(); ++i) {
+            SendBuffer *buf = m_write_chunks.at(i);
+            if (out) {
+                out->writeBytes(buf->chunk->data + buf->pos, buf->len);
+            }
+            DFree(buf);
+        }
+        m_write_chunks.clear();
+        m_write_buffer_len = 0;
+    }
+
+    void feed(const char *data, int len)
+    {
+        MemoryChunk *chunk = DMemPool::instance()->getMemory(len);
+        memcpy(chunk->data, data, len);
+        chunk->length = len;
+
+        m_read_chunks.push_back(chunk);
+        m_read_buffer_length += len;
+    }
+
+protected:
+    virtual int onReadProcess() { return SOCKET_SUCCESS; }
+    virtual int onWriteProcess() { return SOCKET_SUCCESS; }
+    virtual void onErrorProcess() {}
+    virtual void onCloseProcess() {}
+    virtual void onReadTimeOutProcess() {}
+    virtual void onWriteTimeOutProcess() {}
+};
+
+static bench_socket *out_socket;
+static RtmpChunk *out_chunk;
+
+static RtmpMessage video_msg;
+static RtmpMessage audio_msg;
+
+static bench_socket *in_socket;
+static RtmpChunk *in_chunk;
+
+// 编码后的chunk数据，用于解析
+static DStream video_chunks;
+static DStream audio_chunks;
+
+static void init_av_message(RtmpMessage &msg, dint8 type, int cid, int size)
+{
+    MemoryChunk *chunk = DMemPool::instance()->getMemory(size);
+    memset(chunk->data, 0x17, size);
+    chunk->length = size;
+
+    msg.header.message_type = type;
+    msg.header.perfer_cid = cid;
+    msg.header.stream_id = 1;
+    msg.header.payload_length = size;
+    msg.payload = DSharedPtr<MemoryChunk>(chunk);
+}
+
+static void encode_message(RtmpMessage *msg, dint64 n)
+{
+    for (dint64 i = 0; i < n; ++i) {
+        msg->header.timestamp = i;
+        out_chunk->send_message(msg);
+        out_socket->drain(NULL);
+    }
+}
+
+static void encode_video(dint64 n)
+{
+    encode_message(&video_msg, n);
+}
+
+static void encode_audio(dint64 n)
+{
+    encode_message(&audio_msg, n);
+}
+
+/**
+ * @brief 和rtmp_server::read_chunk一样循环读chunk，直到得到完整的消息
+ */
+static void parse_message(DStream &chunks, dint64 n)
+{
+    for (dint64 i = 0; i < n; ++i) {
+        in_socket->feed(chunks.data(), chunks.size());
+
+        while (in_chunk->read_chunk() == ERROR_SUCCESS) {
+            if (in_chunk->entired()) {
+                RtmpMessage *msg = in_chunk->get_message();
+                bench_escape(msg);
+                DFree(msg);
+            }
+        }
+    }
+}
+
+static void parse_video(dint64 n)
+{
+    parse_message(video_chunks, n);
+}
+
+static void parse_audio(dint64 n)
+{
+    parse_message(audio_chunks, n);
+}
+
+static ConnectAppPacket *new_connect_packet()
+{
+    ConnectAppPacket *pkt = new ConnectAppPacket();
+    pkt->command_object.setValue("app", new AMF0String("live"));
+    pkt->command_object.setValue("flashVer", new AMF0String("WIN 12,0,0,41"));
+    pkt->command_object.setValue("swfUrl", new AMF0String("http://test.com/player.swf"));
+    pkt->command_object.setValue("tcUrl", new AMF0String("rtmp://test.com/live"));
+    pkt->command_object.setValue("fpad", new AMF0Boolean(false));
+    pkt->command_object.setValue("capabilities", new AMF0Number(239));
+    pkt->command_object.setValue("audioCodecs", new AMF0Number(3575));
+    pkt->command_object.setValue("videoCodecs", new AMF0Number(252));
+    pkt->command_object.setValue("videoFunction", new AMF0Number(1));
+    pkt->command_object.setValue("pageUrl", new AMF0String("http://test.com/index.html"));
+    pkt->command_object.setValue("objectEncoding", new AMF0Number(0));
+
+    return pkt;
+}
+
+static PlayPacket *new_play_packet()
+{
+    PlayPacket *pkt = new PlayPacket();
+    pkt->transaction_id = 4;
+    pkt->stream_name = "123?token=0123456789abcdef";
+
+    return pkt;
+}
+
+static DSharedPtr<MemoryChunk> connect_payload;
+static DSharedPtr<MemoryChunk> play_payload;
+
+static void amf_encode_connect(dint64 n)
+{
+    ConnectAppPacket *pkt = new_connect_packet();
+
+    for (dint64 i = 0; i < n; ++i) {
+        pkt->encode();
+        bench_escape(pkt->payload.get());
+    }
+
+    DFree(pkt);
+}
+
+static void amf_encode_play(dint64 n)
+{
+    PlayPacket *pkt = new_play_packet();
+
+    for (dint64 i = 0; i < n; ++i) {
+        pkt->encode();
+        bench_escape(pkt->payload.get());
+    }
+
+    DFree(pkt);
+}
+
+static void amf_decode_connect(dint64 n)
+{
+    for (dint64 i = 0; i < n; ++i) {
+        ConnectAppPacket pkt;
+        pkt.payload = connect_payload;
+        pkt.decode();
+        bench_escape(&pkt);
+    }
+}
+
+static void amf_decode_play(dint64 n)
+{
+    for (dint64 i = 0; i < n; ++i) {
+        PlayPacket pkt;
+        pkt.payload = play_payload;
+        pkt.decode();
+        bench_escape(&pkt);
+    }
+}
+
+/**
+ * @brief rtmp_server处理命令时使用的不分配内存的解码
+ */
+static void amf_reader_connect(dint64 n)
+{
+    AMF0Reader reader;
+    AMF0StringRef tc_url;
+
+    for (dint64 i = 0; i < n; ++i) {
+        reader.decode(connect_payload->data, connect_payload->length);
+        reader.findString("tcUrl", tc_url);
+        bench_escape(&tc_url);
+    }
+}
+
+static void amf_reader_play(dint64 n)
+{
+    AMF0Reader reader;
+    AMF0StringRef stream;
+
+    for (dint64 i = 0; i < n; ++i) {
+        reader.decode(play_payload->data, play_payload->length);
+        reader.findString(3, stream);
+        bench_escape(&stream);
+    }
+}
+
+void bench_rtmp()
+{
+    out_socket = new bench_socket();
+    out_chunk = new RtmpChunk(out_socket);
+    out_chunk->set_out_chunk_size(BENCH_CHUNK_SIZE);
+
+    in_socket = new bench_socket();
+    in_chunk = new RtmpChunk(in_socket);
+    in_chunk->set_in_chunk_size(BENCH_CHUNK_SIZE);
+
+    // 25fps、1Mbps左右的视频帧和一帧aac
+    init_av_message(video_msg, RTMP_MSG_VideoMessage, RTMP_CID_Video, 16 * 1024);
+    init_av_message(audio_msg, RTMP_MSG_AudioMessage, RTMP_CID_Audio, 256);
+
+    out_chunk->send_message(&video_msg);
+    out_socket->drain(&video_chunks);
+    out_chunk->send_message(&audio_msg);
+    out_socket->drain(&audio_chunks);
+
+    ConnectAppPacket *connect = new_connect_packet();
+    connect->encode();
+    connect_payload = connect->payload;
+    DFree(connect);
+
+    PlayPacket *play = new_play_packet();
+    play->encode();
+    play_payload = play->payload;
+    DFree(play);
+
+    bench_run("rtmp/encode_chunk video 16KB", encode_video, 200000);
+    bench_run("rtmp/encode_chunk audio 256B", encode_audio, 1000000);
+    bench_run("rtmp/read_chunk video 16KB", parse_video, 100000);
+    bench_run("rtmp/read_chunk audio 256B", parse_audio, 1000000);
+
+    bench_run("amf0/encode connect", amf_encode_connect, 50000);
+    bench_run("amf0/encode play", amf_encode_play, 1000000);
+    bench_run("amf0/decode connect", amf_decode_connect, 50000);
+    bench_run("amf0/decode play", amf_decode_play, 1000000);
+    bench_run("amf0/reader connect", amf_reader_connect, 1000000);
+    bench_run("amf0/reader play", amf_reader_play, 1000000);
+
+    DFree(in_chunk);
+    DFree(in_socket);
+    DFree(out_chunk);
+    DFree(out_socket);
+}
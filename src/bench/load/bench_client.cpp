@@ -0,0 +1,147 @@
+#include "bench_client.hpp"
+#include "bench_worker.hpp"
+#include "bench_stat.hpp"
+#include "bench_config.hpp"
+
+bench_client::bench_client(bench_worker *worker, const DString &stream)
+    : m_worker(worker)
+    , m_stream(stream)
+{
+
+}
+
+bench_client::~bench_client()
+{
+
+}
+
+bench_stat *bench_client::stat()
+{
+    return m_worker->stat();
+}
+
+bench_player::bench_player(bench_worker *worker, const DString &stream, int protocol)
+    : bench_client(worker, stream)
+    , m_protocol(protocol)
+    , m_start_time(0)
+    , m_join_time(0)
+    , m_stopped(false)
+    , m_first_dts(0)
+    , m_last_dts(0)
+    , m_stall_start(0)
+    , m_stall_played(0)
+    , m_stall_total(0)
+    , m_read_total(0)
+{
+
+}
+
+bench_player::~bench_player()
+{
+
+}
+
+void bench_player::tick(dint64 now)
+{
+    if (m_stopped || m_join_time == 0) {
+        return;
+    }
+
+    dint64 buffer = bench_config::instance()->buffer;
+    dint64 available = m_last_dts - m_first_dts;
+
+    if (m_stall_start > 0) {
+        if (available - m_stall_played >= buffer) {
+            stat()->stall_ms[m_protocol] += (now - m_stall_start) / 1000;
+            m_stall_total += now - m_stall_start;
+            m_stall_start = 0;
+        }
+        return;
+    }
+
+    dint64 played = (now - m_join_time - m_stall_total) / 1000 - buffer;
+    if (played > available) {
+        m_stall_start = now;
+        m_stall_played = played;
+        stat()->stalls[m_protocol]++;
+    }
+}
+
+void bench_player::start_play()
+{
+    m_start_time = bench_now();
+
+    stat()->started[m_protocol]++;
+    stat()->active[m_protocol]++;
+}
+
+void bench_player::stop_play(bool failed)
+{
+    if (m_stopped) {
+        return;
+    }
+    m_stopped = true;
+
+    stat()->active[m_protocol]--;
+
+    if (failed) {
+        stat()->failed[m_protocol]++;
+    }
+
+    if (m_stall_start > 0) {
+        stat()->stall_ms[m_protocol] += (bench_now() - m_stall_start) / 1000;
+        m_stall_start = 0;
+    }
+}
+
+void bench_player::on_video(dint64 dts, const char *data, int len)
+{
+    dint64 now = bench_now();
+
+    stat()->frames[m_protocol]++;
+
+    if (m_join_time == 0) {
+        m_join_time = now;
+        m_first_dts = dts;
+
+        stat()->joined[m_protocol]++;
+        stat()->join[m_protocol].observe((now - m_start_time) / 1000);
+    }
+
+    // 重连或者时间戳回退时不影响已收到的时长
+    if (dts > m_last_dts) {
+        m_last_dts = dts;
+    }
+
+    if (now - m_join_time < (dint64)bench_config::instance()->steady * 1000) {
+        return;
+    }
+
+    dint64 stamp = bench_stamp_read(data, len);
+    if (stamp > 0) {
+        stat()->latency[m_protocol].observe((now - stamp) / 1000);
+    }
+}
+
+void bench_player::add_bytes(duint64 size)
+{
+    stat()->bytes[m_protocol] += size;
+}
+
+void bench_player::update_bytes(duint64 total)
+{
+    if (total > m_read_total) {
+        add_bytes(total - m_read_total);
+        m_read_total = total;
+    }
+}
+
+bool bench_player::stopped()
+{
+    return m_stopped;
+}
+
+bool bench_player::joined()
+{
+    return m_join_time > 0;
+}
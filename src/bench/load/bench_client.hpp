@@ -0,0 +1,96 @@
+#ifndef BENCH_CLIENT_HPP
+#define BENCH_CLIENT_HPP
+
+#include "DGlobal.hpp"
+#include "DString.hpp"
+
+class bench_worker;
+struct bench_stat;
+
+/**
+ * @brief 推流端和播放端的基类，由所属的bench_worker创建，只在工作线程中使用
+ */
+class bench_client
+{
+public:
+    bench_client(bench_worker *worker, const DString &stream);
+    virtual ~bench_client();
+
+    /**
+     * @brief 发起连接，失败时自己释放
+     */
+    virtual void start() = 0;
+    /**
+     * @brief 工作线程的定时器每10毫秒调用一次
+     * @param now 单调时钟，单位微秒
+     */
+    virtual void tick(dint64 now) = 0;
+
+protected:
+    bench_stat *stat();
+
+protected:
+    bench_worker *m_worker;
+    DString m_stream;
+};
+
+/**
+ * @brief 播放端的统计逻辑，各协议收到视频帧时调用on_video
+ *
+ * 按播放器的方式模拟卡顿：收到第一个视频帧后缓冲buffer毫秒开始播放，
+ * 播放进度追上已收到数据的时长时开始卡顿，重新攒够buffer毫秒后恢复
+ */
+class bench_player : public bench_client
+{
+public:
+    bench_player(bench_worker *worker, const DString &stream, int protocol);
+    virtual ~bench_player();
+
+    virtual void tick(dint64 now);
+
+protected:
+    /**
+     * @brief 开始连接时调用，作为加入时间的起点
+     */
+    void start_play();
+    /**
+     * @brief 结束播放，failed为true时计为失败
+     */
+    void stop_play(bool failed);
+    /**
+     * @brief 收到一个视频帧，不包括sequence header
+     * @param dts 单位毫秒
+     */
+    void on_video(dint64 dts, const char *data, int len);
+
+    void add_bytes(duint64 size);
+    /**
+     * @brief 根据socket收到数据的总量累加
+     */
+    void update_bytes(duint64 total);
+
+    bool stopped();
+    bool joined();
+
+protected:
+    int m_protocol;
+
+private:
+    dint64 m_start_time;
+    dint64 m_join_time;
+    bool m_stopped;
+
+    dint64 m_first_dts;
+    dint64 m_last_dts;
+
+    // 当前卡顿开始的时间，0表示没有卡顿
+    dint64 m_stall_start;
+    // 卡顿开始时的播放进度，单位毫秒
+    dint64 m_stall_played;
+    // 累计卡顿时长，单位微秒
+    dint64 m_stall_total;
+
+    duint64 m_read_total;
+};
+
+#endif // BENCH_CLIENT_HPP
@@ -0,0 +1,55 @@
+#include "bench_config.hpp"
+
+static const char *protocol_names[BenchProtocol::count] = { "rtmp", "flv", "ts", "hls" };
+
+const char *bench_protocol_name(int protocol)
+{
+    if (protocol < 0 || protocol >= BenchProtocol::count) {
+        return "unknown";
+    }
+    return protocol_names[protocol];
+}
+
+bench_config *bench_config::m_instance = new bench_config;
+
+bench_config::bench_config()
+    : host("127.0.0.1")
+    , rtmp_port(1935)
+    , http_port(8080)
+    , vhost("test.com")
+    , app("live")
+    , stream("123")
+    , m3u8("/[app]/[stream]/playlist.m3u8")
+    , publishers(1)
+    , threads(1)
+    , duration(30)
+    , interval(5)
+    , ramp(0)
+    , play_delay(2000)
+    , buffer(1000)
+    , steady(5000)
+    , server_pid(0)
+{
+    for (int i = 0; i < BenchProtocol::count; ++i) {
+        players[i] = 0;
+    }
+}
+
+bench_config::~bench_config()
+{
+
+}
+
+bench_config *bench_config::instance()
+{
+    return m_instance;
+}
+
+DString bench_config::get_stream(int index)
+{
+    if (publishers <= 1) {
+        return stream;
+    }
+
+    return stream + "_" + DString::number(index);
+}
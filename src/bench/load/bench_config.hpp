@@ -0,0 +1,65 @@
+#ifndef BENCH_CONFIG_HPP
+#define BENCH_CONFIG_HPP
+
+#include "DString.hpp"
+
+namespace BenchProtocol {
+    enum Type { rtmp = 0, flv, ts, hls, count };
+}
+
+const char *bench_protocol_name(int protocol);
+
+/**
+ * @brief lms-bench的命令行参数，启动前设置，运行中只读
+ */
+class bench_config
+{
+public:
+    bench_config();
+    ~bench_config();
+
+    static bench_config *instance();
+
+    /**
+     * @brief 第index个推流使用的流名，只有一路推流时不加后缀
+     */
+    DString get_stream(int index);
+
+public:
+    DString host;
+    int rtmp_port;
+    int http_port;
+
+    DString vhost;
+    DString app;
+    DString stream;
+
+    // 循环推送的本地flv文件
+    DString file;
+    // hls播放列表的uri，[app]和[stream]会被替换
+    DString m3u8;
+
+    int publishers;
+    int players[BenchProtocol::count];
+
+    int threads;
+    // 运行时长、统计输出间隔、播放端在这段时间内均匀启动，单位秒
+    int duration;
+    int interval;
+    int ramp;
+    // 推流开始后等待多久再启动播放端，让服务器有gop缓存，单位毫秒
+    int play_delay;
+
+    // 播放端的缓冲时长，播放进度追上已收到的数据时计为一次卡顿，单位毫秒
+    int buffer;
+    // 加入后经过这段时间才统计延迟，跳过gop缓存带来的初始延迟，单位毫秒
+    int steady;
+
+    // 服务器进程号，大于0时统计服务器的cpu
+    int server_pid;
+
+private:
+    static bench_config *m_instance;
+};
+
+#endif // BENCH_CONFIG_HPP
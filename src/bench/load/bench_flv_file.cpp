@@ -0,0 +1,109 @@
+#include "bench_flv_file.hpp"
+#include "DFile.hpp"
+#include "kernel_codec.hpp"
+#include "kernel_log.hpp"
+
+#include <string.h>
+
+// flv header加上第一个previous tag size
+#define FLV_FILE_HEADER_SIZE    13
+#define FLV_TAG_HEADER_SIZE     11
+
+bench_flv_file::bench_flv_file()
+    : first_frame(0)
+    , duration(0)
+{
+
+}
+
+bench_flv_file::~bench_flv_file()
+{
+
+}
+
+bool bench_flv_file::load(const DString &path)
+{
+    DFile file(path);
+    if (!file.open("rb")) {
+        log_error("open flv file failed. file=%s", path.c_str());
+        return false;
+    }
+
+    DString data = file.readAll();
+    file.close();
+
+    const char *p = data.data();
+    const char *end = p + data.size();
+
+    if (end - p < FLV_FILE_HEADER_SIZE || memcmp(p, "FLV", 3) != 0) {
+        log_error("invalid flv file. file=%s", path.c_str());
+        return false;
+    }
+    p += FLV_FILE_HEADER_SIZE;
+
+    while (end - p >= FLV_TAG_HEADER_SIZE) {
+        const duint8 *h = (const duint8*)p;
+
+        duint8 type = h[0] & 0x1F;
+        int size = (h[1] << 16) | (h[2] << 8) | h[3];
+        dint64 dts = (h[4] << 16) | (h[5] << 8) | h[6] | ((dint64)h[7] << 24);
+
+        if (end - p < FLV_TAG_HEADER_SIZE + size + 4) {
+            break;
+        }
+        p += FLV_TAG_HEADER_SIZE;
+
+        if ((type == CommonMessageAudio || type == CommonMessageVideo || type == CommonMessageMetadata) && size > 0) {
+            MemoryChunk *chunk = DMemPool::instance()->getMemory(size);
+            memcpy(chunk->data, p, size);
+            chunk->length = size;
+
+            bench_flv_tag tag;
+            tag.type = type;
+            tag.dts = dts;
+            tag.payload = DSharedPtr<MemoryChunk>(chunk);
+
+            if (type == CommonMessageVideo) {
+                tag.sequence_header = kernel_codec::video_is_sequence_header(chunk->data, size);
+            } else if (type == CommonMessageAudio) {
+                tag.sequence_header = kernel_codec::audio_is_aac(chunk->data, size)
+                        && kernel_codec::audio_is_sequence_header(chunk->data, size);
+            } else {
+                tag.sequence_header = true;
+            }
+
+            tags.push_back(tag);
+        }
+
+        p += size + 4;
+    }
+
+    first_frame = 0;
+    while (first_frame < (int)tags.size() && tags.at(first_frame).sequence_header) {
+        first_frame++;
+    }
+
+    if (first_frame >= (int)tags.size()) {
+        log_error("flv file has no audio/video frame. file=%s", path.c_str());
+        return false;
+    }
+
+    // 用最后两个视频帧的间隔作为循环时的间隔，没有时按25fps
+    dint64 last = tags.back().dts;
+    dint64 gap = 40;
+    dint64 prev_video = -1;
+    for (int i = first_frame; i < (int)tags.size(); ++i) {
+        bench_flv_tag &tag = tags.at(i);
+        if (tag.type != CommonMessageVideo) {
+            continue;
+        }
+        if (prev_video >= 0 && tag.dts > prev_video) {
+            gap = tag.dts - prev_video;
+        }
+        prev_video = tag.dts;
+    }
+
+    duration = last - tags.at(first_frame).dts + gap;
+
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef BENCH_FLV_FILE_HPP
+#define BENCH_FLV_FILE_HPP
+
+#include "kernel_global.hpp"
+#include "DString.hpp"
+
+#include <vector>
+
+struct bench_flv_tag
+{
+    duint8 type;
+    dint64 dts;
+    bool sequence_header;
+    DSharedPtr<MemoryChunk> payload;
+};
+
+/**
+ * @brief 把整个flv文件读到内存中，所有推流端共享，加载后只读
+ */
+class bench_flv_file
+{
+public:
+    bench_flv_file();
+    ~bench_flv_file();
+
+    bool load(const DString &path);
+
+public:
+    std::vector<bench_flv_tag> tags;
+    // 第一个音视频帧的位置，之前是metadata和sequence header，循环时从这里重新开始
+    int first_frame;
+    // 从第一个音视频帧到最后一帧的时长，加上一个视频帧间隔，单位毫秒
+    dint64 duration;
+};
+
+#endif // BENCH_FLV_FILE_HPP
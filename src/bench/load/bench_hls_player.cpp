@@ -0,0 +1,369 @@
+#include "bench_hls_player.hpp"
+#include "bench_worker.hpp"
+#include "bench_config.hpp"
+#include "kernel_errno.hpp"
+#include "kernel_log.hpp"
+#include "DHttpHeader.hpp"
+#include "DStringList.hpp"
+
+#include <string.h>
+
+#define BENCH_HLS_TIMEOUT           (10 * 1000 * 1000)
+// m3u8的刷新间隔，单位微秒
+#define BENCH_HLS_PLAYLIST_INTERVAL (500 * 1000)
+#define BENCH_HLS_TS_PACKET         188
+
+bench_hls_fetch::bench_hls_fetch(bench_hls_player *parent, DEvent *event, const DString &uri)
+    : DTcpSocket(event)
+    , m_parent(parent)
+    , m_uri(uri)
+    , m_started(false)
+    , m_status(0)
+    , m_content_length(-1)
+    , m_read_total(0)
+{
+    m_reader = new http_reader(this, false, HTTP_HEADER_CALLBACK(&bench_hls_fetch::onHttpParser));
+
+    setWriteTimeOut(BENCH_HLS_TIMEOUT);
+    setReadTimeOut(BENCH_HLS_TIMEOUT);
+}
+
+bench_hls_fetch::~bench_hls_fetch()
+{
+    DFree(m_reader);
+}
+
+void bench_hls_fetch::start()
+{
+    int ret = ERROR_SUCCESS;
+
+    bench_config *config = bench_config::instance();
+
+    if ((ret = connectToHost(config->host.c_str(), config->http_port)) != ERROR_SUCCESS) {
+        if (ret != SOCKET_EINPROGRESS) {
+            log_error("bench hls fetch connect failed. host=%s, port=%d, ret=%d", config->host.c_str(), config->http_port, ret);
+            finish(false);
+        }
+    }
+}
+
+void bench_hls_fetch::detach()
+{
+    m_parent = NULL;
+    close();
+}
+
+int bench_hls_fetch::onReadProcess()
+{
+    int ret = ERROR_SUCCESS;
+
+    if ((ret = m_reader->service()) != ERROR_SUCCESS) {
+        if (ret != SOCKET_EAGAIN) {
+            log_error("bench hls fetch read http response failed. uri=%s, ret=%d", m_uri.c_str(), ret);
+            return ret;
+        }
+    }
+
+    duint64 total = getTotalReadSize();
+    if (m_parent) {
+        m_parent->on_fetch_bytes(total - m_read_total);
+    }
+    m_read_total = total;
+
+    if (m_status == 0) {
+        return ERROR_SUCCESS;
+    }
+
+    while (!m_reader->empty()) {
+        int len = m_reader->getLength();
+        int pos = m_body.size();
+
+        m_body.resize(pos + len);
+        if ((ret = m_reader->readBody(&m_body[pos], len)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+
+    if (m_content_length >= 0 && m_body.size() >= m_content_length) {
+        finish(m_status == 200);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+int bench_hls_fetch::onWriteProcess()
+{
+    int ret = ERROR_SUCCESS;
+
+    if (m_started) {
+        return ret;
+    }
+    m_started = true;
+
+    setWriteTimeOut(-1);
+
+    bench_config *config = bench_config::instance();
+
+    DHttpHeader header;
+
+    // 服务器在Connection: close时发完就关闭，和关闭一起收到的数据不会回调onReadProcess
+    header.setConnectionKeepAlive();
+    header.setHost(config->vhost + ":" + DString::number(config->http_port));
+    header.addValue("Accept", "*/*");
+
+    DString str = header.getRequestString("GET", m_uri);
+
+    MemoryChunk *chunk = DMemPool::instance()->getMemory(str.size());
+    DSharedPtr<MemoryChunk> h = DSharedPtr<MemoryChunk>(chunk);
+
+    memcpy(h->data, str.data(), str.size());
+    h->length = str.size();
+
+    if ((ret = write(h, h->length)) != ERROR_SUCCESS) {
+        if (ret != SOCKET_EAGAIN) {
+            return ERROR_HTTP_SEND_REQUEST_HEADER;
+        }
+    }
+
+    return ERROR_SUCCESS;
+}
+
+void bench_hls_fetch::onReadTimeOutProcess()
+{
+    log_error("bench hls fetch read timeout. uri=%s", m_uri.c_str());
+    finish(false);
+}
+
+void bench_hls_fetch::onWriteTimeOutProcess()
+{
+    log_error("bench hls fetch write timeout. uri=%s", m_uri.c_str());
+    finish(false);
+}
+
+void bench_hls_fetch::onErrorProcess()
+{
+    finish(false);
+}
+
+void bench_hls_fetch::onCloseProcess()
+{
+    // 处理和关闭一起收到的数据，没有Content-Length时以连接关闭作为结束
+    if (onReadProcess() != ERROR_SUCCESS) {
+        finish(false);
+        return;
+    }
+
+    finish(m_status == 200 && m_content_length < 0);
+}
+
+int bench_hls_fetch::onHttpParser(DHttpParser *parser)
+{
+    m_status = parser->statusCode();
+
+    DStringRef length = parser->field(DHttpHeaderContentLength);
+    if (!length.isEmpty()) {
+        m_content_length = length.toString().toInt();
+    }
+
+    return ERROR_SUCCESS;
+}
+
+void bench_hls_fetch::finish(bool success)
+{
+    if (m_parent) {
+        bench_hls_player *parent = m_parent;
+        m_parent = NULL;
+
+        parent->on_fetch_done(this, success, m_body);
+    }
+
+    close();
+}
+
+bench_hls_player::bench_hls_player(bench_worker *worker, const DString &stream)
+    : bench_player(worker, stream, BenchProtocol::hls)
+    , m_fetch(NULL)
+    , m_fetch_playlist(false)
+    , m_sequence(-1)
+    , m_next_playlist(0)
+    , m_join_deadline(0)
+{
+    bench_config *config = bench_config::instance();
+
+    m_m3u8 = config->m3u8;
+    m_m3u8.replace("[app]", config->app);
+    m_m3u8.replace("[stream]", m_stream);
+
+    m_m3u8_dir = m_m3u8.substr(0, m_m3u8.rfind('/') + 1);
+
+    m_demuxer = GetCodecTsDemuxer();
+    m_demuxer->initialize(BENCH_HLS_TS_PACKET);
+    m_demuxer->setHandler(TS_DEMUXER_CALLBACK(&bench_hls_player::onPacket));
+}
+
+bench_hls_player::~bench_hls_player()
+{
+    DFree(m_demuxer);
+}
+
+void bench_hls_player::start()
+{
+    start_play();
+
+    m_join_deadline = bench_now() + BENCH_HLS_TIMEOUT;
+}
+
+void bench_hls_player::tick(dint64 now)
+{
+    bench_player::tick(now);
+
+    if (!joined() && now > m_join_deadline) {
+        log_error("bench hls player join timeout. m3u8=%s", m_m3u8.c_str());
+        release(true);
+        return;
+    }
+
+    if (m_fetch) {
+        return;
+    }
+
+    if (!m_segments.empty()) {
+        DString uri = m_segments.front();
+        m_segments.pop_front();
+
+        m_fetch_playlist = false;
+        fetch(uri);
+        return;
+    }
+
+    if (now >= m_next_playlist) {
+        m_next_playlist = now + BENCH_HLS_PLAYLIST_INTERVAL;
+
+        m_fetch_playlist = true;
+        fetch(m_m3u8);
+    }
+}
+
+void bench_hls_player::on_fetch_done(bench_hls_fetch *fetch, bool success, const DString &body)
+{
+    if (fetch != m_fetch) {
+        return;
+    }
+    m_fetch = NULL;
+
+    // m3u8还没有生成或者分片已经过期，等下次刷新
+    if (!success) {
+        return;
+    }
+
+    if (m_fetch_playlist) {
+        parse_playlist(body);
+    } else {
+        demux_segment(body);
+    }
+}
+
+void bench_hls_player::on_fetch_bytes(duint64 size)
+{
+    add_bytes(size);
+}
+
+void bench_hls_player::fetch(const DString &uri)
+{
+    m_fetch = new bench_hls_fetch(this, m_worker->event(), uri);
+    m_fetch->start();
+}
+
+void bench_hls_player::parse_playlist(const DString &body)
+{
+    dint64 sequence = 0;
+    std::vector<DString> uris;
+
+    DStringList lines = DString(body).split("\n");
+    for (int i = 0; i < (int)lines.size(); ++i) {
+        DString line = lines.at(i).trimmed();
+
+        if (line.startWith("#EXT-X-MEDIA-SEQUENCE:")) {
+            sequence = DString(line.substr(strlen("#EXT-X-MEDIA-SEQUENCE:"))).toInt64();
+            continue;
+        }
+
+        if (line.isEmpty() || line.startWith("#")) {
+            continue;
+        }
+
+        if (line.startWith("http://")) {
+            size_t pos = line.find('/', strlen("http://"));
+            uris.push_back(pos == DString::npos ? DString("/") : DString(line.substr(pos)));
+        } else if (line.startWith("/")) {
+            uris.push_back(line);
+        } else {
+            uris.push_back(m_m3u8_dir + line);
+        }
+    }
+
+    if (uris.empty()) {
+        return;
+    }
+
+    // 重新推流后序号从头开始
+    if (m_sequence >= 0 && sequence + (dint64)uris.size() < m_sequence) {
+        m_sequence = -1;
+    }
+
+    // 第一次从最新的分片开始，和播放器的行为一致
+    if (m_sequence < 0) {
+        m_sequence = sequence + (dint64)uris.size() - 1;
+    }
+
+    for (int i = 0; i < (int)uris.size(); ++i) {
+        if (sequence + i >= m_sequence) {
+            m_segments.push_back(uris.at(i));
+        }
+    }
+
+    m_sequence = DMax(m_sequence, sequence + (dint64)uris.size());
+}
+
+void bench_hls_player::demux_segment(const DString &body)
+{
+    const char *p = body.data();
+    int left = body.size();
+
+    while (left >= BENCH_HLS_TS_PACKET) {
+        if ((duint8)p[0] != 0x47) {
+            p++;
+            left--;
+            continue;
+        }
+
+        if (m_demuxer->demuxer((char*)p) != 0) {
+            log_error("bench hls player demux ts failed. m3u8=%s", m_m3u8.c_str());
+            return;
+        }
+
+        p += BENCH_HLS_TS_PACKET;
+        left -= BENCH_HLS_TS_PACKET;
+    }
+}
+
+int bench_hls_player::onPacket(TsDemuxerPacket pkt)
+{
+    if (pkt.type == LibCodecStreamType::Video && !pkt.sequence_header) {
+        on_video(pkt.dts, (const char*)pkt.buf, pkt.len);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+void bench_hls_player::release(bool failed)
+{
+    stop_play(failed);
+
+    if (m_fetch) {
+        m_fetch->detach();
+        m_fetch = NULL;
+    }
+
+    m_worker->release(this);
+}
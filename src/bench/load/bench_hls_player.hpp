@@ -0,0 +1,99 @@
+#ifndef BENCH_HLS_PLAYER_HPP
+#define BENCH_HLS_PLAYER_HPP
+
+#include "DTcpSocket.hpp"
+#include "http_reader.hpp"
+#include "codec.h"
+#include "bench_client.hpp"
+
+#include <deque>
+
+class bench_hls_player;
+
+/**
+ * @brief 下载一个m3u8或ts文件，每次使用新的短连接，完成后交给bench_hls_player
+ */
+class bench_hls_fetch : public DTcpSocket
+{
+public:
+    bench_hls_fetch(bench_hls_player *parent, DEvent *event, const DString &uri);
+    virtual ~bench_hls_fetch();
+
+    void start();
+    /**
+     * @brief 播放端结束时调用，之后不再回调播放端
+     */
+    void detach();
+
+public:
+    virtual int onReadProcess();
+    virtual int onWriteProcess();
+    virtual void onReadTimeOutProcess();
+    virtual void onWriteTimeOutProcess();
+    virtual void onErrorProcess();
+    virtual void onCloseProcess();
+
+private:
+    int onHttpParser(DHttpParser *parser);
+
+    void finish(bool success);
+
+private:
+    bench_hls_player *m_parent;
+    http_reader *m_reader;
+    DString m_uri;
+
+    bool m_started;
+    duint16 m_status;
+    // 没有Content-Length时为-1，连接关闭时结束
+    int m_content_length;
+    DString m_body;
+    duint64 m_read_total;
+};
+
+/**
+ * @brief 定时下载m3u8，从最新的分片开始按顺序下载ts并解复用，同时只有一个请求
+ */
+class bench_hls_player : public bench_player
+{
+public:
+    bench_hls_player(bench_worker *worker, const DString &stream);
+    virtual ~bench_hls_player();
+
+    virtual void start();
+    virtual void tick(dint64 now);
+
+    void on_fetch_done(bench_hls_fetch *fetch, bool success, const DString &body);
+    void on_fetch_bytes(duint64 size);
+
+private:
+    void fetch(const DString &uri);
+
+    void parse_playlist(const DString &body);
+    void demux_segment(const DString &body);
+
+    int onPacket(TsDemuxerPacket pkt);
+
+    void release(bool failed);
+
+private:
+    DString m_m3u8;
+    // m3u8所在的目录，以'/'结尾，用于拼接相对路径的分片
+    DString m_m3u8_dir;
+
+    bench_hls_fetch *m_fetch;
+    bool m_fetch_playlist;
+
+    CodecTsDemuxer *m_demuxer;
+
+    // 下一个要下载的分片序号，-1表示还没有收到m3u8
+    dint64 m_sequence;
+    std::deque<DString> m_segments;
+
+    // 下次下载m3u8的时间，单位微秒
+    dint64 m_next_playlist;
+    // 在这个时间之前还没有收到视频帧时计为失败，单位微秒
+    dint64 m_join_deadline;
+};
+
+#endif // BENCH_HLS_PLAYER_HPP
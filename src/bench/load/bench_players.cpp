@@ -0,0 +1,292 @@
+#include "bench_players.hpp"
+#include "bench_worker.hpp"
+#include "bench_config.hpp"
+#include "kernel_codec.hpp"
+#include "kernel_errno.hpp"
+#include "kernel_log.hpp"
+#include "DHttpHeader.hpp"
+
+#include <string.h>
+
+#define BENCH_PLAY_TIMEOUT      (10 * 1000 * 1000)
+
+bench_socket_player::bench_socket_player(bench_worker *worker, const DString &stream, int protocol)
+    : DTcpSocket(worker->event())
+    , bench_player(worker, stream, protocol)
+    , m_started(false)
+{
+    setWriteTimeOut(BENCH_PLAY_TIMEOUT);
+    setReadTimeOut(BENCH_PLAY_TIMEOUT);
+}
+
+bench_socket_player::~bench_socket_player()
+{
+
+}
+
+void bench_socket_player::start()
+{
+    int ret = ERROR_SUCCESS;
+
+    bench_config *config = bench_config::instance();
+    int port = (m_protocol == BenchProtocol::rtmp) ? config->rtmp_port : config->http_port;
+
+    start_play();
+
+    if ((ret = connectToHost(config->host.c_str(), port)) != ERROR_SUCCESS) {
+        if (ret != SOCKET_EINPROGRESS) {
+            ret = ERROR_TCP_SOCKET_CONNECT;
+            log_error("bench %s player connect failed. host=%s, port=%d, ret=%d",
+                      bench_protocol_name(m_protocol), config->host.c_str(), port, ret);
+            release(true);
+        }
+    }
+}
+
+void bench_socket_player::release(bool failed)
+{
+    stop_play(failed);
+
+    m_worker->remove(this);
+
+    close();
+}
+
+int bench_socket_player::onReadProcess()
+{
+    int ret = do_read();
+
+    update_bytes(getTotalReadSize());
+
+    return ret;
+}
+
+int bench_socket_player::onWriteProcess()
+{
+    if (m_started) {
+        return ERROR_SUCCESS;
+    }
+    m_started = true;
+
+    setWriteTimeOut(-1);
+
+    return do_start();
+}
+
+void bench_socket_player::onReadTimeOutProcess()
+{
+    log_error("bench %s player read timeout", bench_protocol_name(m_protocol));
+    release(true);
+}
+
+void bench_socket_player::onWriteTimeOutProcess()
+{
+    log_error("bench %s player write timeout", bench_protocol_name(m_protocol));
+    release(true);
+}
+
+void bench_socket_player::onErrorProcess()
+{
+    log_error("bench %s player socket error", bench_protocol_name(m_protocol));
+    release(true);
+}
+
+void bench_socket_player::onCloseProcess()
+{
+    log_error("bench %s player socket closed", bench_protocol_name(m_protocol));
+    release(true);
+}
+
+bench_rtmp_player::bench_rtmp_player(bench_worker *worker, const DString &stream)
+    : bench_socket_player(worker, stream, BenchProtocol::rtmp)
+{
+    m_rtmp = new rtmp_client(this);
+    m_rtmp->set_av_handler(Rtmp_AV_Handler_Callback(&bench_rtmp_player::onMessage));
+}
+
+bench_rtmp_player::~bench_rtmp_player()
+{
+    DFree(m_rtmp);
+}
+
+int bench_rtmp_player::do_start()
+{
+    bench_config *config = bench_config::instance();
+
+    m_req.vhost = config->vhost;
+    m_req.app = config->app;
+    m_req.stream = m_stream;
+    m_req.tcUrl = "rtmp://" + config->vhost + ":" + DString::number(config->rtmp_port) + "/" + config->app;
+
+    return m_rtmp->start_rtmp(false, &m_req);
+}
+
+int bench_rtmp_player::do_read()
+{
+    int ret = ERROR_SUCCESS;
+
+    if ((ret = m_rtmp->service()) != ERROR_SUCCESS) {
+        log_error_eagain(ret, ret, "bench rtmp player rtmp protocol failed. ret=%d", ret);
+        return ret;
+    }
+
+    return ret;
+}
+
+int bench_rtmp_player::onMessage(RtmpMessage *msg)
+{
+    if (!msg->is_video()) {
+        return ERROR_SUCCESS;
+    }
+
+    char *data = msg->payload->data;
+    int len = msg->payload->length;
+
+    if (!kernel_codec::video_is_sequence_header(data, len)) {
+        on_video(msg->header.timestamp, data, len);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+bench_http_player::bench_http_player(bench_worker *worker, const DString &stream, int protocol, const DString &suffix)
+    : bench_socket_player(worker, stream, protocol)
+    , m_suffix(suffix)
+    , m_response(false)
+{
+    m_reader = new http_reader(this, false, HTTP_HEADER_CALLBACK(&bench_http_player::onHttpParser));
+}
+
+bench_http_player::~bench_http_player()
+{
+    DFree(m_reader);
+}
+
+int bench_http_player::do_start()
+{
+    int ret = ERROR_SUCCESS;
+
+    bench_config *config = bench_config::instance();
+
+    DHttpHeader header;
+
+    header.setConnectionKeepAlive();
+    header.setHost(config->vhost + ":" + DString::number(config->http_port));
+    header.addValue("Accept", "*/*");
+
+    DString uri = "/" + config->app + "/" + m_stream + m_suffix + "?type=live";
+    DString str = header.getRequestString("GET", uri);
+
+    MemoryChunk *chunk = DMemPool::instance()->getMemory(str.size());
+    DSharedPtr<MemoryChunk> h = DSharedPtr<MemoryChunk>(chunk);
+
+    memcpy(h->data, str.data(), str.size());
+    h->length = str.size();
+
+    if ((ret = write(h, h->length)) != ERROR_SUCCESS) {
+        if (ret != SOCKET_EAGAIN) {
+            return ERROR_HTTP_SEND_REQUEST_HEADER;
+        }
+    }
+
+    return ERROR_SUCCESS;
+}
+
+int bench_http_player::do_read()
+{
+    int ret = ERROR_SUCCESS;
+
+    if ((ret = m_reader->service()) != ERROR_SUCCESS) {
+        if (ret != SOCKET_EAGAIN) {
+            log_error("bench %s player read http response failed. ret=%d", bench_protocol_name(m_protocol), ret);
+            return ret;
+        }
+    }
+
+    if (m_response) {
+        return read_body();
+    }
+
+    return ret;
+}
+
+int bench_http_player::onHttpParser(DHttpParser *parser)
+{
+    int ret = ERROR_SUCCESS;
+
+    duint16 status_code = parser->statusCode();
+
+    if (status_code != 200) {
+        ret = (m_protocol == BenchProtocol::flv) ? ERROR_HTTP_FLV_PULL_REJECTED : ERROR_HTTP_TS_PULL_REJECTED;
+        log_error("bench %s player rejected. status_code=%d, ret=%d", bench_protocol_name(m_protocol), status_code, ret);
+        return ret;
+    }
+
+    m_response = true;
+    on_response();
+
+    return ret;
+}
+
+bench_flv_player::bench_flv_player(bench_worker *worker, const DString &stream)
+    : bench_http_player(worker, stream, BenchProtocol::flv, ".flv")
+    , m_flv_reader(NULL)
+{
+
+}
+
+bench_flv_player::~bench_flv_player()
+{
+    DFree(m_flv_reader);
+}
+
+void bench_flv_player::on_response()
+{
+    m_flv_reader = new http_flv_reader(m_reader, AV_Handler_Callback(&bench_flv_player::onMessage));
+}
+
+int bench_flv_player::read_body()
+{
+    return m_flv_reader->service();
+}
+
+int bench_flv_player::onMessage(CommonMessage *msg)
+{
+    if (msg->is_video() && !msg->is_sequence_header()) {
+        on_video(msg->dts, msg->payload->data, msg->payload_length);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+bench_ts_player::bench_ts_player(bench_worker *worker, const DString &stream)
+    : bench_http_player(worker, stream, BenchProtocol::ts, ".ts")
+    , m_demuxer(NULL)
+{
+
+}
+
+bench_ts_player::~bench_ts_player()
+{
+    DFree(m_demuxer);
+}
+
+void bench_ts_player::on_response()
+{
+    m_demuxer = new lms_http_ts_demuxer(m_reader);
+    m_demuxer->initialize(188, TS_DEMUXER_CALLBACK(&bench_ts_player::onPacket));
+}
+
+int bench_ts_player::read_body()
+{
+    return m_demuxer->service();
+}
+
+int bench_ts_player::onPacket(TsDemuxerPacket pkt)
+{
+    if (pkt.type == LibCodecStreamType::Video && !pkt.sequence_header) {
+        on_video(pkt.dts, (const char*)pkt.buf, pkt.len);
+    }
+
+    return ERROR_SUCCESS;
+}
@@ -0,0 +1,127 @@
+#ifndef BENCH_PLAYERS_HPP
+#define BENCH_PLAYERS_HPP
+
+#include "DTcpSocket.hpp"
+#include "kernel_global.hpp"
+#include "kernel_request.hpp"
+#include "rtmp_client.hpp"
+#include "http_reader.hpp"
+#include "http_flv_reader.hpp"
+#include "lms_http_ts_demuxer.hpp"
+#include "bench_client.hpp"
+
+/**
+ * @brief 基于单个tcp连接的播放端，处理连接、超时和释放
+ */
+class bench_socket_player : public DTcpSocket, public bench_player
+{
+public:
+    bench_socket_player(bench_worker *worker, const DString &stream, int protocol);
+    virtual ~bench_socket_player();
+
+    virtual void start();
+
+    void release(bool failed);
+
+public:
+    virtual int onReadProcess();
+    virtual int onWriteProcess();
+    virtual void onReadTimeOutProcess();
+    virtual void onWriteTimeOutProcess();
+    virtual void onErrorProcess();
+    virtual void onCloseProcess();
+
+protected:
+    /**
+     * @brief 连接成功后调用一次，发送请求
+     */
+    virtual int do_start() = 0;
+    virtual int do_read() = 0;
+
+private:
+    bool m_started;
+};
+
+class bench_rtmp_player : public bench_socket_player
+{
+public:
+    bench_rtmp_player(bench_worker *worker, const DString &stream);
+    virtual ~bench_rtmp_player();
+
+protected:
+    virtual int do_start();
+    virtual int do_read();
+
+private:
+    int onMessage(RtmpMessage *msg);
+
+private:
+    rtmp_client *m_rtmp;
+    kernel_request m_req;
+};
+
+/**
+ * @brief http请求的公共部分，flv和ts只在uri和body的解析上不同
+ */
+class bench_http_player : public bench_socket_player
+{
+public:
+    bench_http_player(bench_worker *worker, const DString &stream, int protocol, const DString &suffix);
+    virtual ~bench_http_player();
+
+protected:
+    virtual int do_start();
+    virtual int do_read();
+
+    /**
+     * @brief 收到200响应后创建body的解析器
+     */
+    virtual void on_response() = 0;
+    virtual int read_body() = 0;
+
+private:
+    int onHttpParser(DHttpParser *parser);
+
+protected:
+    http_reader *m_reader;
+
+private:
+    DString m_suffix;
+    bool m_response;
+};
+
+class bench_flv_player : public bench_http_player
+{
+public:
+    bench_flv_player(bench_worker *worker, const DString &stream);
+    virtual ~bench_flv_player();
+
+protected:
+    virtual void on_response();
+    virtual int read_body();
+
+private:
+    int onMessage(CommonMessage *msg);
+
+private:
+    http_flv_reader *m_flv_reader;
+};
+
+class bench_ts_player : public bench_http_player
+{
+public:
+    bench_ts_player(bench_worker *worker, const DString &stream);
+    virtual ~bench_ts_player();
+
+protected:
+    virtual void on_response();
+    virtual int read_body();
+
+private:
+    int onPacket(TsDemuxerPacket pkt);
+
+private:
+    lms_http_ts_demuxer *m_demuxer;
+};
+
+#endif // BENCH_PLAYERS_HPP
@@ -0,0 +1,217 @@
+#include "bench_publisher.hpp"
+#include "bench_worker.hpp"
+#include "bench_flv_file.hpp"
+#include "bench_config.hpp"
+#include "kernel_errno.hpp"
+#include "kernel_log.hpp"
+
+#include <string.h>
+
+#define BENCH_PUBLISH_CHUNK_SIZE    4096
+#define BENCH_PUBLISH_TIMEOUT       (10 * 1000 * 1000)
+
+bench_publisher::bench_publisher(bench_worker *worker, const DString &stream)
+    : DTcpSocket(worker->event())
+    , bench_client(worker, stream)
+    , m_started(false)
+    , m_publishing(false)
+    , m_released(false)
+    , m_publish_time(0)
+    , m_index(0)
+    , m_base(0)
+    , m_write_total(0)
+{
+    m_rtmp = new rtmp_client(this);
+    m_rtmp->set_publish_start_handler(Rtmp_Verify_Handler_Callback(&bench_publisher::onPublishStart));
+    m_rtmp->set_chunk_size(BENCH_PUBLISH_CHUNK_SIZE);
+
+    setWriteTimeOut(BENCH_PUBLISH_TIMEOUT);
+    setReadTimeOut(BENCH_PUBLISH_TIMEOUT);
+}
+
+bench_publisher::~bench_publisher()
+{
+    DFree(m_rtmp);
+}
+
+void bench_publisher::start()
+{
+    int ret = ERROR_SUCCESS;
+
+    bench_config *config = bench_config::instance();
+
+    m_req.vhost = config->vhost;
+    m_req.app = config->app;
+    m_req.stream = m_stream;
+    m_req.tcUrl = "rtmp://" + config->vhost + ":" + DString::number(config->rtmp_port) + "/" + config->app;
+
+    stat()->publishers++;
+
+    if ((ret = connectToHost(config->host.c_str(), config->rtmp_port)) != ERROR_SUCCESS) {
+        if (ret != SOCKET_EINPROGRESS) {
+            ret = ERROR_TCP_SOCKET_CONNECT;
+            log_error("bench publisher connect failed. host=%s, port=%d, ret=%d", config->host.c_str(), config->rtmp_port, ret);
+            release(true);
+        }
+    }
+}
+
+void bench_publisher::tick(dint64 now)
+{
+    int ret = ERROR_SUCCESS;
+
+    if (!m_publishing) {
+        return;
+    }
+
+    bench_flv_file *file = m_worker->file();
+    dint64 first_dts = file->tags.at(file->first_frame).dts;
+    dint64 elapsed = (now - m_publish_time) / 1000;
+
+    while (true) {
+        bench_flv_tag &tag = file->tags.at(m_index);
+        dint64 dts = tag.dts - first_dts + m_base;
+
+        if (dts > elapsed) {
+            break;
+        }
+
+        if ((ret = send_tag(tag, dts, true)) != ERROR_SUCCESS && ret != SOCKET_EAGAIN) {
+            release(true);
+            return;
+        }
+
+        if (++m_index >= (int)file->tags.size()) {
+            m_index = file->first_frame;
+            m_base += file->duration;
+            stat()->publish_loops++;
+        }
+    }
+
+    duint64 total = getTotalWriteSize();
+    stat()->publish_bytes += total - m_write_total;
+    m_write_total = total;
+}
+
+void bench_publisher::release(bool failed)
+{
+    if (m_released) {
+        return;
+    }
+    m_released = true;
+
+    if (m_publishing) {
+        stat()->publishing--;
+        m_publishing = false;
+    }
+
+    if (failed) {
+        stat()->publish_failed++;
+    }
+
+    m_worker->remove(this);
+
+    close();
+}
+
+int bench_publisher::onReadProcess()
+{
+    int ret = ERROR_SUCCESS;
+
+    if ((ret = m_rtmp->service()) != ERROR_SUCCESS) {
+        log_error_eagain(ret, ret, "bench publisher rtmp protocol failed. ret=%d", ret);
+        return ret;
+    }
+
+    return ret;
+}
+
+int bench_publisher::onWriteProcess()
+{
+    if (m_started) {
+        return ERROR_SUCCESS;
+    }
+    m_started = true;
+
+    return m_rtmp->start_rtmp(true, &m_req);
+}
+
+void bench_publisher::onReadTimeOutProcess()
+{
+    log_error("bench publisher read timeout");
+    release(true);
+}
+
+void bench_publisher::onWriteTimeOutProcess()
+{
+    log_error("bench publisher write timeout");
+    release(true);
+}
+
+void bench_publisher::onErrorProcess()
+{
+    log_error("bench publisher socket error");
+    release(true);
+}
+
+void bench_publisher::onCloseProcess()
+{
+    log_error("bench publisher socket closed");
+    release(true);
+}
+
+bool bench_publisher::onPublishStart(kernel_request *req)
+{
+    int ret = ERROR_SUCCESS;
+
+    setReadTimeOut(-1);
+
+    bench_flv_file *file = m_worker->file();
+
+    // metadata和sequence header的时间戳都为0
+    for (int i = 0; i < file->first_frame; ++i) {
+        if ((ret = send_tag(file->tags.at(i), 0, false)) != ERROR_SUCCESS && ret != SOCKET_EAGAIN) {
+            return false;
+        }
+    }
+
+    m_publishing = true;
+    m_publish_time = bench_now();
+    m_index = file->first_frame;
+
+    stat()->publishing++;
+
+    return true;
+}
+
+int bench_publisher::send_tag(bench_flv_tag &tag, dint64 dts, bool stamp)
+{
+    RtmpMessage msg;
+    msg.header.message_type = tag.type;
+    msg.header.timestamp = dts;
+    msg.header.payload_length = tag.payload->length;
+    msg.payload = tag.payload;
+
+    if (tag.type == RTMP_MSG_VideoMessage) {
+        msg.header.perfer_cid = RTMP_CID_Video;
+    } else if (tag.type == RTMP_MSG_AudioMessage) {
+        msg.header.perfer_cid = RTMP_CID_Audio;
+    } else {
+        msg.header.perfer_cid = RTMP_CID_OverConnection2;
+    }
+
+    // 文件中的帧是所有推流端共享的，写入发送时间前先拷贝
+    if (stamp && tag.type == RTMP_MSG_VideoMessage && !tag.sequence_header
+            && tag.payload->length >= BENCH_STAMP_MIN_FRAME) {
+        MemoryChunk *chunk = DMemPool::instance()->getMemory(tag.payload->length);
+        memcpy(chunk->data, tag.payload->data, tag.payload->length);
+        chunk->length = tag.payload->length;
+
+        bench_stamp_write(chunk->data, chunk->length, bench_now());
+        msg.payload = DSharedPtr<MemoryChunk>(chunk);
+    }
+
+    stat()->publish_frames++;
+
+    return m_rtmp->send_av_data(&msg);
+}
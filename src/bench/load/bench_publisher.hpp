@@ -0,0 +1,57 @@
+#ifndef BENCH_PUBLISHER_HPP
+#define BENCH_PUBLISHER_HPP
+
+#include "DTcpSocket.hpp"
+#include "kernel_request.hpp"
+#include "rtmp_client.hpp"
+#include "bench_client.hpp"
+
+struct bench_flv_tag;
+
+/**
+ * @brief 用rtmp_client推流，按文件中的时间戳实时发送，到达文件末尾后从第一个音视频帧循环
+ */
+class bench_publisher : public DTcpSocket, public bench_client
+{
+public:
+    bench_publisher(bench_worker *worker, const DString &stream);
+    virtual ~bench_publisher();
+
+    virtual void start();
+    virtual void tick(dint64 now);
+
+    void release(bool failed);
+
+public:
+    virtual int onReadProcess();
+    virtual int onWriteProcess();
+    virtual void onReadTimeOutProcess();
+    virtual void onWriteTimeOutProcess();
+    virtual void onErrorProcess();
+    virtual void onCloseProcess();
+
+private:
+    bool onPublishStart(kernel_request *req);
+
+    int send_tag(bench_flv_tag &tag, dint64 dts, bool stamp);
+
+private:
+    rtmp_client *m_rtmp;
+    kernel_request m_req;
+
+    bool m_started;
+    bool m_publishing;
+    // close后同一轮事件中还可能回调到写事件，只统计一次
+    bool m_released;
+
+    // 开始推流的时间，单位微秒
+    dint64 m_publish_time;
+    // 下一个要发送的tag
+    int m_index;
+    // 已经循环的总时长，加到文件的时间戳上，单位毫秒
+    dint64 m_base;
+
+    duint64 m_write_total;
+};
+
+#endif // BENCH_PUBLISHER_HPP
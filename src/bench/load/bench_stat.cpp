@@ -0,0 +1,155 @@
+#include "bench_stat.hpp"
+#include "DDateTime.hpp"
+
+#include <string.h>
+
+static const dint64 histogram_bounds[BENCH_HISTOGRAM_BUCKETS - 1] = {
+    5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000
+};
+
+dint64 bench_now()
+{
+    struct timespec now = DDateTime::monotonic();
+    return (dint64)now.tv_sec * 1000 * 1000 + now.tv_nsec / 1000;
+}
+
+void bench_stamp_write(char *data, int len, dint64 usec)
+{
+    if (len < BENCH_STAMP_MIN_FRAME) {
+        return;
+    }
+
+    char *p = data + len - BENCH_STAMP_SIZE;
+    memcpy(p, BENCH_STAMP_MAGIC, 4);
+    p += 4;
+
+    static const char *digits = "0123456789abcdef";
+    for (int i = 15; i >= 0; --i) {
+        *p++ = digits[(usec >> (i * 4)) & 0x0F];
+    }
+}
+
+dint64 bench_stamp_read(const char *data, int len)
+{
+    if (len < BENCH_STAMP_MIN_FRAME) {
+        return -1;
+    }
+
+    const char *p = data + len - BENCH_STAMP_SIZE;
+    if (memcmp(p, BENCH_STAMP_MAGIC, 4) != 0) {
+        return -1;
+    }
+    p += 4;
+
+    dint64 usec = 0;
+    for (int i = 0; i < 16; ++i) {
+        char c = p[i];
+        if (c >= '0' && c <= '9') {
+            usec = (usec << 4) | (c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            usec = (usec << 4) | (c - 'a' + 10);
+        } else {
+            return -1;
+        }
+    }
+
+    return usec;
+}
+
+bench_histogram::bench_histogram()
+    : count(0)
+    , sum(0)
+{
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void bench_histogram::observe(dint64 ms)
+{
+    int index = 0;
+    while (index < BENCH_HISTOGRAM_BUCKETS - 1 && ms > histogram_bounds[index]) {
+        index++;
+    }
+
+    buckets[index]++;
+    count++;
+    sum += DMax(ms, 0);
+}
+
+void bench_histogram::merge(const bench_histogram &h)
+{
+    for (int i = 0; i < BENCH_HISTOGRAM_BUCKETS; ++i) {
+        buckets[i] += h.buckets[i];
+    }
+    count += h.count;
+    sum += h.sum;
+}
+
+dint64 bench_histogram::percentile(double p) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    duint64 rank = (duint64)(count * p);
+    duint64 seen = 0;
+
+    for (int i = 0; i < BENCH_HISTOGRAM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            return bound(i);
+        }
+    }
+
+    return -1;
+}
+
+dint64 bench_histogram::bound(int index)
+{
+    if (index < 0 || index >= BENCH_HISTOGRAM_BUCKETS - 1) {
+        return -1;
+    }
+    return histogram_bounds[index];
+}
+
+bench_stat::bench_stat()
+    : publishers(0)
+    , publishing(0)
+    , publish_failed(0)
+    , publish_bytes(0)
+    , publish_frames(0)
+    , publish_loops(0)
+{
+    for (int i = 0; i < BenchProtocol::count; ++i) {
+        started[i] = 0;
+        active[i] = 0;
+        joined[i] = 0;
+        failed[i] = 0;
+        stalls[i] = 0;
+        stall_ms[i] = 0;
+        bytes[i] = 0;
+        frames[i] = 0;
+    }
+}
+
+void bench_stat::merge(const bench_stat &s)
+{
+    for (int i = 0; i < BenchProtocol::count; ++i) {
+        started[i] += s.started[i];
+        active[i] += s.active[i];
+        joined[i] += s.joined[i];
+        failed[i] += s.failed[i];
+        stalls[i] += s.stalls[i];
+        stall_ms[i] += s.stall_ms[i];
+        bytes[i] += s.bytes[i];
+        frames[i] += s.frames[i];
+        join[i].merge(s.join[i]);
+        latency[i].merge(s.latency[i]);
+    }
+
+    publishers += s.publishers;
+    publishing += s.publishing;
+    publish_failed += s.publish_failed;
+    publish_bytes += s.publish_bytes;
+    publish_frames += s.publish_frames;
+    publish_loops += s.publish_loops;
+}
@@ -0,0 +1,83 @@
+#ifndef BENCH_STAT_HPP
+#define BENCH_STAT_HPP
+
+#include "DGlobal.hpp"
+#include "bench_config.hpp"
+
+// 直方图的桶数，上限见bench_stat.cpp中的histogram_bounds，单位毫秒，最后一个桶没有上限
+#define BENCH_HISTOGRAM_BUCKETS     12
+
+/**
+ * 推流端在每个视频帧(不含sequence header)的末尾写入魔数和发送时间，
+ * 播放端取出后计算端到端延迟。只覆盖最后一个nalu的数据，不改变帧的长度和结构。
+ * 时间写成16个十六进制字符，不含0字节，转成ts时不会被当作起始码
+ */
+#define BENCH_STAMP_MAGIC           "LMSB"
+#define BENCH_STAMP_SIZE            20
+// 小于此长度的帧不写入时间
+#define BENCH_STAMP_MIN_FRAME       64
+
+/**
+ * @brief 单调时钟，单位微秒
+ */
+dint64 bench_now();
+
+void bench_stamp_write(char *data, int len, dint64 usec);
+/**
+ * @brief 读取帧末尾的发送时间，没有时返回-1
+ */
+dint64 bench_stamp_read(const char *data, int len);
+
+struct bench_histogram
+{
+    bench_histogram();
+
+    void observe(dint64 ms);
+    void merge(const bench_histogram &h);
+    /**
+     * @brief 第p(0~1)分位所在桶的上限，落在最后一个桶时返回-1，没有数据返回0
+     */
+    dint64 percentile(double p) const;
+
+    static dint64 bound(int index);
+
+    duint64 buckets[BENCH_HISTOGRAM_BUCKETS];
+    duint64 count;
+    duint64 sum;
+};
+
+/**
+ * @brief 每个工作线程一份，只由所属线程修改，主线程定时读取汇总，不加锁
+ */
+struct bench_stat
+{
+    bench_stat();
+
+    void merge(const bench_stat &s);
+
+    // 播放端
+    dint64 started[BenchProtocol::count];
+    dint64 active[BenchProtocol::count];
+    dint64 joined[BenchProtocol::count];
+    // 连接失败或者播放中被断开
+    dint64 failed[BenchProtocol::count];
+    dint64 stalls[BenchProtocol::count];
+    dint64 stall_ms[BenchProtocol::count];
+    duint64 bytes[BenchProtocol::count];
+    duint64 frames[BenchProtocol::count];
+    // 从发起连接到收到第一个视频帧的时间
+    bench_histogram join[BenchProtocol::count];
+    // 稳定播放后的端到端延迟
+    bench_histogram latency[BenchProtocol::count];
+
+    // 推流端
+    dint64 publishers;
+    dint64 publishing;
+    dint64 publish_failed;
+    duint64 publish_bytes;
+    duint64 publish_frames;
+    // 文件从头循环的次数
+    dint64 publish_loops;
+};
+
+#endif // BENCH_STAT_HPP
@@ -0,0 +1,126 @@
+#include "bench_worker.hpp"
+#include "bench_publisher.hpp"
+#include "bench_players.hpp"
+#include "bench_hls_player.hpp"
+#include "kernel_log.hpp"
+
+#include <algorithm>
+
+static bool spec_less(const bench_client_spec &a, const bench_client_spec &b)
+{
+    return a.start_ms < b.start_ms;
+}
+
+bench_worker::bench_worker(bench_flv_file *file, dint64 begin)
+    : m_file(file)
+    , m_begin(begin)
+    , m_timer(NULL)
+    , m_next_spec(0)
+{
+    m_event = new DEvent();
+}
+
+bench_worker::~bench_worker()
+{
+
+}
+
+void bench_worker::add_client(int type, const DString &stream, dint64 start_ms)
+{
+    bench_client_spec spec;
+    spec.type = type;
+    spec.stream = stream;
+    spec.start_ms = start_ms;
+
+    m_specs.push_back(spec);
+}
+
+void bench_worker::remove(bench_client *client)
+{
+    m_clients.erase(client);
+}
+
+void bench_worker::release(bench_client *client)
+{
+    m_clients.erase(client);
+    m_released.push_back(client);
+}
+
+DEvent *bench_worker::event()
+{
+    return m_event;
+}
+
+bench_stat *bench_worker::stat()
+{
+    return &m_stat;
+}
+
+bench_flv_file *bench_worker::file()
+{
+    return m_file;
+}
+
+void bench_worker::run()
+{
+    std::stable_sort(m_specs.begin(), m_specs.end(), spec_less);
+
+    m_timer = new DTimer(m_event);
+    m_timer->setTimerEvent(TIMER_CALLBACK(&bench_worker::onTimer));
+    m_timer->start(10);
+
+    m_event->start();
+}
+
+void bench_worker::onTimer()
+{
+    for (int i = 0; i < (int)m_released.size(); ++i) {
+        delete m_released.at(i);
+    }
+    m_released.clear();
+
+    dint64 now = bench_now();
+    dint64 elapsed = (now - m_begin) / 1000;
+
+    while (m_next_spec < (int)m_specs.size() && m_specs.at(m_next_spec).start_ms <= elapsed) {
+        create_client(m_specs.at(m_next_spec));
+        m_next_spec++;
+    }
+
+    // 客户端可能在tick中释放自己，遍历副本并确认还在列表中
+    std::vector<bench_client*> clients(m_clients.begin(), m_clients.end());
+
+    for (int i = 0; i < (int)clients.size(); ++i) {
+        bench_client *client = clients.at(i);
+        if (m_clients.find(client) == m_clients.end()) {
+            continue;
+        }
+        client->tick(now);
+    }
+}
+
+void bench_worker::create_client(const bench_client_spec &spec)
+{
+    bench_client *client = NULL;
+
+    switch (spec.type) {
+    case BenchProtocol::rtmp:
+        client = new bench_rtmp_player(this, spec.stream);
+        break;
+    case BenchProtocol::flv:
+        client = new bench_flv_player(this, spec.stream);
+        break;
+    case BenchProtocol::ts:
+        client = new bench_ts_player(this, spec.stream);
+        break;
+    case BenchProtocol::hls:
+        client = new bench_hls_player(this, spec.stream);
+        break;
+    default:
+        client = new bench_publisher(this, spec.stream);
+        break;
+    }
+
+    m_clients.insert(client);
+    client->start();
+}
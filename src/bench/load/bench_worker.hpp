@@ -0,0 +1,73 @@
+#ifndef BENCH_WORKER_HPP
+#define BENCH_WORKER_HPP
+
+#include "DThread.hpp"
+#include "DEvent.hpp"
+#include "DTimer.hpp"
+#include "bench_stat.hpp"
+
+#include <vector>
+#include <set>
+
+class bench_client;
+class bench_flv_file;
+
+struct bench_client_spec
+{
+    // -1为推流端，其他为BenchProtocol::Type
+    int type;
+    DString stream;
+    // 相对于测试开始的启动时间，单位毫秒
+    dint64 start_ms;
+};
+
+/**
+ * @brief 每个工作线程一个DEvent，按启动时间创建分配给自己的推流端和播放端
+ */
+class bench_worker : public DThread
+{
+public:
+    bench_worker(bench_flv_file *file, dint64 begin);
+    virtual ~bench_worker();
+
+    void add_client(int type, const DString &stream, dint64 start_ms);
+
+    /**
+     * @brief 从定时调用的列表中移除，客户端释放前调用
+     */
+    void remove(bench_client *client);
+    /**
+     * @brief 移除并在下次定时器触发时释放，用于不是socket的客户端
+     */
+    void release(bench_client *client);
+
+    DEvent *event();
+    bench_stat *stat();
+    bench_flv_file *file();
+
+protected:
+    virtual void run();
+
+private:
+    void onTimer();
+
+    void create_client(const bench_client_spec &spec);
+
+private:
+    bench_flv_file *m_file;
+    // 测试开始的单调时钟，所有线程相同，单位微秒
+    dint64 m_begin;
+
+    DEvent *m_event;
+    DTimer *m_timer;
+
+    bench_stat m_stat;
+
+    std::vector<bench_client_spec> m_specs;
+    int m_next_spec;
+
+    std::set<bench_client*> m_clients;
+    std::vector<bench_client*> m_released;
+};
+
+#endif // BENCH_WORKER_HPP
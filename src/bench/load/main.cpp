@@ -0,0 +1,325 @@
+#include "bench_config.hpp"
+#include "bench_stat.hpp"
+#include "bench_worker.hpp"
+#include "bench_flv_file.hpp"
+#include "kernel_log.hpp"
+#include "DFile.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
+#include <vector>
+
+kernel_context* global_context = new kernel_context();
+
+std::vector<bench_worker*> workers;
+
+void usage(const char *name)
+{
+    printf("usage: %s -i file.flv [options]\n"
+           "  -i, --input       flv file published in a loop\n"
+           "  -H, --host        server ip, default 127.0.0.1\n"
+           "  -r, --rtmp-port   default 1935\n"
+           "  -P, --http-port   default 8080\n"
+           "      --vhost       default test.com\n"
+           "      --app         default live\n"
+           "      --stream      default 123, publishers > 1 use stream_0, stream_1, ...\n"
+           "      --m3u8        hls playlist uri, default /[app]/[stream]/playlist.m3u8\n"
+           "  -n, --publishers  default 1\n"
+           "      --rtmp        rtmp players\n"
+           "      --flv         http-flv players\n"
+           "      --ts          http-ts players\n"
+           "      --hls         hls players\n"
+           "  -t, --threads     worker threads, default 1\n"
+           "  -d, --duration    seconds, default 30\n"
+           "  -I, --interval    report interval in seconds, default 5\n"
+           "  -R, --ramp        start players evenly in seconds, default 0\n"
+           "      --delay       start players after publishing in ms, default 2000\n"
+           "      --buffer      player buffer in ms, default 1000\n"
+           "      --steady      measure latency after joined in ms, default 5000\n"
+           "  -p, --pid         server pid for cpu usage\n", name);
+}
+
+void parse_options(int argc, char** argv)
+{
+    bench_config *config = bench_config::instance();
+
+    struct option long_options[] = {
+        {"input", required_argument, 0, 'i'},
+        {"host", required_argument, 0, 'H'},
+        {"rtmp-port", required_argument, 0, 'r'},
+        {"http-port", required_argument, 0, 'P'},
+        {"vhost", required_argument, 0, 1000},
+        {"app", required_argument, 0, 1001},
+        {"stream", required_argument, 0, 1002},
+        {"m3u8", required_argument, 0, 1003},
+        {"publishers", required_argument, 0, 'n'},
+        {"rtmp", required_argument, 0, 1100 + BenchProtocol::rtmp},
+        {"flv", required_argument, 0, 1100 + BenchProtocol::flv},
+        {"ts", required_argument, 0, 1100 + BenchProtocol::ts},
+        {"hls", required_argument, 0, 1100 + BenchProtocol::hls},
+        {"threads", required_argument, 0, 't'},
+        {"duration", required_argument, 0, 'd'},
+        {"interval", required_argument, 0, 'I'},
+        {"ramp", required_argument, 0, 'R'},
+        {"delay", required_argument, 0, 1200},
+        {"buffer", required_argument, 0, 1201},
+        {"steady", required_argument, 0, 1202},
+        {"pid", required_argument, 0, 'p'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while((opt = getopt_long(argc, argv, "i:H:r:P:n:t:d:I:R:p:h", long_options, NULL)) != -1) {
+        switch (opt)
+        {
+        case 'i': config->file = optarg; break;
+        case 'H': config->host = optarg; break;
+        case 'r': config->rtmp_port = atoi(optarg); break;
+        case 'P': config->http_port = atoi(optarg); break;
+        case 1000: config->vhost = optarg; break;
+        case 1001: config->app = optarg; break;
+        case 1002: config->stream = optarg; break;
+        case 1003: config->m3u8 = optarg; break;
+        case 'n': config->publishers = atoi(optarg); break;
+        case 1100 + BenchProtocol::rtmp:
+        case 1100 + BenchProtocol::flv:
+        case 1100 + BenchProtocol::ts:
+        case 1100 + BenchProtocol::hls:
+            config->players[opt - 1100] = atoi(optarg);
+            break;
+        case 't': config->threads = DMax(atoi(optarg), 1); break;
+        case 'd': config->duration = atoi(optarg); break;
+        case 'I': config->interval = DMax(atoi(optarg), 1); break;
+        case 'R': config->ramp = atoi(optarg); break;
+        case 1200: config->play_delay = atoi(optarg); break;
+        case 1201: config->buffer = atoi(optarg); break;
+        case 1202: config->steady = atoi(optarg); break;
+        case 'p': config->server_pid = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            exit(0);
+        }
+    }
+
+    if (config->file.isEmpty() || config->publishers <= 0) {
+        usage(argv[0]);
+        exit(-1);
+    }
+}
+
+/**
+ * @brief 读取/proc/[pid]/stat中的utime+stime，单位clock tick，失败返回-1
+ */
+dint64 read_cpu_ticks(const DString &path)
+{
+    FILE *fp = fopen(path.c_str(), "r");
+    if (!fp) {
+        return -1;
+    }
+
+    char buf[1024];
+    int len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+
+    if (len <= 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+
+    // 进程名中可能有空格，从最后一个')'之后开始，第3个字段是state，utime和stime是第14、15个字段
+    char *p = strrchr(buf, ')');
+    if (!p) {
+        return -1;
+    }
+
+    unsigned long long utime = 0, stime = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2) {
+        return -1;
+    }
+
+    return utime + stime;
+}
+
+struct bench_cpu
+{
+    bench_cpu(const DString &p) : path(p), ticks(read_cpu_ticks(p)), time(bench_now()) {}
+
+    /**
+     * @brief 上次调用以来的cpu占用，100表示一个核，不可用时返回-1
+     */
+    double sample()
+    {
+        dint64 now_ticks = read_cpu_ticks(path);
+        dint64 now = bench_now();
+
+        double ret = -1;
+        if (ticks >= 0 && now_ticks >= 0 && now > time) {
+            ret = (double)(now_ticks - ticks) / sysconf(_SC_CLK_TCK) * 1000 * 1000 / (now - time) * 100;
+        }
+
+        ticks = now_ticks;
+        time = now;
+        return ret;
+    }
+
+    DString path;
+    dint64 ticks;
+    dint64 time;
+};
+
+DString format_ms(dint64 ms)
+{
+    if (ms < 0) {
+        return ">" + DString::number(bench_histogram::bound(BENCH_HISTOGRAM_BUCKETS - 2));
+    }
+    return DString::number(ms);
+}
+
+double mbps(duint64 bytes, dint64 usec)
+{
+    if (usec <= 0) {
+        return 0;
+    }
+    return (double)bytes * 8 / usec;
+}
+
+void report(dint64 elapsed, const bench_stat &total, const bench_stat &last, dint64 usec, double server_cpu, double self_cpu)
+{
+    printf("[%4llds] publish %lld/%lld failed %lld loops %lld %.2f Mbps",
+           (long long)(elapsed / 1000 / 1000), (long long)total.publishing, (long long)total.publishers,
+           (long long)total.publish_failed, (long long)total.publish_loops,
+           mbps(total.publish_bytes - last.publish_bytes, usec));
+
+    if (server_cpu >= 0) {
+        printf(" | server cpu %.1f%%", server_cpu);
+    }
+    printf(" | bench cpu %.1f%%\n", self_cpu);
+
+    printf("  %-5s %9s %7s %7s %15s %15s %7s %9s %9s\n", "proto", "active", "joined", "failed",
+           "join p50/p99", "delay p50/p99", "stalls", "stall ms", "Mbps");
+
+    for (int i = 0; i < BenchProtocol::count; ++i) {
+        if (total.started[i] == 0) {
+            continue;
+        }
+
+        DString active = DString::number(total.active[i]) + "/" + DString::number(total.started[i]);
+        DString join = format_ms(total.join[i].percentile(0.5)) + "/" + format_ms(total.join[i].percentile(0.99));
+        DString latency = format_ms(total.latency[i].percentile(0.5)) + "/" + format_ms(total.latency[i].percentile(0.99));
+
+        printf("  %-5s %9s %7lld %7lld %15s %15s %7lld %9lld %9.2f\n", bench_protocol_name(i),
+               active.c_str(), (long long)total.joined[i], (long long)total.failed[i], join.c_str(), latency.c_str(),
+               (long long)total.stalls[i], (long long)total.stall_ms[i], mbps(total.bytes[i] - last.bytes[i], usec));
+    }
+
+    fflush(stdout);
+}
+
+/**
+ * lms-bench -i file.flv [options]
+ * 在本机启动推流端和各协议的播放端压测服务器，统计加入时间、延迟、卡顿、吞吐和服务器cpu
+ */
+int main(int argc, char *argv[])
+{
+    parse_options(argc, argv);
+
+    ::signal(SIGPIPE, SIG_IGN);
+
+    kernel_log::instance()->setLogLevel(DLogLevel::Error);
+
+    bench_config *config = bench_config::instance();
+
+    bench_flv_file *file = new bench_flv_file();
+    if (!file->load(config->file)) {
+        return -1;
+    }
+
+    printf("file %s: %d tags, %lld ms per loop\n", config->file.c_str(), (int)file->tags.size(), (long long)file->duration);
+
+    dint64 begin = bench_now();
+
+    for (int i = 0; i < config->threads; ++i) {
+        workers.push_back(new bench_worker(file, begin));
+    }
+
+    for (int i = 0; i < config->publishers; ++i) {
+        workers.at(i % config->threads)->add_client(-1, config->get_stream(i), 0);
+    }
+
+    int total_players = 0;
+    for (int i = 0; i < BenchProtocol::count; ++i) {
+        total_players += config->players[i];
+    }
+
+    // 播放端依次分配到各线程和各路流，在ramp时间内均匀启动
+    int index = 0;
+    for (int i = 0; i < BenchProtocol::count; ++i) {
+        for (int j = 0; j < config->players[i]; ++j) {
+            dint64 start_ms = config->play_delay + (dint64)config->ramp * 1000 * index / DMax(total_players, 1);
+            workers.at(index % config->threads)->add_client(i, config->get_stream(j % config->publishers), start_ms);
+            index++;
+        }
+    }
+
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        workers.at(i)->start();
+    }
+
+    bench_cpu server_cpu("/proc/" + DString::number(config->server_pid) + "/stat");
+    bench_cpu self_cpu("/proc/self/stat");
+
+    bench_stat last;
+    dint64 last_time = begin;
+    double server_total = 0;
+    int server_samples = 0;
+
+    while (true) {
+        sleep(config->interval);
+
+        dint64 now = bench_now();
+
+        bench_stat total;
+        for (int i = 0; i < (int)workers.size(); ++i) {
+            total.merge(*workers.at(i)->stat());
+        }
+
+        double server = (config->server_pid > 0) ? server_cpu.sample() : -1;
+        double self = self_cpu.sample();
+
+        // 播放端全部启动后的cpu用于计算每核的观看数
+        if (server >= 0 && (now - begin) / 1000 > config->play_delay + config->ramp * 1000) {
+            server_total += server;
+            server_samples++;
+        }
+
+        report(now - begin, total, last, now - last_time, server, self);
+
+        last = total;
+        last_time = now;
+
+        if (now - begin >= (dint64)config->duration * 1000 * 1000) {
+            int playing = 0;
+            for (int i = 0; i < BenchProtocol::count; ++i) {
+                playing += total.active[i];
+            }
+
+            printf("summary: %d players active, %lld failed publishers", playing, (long long)total.publish_failed);
+            if (server_samples > 0 && server_total > 0) {
+                double cpu = server_total / server_samples;
+                printf(", server cpu %.1f%%, %.0f players per core", cpu, playing / (cpu / 100));
+            }
+            printf("\n");
+            break;
+        }
+    }
+
+    fflush(stdout);
+
+    // 工作线程的事件循环不会退出，直接结束进程
+    _exit(0);
+}
@@ -0,0 +1,34 @@
+#include "bench_global.hpp"
+#include "kernel_log.hpp"
+
+#include <stdio.h>
+
+// 被测代码中的日志需要
+kernel_context* global_context = new kernel_context();
+
+void bench_core();
+void bench_rtmp();
+void bench_lms();
+
+/**
+ * lms-microbench [filter]
+ * 在bin目录下运行，只运行名字中包含filter的用例，例如 ./lms-microbench rtmp/
+ */
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        bench_set_filter(argv[1]);
+    }
+
+#ifndef __OPTIMIZE__
+    printf("warning: built without optimization, use -DCMAKE_BUILD_TYPE=Release\n");
+#endif
+
+    printf("%-40s %4s %15s %20s %16s\n", "name", "thr", "time", "allocs", "iterations");
+
+    bench_core();
+    bench_rtmp();
+    bench_lms();
+
+    return 0;
+}
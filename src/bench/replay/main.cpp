@@ -0,0 +1,365 @@
+#include "replay_worker.hpp"
+#include "lms_capture.hpp"
+#include "lms_config.hpp"
+#include "lms_source.hpp"
+#include "lms_stats.hpp"
+#include "kernel_errno.hpp"
+#include "kernel_log.hpp"
+#include "kernel_request.hpp"
+#include "DDateTime.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
+#include <vector>
+
+kernel_context* global_context = new kernel_context();
+
+struct replay_options
+{
+    replay_options()
+        : vhost("test.com")
+        , app("live")
+        , stream("replay")
+        , viewers(100)
+        , threads(1)
+        , loops(1)
+        , realtime(false)
+        , mux(true)
+        , interval(5)
+    {}
+
+    DString file;
+    DString vhost;
+    DString app;
+    DString stream;
+    int viewers;
+    int threads;
+    int loops;
+    bool realtime;
+    bool mux;
+    int interval;
+};
+
+replay_options options;
+std::vector<replay_worker*> workers;
+
+void usage(const char *name)
+{
+    printf("usage: %s -i file.lmsc [options]\n"
+           "  -i, --input       capture file written by the live capture directive\n"
+           "      --vhost       must match a server in ../conf/lms.conf, default test.com\n"
+           "      --app         default live\n"
+           "      --stream      default replay\n"
+           "  -n, --viewers     in-process viewers, default 100\n"
+           "  -t, --threads     worker threads, default 1\n"
+           "  -l, --loops       replay the file n times, default 1\n"
+           "      --realtime    pace by the recorded receive time instead of full speed\n"
+           "      --no-mux      count payload bytes instead of muxing flv tags\n"
+           "  -I, --interval    report interval in seconds, default 5\n", name);
+}
+
+void parse_options(int argc, char** argv)
+{
+    struct option long_options[] = {
+        {"input", required_argument, 0, 'i'},
+        {"vhost", required_argument, 0, 1000},
+        {"app", required_argument, 0, 1001},
+        {"stream", required_argument, 0, 1002},
+        {"viewers", required_argument, 0, 'n'},
+        {"threads", required_argument, 0, 't'},
+        {"loops", required_argument, 0, 'l'},
+        {"realtime", no_argument, 0, 1100},
+        {"no-mux", no_argument, 0, 1101},
+        {"interval", required_argument, 0, 'I'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while((opt = getopt_long(argc, argv, "i:n:t:l:I:h", long_options, NULL)) != -1) {
+        switch (opt)
+        {
+        case 'i': options.file = optarg; break;
+        case 1000: options.vhost = optarg; break;
+        case 1001: options.app = optarg; break;
+        case 1002: options.stream = optarg; break;
+        case 'n': options.viewers = DMax(atoi(optarg), 0); break;
+        case 't': options.threads = DMax(atoi(optarg), 1); break;
+        case 'l': options.loops = DMax(atoi(optarg), 1); break;
+        case 1100: options.realtime = true; break;
+        case 1101: options.mux = false; break;
+        case 'I': options.interval = DMax(atoi(optarg), 1); break;
+        default:
+            usage(argv[0]);
+            exit(0);
+        }
+    }
+
+    if (options.file.isEmpty()) {
+        usage(argv[0]);
+        exit(-1);
+    }
+}
+
+/**
+ * @brief 单调时钟，单位微秒
+ */
+dint64 replay_now()
+{
+    struct timespec now = DDateTime::monotonic();
+    return (dint64)now.tv_sec * 1000 * 1000 + now.tv_nsec / 1000;
+}
+
+struct replay_total
+{
+    replay_total() : msgs(0), bytes(0), released(0), drop_bytes(0) {}
+
+    dint64 msgs;
+    dint64 bytes;
+    dint64 released;
+    dint64 drop_bytes;
+    lms_histogram fanout;
+};
+
+replay_total collect()
+{
+    replay_total total;
+
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        replay_stat *stat = workers.at(i)->stat();
+        total.msgs += stat->msgs;
+        total.bytes += stat->bytes;
+        total.released += stat->released;
+    }
+
+    std::vector<lms_worker_stat> stats = lms_stats::instance()->get_workers();
+    for (int i = 0; i < (int)stats.size(); ++i) {
+        lms_histogram &h = stats.at(i).histograms[LmsHistogram::fanout];
+        for (int j = 0; j < LMS_HISTOGRAM_BUCKETS; ++j) {
+            total.fanout.buckets[j] += h.buckets[j];
+        }
+        total.fanout.count += h.count;
+        total.fanout.sum += h.sum;
+        total.drop_bytes += stats.at(i).drop_bytes;
+    }
+
+    return total;
+}
+
+/**
+ * @brief 直方图中百分位所在桶的上限，落在最后一个桶时返回">上一个桶的上限"
+ */
+DString percentile(const lms_histogram &h, double p)
+{
+    if (h.count <= 0) {
+        return "-";
+    }
+
+    dint64 target = (dint64)(h.count * p);
+    dint64 sum = 0;
+
+    for (int i = 0; i < LMS_HISTOGRAM_BUCKETS - 1; ++i) {
+        sum += h.buckets[i];
+        if (sum > target) {
+            return DString::number(lms_worker_stat::bound(LmsHistogram::fanout, i));
+        }
+    }
+
+    return ">" + DString::number(lms_worker_stat::bound(LmsHistogram::fanout, LMS_HISTOGRAM_BUCKETS - 2));
+}
+
+double per_second(dint64 value, dint64 usec)
+{
+    if (usec <= 0) {
+        return 0;
+    }
+    return (double)value * 1000 * 1000 / usec;
+}
+
+void report(dint64 elapsed, dint64 ingest, const replay_total &total, const replay_total &last, dint64 last_ingest, dint64 usec)
+{
+    printf("[%6.1fs] ingest %lld msgs %.0f/s | delivered %lld msgs %.0f/s %.2f Mbps | fanout us p50 %s p99 %s | drop %lld bytes, released %lld\n",
+           (double)elapsed / 1000 / 1000, (long long)ingest, per_second(ingest - last_ingest, usec),
+           (long long)total.msgs, per_second(total.msgs - last.msgs, usec),
+           per_second(total.bytes - last.bytes, usec) * 8 / 1000 / 1000,
+           percentile(total.fanout, 0.5).c_str(), percentile(total.fanout, 0.99).c_str(),
+           (long long)total.drop_bytes, (long long)total.released);
+
+    fflush(stdout);
+}
+
+/**
+ * lms-replay -i file.lmsc [options]
+ * 把capture录制的消息直接交给lms_source，由进程内的假播放端接收，
+ * 不经过socket测试分发路径，也用于复现线上流的gop结构和时间戳跳变
+ */
+int main(int argc, char *argv[])
+{
+    int ret = ERROR_SUCCESS;
+
+    parse_options(argc, argv);
+
+    ::signal(SIGPIPE, SIG_IGN);
+
+    kernel_log::instance()->setLogLevel(DLogLevel::Error);
+
+    if ((ret = lms_config::instance()->parse_file()) != ERROR_SUCCESS) {
+        printf("load ../conf/lms.conf failed. ret=%d\n", ret);
+        return -1;
+    }
+
+    kernel_request req;
+    req.vhost = options.vhost;
+    req.host = options.vhost;
+    req.app = options.app;
+    req.stream = options.stream;
+    req.tcUrl = "rtmp://" + req.vhost + "/" + req.app;
+    req.schema = "rtmp";
+
+    lms_server_config_struct *config = lms_config::instance()->get_server(&req);
+    if (!config) {
+        printf("vhost %s is not configured\n", options.vhost.c_str());
+        return -1;
+    }
+    DFree(config);
+
+    lms_capture_reader reader;
+    if ((ret = reader.open(options.file)) != ERROR_SUCCESS) {
+        printf("open capture %s failed. ret=%d\n", options.file.c_str(), ret);
+        return -1;
+    }
+
+    lms_source *source = new lms_source(&req);
+    if (!source->onPublish(NULL, false)) {
+        printf("publish replay stream failed\n");
+        return -1;
+    }
+
+    // 播放端在工作线程中加入source，全部加入后再开始推送
+    int first_id = -2;
+    for (int i = 0; i < options.threads; ++i) {
+        int count = options.viewers / options.threads + (i < options.viewers % options.threads ? 1 : 0);
+
+        replay_worker *worker = new replay_worker(source, &req, count, first_id, options.mux);
+        first_id -= count;
+
+        workers.push_back(worker);
+        worker->start();
+    }
+
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        while (!workers.at(i)->ready()) {
+            usleep(1000);
+        }
+    }
+
+    printf("replay %s to %s/%s/%s: %d viewers on %d threads, %s\n", options.file.c_str(),
+           options.vhost.c_str(), options.app.c_str(), options.stream.c_str(),
+           options.viewers, options.threads, options.realtime ? "realtime" : "full speed");
+    fflush(stdout);
+
+    dint64 begin = replay_now();
+    dint64 last_time = begin;
+    dint64 next_report = begin + (dint64)options.interval * 1000 * 1000;
+
+    dint64 ingest = 0;
+    dint64 ingest_bytes = 0;
+    dint64 last_ingest = 0;
+    replay_total last;
+
+    // 循环时把时间戳和接收时间接在上一轮之后，文件内的跳变保持原样
+    dint64 dts_base = 0;
+    dint64 time_base = 0;
+
+    for (int loop = 0; loop < options.loops; ++loop) {
+        if (loop > 0 && (ret = reader.rewind()) != ERROR_SUCCESS) {
+            printf("rewind capture failed. ret=%d\n", ret);
+            break;
+        }
+
+        dint64 max_dts = 0;
+        dint64 max_time = 0;
+
+        while (true) {
+            CommonMessage msg;
+            dint64 time = 0;
+
+            if (!reader.read(&msg, time, ret)) {
+                break;
+            }
+
+            max_dts = DMax(max_dts, msg.dts);
+            max_time = DMax(max_time, time);
+
+            msg.dts += dts_base;
+
+            if (options.realtime) {
+                dint64 wait = begin + (time_base + time) * 1000 - replay_now();
+                if (wait > 0) {
+                    usleep(wait);
+                }
+            }
+
+            if (msg.is_video()) {
+                source->onVideo(&msg);
+            } else if (msg.is_audio()) {
+                source->onAudio(&msg);
+            } else if (msg.is_metadata()) {
+                source->onMetadata(&msg);
+            }
+
+            ingest++;
+            ingest_bytes += msg.payload_length;
+
+            dint64 now = replay_now();
+            if (now >= next_report) {
+                replay_total total = collect();
+                report(now - begin, ingest, total, last, last_ingest, now - last_time);
+
+                last = total;
+                last_ingest = ingest;
+                last_time = now;
+                next_report = now + (dint64)options.interval * 1000 * 1000;
+            }
+        }
+
+        if (ret != ERROR_SUCCESS) {
+            printf("read capture failed. ret=%d\n", ret);
+            break;
+        }
+
+        dts_base += max_dts + 1;
+        time_base += max_time + 1;
+    }
+
+    dint64 feed_end = replay_now();
+
+    // 全速推送时工作线程的队列会积压，等到100毫秒内没有新的消息发出
+    replay_total total = collect();
+    int idle = 0;
+    while (idle < 10) {
+        usleep(10 * 1000);
+
+        replay_total now = collect();
+        idle = (now.msgs == total.msgs) ? idle + 1 : 0;
+        total = now;
+    }
+
+    dint64 end = replay_now();
+    report(end - begin, ingest, total, last, last_ingest, end - last_time);
+
+    printf("summary: ingest %lld msgs %.2f MB in %.3fs (%.0f msgs/s), delivered %lld msgs (%.0f/s) %.2f MB, fanout us p50 %s p99 %s\n",
+           (long long)ingest, (double)ingest_bytes / 1024 / 1024, (double)(feed_end - begin) / 1000 / 1000,
+           per_second(ingest, feed_end - begin), (long long)total.msgs, per_second(total.msgs, end - begin),
+           (double)total.bytes / 1024 / 1024, percentile(total.fanout, 0.5).c_str(), percentile(total.fanout, 0.99).c_str());
+
+    fflush(stdout);
+
+    source->onUnpublish();
+
+    // 工作线程的事件循环不会退出，直接结束进程
+    _exit(0);
+}
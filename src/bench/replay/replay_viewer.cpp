@@ -0,0 +1,88 @@
+#include "replay_viewer.hpp"
+#include "kernel_errno.hpp"
+
+replay_stat::replay_stat()
+    : msgs(0)
+    , bytes(0)
+    , released(0)
+{
+
+}
+
+replay_viewer::replay_viewer(DThread *thread, DEvent *event, int id, kernel_request *req, bool mux, replay_stat *stat)
+    : lms_conn_base(thread, event, id)
+    , m_mux(mux)
+    , m_stat(stat)
+{
+    m_writer = new lms_stream_writer(req, AV_Handler_Callback(&replay_viewer::onSendMessage), false);
+    m_muxer = new flv_muxer();
+}
+
+replay_viewer::~replay_viewer()
+{
+    DFree(m_writer);
+    DFree(m_muxer);
+}
+
+int replay_viewer::Process(CommonMessage *msg)
+{
+    return m_writer->send(msg);
+}
+
+void replay_viewer::reload()
+{
+    m_writer->reload();
+}
+
+void replay_viewer::release()
+{
+    m_stat->released++;
+}
+
+int replay_viewer::onReadProcess()
+{
+    return ERROR_SUCCESS;
+}
+
+int replay_viewer::onWriteProcess()
+{
+    return ERROR_SUCCESS;
+}
+
+void replay_viewer::onReadTimeOutProcess()
+{
+
+}
+
+void replay_viewer::onWriteTimeOutProcess()
+{
+
+}
+
+void replay_viewer::onErrorProcess()
+{
+
+}
+
+void replay_viewer::onCloseProcess()
+{
+
+}
+
+int replay_viewer::onSendMessage(CommonMessage *msg)
+{
+    m_stat->msgs++;
+
+    if (!m_mux) {
+        m_stat->bytes += msg->payload_length;
+        return ERROR_SUCCESS;
+    }
+
+    std::list<DSharedPtr<MemoryChunk> > chunks = m_muxer->encode(msg);
+    std::list<DSharedPtr<MemoryChunk> >::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        m_stat->bytes += (*it)->length;
+    }
+
+    return ERROR_SUCCESS;
+}
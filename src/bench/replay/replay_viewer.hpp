@@ -0,0 +1,58 @@
+#ifndef REPLAY_VIEWER_HPP
+#define REPLAY_VIEWER_HPP
+
+#include "lms_conn_base.hpp"
+#include "lms_stream_writer.hpp"
+#include "kernel_request.hpp"
+#include "flv_muxer.hpp"
+
+struct replay_stat
+{
+    replay_stat();
+
+    char head_pad[64];
+
+    // 交给连接的消息数和flv封装后的字节数
+    dint64 msgs;
+    dint64 bytes;
+    // lms_event_conn让连接释放的次数
+    dint64 released;
+
+    char tail_pad[64];
+};
+
+/**
+ * @brief 进程内的假播放端，和真实播放连接一样加入source，消息经过lms_stream_writer后
+ *        封装成flv计数，不写入socket。描述符是负数，只用作lms_event_conn中的key，不加入epoll
+ */
+class replay_viewer : public lms_conn_base
+{
+public:
+    replay_viewer(DThread *thread, DEvent *event, int id, kernel_request *req, bool mux, replay_stat *stat);
+    virtual ~replay_viewer();
+
+public:
+    virtual int Process(CommonMessage *msg);
+    virtual void reload();
+    virtual void release();
+
+public:
+    virtual int onReadProcess();
+    virtual int onWriteProcess();
+    virtual void onReadTimeOutProcess();
+    virtual void onWriteTimeOutProcess();
+    virtual void onErrorProcess();
+    virtual void onCloseProcess();
+
+private:
+    int onSendMessage(CommonMessage *msg);
+
+private:
+    lms_stream_writer *m_writer;
+    flv_muxer *m_muxer;
+    bool m_mux;
+
+    replay_stat *m_stat;
+};
+
+#endif // REPLAY_VIEWER_HPP
@@ -0,0 +1,57 @@
+#include "replay_worker.hpp"
+#include "lms_source.hpp"
+#include "kernel_log.hpp"
+
+replay_worker::replay_worker(lms_source *source, kernel_request *req, int viewers, int first_id, bool mux)
+    : m_source(source)
+    , m_req(req)
+    , m_count(viewers)
+    , m_first_id(first_id)
+    , m_mux(mux)
+    , m_timer(NULL)
+    , m_ready(false)
+{
+    m_event = new DEvent();
+}
+
+replay_worker::~replay_worker()
+{
+
+}
+
+bool replay_worker::ready()
+{
+    return m_ready;
+}
+
+replay_stat *replay_worker::stat()
+{
+    return &m_stat;
+}
+
+void replay_worker::run()
+{
+    m_timer = new DTimer(m_event);
+    m_timer->setTimerEvent(TIMER_CALLBACK(&replay_worker::onStart));
+    m_timer->setSingleShot(true);
+    m_timer->start(1);
+
+    m_event->start();
+}
+
+void replay_worker::onStart()
+{
+    for (int i = 0; i < m_count; ++i) {
+        replay_viewer *viewer = new replay_viewer(this, m_event, m_first_id - i, m_req, m_mux, &m_stat);
+
+        if (!m_source->add_connection(viewer, LmsStatProtocol::flv)) {
+            log_error("replay viewer add to source failed");
+            DFree(viewer);
+            continue;
+        }
+
+        m_viewers.push_back(viewer);
+    }
+
+    m_ready = true;
+}
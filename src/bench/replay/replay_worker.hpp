@@ -0,0 +1,57 @@
+#ifndef REPLAY_WORKER_HPP
+#define REPLAY_WORKER_HPP
+
+#include "DThread.hpp"
+#include "DEvent.hpp"
+#include "DTimer.hpp"
+#include "kernel_request.hpp"
+#include "replay_viewer.hpp"
+
+#include <vector>
+
+class lms_source;
+
+/**
+ * @brief 每个工作线程一个DEvent，和lms_threads_server一样由lms_event_conn唤醒处理消息
+ */
+class replay_worker : public DThread
+{
+public:
+    /**
+     * @param first_id 第一个假播放端的描述符，依次递减
+     */
+    replay_worker(lms_source *source, kernel_request *req, int viewers, int first_id, bool mux);
+    virtual ~replay_worker();
+
+    /**
+     * @brief 所有播放端都加入source后返回true
+     */
+    bool ready();
+    replay_stat *stat();
+
+protected:
+    virtual void run();
+
+private:
+    /**
+     * @brief 在工作线程中创建播放端，lms_event_conn的eventfd需要加入本线程的DEvent
+     */
+    void onStart();
+
+private:
+    lms_source *m_source;
+    kernel_request *m_req;
+    int m_count;
+    int m_first_id;
+    bool m_mux;
+
+    DEvent *m_event;
+    DTimer *m_timer;
+
+    replay_stat m_stat;
+    std::vector<replay_viewer*> m_viewers;
+
+    volatile bool m_ready;
+};
+
+#endif // REPLAY_WORKER_HPP
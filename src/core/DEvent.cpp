@@ -2,12 +2,43 @@
 #include <sys/epoll.h>
 #include <string.h>
 #include <algorithm>
+#include <typeinfo>
 
 #include "DTimer.hpp"
 
+static const dint64 loop_bounds[EVENT_LOOP_BUCKETS - 1] = {
+    100, 1000, 5000, 10000, 50000, 100000, 500000, 1000000
+};
+
+static inline dint64 monotonic_usec()
+{
+    struct timespec now = DDateTime::monotonic();
+    return (dint64)now.tv_sec * 1000 * 1000 + now.tv_nsec / 1000;
+}
+
+DEventHandlerStat::DEventHandlerStat()
+    : calls(0)
+    , usec(0)
+    , max_usec(0)
+{
+
+}
+
 DEvent::DEvent()
     : m_timer(NULL)
+    , m_loops(0)
+    , m_events(0)
+    , m_busy_usec(0)
+    , m_loop_start(0)
+    , m_handler(NULL)
+    , m_handler_start(0)
+    , m_max_loop_usec(0)
+    , m_max_handler_usec(0)
 {
+    for (int i = 0; i < EVENT_LOOP_BUCKETS; ++i) {
+        m_loop_buckets[i] = 0;
+    }
+
     m_fd = epoll_create1(0);
     if (m_fd == -1) {
         fprintf(stderr, "epoll_create1 return fd is invalid");
@@ -106,6 +137,52 @@ void DEvent::delWriteTimeOut(EventTimeOutBase *handler)
     }
 }
 
+duint64 DEvent::loops()
+{
+    return m_loops;
+}
+
+duint64 DEvent::events()
+{
+    return m_events;
+}
+
+duint64 DEvent::busyUsec()
+{
+    return m_busy_usec;
+}
+
+void DEvent::loopStat(duint64 *buckets, duint64 &max_loop, duint64 &max_handler)
+{
+    DSpinLocker locker(&m_stat_mutex);
+
+    for (int i = 0; i < EVENT_LOOP_BUCKETS; ++i) {
+        buckets[i] = m_loop_buckets[i];
+    }
+    max_loop = m_max_loop_usec;
+    max_handler = m_max_handler_usec;
+}
+
+std::map<const char*, DEventHandlerStat> DEvent::handlerStats()
+{
+    DSpinLocker locker(&m_stat_mutex);
+
+    return m_handler_stats;
+}
+
+dint64 DEvent::current(const char *&handler, dint64 &handler_start)
+{
+    handler = m_handler;
+    handler_start = m_handler_start;
+
+    return m_loop_start;
+}
+
+dint64 DEvent::loopBound(int index)
+{
+    return loop_bounds[index];
+}
+
 void DEvent::onTimeOut()
 {
     generateMonotonicTime();
@@ -169,28 +246,79 @@ void DEvent::wait()
 
     int count = epoll_wait(m_fd, events, 1024, -1);
 
+    m_loops++;
+
     if (count > 0) {
+        m_events += count;
+
+        dint64 begin = monotonic_usec();
+        dint64 last = begin;
+        m_loop_start = begin;
+
         for (int i = 0; i < count; ++i) {
             EventHanderBase *handler = reinterpret_cast<EventHanderBase*>(events[i].data.ptr);
             if (!handler) {
                 continue;
             }
 
-            duint32 event = events[i].events;
-            if (event & EPOLLIN || event & EPOLLERR || event & EPOLLHUP) {
-                if (handler->onRead() != 0) {
-                    continue;
-                }
-            }
-            if (event & EPOLLOUT) {
-                if (handler->onWrite() != 0) {
-                    continue;
-                }
-            }
+            const char *name = typeid(*handler).name();
+            m_handler_start = last;
+            m_handler = name;
+
+            dispatch(handler, events[i].events);
+
+            dint64 now = monotonic_usec();
+            m_handler_times.push_back(std::make_pair(name, now - last));
+            last = now;
         }
+
+        m_handler = NULL;
+        m_loop_start = 0;
+
+        updateStat(last - begin);
     }
 }
 
+void DEvent::dispatch(EventHanderBase *handler, duint32 event)
+{
+    if (event & EPOLLIN || event & EPOLLERR || event & EPOLLHUP) {
+        if (handler->onRead() != 0) {
+            return;
+        }
+    }
+    if (event & EPOLLOUT) {
+        handler->onWrite();
+    }
+}
+
+void DEvent::updateStat(dint64 loop_usec)
+{
+    int bucket = 0;
+    while (bucket < EVENT_LOOP_BUCKETS - 1 && loop_usec > loop_bounds[bucket]) {
+        bucket++;
+    }
+
+    m_busy_usec += loop_usec;
+
+    DSpinLocker locker(&m_stat_mutex);
+
+    m_loop_buckets[bucket]++;
+    m_max_loop_usec = DMax(m_max_loop_usec, (duint64)loop_usec);
+
+    for (int i = 0; i < (int)m_handler_times.size(); ++i) {
+        std::pair<const char*, dint64> &item = m_handler_times.at(i);
+
+        DEventHandlerStat &stat = m_handler_stats[item.first];
+        stat.calls++;
+        stat.usec += item.second;
+        stat.max_usec = DMax(stat.max_usec, (duint64)item.second);
+
+        m_max_handler_usec = DMax(m_max_handler_usec, (duint64)item.second);
+    }
+
+    m_handler_times.clear();
+}
+
 void DEvent::freeDelHandlers()
 {
     for (int i = 0; i < (int)m_del_handlers.size(); ++i) {
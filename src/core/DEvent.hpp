@@ -3,6 +3,7 @@
 
 #include "DGlobal.hpp"
 #include "DDateTime.hpp"
+#include "DSpinLock.hpp"
 
 #include <map>
 #include <vector>
@@ -10,6 +11,22 @@
 
 class DTimer;
 
+// 每轮事件处理时间的直方图桶数，上限见DEvent.cpp中的loop_bounds，最后一个桶没有上限
+#define EVENT_LOOP_BUCKETS      9
+
+/**
+ * @brief 一种handler的处理统计，按typeid区分
+ */
+struct DEventHandlerStat
+{
+    DEventHandlerStat();
+
+    duint64 calls;
+    // 累计和单次最长的处理时间，单位微秒
+    duint64 usec;
+    duint64 max_usec;
+};
+
 class EventHanderBase
 {
 public:
@@ -66,6 +83,37 @@ public:
     void delReadTimeOut(EventTimeOutBase *handler);
     void delWriteTimeOut(EventTimeOutBase *handler);
 
+    /**
+     * @brief epoll_wait返回的次数和处理的事件数，只由事件线程修改，其他线程读取时可能略有延迟
+     */
+    duint64 loops();
+    duint64 events();
+
+    /**
+     * @brief 处理事件的累计时间，不包括epoll_wait等待的时间，单位微秒
+     */
+    duint64 busyUsec();
+    /**
+     * @brief 单轮处理时间的直方图，以及单轮和单个handler的最长时间，单位微秒
+     */
+    void loopStat(duint64 *buckets, duint64 &max_loop, duint64 &max_handler);
+    /**
+     * @brief 按handler类型的统计，key是typeid的名字
+     */
+    std::map<const char*, DEventHandlerStat> handlerStats();
+
+    /**
+     * @brief 当前这一轮开始处理的时间，在epoll_wait中等待时返回0，单位微秒。供其他线程检测卡顿
+     * @param handler 正在处理的handler的typeid名字，没有时为NULL
+     * @param handler_start 开始处理这个handler的时间，单位微秒
+     */
+    dint64 current(const char *&handler, dint64 &handler_start);
+
+    /**
+     * @brief 单轮处理时间的直方图第index个桶的上限，单位微秒
+     */
+    static dint64 loopBound(int index);
+
 private:
     void onTimeOut();
     void generateMonotonicTime();
@@ -74,6 +122,15 @@ private:
     void wait();
     void freeDelHandlers();
 
+    /**
+     * @brief onRead返回非0时handler可能已经释放，不再处理写事件
+     */
+    void dispatch(EventHanderBase *handler, duint32 event);
+    /**
+     * @brief 每轮处理结束后加锁一次，把这一轮各handler的时间累加到统计中
+     */
+    void updateStat(dint64 loop_usec);
+
 private:
     int m_fd;
     std::vector<EventHanderBase*> m_del_handlers;
@@ -93,6 +150,25 @@ private:
 private:
     struct timespec m_monotonic;
     dint64 m_usec;
+
+private:
+    volatile duint64 m_loops;
+    volatile duint64 m_events;
+    volatile duint64 m_busy_usec;
+
+    // 正在处理的这一轮和handler，其他线程读取
+    volatile dint64 m_loop_start;
+    const char * volatile m_handler;
+    volatile dint64 m_handler_start;
+
+    // 这一轮各handler的类型和处理时间
+    std::vector<std::pair<const char*, dint64> > m_handler_times;
+
+    DSpinLock m_stat_mutex;
+    duint64 m_loop_buckets[EVENT_LOOP_BUCKETS];
+    duint64 m_max_loop_usec;
+    duint64 m_max_handler_usec;
+    std::map<const char*, DEventHandlerStat> m_handler_stats;
 };
 
 #endif // DEVENT_HPP
@@ -1,16 +1,32 @@
 #include "DHttpParser.hpp"
 #include <string.h>
+#include <strings.h>
+
+// same order as DHttpHeaderId
+static const char *header_names[DHttpHeaderMax] = {
+    "Host",
+    "Referer",
+    "User-Agent",
+    "Connection",
+    "Content-Length",
+    "Content-Type",
+    "Transfer-Encoding"
+};
+
+// the buffer grows when a header is larger than this.
+#define DHTTP_PARSER_BUFFER_SIZE    2048
 
 DHttpParser::DHttpParser(enum http_parser_type type)
     : m_type(type)
-    , m_lasWasValue(true)
+    , m_completed(false)
+    , m_buffer(NULL)
 {
     init();
 }
 
 DHttpParser::~DHttpParser()
 {
-
+    DFree(m_buffer);
 }
 
 void DHttpParser::init()
@@ -24,13 +40,35 @@ void DHttpParser::init()
     m_settings.on_body = onBody;
     m_settings.on_message_complete = onMessageComplete;
 
+    reset();
+}
+
+void DHttpParser::reset()
+{
     http_parser_init(&m_parser, m_type);
     m_parser.data = reinterpret_cast<void*>(this);
+
+    if (m_buffer) {
+        m_buffer->length = 0;
+    }
+
+    m_completed = false;
+    m_lasWasValue = true;
+
+    memset(&m_url, 0, sizeof(m_url));
+    memset(&m_field_key, 0, sizeof(m_field_key));
+    memset(&m_field_value, 0, sizeof(m_field_value));
+    memset(m_fields, 0, sizeof(m_fields));
+    m_other_count = 0;
 }
 
 int DHttpParser::parse(const char *data, unsigned int length)
 {
-    int nparsed = http_parser_execute(&m_parser, &m_settings, data, length);
+    // copy into our buffer, so the callbacks get positions in it
+    append(data, length);
+    const char *p = m_buffer->data + m_buffer->length - length;
+
+    int nparsed = http_parser_execute(&m_parser, &m_settings, p, length);
 
     if (m_parser.http_errno != 0) {
         return -1;
@@ -50,19 +88,12 @@ bool DHttpParser::completed()
 
 DString DHttpParser::getUrl()
 {
-    return m_url;
+    return url().toString();
 }
 
 DString DHttpParser::feild(const DString &key)
 {
-    std::map<DString, DString>::iterator iter;
-    iter = m_fields.find(key);
-    if (iter != m_fields.end())
-    {
-        return m_fields[key];
-    }
-
-    return "";
+    return field(key.c_str()).toString();
 }
 
 DString DHttpParser::method()
@@ -75,6 +106,112 @@ duint16 DHttpParser::statusCode()
     return m_parser.status_code;
 }
 
+bool DHttpParser::keepAlive()
+{
+    return http_should_keep_alive(&m_parser) != 0;
+}
+
+DStringRef DHttpParser::url()
+{
+    return ref(m_url);
+}
+
+DStringRef DHttpParser::field(DHttpHeaderId id)
+{
+    if (id < 0 || id >= DHttpHeaderMax) {
+        return DStringRef();
+    }
+
+    return ref(m_fields[id]);
+}
+
+DStringRef DHttpParser::field(const char *key)
+{
+    for (int i = 0; i < DHttpHeaderMax; ++i) {
+        if (strcasecmp(header_names[i], key) == 0) {
+            return ref(m_fields[i]);
+        }
+    }
+
+    // the last one wins when a header is repeated
+    for (int i = m_other_count - 1; i >= 0; --i) {
+        if (ref(m_other_keys[i]).iequals(key)) {
+            return ref(m_other_values[i]);
+        }
+    }
+
+    return DStringRef();
+}
+
+int DHttpParser::methodId()
+{
+    return m_parser.method;
+}
+
+void DHttpParser::append(const char *data, int length)
+{
+    int used = m_buffer ? m_buffer->length : 0;
+
+    if (!m_buffer || used + length > m_buffer->size) {
+        int size = DMax(used + length, DHTTP_PARSER_BUFFER_SIZE);
+        if (m_buffer) {
+            size = DMax(size, m_buffer->size * 2);
+        }
+
+        MemoryChunk *chunk = DMemPool::instance()->getMemory(size);
+        if (used > 0) {
+            memcpy(chunk->data, m_buffer->data, used);
+        }
+        chunk->length = used;
+
+        DFree(m_buffer);
+        m_buffer = chunk;
+    }
+
+    memcpy(m_buffer->data + used, data, length);
+    m_buffer->length = used + length;
+}
+
+void DHttpParser::extend(Range &range, const char *at, int length)
+{
+    // the pieces of one token are adjacent in the buffer
+    if (range.len == 0) {
+        range.pos = at - m_buffer->data;
+    }
+    range.len += length;
+}
+
+void DHttpParser::commitField()
+{
+    if (m_field_key.len <= 0) {
+        return;
+    }
+
+    DStringRef key = ref(m_field_key);
+
+    for (int i = 0; i < DHttpHeaderMax; ++i) {
+        if (key.iequals(header_names[i])) {
+            m_fields[i] = m_field_value;
+            return;
+        }
+    }
+
+    if (m_other_count < DHTTP_PARSER_MAX_FIELDS) {
+        m_other_keys[m_other_count] = m_field_key;
+        m_other_values[m_other_count] = m_field_value;
+        m_other_count++;
+    }
+}
+
+DStringRef DHttpParser::ref(const Range &range)
+{
+    if (!m_buffer || range.len <= 0) {
+        return DStringRef();
+    }
+
+    return DStringRef(m_buffer->data + range.pos, range.len);
+}
+
 int DHttpParser::onMessageBegin(http_parser *parser)
 {
     DHttpParser *obj = (DHttpParser*)parser->data;
@@ -89,9 +226,7 @@ int DHttpParser::onHeaderscComplete(http_parser *parser)
     DHttpParser *obj = (DHttpParser*)parser->data;
     obj->m_completed = true;
 
-    if (!obj->m_field_key.empty()) {
-        obj->m_fields[obj->m_field_key] = obj->m_field_value;
-    }
+    obj->commitField();
 
     return 0;
 }
@@ -104,9 +239,7 @@ int DHttpParser::onMessageComplete(http_parser *parser)
 int DHttpParser::onUrl(http_parser *parser, const char *at, size_t length)
 {
     DHttpParser *obj = (DHttpParser*)parser->data;
-    if (length > 0) {
-        obj->m_url = DString(at, (int)length);
-    }
+    obj->extend(obj->m_url, at, (int)length);
 
     return 0;
 }
@@ -116,15 +249,13 @@ int DHttpParser::onHeaderField(http_parser *parser, const char *at, size_t lengt
     DHttpParser *obj = (DHttpParser*)parser->data;
 
     if (obj->m_lasWasValue) {
-        if (!obj->m_field_key.empty()) {
-            obj->m_fields[obj->m_field_key] = obj->m_field_value;
-        }
+        obj->commitField();
 
-        obj->m_field_key.clear();
-        obj->m_field_value.clear();
+        memset(&obj->m_field_key, 0, sizeof(obj->m_field_key));
+        memset(&obj->m_field_value, 0, sizeof(obj->m_field_value));
     }
 
-    obj->m_field_key.append(at, length);
+    obj->extend(obj->m_field_key, at, (int)length);
     obj->m_lasWasValue = false;
 
     return 0;
@@ -133,7 +264,7 @@ int DHttpParser::onHeaderField(http_parser *parser, const char *at, size_t lengt
 int DHttpParser::onHeaderValue(http_parser *parser, const char *at, size_t length)
 {
     DHttpParser *obj = (DHttpParser*)parser->data;
-    obj->m_field_value.append(at, length);
+    obj->extend(obj->m_field_value, at, (int)length);
     obj->m_lasWasValue = true;
 
     return 0;
@@ -3,7 +3,7 @@
 
 #include "http_parser.h"
 #include "DString.hpp"
-#include <map>
+#include "DMemPool.hpp"
 
 // for http parser macros
 #define LMS_HTTP_METHOD_OPTIONS      HTTP_OPTIONS
@@ -12,6 +12,27 @@
 #define LMS_HTTP_METHOD_PUT          HTTP_PUT
 #define LMS_HTTP_METHOD_DELETE       HTTP_DELETE
 
+// interned header names, matched once when the header is parsed.
+enum DHttpHeaderId
+{
+    DHttpHeaderHost = 0,
+    DHttpHeaderReferer,
+    DHttpHeaderUserAgent,
+    DHttpHeaderConnection,
+    DHttpHeaderContentLength,
+    DHttpHeaderContentType,
+    DHttpHeaderTransferEncoding,
+    DHttpHeaderMax
+};
+
+// max number of other headers to keep, the rest are ignored.
+#define DHTTP_PARSER_MAX_FIELDS     32
+
+/**
+ * the header is copied into a buffer owned by the parser, url and fields are
+ * views into this buffer. the buffer is reused by next message, so views
+ * are valid until next reset.
+ */
 class DHttpParser
 {
 public:
@@ -21,12 +42,23 @@ public:
 
 public:
     int parse(const char *data, unsigned int length);
+    // prepare for next message, keep the buffer.
+    void reset();
 
     bool completed();
     DString getUrl();
     DString feild(const DString &key);
     DString method();
     duint16 statusCode();
+    // HTTP/1.1 without "Connection: close", or HTTP/1.0 with "Connection: keep-alive"
+    bool keepAlive();
+
+    DStringRef url();
+    DStringRef field(DHttpHeaderId id);
+    // header name is case insensitive.
+    DStringRef field(const char *key);
+    // compare with LMS_HTTP_METHOD_*
+    int methodId();
 
 public:
     // functions start with _ should not be called in outside.
@@ -39,7 +71,17 @@ public:
     static int onBody(http_parser* parser, const char* at, size_t length);
 
 private:
+    struct Range
+    {
+        int pos;
+        int len;
+    };
+
     void init();
+    void append(const char *data, int length);
+    void extend(Range &range, const char *at, int length);
+    void commitField();
+    DStringRef ref(const Range &range);
 
 private:
     http_parser_settings m_settings;
@@ -49,12 +91,19 @@ private:
     enum http_parser_type m_type;
 
     bool m_completed;
-    DString m_url;
+
+    MemoryChunk *m_buffer;
+
+    Range m_url;
 
     bool m_lasWasValue;
-    DString m_field_key;
-    DString m_field_value;
-    std::map<DString, DString> m_fields;
+    Range m_field_key;
+    Range m_field_value;
+
+    Range m_fields[DHttpHeaderMax];
+    Range m_other_keys[DHTTP_PARSER_MAX_FIELDS];
+    Range m_other_values[DHTTP_PARSER_MAX_FIELDS];
+    int m_other_count;
 };
 
 #endif // DHTTPPARSER_HPP
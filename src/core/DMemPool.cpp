@@ -5,11 +5,98 @@
 
 #define DEFAULT_BLOCK_SIZE   1048576   // 1024 * 1024
 
+// 线程局部变量，由DMemAccountScope设置
+static __thread DMemAccount *current_account = NULL;
+
+DMemAccount::DMemAccount()
+    : m_bytes(0)
+    , m_chunks(0)
+    , m_peak(0)
+    , m_ref(1)
+{
+
+}
+
+DMemAccount::~DMemAccount()
+{
+
+}
+
+DMemAccount *DMemAccount::retain()
+{
+    __sync_add_and_fetch(&m_ref, 1);
+    return this;
+}
+
+void DMemAccount::release()
+{
+    if (!__sync_sub_and_fetch(&m_ref, 1)) {
+        delete this;
+    }
+}
+
+dint64 DMemAccount::bytes() const
+{
+    return m_bytes;
+}
+
+dint64 DMemAccount::chunks() const
+{
+    return m_chunks;
+}
+
+dint64 DMemAccount::peak() const
+{
+    return m_peak;
+}
+
+DMemAccount *DMemAccount::current()
+{
+    return current_account;
+}
+
+void DMemAccount::add(int size)
+{
+    dint64 bytes = __sync_add_and_fetch(&m_bytes, (dint64)size);
+    __sync_add_and_fetch(&m_chunks, 1);
+
+    // 峰值只用于展示，不同线程同时更新时可能略小
+    if (bytes > m_peak) {
+        m_peak = bytes;
+    }
+}
+
+void DMemAccount::sub(int size)
+{
+    __sync_sub_and_fetch(&m_bytes, (dint64)size);
+    __sync_sub_and_fetch(&m_chunks, 1);
+}
+
+DMemAccountScope::DMemAccountScope(DMemAccount *account)
+    : m_account(account)
+    , m_prev(current_account)
+{
+    if (m_account) {
+        m_account->retain();
+    }
+    current_account = m_account;
+}
+
+DMemAccountScope::~DMemAccountScope()
+{
+    current_account = m_prev;
+    if (m_account) {
+        m_account->release();
+    }
+}
+
 MemoryChunk::MemoryChunk()
     : length(0)
     , data(NULL)
     , size(0)
     , block(NULL)
+    , account(NULL)
+    , ref(0)
 {
 
 }
@@ -38,6 +125,8 @@ DMemPool *DMemPool::m_instance = new DMemPool();
 DMemPool::DMemPool()
     : m_enable(true)
     , m_block_size(DEFAULT_BLOCK_SIZE)
+    , m_chunks(0)
+    , m_chunk_bytes(0)
 {
 
 }
@@ -49,11 +138,19 @@ DMemPool::~DMemPool()
 
 MemoryChunk *DMemPool::getMemory(int size)
 {
-    DSpinLocker locker(&m_mutex);
-
     MemoryChunk *chunk = new MemoryChunk();
     chunk->size = size;
 
+    if (current_account) {
+        chunk->account = current_account->retain();
+        chunk->account->add(size);
+    }
+
+    DSpinLocker locker(&m_mutex);
+
+    m_chunks++;
+    m_chunk_bytes += size;
+
     if ((size > m_block_size) || !m_enable) {
         chunk->data = new char[size];
         return chunk;
@@ -98,8 +195,17 @@ MemoryChunk *DMemPool::getMemory(int size)
 
 void DMemPool::destroyMemory(MemoryChunk *chunk)
 {
+    if (chunk->account) {
+        chunk->account->sub(chunk->size);
+        chunk->account->release();
+        chunk->account = NULL;
+    }
+
     DSpinLocker locker(&m_mutex);
 
+    m_chunks--;
+    m_chunk_bytes -= chunk->size;
+
     if ((chunk->size > m_block_size) || (chunk->block == NULL)) {
         DFree(chunk->data);
         return;
@@ -158,6 +264,20 @@ void DMemPool::print()
     printf("DMemPool: total=%d, idles=%d\n", m_pools.size(), m_pools.count(m_block_size));
 }
 
+DMemPoolStat DMemPool::stat()
+{
+    DSpinLocker locker(&m_mutex);
+
+    DMemPoolStat st;
+    st.block_size = m_block_size;
+    st.blocks = m_pools.size();
+    st.idle_blocks = m_pools.count(m_block_size);
+    st.chunks = m_chunks;
+    st.chunk_bytes = m_chunk_bytes;
+
+    return st;
+}
+
 void DMemPool::reduce()
 {
     // 测试
@@ -2,10 +2,70 @@
 #define DMEMPOOL_HPP
 
 #include "DSpinLock.hpp"
+#include "DSharedPtr.hpp"
+#include "DGlobal.hpp"
 #include <map>
 
 class MemoryBlock;
 
+/**
+ * @brief 内存的归属，按流或者连接统计正在使用的chunk字节数。
+ *        chunk分配时记到当前线程设置的account上，释放时扣除，chunk持有account的引用，
+ *        所以account的所有者释放后，还没有释放的chunk仍然可以安全扣除
+ */
+class DMemAccount
+{
+public:
+    DMemAccount();
+
+    DMemAccount *retain();
+    /**
+     * @brief 引用为0时释放
+     */
+    void release();
+
+    dint64 bytes() const;
+    dint64 chunks() const;
+    /**
+     * @brief 创建以来字节数的最大值
+     */
+    dint64 peak() const;
+
+    /**
+     * @brief 当前线程分配chunk时记到的account，没有设置时为NULL
+     */
+    static DMemAccount *current();
+
+private:
+    ~DMemAccount();
+
+    void add(int size);
+    void sub(int size);
+
+private:
+    friend class DMemPool;
+
+    volatile dint64 m_bytes;
+    volatile dint64 m_chunks;
+    volatile dint64 m_peak;
+    volatile int m_ref;
+};
+
+/**
+ * @brief 作用域内当前线程分配的chunk都记到account上，退出时恢复之前的account，可以嵌套。
+ *        作用域内持有account的引用，所有者在作用域内释放也是安全的
+ */
+class DMemAccountScope
+{
+public:
+    DMemAccountScope(DMemAccount *account);
+    ~DMemAccountScope();
+
+private:
+    DMemAccount *m_account;
+    DMemAccount *m_prev;
+};
+
 class MemoryChunk
 {
 public:
@@ -21,6 +81,84 @@ public:
     int size;
 
     MemoryBlock *block;
+
+    // 分配时所在线程的DMemAccount，持有引用，可以为NULL
+    DMemAccount *account;
+
+    // 引用计数，由DSharedPtr<MemoryChunk>原子增减，为0时释放
+    volatile int ref;
+};
+
+/**
+ * @brief MemoryChunk的引用计数保存在chunk中，不再单独分配计数器。
+ *        同一个chunk可以多次构造DSharedPtr
+ */
+template<>
+class DSharedPtr<MemoryChunk>
+{
+public:
+    DSharedPtr(MemoryChunk *p = 0)
+        : px(p)
+    {
+        acquire();
+    }
+
+    DSharedPtr(const DSharedPtr &r)
+        : px(r.px)
+    {
+        acquire();
+    }
+
+    ~DSharedPtr()
+    {
+        dispose();
+    }
+
+public:
+    DSharedPtr& operator=(const DSharedPtr &r)
+    {
+        if (px == r.px) {
+            return *this;
+        }
+        dispose();
+        px = r.px;
+        acquire();
+
+        return *this;
+    }
+
+    MemoryChunk &operator*() const
+    {
+        return *px;
+    }
+
+    MemoryChunk *operator->() const
+    {
+        return px;
+    }
+
+    MemoryChunk *get() const
+    {
+        return px;
+    }
+
+private:
+    void acquire()
+    {
+        if (px) {
+            __sync_add_and_fetch(&px->ref, 1);
+        }
+    }
+
+    void dispose()
+    {
+        if (px && !__sync_sub_and_fetch(&px->ref, 1)) {
+            delete px;
+        }
+    }
+
+private:
+    MemoryChunk *px;
 };
 
 class MemoryBlock
@@ -38,6 +176,20 @@ public:
     int count;
 };
 
+/**
+ * @brief 内存池的使用情况
+ */
+struct DMemPoolStat
+{
+    int block_size;
+    // 内存池中的block总数和完全空闲的block数
+    int blocks;
+    int idle_blocks;
+    // 正在使用的chunk数和字节数，包括不从block中分配的大块内存
+    dint64 chunks;
+    dint64 chunk_bytes;
+};
+
 class DMemPool
 {
 public:
@@ -53,6 +205,8 @@ public:
 
     void print();
 
+    DMemPoolStat stat();
+
     void reduce();
 
 private:
@@ -66,6 +220,9 @@ private:
 
     bool m_enable;
     int m_block_size;
+
+    dint64 m_chunks;
+    dint64 m_chunk_bytes;
 };
 
 #endif // DMEMPOOL_HPP
@@ -12,6 +12,7 @@ DSendFile::DSendFile(int sockfd)
     , m_offset(0)
     , m_count(0)
     , m_filesize(0)
+    , m_owned(true)
 {
 
 }
@@ -26,6 +27,7 @@ int DSendFile::open(const DString &filename)
     mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
 
     m_filefd = ::open(filename.c_str(), O_RDONLY, mode);
+    m_owned = true;
 
     if (m_filefd == -1) {
         return -1;
@@ -41,10 +43,24 @@ int DSendFile::open(const DString &filename)
     return 0;
 }
 
+int DSendFile::attach(int filefd, dint64 filesize)
+{
+    close();
+
+    m_filefd = filefd;
+    m_owned = false;
+    m_offset = 0;
+    m_count = m_filesize = filesize;
+
+    return 0;
+}
+
 void DSendFile::close()
 {
     if (m_filefd != -1) {
-        ::close(m_filefd);
+        if (m_owned) {
+            ::close(m_filefd);
+        }
         m_filefd = -1;
     }
 }
@@ -10,6 +10,8 @@ public:
     virtual ~DSendFile();
 
     int open(const DString &filename);
+    // send an opened file, the fd is owned by caller and not closed here.
+    int attach(int filefd, dint64 filesize);
     void close();
 
     int sendFile();
@@ -25,6 +27,8 @@ public:
     off_t m_offset;
     dint64 m_count;
     dint64 m_filesize;
+
+    bool m_owned;
 };
 
 #endif // DSENDFILE_HPP
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <strings.h>
 #include <inttypes.h>
 #include <math.h>
 
@@ -405,4 +406,84 @@ DString DString::number(double n)
     return buf;
 }
 
+DStringRef::DStringRef()
+    : data(NULL)
+    , length(0)
+{
+}
+
+DStringRef::DStringRef(const char *str)
+    : data(str)
+    , length(str ? strlen(str) : 0)
+{
+}
+
+DStringRef::DStringRef(const char *str, int n)
+    : data(str)
+    , length(n)
+{
+}
+
+bool DStringRef::equals(const char *str) const
+{
+    int len = strlen(str);
+    return len == length && memcmp(data, str, len) == 0;
+}
+
+bool DStringRef::iequals(const char *str) const
+{
+    int len = strlen(str);
+    return len == length && strncasecmp(data, str, len) == 0;
+}
+
+bool DStringRef::endWith(const char *str) const
+{
+    int len = strlen(str);
+    return len <= length && memcmp(data + length - len, str, len) == 0;
+}
+
+int DStringRef::find(char c, int from) const
+{
+    for (int i = from; i < length; ++i) {
+        if (data[i] == c) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int DStringRef::rfind(char c) const
+{
+    for (int i = length - 1; i >= 0; --i) {
+        if (data[i] == c) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+DStringRef DStringRef::mid(int pos, int n) const
+{
+    if (pos < 0 || pos >= length) {
+        return DStringRef();
+    }
+
+    if (n < 0 || pos + n > length) {
+        n = length - pos;
+    }
+
+    return DStringRef(data + pos, n);
+}
+
+DString DStringRef::toString() const
+{
+    if (length <= 0) {
+        return DString();
+    }
+
+    return DString(data, length);
+}
+
 
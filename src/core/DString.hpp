@@ -107,5 +107,41 @@ public:
     static DString number(double n);
 };
 
+/**
+ * a view of chars owned by others, never copy and never free.
+ * it becomes invalid when the owner's buffer is released or reused.
+ * Example:
+ *   DStringRef ref("/live/stream.flv?type=live", 26);
+ *   ref.find('?');              // returns  16
+ *   ref.mid(0, 16).toString();  // returns  "/live/stream.flv"
+ */
+class DStringRef
+{
+public:
+    DStringRef();
+    DStringRef(const char *str);
+    DStringRef(const char *str, int n);
+
+public:
+    inline bool isEmpty() const { return length <= 0; }
+
+    bool equals(const char *str) const;
+    // ignore case, for http header names and values
+    bool iequals(const char *str) const;
+    bool endWith(const char *str) const;
+
+    // returns -1 when not found
+    int find(char c, int from = 0) const;
+    int rfind(char c) const;
+
+    DStringRef mid(int pos, int n = -1) const;
+
+    DString toString() const;
+
+public:
+    const char *data;
+    int length;
+};
+
 
 #endif // DSTRING_HPP
@@ -11,6 +11,30 @@
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 
+// 线程局部变量，每个线程的统计在不同的内存中
+static __thread DSocketStat socket_stat;
+
+static const int write_size_bounds[SOCKET_WRITE_BUCKETS - 1] = {
+    512, 2048, 8192, 32768, 131072, 524288, 2097152
+};
+
+// 计算峰值速率的窗口，单位微秒
+#define SOCKET_RATE_WINDOW  (1000 * 1000)
+
+static inline dint64 monotonic_usec()
+{
+    struct timespec now = DDateTime::monotonic();
+    return (dint64)now.tv_sec * 1000 * 1000 + now.tv_nsec / 1000;
+}
+
+DSocketQos::DSocketQos()
+    : stalls(0)
+    , stall_usec(0)
+    , peak_rate(0)
+{
+
+}
+
 DTcpSocket::DTcpSocket(DEvent *event)
     : m_event(event)
     , m_fd(-1)
@@ -20,11 +44,20 @@ DTcpSocket::DTcpSocket(DEvent *event)
     , m_read_total_size(0)
     , m_write_pos(0)
     , m_write_buffer_len(0)
+    , m_write_total_size(0)
     , m_write_eagain(false)
+    , m_stall_start(0)
+    , m_rate_start(0)
+    , m_rate_bytes(0)
+    , m_own_memory(new DMemAccount())
     , m_read_timeout(-1)
     , m_write_timeout(-1)
+#ifdef LMS_ENABLE_TRACE
+    , m_trace_mark(0)
+    , m_trace_written(0)
+#endif
 {
-
+    m_memory = m_own_memory->retain();
 }
 
 DTcpSocket::DTcpSocket(DEvent *event, int fd)
@@ -36,11 +69,20 @@ DTcpSocket::DTcpSocket(DEvent *event, int fd)
     , m_read_total_size(0)
     , m_write_pos(0)
     , m_write_buffer_len(0)
+    , m_write_total_size(0)
     , m_write_eagain(false)
+    , m_stall_start(0)
+    , m_rate_start(0)
+    , m_rate_bytes(0)
+    , m_own_memory(new DMemAccount())
     , m_read_timeout(-1)
     , m_write_timeout(-1)
+#ifdef LMS_ENABLE_TRACE
+    , m_trace_mark(0)
+    , m_trace_written(0)
+#endif
 {
-
+    m_memory = m_own_memory->retain();
 }
 
 DTcpSocket::~DTcpSocket()
@@ -54,12 +96,17 @@ DTcpSocket::~DTcpSocket()
         DFree(m_write_chunks.at(i));
     }
     m_write_chunks.clear();
+
+    m_memory->release();
+    m_own_memory->release();
 }
 
 int DTcpSocket::onRead()
 {
     int ret = SOCKET_SUCCESS;
 
+    DMemAccountScope memory(m_memory);
+
     ret = readFromFd();
 
     if (ret == SOCKET_CLOSE) {
@@ -84,6 +131,8 @@ int DTcpSocket::onWrite()
 {
     int ret = SOCKET_SUCCESS;
 
+    DMemAccountScope memory(m_memory);
+
     if ((ret = checkConnectStatus()) != SOCKET_SUCCESS) {
         onErrorProcess();
         return ret;
@@ -91,6 +140,11 @@ int DTcpSocket::onWrite()
 
     m_write_eagain = false;
 
+    if (m_stall_start > 0) {
+        m_qos.stall_usec += monotonic_usec() - m_stall_start;
+        m_stall_start = 0;
+    }
+
     // 发送时会优先发送缓冲区的数据，如果在发送缓冲区数据时遇到eagain，直接返回，不触发回调
     if (m_write_buffer_len > 0) {
         if ((ret = flush()) != SOCKET_SUCCESS) {
@@ -188,6 +242,11 @@ int DTcpSocket::getReadBufferLength() const
     return m_read_buffer_length;
 }
 
+int DTcpSocket::getWriteBufferLength() const
+{
+    return m_write_buffer_len;
+}
+
 int DTcpSocket::checkConnectStatus()
 {
     if (m_connected) {
@@ -214,6 +273,11 @@ duint64 DTcpSocket::getTotalReadSize() const
     return m_read_total_size;
 }
 
+duint64 DTcpSocket::getTotalWriteSize() const
+{
+    return m_write_total_size;
+}
+
 int DTcpSocket::write(DSharedPtr<MemoryChunk> chunk, int length, int pos)
 {
     add(chunk, length, pos);
@@ -346,13 +410,36 @@ int DTcpSocket::writeToFd()
 eintr:
         int nwrite = writev(m_fd, iovs, iovcnt);
         if (nwrite > 0) {
+            int bucket = 0;
+            while (bucket < SOCKET_WRITE_BUCKETS - 1 && nwrite > write_size_bounds[bucket]) {
+                bucket++;
+            }
+            socket_stat.writes++;
+            socket_stat.write_bytes += nwrite;
+            socket_stat.write_sizes[bucket]++;
+
             m_write_buffer_len -= nwrite;
+            m_write_total_size += nwrite;
             outpufBufferUpdate(nwrite);
+            updateRate(nwrite);
+
+#ifdef LMS_ENABLE_TRACE
+            if (m_trace_mark > 0 && m_write_total_size >= m_trace_mark) {
+                struct timespec now = DDateTime::monotonic();
+                m_trace_written = (dint64)now.tv_sec * 1000 * 1000 + now.tv_nsec / 1000;
+                m_trace_mark = 0;
+            }
+#endif
 
             updateTimeOut(true);
         } else {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                socket_stat.eagains++;
                 m_write_eagain = true;
+
+                m_qos.stalls++;
+                m_stall_start = monotonic_usec();
+
                 return SOCKET_EAGAIN;
             }
 
@@ -367,6 +454,32 @@ eintr:
     return SOCKET_SUCCESS;
 }
 
+#ifdef LMS_ENABLE_TRACE
+void DTcpSocket::setTraceMark(duint64 offset)
+{
+    m_trace_mark = offset;
+    m_trace_written = 0;
+}
+
+dint64 DTcpSocket::traceWritten()
+{
+    dint64 written = m_trace_written;
+    m_trace_written = 0;
+
+    return written;
+}
+#endif
+
+DSocketStat *DTcpSocket::threadStat()
+{
+    return &socket_stat;
+}
+
+int DTcpSocket::writeSizeBound(int index)
+{
+    return write_size_bounds[index];
+}
+
 int DTcpSocket::copyDataFromBuffer(char *data, int len)
 {
     int ret = 0;
@@ -492,6 +605,70 @@ void DTcpSocket::outpufBufferUpdate(int nwrite)
     }
 }
 
+DSocketQos DTcpSocket::getQos()
+{
+    DSocketQos qos = m_qos;
+
+    if (m_stall_start > 0) {
+        qos.stall_usec += monotonic_usec() - m_stall_start;
+    }
+
+    return qos;
+}
+
+void DTcpSocket::resetQos()
+{
+    m_qos = DSocketQos();
+    m_stall_start = m_write_eagain ? monotonic_usec() : 0;
+    m_rate_start = 0;
+    m_rate_bytes = 0;
+}
+
+void DTcpSocket::setMemoryAccount(DMemAccount *account)
+{
+    if (!account) {
+        account = m_own_memory;
+    }
+
+    if (account == m_memory) {
+        return;
+    }
+
+    m_memory->release();
+    m_memory = account->retain();
+}
+
+DMemAccount *DTcpSocket::memoryAccount()
+{
+    return m_memory;
+}
+
+DMemAccount *DTcpSocket::ownMemoryAccount()
+{
+    return m_own_memory;
+}
+
+void DTcpSocket::updateRate(int nwrite)
+{
+    dint64 now = monotonic_usec();
+
+    if (m_rate_start == 0) {
+        m_rate_start = now;
+    }
+    m_rate_bytes += nwrite;
+
+    dint64 elapsed = now - m_rate_start;
+    if (elapsed < SOCKET_RATE_WINDOW) {
+        return;
+    }
+
+    duint64 rate = m_rate_bytes * 1000 * 1000 / elapsed;
+    m_qos.peak_rate = DMax(m_qos.peak_rate, rate);
+
+    m_rate_start = now;
+    m_rate_bytes = 0;
+}
+
 void DTcpSocket::updateTimeOut(bool send)
 {
     if (send) {
@@ -15,6 +15,36 @@
 
 class DTcpSocket;
 
+// 单次writev大小的直方图桶数，上限见DTcpSocket.cpp中的write_size_bounds，最后一个桶没有上限
+#define SOCKET_WRITE_BUCKETS    8
+
+/**
+ * @brief 每个线程一份的写统计，只由所属线程修改，其他线程读取时不加锁
+ */
+struct DSocketStat
+{
+    // writev成功的次数和字节数
+    duint64 writes;
+    duint64 write_bytes;
+    // writev遇到EAGAIN的次数
+    duint64 eagains;
+    duint64 write_sizes[SOCKET_WRITE_BUCKETS];
+};
+
+/**
+ * @brief 单个socket的发送质量，只由所属线程修改
+ */
+struct DSocketQos
+{
+    DSocketQos();
+
+    // writev遇到EAGAIN到重新可写的次数和累计时间，单位微秒，没有恢复的也计算到当前
+    duint64 stalls;
+    duint64 stall_usec;
+    // 按秒计算的最高发送速率，单位字节每秒
+    duint64 peak_rate;
+};
+
 struct SendBuffer
 {
     // 开始位置
@@ -98,6 +128,18 @@ public:
      */
     duint64 getTotalReadSize() const;
 
+    /**
+     * @brief getWriteBufferLength 获取写队列中还没有发出去的数据长度
+     * @return
+     */
+    int getWriteBufferLength() const;
+
+    /**
+     * @brief getTotalWriteSize 获取socket已经发出去的数据的总大小
+     * @return
+     */
+    duint64 getTotalWriteSize() const;
+
     /**
      * @brief write
      * @param chunk
@@ -123,6 +165,43 @@ public:
     bool setKeepAlive(bool value);
     bool setNonblocking();
 
+    DSocketQos getQos();
+    /**
+     * @brief 重新开始统计发送质量，http保持连接的下一个请求调用
+     */
+    void resetQos();
+
+    /**
+     * @brief 读写事件中分配的内存记到account上，推流和回源设置为流的account，
+     *        为NULL时恢复为连接自己的account
+     */
+    void setMemoryAccount(DMemAccount *account);
+    DMemAccount *memoryAccount();
+    /**
+     * @brief 连接自己的account，不包括记到流上的内存
+     */
+    DMemAccount *ownMemoryAccount();
+
+    /**
+     * @brief 当前线程的写统计
+     */
+    static DSocketStat *threadStat();
+    /**
+     * @brief 写入大小直方图第index个桶的上限，单位字节
+     */
+    static int writeSizeBound(int index);
+
+#ifdef LMS_ENABLE_TRACE
+    /**
+     * @brief 已发送的总量达到offset时记录当前的单调时钟，同时只有一个标记
+     */
+    void setTraceMark(duint64 offset);
+    /**
+     * @brief 返回达到标记的时间，单位微秒，还没有达到返回0。返回后清除
+     */
+    dint64 traceWritten();
+#endif
+
 protected:
     /**
      * @brief readFromFd 从系统socket的fd中读数据
@@ -144,6 +223,11 @@ protected:
 
     void updateTimeOut(bool send);
 
+    /**
+     * @brief 累加本秒发送的字节数，超过一秒时计算速率并更新峰值
+     */
+    void updateRate(int nwrite);
+
     /**
      * @brief socket
      * @return 成功返回0，失败返回-1
@@ -177,13 +261,32 @@ protected:
     std::deque<SendBuffer*> m_write_chunks;
     int m_write_pos;
     int m_write_buffer_len;
+    // 已经发出去的数据的总大小
+    duint64 m_write_total_size;
 
     bool m_write_eagain;
 
+    DSocketQos m_qos;
+    // 遇到EAGAIN的时间，可写后清零，单位微秒
+    dint64 m_stall_start;
+    // 当前速率统计窗口的开始时间和发送的字节数
+    dint64 m_rate_start;
+    duint64 m_rate_bytes;
+
+    // 当前记账的account和连接自己的account，都持有引用
+    DMemAccount *m_memory;
+    DMemAccount *m_own_memory;
+
 protected:
     dint64 m_read_timeout;
     dint64 m_write_timeout;
 
+#ifdef LMS_ENABLE_TRACE
+protected:
+    duint64 m_trace_mark;
+    dint64 m_trace_written;
+#endif
+
 };
 
 #endif // DTCPSOCKET_HPP
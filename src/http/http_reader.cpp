@@ -41,6 +41,9 @@ int http_reader::service()
         case HttpBody:
             ret = read_http_body();
             break;
+        case HttpHold:
+            ret = SOCKET_EAGAIN;
+            break;
         default:
             break;
         }
@@ -245,6 +248,27 @@ bool http_reader::empty()
     return m_body_len == 0;
 }
 
+void http_reader::hold()
+{
+    m_h_type = HttpHold;
+}
+
+void http_reader::reset()
+{
+    for (int i = 0; i < (int)m_recv_chunks.size(); ++i) {
+        DFree(m_recv_chunks.at(i));
+    }
+    m_recv_chunks.clear();
+
+    m_nb_chunk_header = 0;
+    m_nb_chunk = 0;
+    m_recv_pos = 0;
+    m_body_len = 0;
+    m_chunked = true;
+    m_h_type = HttpHeader;
+    m_type = Header;
+}
+
 int http_reader::read_http_header()
 {
     int ret = ERROR_SUCCESS;
@@ -265,16 +289,22 @@ int http_reader::read_http_header()
         return ret;
     }
 
-    DString content(chunk->data, chunk->length);
-
-    DString delim("\r\n\r\n");
-    size_t index = content.find(delim);
-    if (index == string::npos) {
+    // 直接在拷贝出的数据中查找header结尾，不构造字符串
+    int header_len = -1;
+    for (int i = 0; i + 3 < len; ++i) {
+        if (memcmp(chunk->data + i, "\r\n\r\n", 4) == 0) {
+            header_len = i + 4;
+            break;
+        }
+    }
+    if (header_len < 0) {
         return SOCKET_EAGAIN;
     }
-    DString header = content.substr(0, index + delim.size());
 
-    if (m_parser->parse(header.data(), header.length()) != ERROR_SUCCESS) {
+    // 每次都从头解析完整的header，parser复用自己的缓冲区
+    m_parser->reset();
+
+    if (m_parser->parse(chunk->data, header_len) != ERROR_SUCCESS) {
         ret = ERROR_HTTP_HEADER_PARSER;
         log_error("parse http header failed. ret=%d", ret);
         return ret;
@@ -284,10 +314,8 @@ int http_reader::read_http_header()
         return SOCKET_EAGAIN;
     }
 
-    MemoryChunk *buf = DMemPool::instance()->getMemory(header.size());
-    DAutoFree(MemoryChunk, buf);
-
-    if ((ret = m_socket->read(buf->data, header.length())) != ERROR_SUCCESS) {
+    // header已经拷贝到parser中，chunk只用来丢弃socket中的header数据
+    if ((ret = m_socket->read(chunk->data, header_len)) != ERROR_SUCCESS) {
         ret = ERROR_HTTP_READ_HEADER;
         log_error("read http header for reduce data failed. ret=%d", ret);
         return ret;
@@ -295,8 +323,7 @@ int http_reader::read_http_header()
 
     m_h_type = HttpBody;
 
-    DString encoding = m_parser->feild("Transfer-Encoding");
-    if (encoding != "chunked") {
+    if (!m_parser->field(DHttpHeaderTransferEncoding).iequals("chunked")) {
         m_chunked = false;
     }
 
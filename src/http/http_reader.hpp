@@ -25,6 +25,15 @@ public:
 
     bool empty();
 
+    /**
+     * @brief 当前请求没有body，处理完header后不再读取数据，后面的数据属于下一个请求
+     */
+    void hold();
+    /**
+     * @brief 开始读取同一个连接上的下一个请求
+     */
+    void reset();
+
 private:
     int read_chunk();
     int read_chunk_header();
@@ -60,7 +69,8 @@ private:
     enum http_schedule
     {
         HttpHeader = 0,
-        HttpBody
+        HttpBody,
+        HttpHold
     };
     dint8 m_h_type;
 
@@ -87,6 +87,64 @@ bool kernel_codec::video_is_h265(char *data, int size)
     return codec_id == CodecVideoHEVC;
 }
 
+bool kernel_codec::video_is_disposable(char *data, int size)
+{
+    // 5bytes required.
+    if (size < 5) {
+        return false;
+    }
+
+    char frame_type = (data[0] >> 4) & 0x0F;
+    if (frame_type == CodecVideoAVCFrameDisposableInterFrame) {
+        return true;
+    }
+    if (frame_type != CodecVideoAVCFrameInterFrame) {
+        return false;
+    }
+
+    bool h264 = video_is_h264(data, size);
+    bool h265 = video_is_h265(data, size);
+    if ((!h264 && !h265) || data[1] != CodecVideoAVCTypeNALU) {
+        return false;
+    }
+
+    bool found = false;
+    int pos = 5;
+
+    while (pos + 4 < size) {
+        duint8 *p = (duint8*)data + pos;
+        int nal_size = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        if (nal_size <= 0 || nal_size > size - pos - 4) {
+            return false;
+        }
+
+        duint8 header = p[4];
+        if (h264) {
+            int nal_type = header & 0x1F;
+            // coded slice
+            if (nal_type >= 1 && nal_type <= 5) {
+                if ((header >> 5) & 0x03) {
+                    return false;
+                }
+                found = true;
+            }
+        } else {
+            int nal_type = (header >> 1) & 0x3F;
+            // VCL, even types below 16 are sub-layer non-reference
+            if (nal_type < 32) {
+                if (nal_type >= 16 || (nal_type & 0x01)) {
+                    return false;
+                }
+                found = true;
+            }
+        }
+
+        pos += 4 + nal_size;
+    }
+
+    return found;
+}
+
 bool kernel_codec::audio_is_aac(char* data, int size)
 {
     // 1bytes required.
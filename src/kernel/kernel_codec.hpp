@@ -142,6 +142,13 @@ public:
     static bool video_is_h264(char* data, int size);
     static bool video_is_h265(char* data, int size);
     /**
+    * check the frame can be dropped without breaking the decoding of others:
+    * flv disposable inter frame, or h264/h265 frame whose slices are all
+    * non-reference (nal_ref_idc == 0 / sub-layer non-reference).
+    * the NALUs must use 4 bytes length.
+    */
+    static bool video_is_disposable(char* data, int size);
+    /**
     * check codec aac.
     */
     static bool audio_is_aac(char* data, int size);
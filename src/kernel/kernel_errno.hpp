@@ -185,10 +185,21 @@
 #define ERROR_SOURCE_ONPUBLISH              1136
 #define ERROR_SOURCE_ADD_CONNECTION         1137
 #define ERROR_SOURCE_ADD_RELOAD             1138
+#define ERROR_SOURCE_PREWARM                1141
 
 #define ERROR_NO_HANDLER                    1139
 
 #define ERROR_LOOKUP_HOST                   1140
 
+#define ERROR_HTTP_API_REJECT               1142
+#define ERROR_HTTP_API_UNSUPPORTED          1143
+#define ERROR_HTTP_TOKEN_REJECT             1144
+
+#define ERROR_CAPTURE_FORMAT                1145
+
+#define ERROR_PROFILER_BUSY                 1146
+#define ERROR_PROFILER_START                1147
+#define ERROR_PROFILER_THREAD               1148
+
 
 #endif // KERNEL_ERRNO_HPP
@@ -6,11 +6,18 @@ CommonMessage::CommonMessage()
     , dts(0)
     , cts(0)
     , payload_length(0)
+    , corrected(false)
+#ifdef LMS_ENABLE_TRACE
+    , trace_ingest(0)
+    , trace_fanout(0)
+#endif
+    , m_ref(1)
 {
 
 }
 
 CommonMessage::CommonMessage(CommonMessage *msg)
+    : m_ref(1)
 {
     this->dts = msg->dts;
     this->cts = msg->cts;
@@ -19,6 +26,14 @@ CommonMessage::CommonMessage(CommonMessage *msg)
     this->type = msg->type;
     this->sequence_header = msg->sequence_header;
     this->keyframe = msg->keyframe;
+    this->corrected = msg->corrected;
+    for (int i = 0; i < CommonMessageCorrectTypes; ++i) {
+        this->correct_dts[i] = msg->correct_dts[i];
+    }
+#ifdef LMS_ENABLE_TRACE
+    this->trace_ingest = msg->trace_ingest;
+    this->trace_fanout = msg->trace_fanout;
+#endif
 }
 
 CommonMessage::~CommonMessage()
@@ -26,6 +41,19 @@ CommonMessage::~CommonMessage()
 
 }
 
+CommonMessage *CommonMessage::retain()
+{
+    __sync_add_and_fetch(&m_ref, 1);
+    return this;
+}
+
+void CommonMessage::release()
+{
+    if (!__sync_sub_and_fetch(&m_ref, 1)) {
+        delete this;
+    }
+}
+
 void CommonMessage::copy(CommonMessage *msg)
 {
     this->dts = msg->dts;
@@ -35,4 +63,12 @@ void CommonMessage::copy(CommonMessage *msg)
     this->type = msg->type;
     this->sequence_header = msg->sequence_header;
     this->keyframe = msg->keyframe;
+    this->corrected = msg->corrected;
+    for (int i = 0; i < CommonMessageCorrectTypes; ++i) {
+        this->correct_dts[i] = msg->correct_dts[i];
+    }
+#ifdef LMS_ENABLE_TRACE
+    this->trace_ingest = msg->trace_ingest;
+    this->trace_fanout = msg->trace_fanout;
+#endif
 }
@@ -10,6 +10,13 @@
 #define CommonMessageVideo       0x09
 #define CommonMessageMetadata    0x12
 
+// 时间戳修正的方式数，和LmsTimeStamp::CorrectType对应
+#define CommonMessageCorrectTypes   3
+
+/**
+ * @brief 音视频消息。分发给多个线程和连接时使用引用计数共享同一个消息，
+ *        共享后不能再修改，每个连接的时间戳由lms_stream_writer单独保存
+ */
 class CommonMessage
 {
 public:
@@ -19,6 +26,15 @@ public:
 
     virtual void copy(CommonMessage *msg);
 
+    /**
+     * @brief 增加引用计数，返回自身。只能用于new出来的消息
+     */
+    CommonMessage *retain();
+    /**
+     * @brief 减少引用计数，为0时释放
+     */
+    void release();
+
     bool is_audio() { return type == CommonMessageAudio; }
     bool is_video() { return type == CommonMessageVideo; }
     bool is_metadata() { return type == CommonMessageMetadata; }
@@ -37,6 +53,19 @@ public:
     dint32 payload_length;
     DSharedPtr<MemoryChunk> payload;
 
+    // source按每种方式修正后的时间戳，corrected为false时无效
+    bool corrected;
+    dint64 correct_dts[CommonMessageCorrectTypes];
+
+#ifdef LMS_ENABLE_TRACE
+    // 采样消息的接收和分发时间，单调时钟微秒，没有采样为0，见lms_trace.hpp
+    dint64 trace_ingest;
+    dint64 trace_fanout;
+#endif
+
+private:
+    volatile int m_ref;
+
 };
 
 typedef std::tr1::function<int (CommonMessage*)> AVHandler;
@@ -77,61 +77,70 @@ void kernel_request::set_stream(const DString &value)
     }
 }
 
-void kernel_request::set_http_url(const DString &_host, const DString &url, const DString &refer, bool del_suffix)
+void kernel_request::set_http_url(const DStringRef &_host, const DStringRef &url, const DStringRef &refer, bool del_suffix)
 {
-    size_t pos = std::string::npos;
-
-    host = _host;
-    port = "80";
-    if ((pos = host.find(":")) != std::string::npos) {
-        port = host.substr(pos + 1);
-        host = host.substr(0, pos);
+    int pos = _host.find(':');
+    if (pos >= 0) {
+        host = _host.mid(0, pos).toString();
+        port = _host.mid(pos + 1).toString();
+    } else {
+        host = _host.toString();
+        port = "80";
     }
 
     vhost = host;
 
-    DString _url = url;
-    DString location = url;
+    DStringRef location = url;
 
-    pos = std::string::npos;
-    if ((pos = _url.find("?")) != std::string::npos) {
-        location = _url.substr(0, pos);
-        _url = _url.substr(location.length() + 1);
-        oriParam = _url;
-    }
+    if ((pos = url.find('?')) >= 0) {
+        location = url.mid(0, pos);
+        DStringRef query = url.mid(pos + 1);
+        oriParam = query.toString();
 
-    DStringList args = _url.split("&");
-    for (int i = 0; i < (int)args.size(); ++i) {
-        DStringList temp = args.at(i).split("=");
-        if (temp.size() == 2) {
-            if (temp.at(0) == "vhost") {
-                vhost = temp.at(1);
-            } else {
-                params[temp.at(0)] = temp.at(1);
+        int start = 0;
+        while (start < query.length) {
+            int end = query.find('&', start);
+            if (end < 0) {
+                end = query.length;
+            }
+
+            // 只接受key=value的形式，和split的结果一致
+            DStringRef arg = query.mid(start, end - start);
+            int eq = arg.find('=');
+            if (eq > 0 && eq < arg.length - 1 && arg.find('=', eq + 1) < 0) {
+                DStringRef key = arg.mid(0, eq);
+                DStringRef value = arg.mid(eq + 1);
+                if (key.equals("vhost")) {
+                    vhost = value.toString();
+                } else {
+                    params[key.toString()] = value.toString();
+                }
             }
+
+            start = end + 1;
         }
     }
 
-    if ((pos = location.rfind("/")) != string::npos) {
-        stream = location.substr(pos + 1);
-        app = location.substr(0, pos);
-    } else {
-        app = location;
+    DStringRef _app = location;
+    DStringRef _stream;
+    if ((pos = location.rfind('/')) >= 0) {
+        _stream = location.mid(pos + 1);
+        _app = location.mid(0, pos);
     }
 
-    if (app.startWith("/")) {
-        app = app.substr(1);
+    if (_app.length > 0 && _app.data[0] == '/') {
+        _app = _app.mid(1);
     }
 
-    if (del_suffix) {
-        pos = string::npos;
-        if ((pos = stream.rfind(".")) != string::npos) {
-            stream = stream.substr(0, pos);
-        }
+    if (del_suffix && (pos = _stream.rfind('.')) >= 0) {
+        _stream = _stream.mid(0, pos);
     }
 
+    app = _app.toString();
+    stream = _stream.toString();
+
     tcUrl = "rtmp://" + vhost + "/" + app;
-    pageUrl = refer;
+    pageUrl = refer.toString();
     schema = "http";
 
     if (check_ip(vhost)) {
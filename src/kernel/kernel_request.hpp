@@ -23,7 +23,8 @@ public:
     void set_stream(const DString &value);
 
     // /live/livestream.flv?vhost=test.com&arg1=temp&arg2=temp
-    void set_http_url(const DString &_host, const DString &url, const DString &refer, bool del_suffix);
+    // 参数直接指向http header，只在最后生成需要保存的字段
+    void set_http_url(const DStringRef &_host, const DStringRef &url, const DStringRef &refer, bool del_suffix);
 
     DString get_stream_url();
 
@@ -561,6 +561,8 @@ lms_proxy_config_struct::lms_proxy_config_struct()
     , exist_stream(false)
     , exist_timeout(false)
     , timeout(10)
+    , exist_linger(false)
+    , linger(0)
     , ts_codec(NULL)
 {
 
@@ -616,6 +618,17 @@ void lms_proxy_config_struct::load_config(lms_config_directive *directive)
         }
     }
 
+    if (true) {
+        lms_config_directive *conf = directive->get("proxy_forward");
+        if (conf) {
+            for (int i = 0; i < (int)conf->args.size(); i++) {
+                proxy_forward.push_back(conf->args.at(i));
+
+                log_trace("proxy_forward=%s", conf->args.at(i).c_str());
+            }
+        }
+    }
+
     if (true) {
         lms_config_directive *conf = directive->get("proxy_vhost");
         if (conf && !conf->arg(0).isEmpty()) {
@@ -660,6 +673,18 @@ void lms_proxy_config_struct::load_config(lms_config_directive *directive)
             log_trace("timeout=%s", conf->arg(0).c_str());
         }
     }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("proxy_linger");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            linger = conf->arg(0).toInt();
+
+            exist_linger = true;
+
+            log_trace("proxy_linger=%s", conf->arg(0).c_str());
+        }
+    }
 }
 
 lms_proxy_config_struct *lms_proxy_config_struct::copy()
@@ -688,9 +713,15 @@ lms_proxy_config_struct *lms_proxy_config_struct::copy()
         proxy->proxy_pass.assign(proxy_pass.begin(), proxy_pass.end());
     }
 
+    if (!proxy_forward.empty()) {
+        proxy->proxy_forward.assign(proxy_forward.begin(), proxy_forward.end());
+    }
+
     if (ts_codec) {
         proxy->ts_codec = ts_codec->copy();
     }
+    proxy->exist_linger = exist_linger;
+    proxy->linger = linger;
 
     return proxy;
 }
@@ -720,6 +751,15 @@ bool lms_proxy_config_struct::get_proxy_pass(std::vector<DString> &value)
     return false;
 }
 
+bool lms_proxy_config_struct::get_proxy_forward(std::vector<DString> &value)
+{
+    if (!proxy_forward.empty()) {
+        value.assign(proxy_forward.begin(), proxy_forward.end());
+        return true;
+    }
+    return false;
+}
+
 bool lms_proxy_config_struct::get_proxy_vhost(DString &value)
 {
     if (exist_vhost) {
@@ -770,6 +810,14 @@ bool lms_proxy_config_struct::get_proxy_ts_vcodec(DString &value)
     return false;
 }
 
+bool lms_proxy_config_struct::get_proxy_linger(int &value)
+{
+    if (exist_linger) {
+        value = linger;
+    }
+    return exist_linger;
+}
+
 /*****************************************************************************/
 
 lms_live_config_struct::lms_live_config_struct()
@@ -783,6 +831,12 @@ lms_live_config_struct::lms_live_config_struct()
     , fast_gop(false)
     , exist_queue_size(false)
     , queue_size(30)
+    , exist_target_latency(false)
+    , target_latency(0)
+    , exist_capture(false)
+    , capture(false)
+    , exist_capture_path(false)
+    , capture_path("capture/[vhost]/[app]/[stream]_[timestamp].lmsc")
 {
 
 }
@@ -864,6 +918,43 @@ void lms_live_config_struct::load_config(lms_config_directive *directive)
             log_trace("exist_queue_size=%s", conf->arg(0).c_str());
         }
     }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("target_latency");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            target_latency = conf->arg(0).toInt();
+
+            exist_target_latency = true;
+
+            log_trace("target_latency=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("capture");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            if (conf->arg(0) == "on") {
+                capture = true;
+            }
+            exist_capture = true;
+
+            log_trace("capture=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("capture_path");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            capture_path = conf->arg(0);
+
+            exist_capture_path = true;
+
+            log_trace("capture_path=%s", conf->arg(0).c_str());
+        }
+    }
 }
 
 lms_live_config_struct *lms_live_config_struct::copy()
@@ -880,6 +971,12 @@ lms_live_config_struct *lms_live_config_struct::copy()
     live->fast_gop = fast_gop;
     live->exist_queue_size = exist_queue_size;
     live->queue_size = queue_size;
+    live->exist_target_latency = exist_target_latency;
+    live->target_latency = target_latency;
+    live->exist_capture = exist_capture;
+    live->capture = capture;
+    live->exist_capture_path = exist_capture_path;
+    live->capture_path = capture_path;
 
     return live;
 }
@@ -924,6 +1021,30 @@ bool lms_live_config_struct::get_queue_size(int &size)
     return exist_queue_size;
 }
 
+bool lms_live_config_struct::get_target_latency(int &val)
+{
+    if (exist_target_latency) {
+        val = target_latency;
+    }
+    return exist_target_latency;
+}
+
+bool lms_live_config_struct::get_capture(bool &val)
+{
+    if (exist_capture) {
+        val = capture;
+    }
+    return exist_capture;
+}
+
+bool lms_live_config_struct::get_capture_path(DString &val)
+{
+    if (exist_capture_path) {
+        val = capture_path;
+    }
+    return exist_capture_path;
+}
+
 /*****************************************************************************/
 
 lms_rtmp_config_struct::lms_rtmp_config_struct()
@@ -935,6 +1056,10 @@ lms_rtmp_config_struct::lms_rtmp_config_struct()
     , in_ack_size(0)
     , exist_timeout(false)
     , timeout(30)
+    , exist_aggregate_duration(false)
+    , aggregate_duration(0)
+    , exist_chunk_size_max(false)
+    , chunk_size_max(0)
 {
 
 }
@@ -992,6 +1117,30 @@ void lms_rtmp_config_struct::load_config(lms_config_directive *directive)
             log_trace("timeout=%s", conf->arg(0).c_str());
         }
     }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("aggregate_duration");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            aggregate_duration = conf->arg(0).toInt();
+
+            exist_aggregate_duration = true;
+
+            log_trace("aggregate_duration=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("chunk_size_max");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            chunk_size_max = conf->arg(0).toInt();
+
+            exist_chunk_size_max = true;
+
+            log_trace("chunk_size_max=%s", conf->arg(0).c_str());
+        }
+    }
 }
 
 lms_rtmp_config_struct *lms_rtmp_config_struct::copy()
@@ -1006,6 +1155,10 @@ lms_rtmp_config_struct *lms_rtmp_config_struct::copy()
     rtmp->in_ack_size = in_ack_size;
     rtmp->exist_timeout = exist_timeout;
     rtmp->timeout = timeout;
+    rtmp->exist_aggregate_duration = exist_aggregate_duration;
+    rtmp->aggregate_duration = aggregate_duration;
+    rtmp->exist_chunk_size_max = exist_chunk_size_max;
+    rtmp->chunk_size_max = chunk_size_max;
 
     return rtmp;
 }
@@ -1042,6 +1195,22 @@ bool lms_rtmp_config_struct::get_timeout(int &time)
     return exist_timeout;
 }
 
+bool lms_rtmp_config_struct::get_aggregate_duration(int &val)
+{
+    if (exist_aggregate_duration) {
+        val = aggregate_duration;
+    }
+    return exist_aggregate_duration;
+}
+
+bool lms_rtmp_config_struct::get_chunk_size_max(int &val)
+{
+    if (exist_chunk_size_max) {
+        val = chunk_size_max;
+    }
+    return exist_chunk_size_max;
+}
+
 /*****************************************************************************/
 
 lms_http_config_struct::lms_http_config_struct()
@@ -1063,6 +1232,12 @@ lms_http_config_struct::lms_http_config_struct()
     , exist_ts_live_enable(false)
     , ts_live_enable(false)
     , ts_codec(NULL)
+    , exist_keepalive_timeout(false)
+    , keepalive_timeout(15)
+    , exist_file_cache_valid(false)
+    , file_cache_valid(0)
+    , exist_api(false)
+    , api(false)
 {
 
 }
@@ -1189,6 +1364,44 @@ void lms_http_config_struct::load_config(lms_config_directive *directive)
             exist_ts_live_enable = true;
         }
     }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("keepalive_timeout");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            keepalive_timeout = conf->arg(0).toInt();
+
+            exist_keepalive_timeout = true;
+
+            log_trace("keepalive_timeout=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("file_cache_valid");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            file_cache_valid = conf->arg(0).toInt();
+
+            exist_file_cache_valid = true;
+
+            log_trace("file_cache_valid=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("api");
+
+        if (conf && !conf->arg(0).isEmpty()) {
+            if (conf->arg(0) == "on") {
+                api = true;
+            }
+
+            exist_api = true;
+
+            log_trace("api=%s", conf->arg(0).c_str());
+        }
+    }
 }
 
 lms_http_config_struct *lms_http_config_struct::copy()
@@ -1217,6 +1430,12 @@ lms_http_config_struct *lms_http_config_struct::copy()
     if (ts_codec) {
         http->ts_codec = ts_codec->copy();
     }
+    http->exist_keepalive_timeout = exist_keepalive_timeout;
+    http->keepalive_timeout = keepalive_timeout;
+    http->exist_file_cache_valid = exist_file_cache_valid;
+    http->file_cache_valid = file_cache_valid;
+    http->exist_api = exist_api;
+    http->api = api;
 
     return http;
 
@@ -1316,6 +1535,30 @@ bool lms_http_config_struct::get_ts_recv_enable(bool &val)
     return exist_ts_recv_enable;
 }
 
+bool lms_http_config_struct::get_keepalive_timeout(int &val)
+{
+    if (exist_keepalive_timeout) {
+        val = keepalive_timeout;
+    }
+    return exist_keepalive_timeout;
+}
+
+bool lms_http_config_struct::get_file_cache_valid(int &val)
+{
+    if (exist_file_cache_valid) {
+        val = file_cache_valid;
+    }
+    return exist_file_cache_valid;
+}
+
+bool lms_http_config_struct::get_api(bool &val)
+{
+    if (exist_api) {
+        val = api;
+    }
+    return exist_api;
+}
+
 /*****************************************************************************/
 
 lms_refer_config_struct::lms_refer_config_struct()
@@ -1438,6 +1681,154 @@ bool lms_refer_config_struct::get_play(std::vector<DString> &value)
 
 /*****************************************************************************/
 
+lms_token_config_struct::lms_token_config_struct()
+    : exist_enable(false)
+    , enable(false)
+    , exist_publish(false)
+    , publish(true)
+    , exist_play(false)
+    , play(true)
+    , exist_check_ip(false)
+    , check_ip(false)
+{
+
+}
+
+lms_token_config_struct::~lms_token_config_struct()
+{
+
+}
+
+void lms_token_config_struct::load_config(lms_config_directive *directive)
+{
+    if (true) {
+        lms_config_directive *conf = directive->get("enable");
+        if (conf && !conf->arg(0).isEmpty()) {
+            if (conf->arg(0) == "on") {
+                enable = true;
+            }
+
+            exist_enable = true;
+
+            log_trace("enable=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("key");
+        if (conf) {
+            for (int i = 0; i < (int)conf->args.size(); i++) {
+                keys.push_back(conf->args.at(i));
+            }
+
+            log_trace("key count=%d", (int)keys.size());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("publish");
+        if (conf && !conf->arg(0).isEmpty()) {
+            if (conf->arg(0) == "off") {
+                publish = false;
+            }
+
+            exist_publish = true;
+
+            log_trace("publish=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("play");
+        if (conf && !conf->arg(0).isEmpty()) {
+            if (conf->arg(0) == "off") {
+                play = false;
+            }
+
+            exist_play = true;
+
+            log_trace("play=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        lms_config_directive *conf = directive->get("check_ip");
+        if (conf && !conf->arg(0).isEmpty()) {
+            if (conf->arg(0) == "on") {
+                check_ip = true;
+            }
+
+            exist_check_ip = true;
+
+            log_trace("check_ip=%s", conf->arg(0).c_str());
+        }
+    }
+}
+
+lms_token_config_struct *lms_token_config_struct::copy()
+{
+    lms_token_config_struct *token = new lms_token_config_struct();
+
+    token->exist_enable = exist_enable;
+    token->enable = enable;
+
+    if (!keys.empty()) {
+        token->keys.assign(keys.begin(), keys.end());
+    }
+
+    token->exist_publish = exist_publish;
+    token->publish = publish;
+    token->exist_play = exist_play;
+    token->play = play;
+    token->exist_check_ip = exist_check_ip;
+    token->check_ip = check_ip;
+
+    return token;
+}
+
+bool lms_token_config_struct::get_enable(bool &val)
+{
+    if (exist_enable) {
+        val = enable;
+    }
+    return exist_enable;
+}
+
+bool lms_token_config_struct::get_keys(std::vector<DString> &value)
+{
+    if (!keys.empty()) {
+        value.assign(keys.begin(), keys.end());
+        return true;
+    }
+    return false;
+}
+
+bool lms_token_config_struct::get_publish(bool &val)
+{
+    if (exist_publish) {
+        val = publish;
+    }
+    return exist_publish;
+}
+
+bool lms_token_config_struct::get_play(bool &val)
+{
+    if (exist_play) {
+        val = play;
+    }
+    return exist_play;
+}
+
+bool lms_token_config_struct::get_check_ip(bool &val)
+{
+    if (exist_check_ip) {
+        val = check_ip;
+    }
+    return exist_check_ip;
+}
+
+/*****************************************************************************/
+
 lms_hook_config_struct::lms_hook_config_struct()
     : exist_timeout(false)
 {
@@ -1632,6 +2023,7 @@ lms_location_config_struct::lms_location_config_struct()
     , proxy(NULL)
     , http(NULL)
     , refer(NULL)
+    , token(NULL)
     , hook(NULL)
     , hls(NULL)
     , flv(NULL)
@@ -1646,6 +2038,7 @@ lms_location_config_struct::~lms_location_config_struct()
     DFree(proxy);
     DFree(http);
     DFree(refer);
+    DFree(token);
     DFree(hook);
     DFree(hls);
     DFree(flv);
@@ -1702,6 +2095,14 @@ void lms_location_config_struct::load_config(lms_config_directive *directive)
         }
     }
 
+    if (true) {
+        lms_config_directive *conf = directive->get("token");
+        if (conf) {
+            token = new lms_token_config_struct();
+            token->load_config(conf);
+        }
+    }
+
     if (true) {
         lms_config_directive *conf = directive->get("hook");
         if (conf) {
@@ -1748,6 +2149,9 @@ lms_location_config_struct *lms_location_config_struct::copy()
     if (refer) {
         location->refer = refer->copy();
     }
+    if (token) {
+        location->token = token->copy();
+    }
     if (hook) {
         location->hook = hook->copy();
     }
@@ -1861,6 +2265,24 @@ bool lms_location_config_struct::get_rtmp_timeout(int &value)
     return false;
 }
 
+bool lms_location_config_struct::get_rtmp_aggregate_duration(int &value)
+{
+    if (rtmp) {
+        return rtmp->get_aggregate_duration(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_rtmp_chunk_size_max(int &value)
+{
+    if (rtmp) {
+        return rtmp->get_chunk_size_max(value);
+    }
+
+    return false;
+}
+
 bool lms_location_config_struct::get_queue_size(int &value)
 {
     if (live) {
@@ -1870,6 +2292,33 @@ bool lms_location_config_struct::get_queue_size(int &value)
     return false;
 }
 
+bool lms_location_config_struct::get_target_latency(int &value)
+{
+    if (live) {
+        return live->get_target_latency(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_capture(bool &value)
+{
+    if (live) {
+        return live->get_capture(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_capture_path(DString &value)
+{
+    if (live) {
+        return live->get_capture_path(value);
+    }
+
+    return false;
+}
+
 bool lms_location_config_struct::get_proxy_enable(bool &value)
 {
     if (proxy) {
@@ -1897,6 +2346,15 @@ bool lms_location_config_struct::get_proxy_pass(std::vector<DString> &value)
     return false;
 }
 
+bool lms_location_config_struct::get_proxy_forward(std::vector<DString> &value)
+{
+    if (proxy) {
+        return proxy->get_proxy_forward(value);
+    }
+
+    return false;
+}
+
 bool lms_location_config_struct::get_proxy_vhost(DString &value)
 {
     if (proxy) {
@@ -1933,6 +2391,15 @@ bool lms_location_config_struct::get_proxy_timeout(int &value)
     return false;
 }
 
+bool lms_location_config_struct::get_proxy_linger(int &value)
+{
+    if (proxy) {
+        return proxy->get_proxy_linger(value);
+    }
+
+    return false;
+}
+
 bool lms_location_config_struct::get_proxy_ts_acodec(DString &value)
 {
     if (proxy) {
@@ -1996,6 +2463,33 @@ bool lms_location_config_struct::get_http_timeout(int &value)
     return false;
 }
 
+bool lms_location_config_struct::get_http_keepalive_timeout(int &value)
+{
+    if (http) {
+        return http->get_keepalive_timeout(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_http_file_cache_valid(int &value)
+{
+    if (http) {
+        return http->get_file_cache_valid(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_http_api(bool &value)
+{
+    if (http) {
+        return http->get_api(value);
+    }
+
+    return false;
+}
+
 bool lms_location_config_struct::get_flv_live_enable(bool &value)
 {
     if (http) {
@@ -2088,6 +2582,51 @@ bool lms_location_config_struct::get_refer_play(std::vector<DString> &value)
     return false;
 }
 
+bool lms_location_config_struct::get_token_enable(bool &value)
+{
+    if (token) {
+        return token->get_enable(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_token_keys(std::vector<DString> &value)
+{
+    if (token) {
+        return token->get_keys(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_token_publish(bool &value)
+{
+    if (token) {
+        return token->get_publish(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_token_play(bool &value)
+{
+    if (token) {
+        return token->get_play(value);
+    }
+
+    return false;
+}
+
+bool lms_location_config_struct::get_token_check_ip(bool &value)
+{
+    if (token) {
+        return token->get_check_ip(value);
+    }
+
+    return false;
+}
+
 bool lms_location_config_struct::get_hook_rtmp_connect(DString &value)
 {
     if (hook) {
@@ -2377,6 +2916,7 @@ lms_server_config_struct::lms_server_config_struct()
     , proxy(NULL)
     , http(NULL)
     , refer(NULL)
+    , token(NULL)
     , hook(NULL)
     , hls(NULL)
     , flv(NULL)
@@ -2391,6 +2931,7 @@ lms_server_config_struct::~lms_server_config_struct()
     DFree(proxy);
     DFree(http);
     DFree(refer);
+    DFree(token);
     DFree(hook);
     DFree(hls);
     DFree(flv);
@@ -2458,6 +2999,15 @@ void lms_server_config_struct::load_config(lms_config_directive *directive)
         }
     }
 
+    if (true) {
+        lms_config_directive *conf = directive->get("token");
+
+        if (conf) {
+            token = new lms_token_config_struct();
+            token->load_config(conf);
+        }
+    }
+
     if (true) {
         lms_config_directive *conf = directive->get("hook");
 
@@ -2523,6 +3073,9 @@ lms_server_config_struct *lms_server_config_struct::copy()
     if (refer) {
         server->refer = refer->copy();
     }
+    if (token) {
+        server->token = token->copy();
+    }
     if (hook) {
         server->hook = hook->copy();
     }
@@ -2640,37 +3193,147 @@ bool lms_server_config_struct::get_time_jitter(kernel_request *req)
     return ret;
 }
 
-int lms_server_config_struct::get_time_jitter_type(kernel_request *req)
+int lms_server_config_struct::get_time_jitter_type(kernel_request *req)
+{
+    int ret = LmsTimeStamp::middle;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_time_jitter_type(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (live) {
+        live->get_jitter_type(ret);
+    }
+
+    return ret;
+}
+
+bool lms_server_config_struct::get_gop_cache(kernel_request *req)
+{
+    bool ret = true;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_gop_cache(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (live) {
+        live->get_gop_cache(ret);
+    }
+
+    return ret;
+}
+
+bool lms_server_config_struct::get_fast_gop(kernel_request *req)
+{
+    bool ret = false;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_fast_gop(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (live) {
+        live->get_fast_gop(ret);
+    }
+
+    return ret;
+}
+
+int lms_server_config_struct::get_rtmp_timeout(kernel_request *req)
+{
+    int ret = 30;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_rtmp_timeout(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (rtmp) {
+        rtmp->get_timeout(ret);
+    }
+
+    return ret;
+}
+
+int lms_server_config_struct::get_rtmp_aggregate_duration(kernel_request *req)
+{
+    int ret = 0;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_rtmp_aggregate_duration(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (rtmp) {
+        rtmp->get_aggregate_duration(ret);
+    }
+
+    return ret;
+}
+
+int lms_server_config_struct::get_rtmp_chunk_size_max(kernel_request *req)
 {
-    int ret = LmsTimeStamp::middle;
+    int ret = 0;
 
     for (int i = 0; i < (int)locations.size(); ++i) {
         lms_location_config_struct *location = locations.at(i);
 
         if (location->get_matched(req)) {
-            if (location->get_time_jitter_type(ret)) {
+            if (location->get_rtmp_chunk_size_max(ret)) {
                 return ret;
             }
             break;
         }
     }
 
-    if (live) {
-        live->get_jitter_type(ret);
+    if (rtmp) {
+        rtmp->get_chunk_size_max(ret);
     }
 
     return ret;
 }
 
-bool lms_server_config_struct::get_gop_cache(kernel_request *req)
+int lms_server_config_struct::get_queue_size(kernel_request *req)
 {
-    bool ret = true;
+    int ret = 30;
 
     for (int i = 0; i < (int)locations.size(); ++i) {
         lms_location_config_struct *location = locations.at(i);
 
         if (location->get_matched(req)) {
-            if (location->get_gop_cache(ret)) {
+            if (location->get_queue_size(ret)) {
                 return ret;
             }
             break;
@@ -2678,21 +3341,21 @@ bool lms_server_config_struct::get_gop_cache(kernel_request *req)
     }
 
     if (live) {
-        live->get_gop_cache(ret);
+        live->get_queue_size(ret);
     }
 
     return ret;
 }
 
-bool lms_server_config_struct::get_fast_gop(kernel_request *req)
+int lms_server_config_struct::get_target_latency(kernel_request *req)
 {
-    bool ret = false;
+    int ret = 0;
 
     for (int i = 0; i < (int)locations.size(); ++i) {
         lms_location_config_struct *location = locations.at(i);
 
         if (location->get_matched(req)) {
-            if (location->get_fast_gop(ret)) {
+            if (location->get_target_latency(ret)) {
                 return ret;
             }
             break;
@@ -2700,43 +3363,43 @@ bool lms_server_config_struct::get_fast_gop(kernel_request *req)
     }
 
     if (live) {
-        live->get_fast_gop(ret);
+        live->get_target_latency(ret);
     }
 
     return ret;
 }
 
-int lms_server_config_struct::get_rtmp_timeout(kernel_request *req)
+bool lms_server_config_struct::get_capture(kernel_request *req)
 {
-    int ret = 30;
+    bool ret = false;
 
     for (int i = 0; i < (int)locations.size(); ++i) {
         lms_location_config_struct *location = locations.at(i);
 
         if (location->get_matched(req)) {
-            if (location->get_rtmp_timeout(ret)) {
+            if (location->get_capture(ret)) {
                 return ret;
             }
             break;
         }
     }
 
-    if (rtmp) {
-        rtmp->get_timeout(ret);
+    if (live) {
+        live->get_capture(ret);
     }
 
     return ret;
 }
 
-int lms_server_config_struct::get_queue_size(kernel_request *req)
+DString lms_server_config_struct::get_capture_path(kernel_request *req)
 {
-    int ret = 30;
+    DString ret = "capture/[vhost]/[app]/[stream]_[timestamp].lmsc";
 
     for (int i = 0; i < (int)locations.size(); ++i) {
         lms_location_config_struct *location = locations.at(i);
 
         if (location->get_matched(req)) {
-            if (location->get_queue_size(ret)) {
+            if (location->get_capture_path(ret)) {
                 return ret;
             }
             break;
@@ -2744,7 +3407,7 @@ int lms_server_config_struct::get_queue_size(kernel_request *req)
     }
 
     if (live) {
-        live->get_queue_size(ret);
+        live->get_capture_path(ret);
     }
 
     return ret;
@@ -2816,6 +3479,28 @@ std::vector<DString> lms_server_config_struct::get_proxy_pass(kernel_request *re
     return ret;
 }
 
+std::vector<DString> lms_server_config_struct::get_proxy_forward(kernel_request *req)
+{
+    std::vector<DString> ret;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_proxy_forward(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (proxy) {
+        proxy->get_proxy_forward(ret);
+    }
+
+    return ret;
+}
+
 DString lms_server_config_struct::get_proxy_vhost(kernel_request *req)
 {
     DString ret = "[vhost]";
@@ -2904,6 +3589,28 @@ int lms_server_config_struct::get_proxy_timeout(kernel_request *req)
     return ret;
 }
 
+int lms_server_config_struct::get_proxy_linger(kernel_request *req)
+{
+    int ret = 0;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_proxy_linger(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (proxy) {
+        proxy->get_proxy_linger(ret);
+    }
+
+    return ret;
+}
+
 DString lms_server_config_struct::get_proxy_ts_acodec(kernel_request *req)
 {
     DString ret = "aac";
@@ -3058,6 +3765,72 @@ int lms_server_config_struct::get_http_timeout(kernel_request *req)
     return ret;
 }
 
+int lms_server_config_struct::get_http_keepalive_timeout(kernel_request *req)
+{
+    int ret = 15;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_http_keepalive_timeout(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (http) {
+        http->get_keepalive_timeout(ret);
+    }
+
+    return ret;
+}
+
+int lms_server_config_struct::get_http_file_cache_valid(kernel_request *req)
+{
+    int ret = 0;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_http_file_cache_valid(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (http) {
+        http->get_file_cache_valid(ret);
+    }
+
+    return ret;
+}
+
+bool lms_server_config_struct::get_http_api(kernel_request *req)
+{
+    bool ret = false;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_http_api(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (http) {
+        http->get_api(ret);
+    }
+
+    return ret;
+}
+
 bool lms_server_config_struct::get_flv_live_enable(kernel_request *req)
 {
     bool ret = false;
@@ -3294,6 +4067,116 @@ std::vector<DString> lms_server_config_struct::get_refer_play(kernel_request *re
     return ret;
 }
 
+bool lms_server_config_struct::get_token_enable(kernel_request *req)
+{
+    bool ret = false;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_token_enable(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (token) {
+        token->get_enable(ret);
+    }
+
+    return ret;
+}
+
+std::vector<DString> lms_server_config_struct::get_token_keys(kernel_request *req)
+{
+    std::vector<DString> ret;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_token_keys(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (token) {
+        token->get_keys(ret);
+    }
+
+    return ret;
+}
+
+bool lms_server_config_struct::get_token_publish(kernel_request *req)
+{
+    bool ret = true;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_token_publish(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (token) {
+        token->get_publish(ret);
+    }
+
+    return ret;
+}
+
+bool lms_server_config_struct::get_token_play(kernel_request *req)
+{
+    bool ret = true;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_token_play(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (token) {
+        token->get_play(ret);
+    }
+
+    return ret;
+}
+
+bool lms_server_config_struct::get_token_check_ip(kernel_request *req)
+{
+    bool ret = false;
+
+    for (int i = 0; i < (int)locations.size(); ++i) {
+        lms_location_config_struct *location = locations.at(i);
+
+        if (location->get_matched(req)) {
+            if (location->get_token_check_ip(ret)) {
+                return ret;
+            }
+            break;
+        }
+    }
+
+    if (token) {
+        token->get_check_ip(ret);
+    }
+
+    return ret;
+}
+
 DString lms_server_config_struct::get_hook_rtmp_connect(kernel_request *req)
 {
     DString ret;
@@ -4138,6 +5021,50 @@ void lms_config_struct::load_global_config(lms_config_directive *directive)
         }
     }
 
+    if (true) {
+        lms_config_directive *conf = directive->get("prewarm");
+        if (conf) {
+            for (int i = 0; i < (int)conf->args.size(); ++i) {
+                prewarm.push_back(conf->args.at(i));
+
+                log_trace("prewarm=%s", conf->args.at(i).c_str());
+            }
+        }
+    }
+
+    if (true) {
+        prewarm_ttl = 300;
+
+        lms_config_directive *conf = directive->get("prewarm_ttl");
+        if (conf && !conf->arg(0).isEmpty()) {
+            prewarm_ttl = conf->arg(0).toInt();
+
+            log_trace("prewarm_ttl=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        watchdog_threshold = 500;
+
+        lms_config_directive *conf = directive->get("watchdog_threshold");
+        if (conf && !conf->arg(0).isEmpty()) {
+            watchdog_threshold = conf->arg(0).toInt();
+
+            log_trace("watchdog_threshold=%s", conf->arg(0).c_str());
+        }
+    }
+
+    if (true) {
+        memory_limit = 0;
+
+        lms_config_directive *conf = directive->get("memory_limit");
+        if (conf && !conf->arg(0).isEmpty()) {
+            memory_limit = conf->arg(0).toInt();
+
+            log_trace("memory_limit=%s", conf->arg(0).c_str());
+        }
+    }
+
     if (true) {
         lms_config_directive *conf = directive->get("access_log");
 
@@ -4289,6 +5216,26 @@ std::vector<int> lms_config::get_http_ports()
     return m_config->http_ports;
 }
 
+std::vector<DString> lms_config::get_prewarm()
+{
+    return m_config->prewarm;
+}
+
+int lms_config::get_prewarm_ttl()
+{
+    return m_config->prewarm_ttl;
+}
+
+int lms_config::get_watchdog_threshold()
+{
+    return m_config->watchdog_threshold;
+}
+
+int lms_config::get_memory_limit()
+{
+    return m_config->memory_limit;
+}
+
 lms_server_config_struct *lms_config::get_server(kernel_request *req)
 {
     DSpinLocker locker(&m_mutex);
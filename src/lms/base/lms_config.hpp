@@ -160,10 +160,12 @@ public:
     bool get_proxy_enable(bool &value);
     bool get_proxy_type(DString &value);
     bool get_proxy_pass(std::vector<DString> &value);
+    bool get_proxy_forward(std::vector<DString> &value);
     bool get_proxy_vhost(DString &value);
     bool get_proxy_app(DString &value);
     bool get_proxy_stream(DString &value);
     bool get_proxy_timeout(int &value);
+    bool get_proxy_linger(int &value);
 
     bool get_proxy_ts_acodec(DString &value);
     bool get_proxy_ts_vcodec(DString &value);
@@ -180,6 +182,9 @@ public:
     // 127.0.0.1:1935 127.0.0.1:80
     std::vector<DString> proxy_pass;
 
+    // 推流时除proxy_pass外同时转推的地址，每个地址单独连接和重连
+    std::vector<DString> proxy_forward;
+
     bool exist_vhost;
     // 默认[vhost]，原始vhost
     DString proxy_vhost;
@@ -196,6 +201,10 @@ public:
     // 默认10秒
     int timeout;
 
+    bool exist_linger;
+    // 默认0，单位秒，最后一个播放断开后继续回源的时间
+    int linger;
+
     lms_ts_codec_struct *ts_codec;
 };
 
@@ -207,6 +216,9 @@ public:
  * gop_cache            on;
  * fast_gop             on;
  * queue_size           30; //单位M
+ * target_latency       0;  //单位毫秒
+ * capture              off;
+ * capture_path         capture/[vhost]/[app]/[stream]_[timestamp].lmsc;
  */
 class lms_live_config_struct : public lms_config_base
 {
@@ -223,6 +235,9 @@ public:
     bool get_gop_cache(bool &gop);
     bool get_fast_gop(bool &gop);
     bool get_queue_size(int &size);
+    bool get_target_latency(int &val);
+    bool get_capture(bool &val);
+    bool get_capture_path(DString &val);
 
 public:
     bool exist_jitter;
@@ -244,6 +259,18 @@ public:
     bool exist_queue_size;
     // 默认30Mb
     int queue_size;
+
+    bool exist_target_latency;
+    // 默认0，单位毫秒，0表示不限制
+    int target_latency;
+
+    bool exist_capture;
+    // 默认false，录制推流解析后的消息，用于lms-replay回放
+    bool capture;
+
+    bool exist_capture_path;
+    // 默认capture/[vhost]/[app]/[stream]_[timestamp].lmsc
+    DString capture_path;
 };
 
 /**
@@ -269,6 +296,8 @@ public:
     bool get_chunk_size(int &val);
     bool get_in_ack_size(int &val);
     bool get_timeout(int &time);
+    bool get_aggregate_duration(int &val);
+    bool get_chunk_size_max(int &val);
 
 public:
     bool exist_enable;
@@ -286,6 +315,14 @@ public:
     bool exist_timeout;
     // 默认30，单位秒
     int timeout;
+
+    bool exist_aggregate_duration;
+    // 默认0，不合并，单位毫秒
+    int aggregate_duration;
+
+    bool exist_chunk_size_max;
+    // 默认0，不自适应调整chunk size，最大65536
+    int chunk_size_max;
 };
 
 /**
@@ -319,6 +356,9 @@ public:
     bool get_ts_live_acodec(DString &val);
     bool get_ts_live_vcodec(DString &val);
     bool get_ts_recv_enable(bool &val);
+    bool get_keepalive_timeout(int &val);
+    bool get_file_cache_valid(int &val);
+    bool get_api(bool &val);
 
 public:
     bool exist_enable;
@@ -357,6 +397,18 @@ public:
     bool ts_live_enable;
 
     lms_ts_codec_struct *ts_codec;
+
+    bool exist_keepalive_timeout;
+    // 默认15，单位秒，0表示不保持连接
+    int keepalive_timeout;
+
+    bool exist_file_cache_valid;
+    // 默认0，单位毫秒，缓存的文件超过这个时间才重新stat检查
+    int file_cache_valid;
+
+    bool exist_api;
+    // 是否开启/api控制接口
+    bool api;
 };
 
 class lms_refer_config_struct : public lms_config_base
@@ -383,6 +435,52 @@ public:
     std::vector<DString> play;
 };
 
+/**
+ * @brief lms_token_config_struct class
+ *
+ * token {
+ *     enable       on;
+ *     key          new_secret old_secret;  //按顺序尝试，轮换时新key放在前面
+ *     publish      on;
+ *     play         on;
+ *     check_ip     off;
+ * }
+ */
+class lms_token_config_struct : public lms_config_base
+{
+public:
+    lms_token_config_struct();
+    ~lms_token_config_struct();
+
+    virtual void load_config(lms_config_directive *directive);
+    virtual lms_token_config_struct *copy();
+
+    bool get_enable(bool &val);
+    bool get_keys(std::vector<DString> &value);
+    bool get_publish(bool &val);
+    bool get_play(bool &val);
+    bool get_check_ip(bool &val);
+
+public:
+    bool exist_enable;
+    // 默认false
+    bool enable;
+
+    std::vector<DString> keys;
+
+    bool exist_publish;
+    // 默认true，推流是否验证token
+    bool publish;
+
+    bool exist_play;
+    // 默认true，播放是否验证token
+    bool play;
+
+    bool exist_check_ip;
+    // 默认false，签名中是否包含客户端ip
+    bool check_ip;
+};
+
 class lms_hook_config_struct : public lms_config_base
 {
 public:
@@ -455,20 +553,27 @@ public:
     bool get_rtmp_chunk_size(int &value);
     bool get_rtmp_in_ack_size(int &value);
     bool get_rtmp_timeout(int &value);
+    bool get_rtmp_aggregate_duration(int &value);
+    bool get_rtmp_chunk_size_max(int &value);
 
     bool get_time_jitter(bool &value);
     bool get_time_jitter_type(int &value);
     bool get_gop_cache(bool &value);
     bool get_fast_gop(bool &value);
     bool get_queue_size(int &value);
+    bool get_target_latency(int &value);
+    bool get_capture(bool &value);
+    bool get_capture_path(DString &value);
 
     bool get_proxy_enable(bool &value);
     bool get_proxy_type(DString &value);
     bool get_proxy_pass(std::vector<DString> &value);
+    bool get_proxy_forward(std::vector<DString> &value);
     bool get_proxy_vhost(DString &value);
     bool get_proxy_app(DString &value);
     bool get_proxy_stream(DString &value);
     bool get_proxy_timeout(int &value);
+    bool get_proxy_linger(int &value);
     bool get_proxy_ts_acodec(DString &value);
     bool get_proxy_ts_vcodec(DString &value);
 
@@ -477,6 +582,9 @@ public:
     bool get_http_chunked(bool &value);
     bool get_http_root(DString &value);
     bool get_http_timeout(int &value);
+    bool get_http_keepalive_timeout(int &value);
+    bool get_http_file_cache_valid(int &value);
+    bool get_http_api(bool &value);
 
     bool get_flv_live_enable(bool &value);
     bool get_flv_recv_enable(bool &value);
@@ -490,6 +598,12 @@ public:
     bool get_refer_publish(std::vector<DString> &value);
     bool get_refer_play(std::vector<DString> &value);
 
+    bool get_token_enable(bool &value);
+    bool get_token_keys(std::vector<DString> &value);
+    bool get_token_publish(bool &value);
+    bool get_token_play(bool &value);
+    bool get_token_check_ip(bool &value);
+
     bool get_hook_rtmp_connect(DString &value);
     bool get_hook_rtmp_connect_pattern(DString &value);
     bool get_hook_rtmp_publish(DString &value);
@@ -529,6 +643,7 @@ public:
     lms_proxy_config_struct *proxy;
     lms_http_config_struct *http;
     lms_refer_config_struct *refer;
+    lms_token_config_struct *token;
     lms_hook_config_struct *hook;
     lms_hls_config_struct *hls;
     lms_flv_dvr_config_struct *flv;
@@ -581,20 +696,27 @@ public:
     int  get_rtmp_chunk_size(kernel_request *req);
     int  get_rtmp_in_ack_size(kernel_request *req);
     int  get_rtmp_timeout(kernel_request *req);
+    int  get_rtmp_aggregate_duration(kernel_request *req);
+    int  get_rtmp_chunk_size_max(kernel_request *req);
 
     bool get_time_jitter(kernel_request *req);
     int  get_time_jitter_type(kernel_request *req);
     bool get_gop_cache(kernel_request *req);
     bool get_fast_gop(kernel_request *req);
     int  get_queue_size(kernel_request *req);
+    int  get_target_latency(kernel_request *req);
+    bool get_capture(kernel_request *req);
+    DString get_capture_path(kernel_request *req);
 
     bool get_proxy_enable(kernel_request *req);
     DString get_proxy_type(kernel_request *req);
     std::vector<DString> get_proxy_pass(kernel_request *req);
+    std::vector<DString> get_proxy_forward(kernel_request *req);
     DString get_proxy_vhost(kernel_request *req);
     DString get_proxy_app(kernel_request *req);
     DString get_proxy_stream(kernel_request *req);
     int     get_proxy_timeout(kernel_request *req);
+    int     get_proxy_linger(kernel_request *req);
     DString get_proxy_ts_acodec(kernel_request *req);
     DString get_proxy_ts_vcodec(kernel_request *req);
 
@@ -603,6 +725,9 @@ public:
     bool get_http_chunked(kernel_request *req);
     DString get_http_root(kernel_request *req);
     int  get_http_timeout(kernel_request *req);
+    int  get_http_keepalive_timeout(kernel_request *req);
+    int  get_http_file_cache_valid(kernel_request *req);
+    bool get_http_api(kernel_request *req);
 
     bool get_flv_live_enable(kernel_request *req);
     bool get_flv_recv_enable(kernel_request *req);
@@ -616,6 +741,12 @@ public:
     std::vector<DString> get_refer_publish(kernel_request *req);
     std::vector<DString> get_refer_play(kernel_request *req);
 
+    bool get_token_enable(kernel_request *req);
+    std::vector<DString> get_token_keys(kernel_request *req);
+    bool get_token_publish(kernel_request *req);
+    bool get_token_play(kernel_request *req);
+    bool get_token_check_ip(kernel_request *req);
+
     DString get_hook_rtmp_connect(kernel_request *req);
     DString get_hook_rtmp_connect_pattern(kernel_request *req);
     DString get_hook_rtmp_publish(kernel_request *req);
@@ -654,6 +785,7 @@ public:
     lms_proxy_config_struct *proxy;
     lms_http_config_struct *http;
     lms_refer_config_struct *refer;
+    lms_token_config_struct *token;
     lms_hook_config_struct *hook;
     lms_hls_config_struct *hls;
     lms_flv_dvr_config_struct *flv;
@@ -736,6 +868,11 @@ public:
 
     bool mempool_enable;      // 默认true
 
+    std::vector<DString> prewarm;   // 边缘启动和reload时预先回源的流，格式为vhost/app/stream
+    int prewarm_ttl;                // 预热的流没有播放时保持回源的时间，单位秒，默认300
+    int watchdog_threshold;         // 工作线程一轮事件处理超过这个时间打印堆栈，单位毫秒，默认500，0表示关闭
+    int memory_limit;               // 内存池中正在使用的内存上限，接近时逐级回收，单位MB，默认0表示不限制
+
     lms_access_log_struct *access_log;
 
 public:
@@ -772,6 +909,11 @@ public:
     std::vector<int> get_rtmp_ports();
     std::vector<int> get_http_ports();
 
+    std::vector<DString> get_prewarm();
+    int get_prewarm_ttl();
+    int get_watchdog_threshold();
+    int get_memory_limit();
+
     lms_server_config_struct *get_server(kernel_request *req);
 
     bool get_access_log_enable();
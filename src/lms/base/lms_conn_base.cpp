@@ -1,15 +1,25 @@
 #include "lms_conn_base.hpp"
+#include "lms_stats.hpp"
+#include "lms_stream_writer.hpp"
+#include "lms_access_log.hpp"
+#include "DDateTime.hpp"
 
 lms_conn_base::lms_conn_base(DThread *thread, DEvent *event, int fd)
     : DTcpSocket(event, fd)
     , m_thread(thread)
+    , m_qos_time(DDateTime::currentDate().toMS())
+    , m_qos_read(0)
+    , m_qos_write(0)
 {
-
+    lms_worker_stat *stat = lms_stats::instance()->worker();
+    stat->event = event;
+    stat->connections++;
+    stat->accepted++;
 }
 
 lms_conn_base::~lms_conn_base()
 {
-
+    lms_stats::instance()->worker()->connections--;
 }
 
 DEvent *lms_conn_base::getEvent()
@@ -21,3 +31,41 @@ pthread_t lms_conn_base::getThread()
 {
     return m_thread->thread_id();
 }
+
+void lms_conn_base::get_qos(lms_access_qos &qos, lms_stream_writer *writer)
+{
+    qos.duration = DDateTime::currentDate().toMS() - m_qos_time;
+    qos.send_bytes = getTotalWriteSize() - m_qos_write;
+    qos.recv_bytes = getTotalReadSize() - m_qos_read;
+    if (qos.duration > 0) {
+        qos.avg_kbps = qos.send_bytes * 8 / qos.duration;
+    }
+
+    // 不到一秒的会话没有按秒的速率
+    DSocketQos socket = getQos();
+    qos.peak_kbps = DMax((dint64)(socket.peak_rate * 8 / 1000), qos.avg_kbps);
+    qos.stalls = socket.stalls;
+    qos.stall_ms = socket.stall_usec / 1000;
+    qos.mem_peak = memoryAccount()->peak();
+
+    if (writer) {
+        lms_writer_stat stat = writer->get_stat();
+
+        qos.first_frame = stat.first_frame;
+        qos.reduce_drops = stat.reduce_drops;
+        qos.degrade_drops = stat.catchup_drops;
+        for (int i = 0; i < LmsDegrade::count; ++i) {
+            qos.degrade_drops += stat.drops[i];
+        }
+        qos.max_queue = stat.max_queue;
+    }
+}
+
+void lms_conn_base::reset_qos()
+{
+    m_qos_time = DDateTime::currentDate().toMS();
+    m_qos_read = getTotalReadSize();
+    m_qos_write = getTotalWriteSize();
+
+    resetQos();
+}
@@ -7,6 +7,9 @@
 
 #include "kernel_global.hpp"
 
+class lms_stream_writer;
+struct lms_access_qos;
+
 class lms_conn_base : public DTcpSocket
 {
 public:
@@ -21,9 +24,26 @@ public:
     DEvent *getEvent();
     pthread_t getThread();
 
+protected:
+    /**
+     * @brief 汇总从连接建立或者上次reset_qos开始的发送质量
+     * @param writer 播放会话的writer，推流和其他请求为NULL
+     */
+    void get_qos(lms_access_qos &qos, lms_stream_writer *writer);
+    /**
+     * @brief http保持连接时，下一个请求重新开始统计
+     */
+    void reset_qos();
+
 protected:
     DThread *m_thread;
 
+private:
+    // 开始统计的时间，单位毫秒，以及当时socket的收发总量
+    duint64 m_qos_time;
+    duint64 m_qos_read;
+    duint64 m_qos_write;
+
 };
 
 #endif // LMS_CONN_BASE_HPP
@@ -15,6 +15,7 @@ lms_edge::lms_edge(lms_source *source, DEvent *event, bool publish)
     , m_flv_play(NULL)
     , m_ts_play(NULL)
     , m_ts_publish(NULL)
+    , m_own_gop_cache(true)
     , m_type(Rtmp)
     , m_started(false)
     , m_pos(0)
@@ -31,7 +32,25 @@ lms_edge::~lms_edge()
 
     DFree(m_src_req);
     DFree(m_dst_req);
-    DFree(m_gop_cache);
+
+    if (m_own_gop_cache) {
+        DFree(m_gop_cache);
+    }
+}
+
+void lms_edge::set_gop_cache(lms_gop_cache *gop_cache)
+{
+    if (m_own_gop_cache) {
+        DFree(m_gop_cache);
+    }
+
+    m_gop_cache = gop_cache;
+    m_own_gop_cache = false;
+}
+
+void lms_edge::set_forward(const DString &host)
+{
+    m_forward = host;
 }
 
 int lms_edge::start(kernel_request *req)
@@ -167,7 +186,7 @@ void lms_edge::reload()
         return;
     }
 
-    m_proxy_pass = config->get_proxy_pass(m_src_req);
+    get_proxy_pass(config);
 
     std::vector<DString>::iterator it = find(m_proxy_pass.begin(), m_proxy_pass.end(), m_host);
     if (it == m_proxy_pass.end()) {
@@ -281,7 +300,9 @@ void lms_edge::reload()
 
 void lms_edge::process(CommonMessage *msg)
 {
-    m_gop_cache->cache(msg);
+    if (m_own_gop_cache) {
+        m_gop_cache->cache(msg);
+    }
 
     switch (m_type) {
     case Rtmp:
@@ -325,7 +346,7 @@ bool lms_edge::get_config_value()
         return false;
     }
 
-    m_proxy_pass = config->get_proxy_pass(m_src_req);
+    get_proxy_pass(config);
     if (m_proxy_pass.empty()) {
         return false;
     }
@@ -367,6 +388,17 @@ bool lms_edge::get_config_value()
     return true;
 }
 
+void lms_edge::get_proxy_pass(lms_server_config_struct *config)
+{
+    m_proxy_pass.clear();
+
+    if (m_forward.empty()) {
+        m_proxy_pass = config->get_proxy_pass(m_src_req);
+    } else {
+        m_proxy_pass.push_back(m_forward);
+    }
+}
+
 void lms_edge::get_ip_port()
 {
     switch (m_type) {
@@ -424,6 +456,7 @@ void lms_edge::start_flv()
         m_flv_publish->start(m_src_req, m_dst_req, m_ip, m_port);
     } else {
         m_flv_play = new lms_http_client_flv_play(this, m_event, m_source);
+        m_flv_play->setMemoryAccount(m_source->memory());
         m_flv_play->start(m_src_req, m_dst_req, m_ip, m_port);
     }
 }
@@ -435,6 +468,7 @@ void lms_edge::start_rtmp()
         m_rtmp_publish->start(m_src_req, m_dst_req, m_ip, m_port);
     } else {
         m_rtmp_play = new lms_rtmp_client_play(this, m_event, m_source);
+        m_rtmp_play->setMemoryAccount(m_source->memory());
         m_rtmp_play->start(m_src_req, m_dst_req, m_ip, m_port);
     }
 }
@@ -446,6 +480,7 @@ void lms_edge::start_ts()
         m_ts_publish->start(m_src_req, m_dst_req, m_ip, m_port);
     } else {
         m_ts_play = new lms_http_client_ts_play(this, m_event, m_source);
+        m_ts_play->setMemoryAccount(m_source->memory());
         m_ts_play->start(m_src_req, m_dst_req, m_ip, m_port);
     }
 }
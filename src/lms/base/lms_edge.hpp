@@ -13,6 +13,7 @@
 #include "lms_http_client_ts_publish.hpp"
 
 class lms_source;
+class lms_server_config_struct;
 
 class lms_edge : public EventTimeOutBase
 {
@@ -27,12 +28,22 @@ public:
 
     void process(CommonMessage *msg);
 
+    /**
+     * @brief 使用外部的gop cache，多个推流edge共用，由调用者负责缓存和释放
+     */
+    void set_gop_cache(lms_gop_cache *gop_cache);
+    /**
+     * @brief 作为proxy_forward的一个目的地址，只推到host，不使用proxy_pass
+     */
+    void set_forward(const DString &host);
+
 public:
     virtual void onReadTimeOut();
     virtual void onWriteTimeOut();
 
 private:
     bool get_config_value();
+    void get_proxy_pass(lms_server_config_struct *config);
     void get_ip_port();
 
     void retry();
@@ -51,6 +62,7 @@ private:
     lms_rtmp_client_publish *m_rtmp_publish;
     lms_http_client_flv_publish *m_flv_publish;
     lms_gop_cache *m_gop_cache;
+    bool m_own_gop_cache;
 
     lms_rtmp_client_play *m_rtmp_play;
     lms_http_client_flv_play *m_flv_play;
@@ -61,6 +73,8 @@ private:
 
 private:
     std::vector<DString> m_proxy_pass;
+    // 不为空时是转推的edge
+    DString m_forward;
 
     enum ProxyType
     {
@@ -1,12 +1,17 @@
 #include "lms_event_conn.hpp"
 #include "kernel_log.hpp"
 #include "kernel_errno.hpp"
+#include "lms_stats.hpp"
+#include "lms_trace.hpp"
+#include "DDateTime.hpp"
 #include <sys/eventfd.h>
 #include <errno.h>
 
-lms_event_conn::lms_event_conn(DEvent *event)
+lms_event_conn::lms_event_conn(DEvent *event, lms_source_stat *stat)
     : m_fd(-1)
     , m_event(event)
+    , m_enqueue_time(0)
+    , m_stat(stat)
 {
 
 }
@@ -16,7 +21,7 @@ lms_event_conn::~lms_event_conn()
     log_warn("free --> lms_event_conn");
 
     for (int i = 0; i < (int)m_msgs.size(); ++i) {
-        DFree(m_msgs.at(i));
+        m_msgs.at(i)->release();
     }
     m_msgs.clear();    
 }
@@ -53,10 +58,14 @@ void lms_event_conn::write(duint64 value)
 
 void lms_event_conn::addData(CommonMessage *_msg)
 {
+    struct timespec now = DDateTime::monotonic();
+
     m_lock.lock();
 
-    CommonMessage *msg = new CommonMessage(_msg);
-    m_msgs.push_back(msg);
+    if (m_msgs.empty()) {
+        m_enqueue_time = now.tv_sec * 1000 * 1000 + now.tv_nsec / 1000;
+    }
+    m_msgs.push_back(_msg->retain());
 
     m_lock.unlock();
 
@@ -68,14 +77,17 @@ void lms_event_conn::addConnection(lms_conn_base *conn)
     m_sockets[conn->GetDescriptor()] = conn;
 }
 
-void lms_event_conn::delConnection(lms_conn_base *conn)
+bool lms_event_conn::delConnection(lms_conn_base *conn)
 {
     std::map<int, lms_conn_base*>::iterator it;
 
     it = m_sockets.find(conn->GetDescriptor());
     if (it != m_sockets.end()) {
         m_sockets.erase(it);
+        return true;
     }
+
+    return false;
 }
 
 bool lms_event_conn::empty()
@@ -99,6 +111,7 @@ int lms_event_conn::onRead()
 
     std::vector<CommonMessage*> msgs(m_msgs);
     m_msgs.clear();
+    dint64 enqueue_time = m_enqueue_time;
 
     m_lock.unlock();
 
@@ -107,22 +120,33 @@ int lms_event_conn::onRead()
     for (int i = 0; i < (int)msgs.size(); ++i)
     {
         CommonMessage *msg = msgs.at(i);
+        LMS_TRACE_PICKUP(msg, m_stat);
 
         it = m_sockets.begin();
         for(;it != m_sockets.end();) {
             lms_conn_base *conn = it->second;
+            // release中会通过lms_source::del_connection删除这个连接，先移到下一个
+            it++;
 
-            ret = conn->Process(msg);
+            if (true) {
+                // 封装和发送时分配的内存记到播放连接上
+                DMemAccountScope memory(conn->memoryAccount());
+                ret = conn->Process(msg);
+            }
             if ((ret != ERROR_SUCCESS) && (ret != SOCKET_EAGAIN)) {
                 conn->release();
-                m_sockets.erase(it++);
-                continue;
+                delConnection(conn);
             }
-
-            it++;
         }
 
-        DFree(msg);
+        LMS_TRACE_PICKUP_END();
+        msg->release();
+    }
+
+    if (!msgs.empty()) {
+        struct timespec now = DDateTime::monotonic();
+        dint64 usec = now.tv_sec * 1000 * 1000 + now.tv_nsec / 1000;
+        lms_stats::instance()->worker()->observe(LmsHistogram::fanout, usec - enqueue_time);
     }
 
     return 0;
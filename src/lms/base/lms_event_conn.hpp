@@ -5,6 +5,7 @@
 #include "kernel_global.hpp"
 #include "lms_conn_base.hpp"
 #include "DSpinLock.hpp"
+#include "lms_stats.hpp"
 #include <map>
 #include <vector>
 
@@ -14,7 +15,10 @@
 class lms_event_conn : public EventHanderBase
 {
 public:
-    lms_event_conn(DEvent *event);
+    /**
+     * @param stat 所属source的统计，用于按流统计帧延迟
+     */
+    lms_event_conn(DEvent *event, lms_source_stat *stat);
     virtual ~lms_event_conn();
 
     bool open();
@@ -24,7 +28,8 @@ public:
     void addData(CommonMessage *_msg);
 
     void addConnection(lms_conn_base *conn);
-    void delConnection(lms_conn_base *conn);
+    // conn在队列中并被删除时返回true
+    bool delConnection(lms_conn_base *conn);
 
     bool empty();
 
@@ -40,6 +45,11 @@ private:
 
     std::vector<CommonMessage*> m_msgs;
     DSpinLock m_lock;
+
+    // m_msgs中第一个消息加入的时间，单位微秒，用于统计分发延迟
+    dint64 m_enqueue_time;
+
+    lms_source_stat *m_stat;
 };
 
 #endif // LMS_EVENT_CONN_HPP
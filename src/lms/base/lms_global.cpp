@@ -1,5 +1,6 @@
 #include "lms_global.hpp"
 #include "kernel_codec.hpp"
+#include "lms_trace.hpp"
 
 RtmpMessage *common_to_rtmp(CommonMessage *msg)
 {
@@ -54,5 +55,7 @@ CommonMessage *rtmp_to_common(RtmpMessage *msg)
         }
     }
 
+    LMS_TRACE_INGEST(ret);
+
     return ret;
 }
@@ -2,14 +2,13 @@
 #include "kernel_codec.hpp"
 #include "kernel_log.hpp"
 
-#define GOP_CACHE_MAX_DURATION    10000
-
 lms_gop_cache::lms_gop_cache()
     : metadata(NULL)
     , video_sh(NULL)
     , audio_sh(NULL)
+    , m_max_duration(GOP_CACHE_MAX_DURATION)
 {
-    m_jitter = new lms_timestamp();
+    m_jitter = new lms_timestamp_base();
     m_jitter->set_correct_type(LmsTimeStamp::middle);
 
     m_gop_count = 0;
@@ -25,20 +24,26 @@ lms_gop_cache::~lms_gop_cache()
 
 void lms_gop_cache::cache_metadata(CommonMessage *msg)
 {
-    DFree(metadata);
-    metadata = new CommonMessage(msg);
+    if (metadata) {
+        metadata->release();
+    }
+    metadata = msg->retain();
 }
 
 void lms_gop_cache::cache_video_sh(CommonMessage *msg)
 {
-    DFree(video_sh);
-    video_sh = new CommonMessage(msg);
+    if (video_sh) {
+        video_sh->release();
+    }
+    video_sh = msg->retain();
 }
 
 void lms_gop_cache::cache_audio_sh(CommonMessage *msg)
 {
-    DFree(audio_sh);
-    audio_sh = new CommonMessage(msg);
+    if (audio_sh) {
+        audio_sh->release();
+    }
+    audio_sh = msg->retain();
 }
 
 void lms_gop_cache::cache(CommonMessage *_msg)
@@ -62,7 +67,7 @@ void lms_gop_cache::cache(CommonMessage *_msg)
 
 void lms_gop_cache::add(CommonMessage *_msg)
 {
-    CommonMessage *msg = new CommonMessage(_msg);
+    CommonMessage *msg = _msg->retain();
 
     dint64 dts = m_jitter->correct(msg);
     bool key_frame = false;
@@ -75,16 +80,16 @@ void lms_gop_cache::add(CommonMessage *_msg)
         GopMessage first = msgs.front();
         dint64 delta = dts - first.correct_time;
 
-        if (delta > GOP_CACHE_MAX_DURATION) {
+        if (delta > m_max_duration) {
             if (m_gop_count >= 2) {
                 dint64 first_duration = m_durations.front();
-                if (delta - first_duration >= GOP_CACHE_MAX_DURATION) {
+                if (delta - first_duration >= m_max_duration) {
                     clear_first_gop();
                 }
             } else if (m_gop_count == 1) {
                 CommonMessage *temp = first.msg;
                 if (!temp->is_video() || !temp->is_keyframe()) {
-                    DFree(temp);
+                    temp->release();
                     msgs.pop_front();
 
                     if (!key_frame) {
@@ -95,12 +100,12 @@ void lms_gop_cache::add(CommonMessage *_msg)
                         return;
                     }
                 } else {
-                    if (delta > GOP_CACHE_MAX_DURATION * 2) {
+                    if (delta > m_max_duration * 2) {
                         clear_front(first.correct_time);
                     }
                 }
             } else {
-                DFree(first.msg);
+                first.msg->release();
                 msgs.pop_front();
             }
         }
@@ -130,13 +135,13 @@ void lms_gop_cache::dump(std::deque<CommonMessage*> &_msgs, dint64 length,
                          CommonMessage *&_metadata, CommonMessage *&_video_sh, CommonMessage *&_audio_sh)
 {
     if (metadata) {
-        _metadata = new CommonMessage(metadata);
+        _metadata = metadata->retain();
     }
     if (video_sh) {
-        _video_sh = new CommonMessage(video_sh);
+        _video_sh = video_sh->retain();
     }
     if (audio_sh) {
-        _audio_sh = new CommonMessage(audio_sh);
+        _audio_sh = audio_sh->retain();
     }
 
     if (msgs.empty()) {
@@ -164,8 +169,7 @@ void lms_gop_cache::dump(std::deque<CommonMessage*> &_msgs, dint64 length,
 
     for (int i = pos; i < (int)msgs.size(); ++i) {
         g_msg = msgs.at(i);
-        msg = new CommonMessage(g_msg.msg);
-        _msgs.push_back(msg);
+        _msgs.push_back(g_msg.msg->retain());
     }
 }
 
@@ -191,13 +195,22 @@ void lms_gop_cache::clear()
 {
     for (int i = 0; i < (int)msgs.size(); ++i) {
         GopMessage msg = msgs.at(i);
-        DFree(msg.msg);
+        msg.msg->release();
     }
     msgs.clear();
 
-    DFree(metadata);
-    DFree(video_sh);
-    DFree(audio_sh);
+    if (metadata) {
+        metadata->release();
+        metadata = NULL;
+    }
+    if (video_sh) {
+        video_sh->release();
+        video_sh = NULL;
+    }
+    if (audio_sh) {
+        audio_sh->release();
+        audio_sh = NULL;
+    }
 
     m_first = true;
 
@@ -208,6 +221,25 @@ void lms_gop_cache::clear()
     m_durations.clear();
 }
 
+void lms_gop_cache::set_max_duration(dint64 duration)
+{
+    m_max_duration = duration;
+
+    while (m_gop_count >= 2 && !m_durations.empty() && !msgs.empty()) {
+        dint64 delta = m_end - msgs.front().correct_time;
+        if (delta - m_durations.front() < m_max_duration) {
+            break;
+        }
+
+        clear_first_gop();
+    }
+}
+
+dint64 lms_gop_cache::max_duration()
+{
+    return m_max_duration;
+}
+
 CommonMessage *lms_gop_cache::video_sequence()
 {
     return video_sh;
@@ -232,7 +264,7 @@ void lms_gop_cache::clear_first_gop()
             break;
         }
 
-        DFree(msg);
+        msg->release();
         num++;
     }
 
@@ -253,7 +285,7 @@ void lms_gop_cache::clear_front(dint64 first)
             break;
         }
 
-        DFree(m.msg);
+        m.msg->release();
         num++;
     }
 
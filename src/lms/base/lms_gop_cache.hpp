@@ -6,6 +6,12 @@
 #include "kernel_global.hpp"
 #include "lms_timestamp.hpp"
 
+// 默认缓存的时长，单位毫秒
+#define GOP_CACHE_MAX_DURATION    10000
+
+/**
+ * @brief 缓存的消息和dump出的消息都是引用，使用后调用release
+ */
 class lms_gop_cache
 {
 public:
@@ -26,6 +32,12 @@ public:
 
     void clear();
 
+    /**
+     * @brief 设置缓存的时长，单位毫秒，小于当前缓存时立即丢弃前面的gop，至少保留最后一个gop
+     */
+    void set_max_duration(dint64 duration);
+    dint64 max_duration();
+
     CommonMessage *video_sequence();
     CommonMessage *audio_sequence();
 
@@ -45,7 +57,7 @@ public:
     CommonMessage *video_sh;
     CommonMessage *audio_sh;
 
-    lms_timestamp *m_jitter;
+    lms_timestamp_base *m_jitter;
     int m_gop_count;
 
     std::deque<dint64> m_durations;
@@ -53,6 +65,8 @@ public:
     dint64 m_end;
 
     bool m_first;
+
+    dint64 m_max_duration;
 };
 
 #endif // LMS_GOP_CACHE_HPP
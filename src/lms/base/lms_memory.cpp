@@ -0,0 +1,150 @@
+#include "lms_memory.hpp"
+#include "lms_source.hpp"
+#include "lms_config.hpp"
+#include "kernel_log.hpp"
+#include "DMemPool.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+static bool more_memory(const lms_source_snapshot &a, const lms_source_snapshot &b)
+{
+    return a.memory > b.memory;
+}
+
+lms_memory_state::lms_memory_state()
+    : limit(0)
+    , used(0)
+    , level(LmsMemoryLevel::normal)
+    , shrinks(0)
+{
+    memset(enters, 0, sizeof(enters));
+}
+
+lms_memory_manager *lms_memory_manager::m_instance = new lms_memory_manager;
+
+lms_memory_manager::lms_memory_manager()
+    : m_queue_cap(0)
+{
+
+}
+
+lms_memory_manager::~lms_memory_manager()
+{
+
+}
+
+lms_memory_manager *lms_memory_manager::instance()
+{
+    return m_instance;
+}
+
+void lms_memory_manager::check()
+{
+    dint64 limit = (dint64)lms_config::instance()->get_memory_limit() * 1024 * 1024;
+    // 只统计内存池分配的chunk，消息、socket缓冲区、gop cache和hls分片都在其中
+    dint64 used = DMemPool::instance()->stat().chunk_bytes;
+
+    int level = m_state.level;
+
+    if (limit <= 0) {
+        level = LmsMemoryLevel::normal;
+    } else if (used >= limit * LMS_MEMORY_CAP_PERCENT / 100) {
+        level = LmsMemoryLevel::cap_queue;
+    } else if (used >= limit * LMS_MEMORY_SHRINK_PERCENT / 100) {
+        level = DMax(level, (int)LmsMemoryLevel::shrink_gop);
+    } else if (used < limit * LMS_MEMORY_RESTORE_PERCENT / 100) {
+        level = LmsMemoryLevel::normal;
+    }
+
+    if (true) {
+        DSpinLocker locker(&m_mutex);
+        m_state.limit = limit;
+        m_state.used = used;
+    }
+
+    if (level != m_state.level) {
+        set_level(level);
+    }
+
+    // 缩小过的流直到恢复前一直保持，仍然超过时继续缩小播放更多的流
+    if (level >= LmsMemoryLevel::shrink_gop && used >= limit * LMS_MEMORY_SHRINK_PERCENT / 100) {
+        dint64 excess = used - limit * LMS_MEMORY_RESTORE_PERCENT / 100;
+        int count = lms_source_manager::instance()->shrink_gop_cache(excess, LMS_MEMORY_GOP_DURATION);
+
+        DSpinLocker locker(&m_mutex);
+        m_state.shrinks += count;
+    }
+}
+
+dint64 lms_memory_manager::queue_limit(dint64 queue_size)
+{
+    dint64 cap = m_queue_cap;
+
+    return (cap > 0) ? DMin(queue_size, cap) : queue_size;
+}
+
+lms_memory_state lms_memory_manager::state()
+{
+    DSpinLocker locker(&m_mutex);
+
+    return m_state;
+}
+
+const char *lms_memory_manager::level_name(int level)
+{
+    const char *names[LmsMemoryLevel::count] = { "normal", "shrink_gop", "cap_queue" };
+
+    if (level < 0 || level >= LmsMemoryLevel::count) {
+        return "unknown";
+    }
+
+    return names[level];
+}
+
+void lms_memory_manager::set_level(int level)
+{
+    int prev = m_state.level;
+
+    if (level > prev) {
+        log_warn("memory pressure level %s -> %s. used=%lld, limit=%lld",
+                 level_name(prev), level_name(level), m_state.used, m_state.limit);
+        log_top_sources();
+    } else {
+        log_trace("memory pressure level %s -> %s. used=%lld, limit=%lld",
+                  level_name(prev), level_name(level), m_state.used, m_state.limit);
+    }
+
+    if (level == LmsMemoryLevel::normal) {
+        lms_source_manager::instance()->restore_gop_cache();
+    }
+
+    m_queue_cap = (level >= LmsMemoryLevel::cap_queue) ? LMS_MEMORY_QUEUE_CAP : 0;
+
+    DSpinLocker locker(&m_mutex);
+
+    m_state.level = level;
+    if (level > prev) {
+        m_state.enters[level]++;
+    }
+}
+
+void lms_memory_manager::log_top_sources()
+{
+    std::vector<lms_source_snapshot> sources = lms_source_manager::instance()->get_stats();
+
+    int count = DMin((int)sources.size(), LMS_MEMORY_TOP_SOURCES);
+    std::partial_sort(sources.begin(), sources.begin() + count, sources.end(), more_memory);
+
+    for (int i = 0; i < count; ++i) {
+        lms_source_snapshot &s = sources.at(i);
+
+        dint64 viewers = 0;
+        for (int p = 0; p < LmsStatProtocol::count; ++p) {
+            viewers += s.stat.viewers[p];
+        }
+
+        log_warn("memory top %d. url=%s, memory=%lld, peak=%lld, viewers=%lld, gop_duration=%lld",
+                 i + 1, s.url.c_str(), s.memory, s.memory_peak, viewers, s.gop_duration);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef LMS_MEMORY_HPP
+#define LMS_MEMORY_HPP
+
+#include "DSpinLock.hpp"
+#include "kernel_global.hpp"
+
+// 占memory_limit的百分比：超过SHRINK缩小gop cache，超过CAP限制播放队列，低于RESTORE恢复
+#define LMS_MEMORY_SHRINK_PERCENT   80
+#define LMS_MEMORY_CAP_PERCENT      95
+#define LMS_MEMORY_RESTORE_PERCENT  70
+// 缩小后gop cache的时长，单位毫秒
+#define LMS_MEMORY_GOP_DURATION     2000
+// 限制后播放连接的队列上限，单位字节
+#define LMS_MEMORY_QUEUE_CAP        (1024 * 1024)
+// 进入回收时打印占用内存最多的流数
+#define LMS_MEMORY_TOP_SOURCES      5
+
+namespace LmsMemoryLevel {
+    enum Level { normal = 0, shrink_gop, cap_queue, count };
+}
+
+struct lms_memory_state
+{
+    lms_memory_state();
+
+    // 单位字节，limit为0表示不限制
+    dint64 limit;
+    dint64 used;
+    // LmsMemoryLevel::Level
+    int level;
+    // 进入每个级别的次数
+    dint64 enters[LmsMemoryLevel::count];
+    // 累计缩小gop cache的流数
+    dint64 shrinks;
+};
+
+/**
+ * @brief 按memory_limit检查内存池中正在使用的内存，接近上限时逐级回收：
+ *        先按播放数从少到多缩小流的gop cache，仍然超过时限制播放连接的队列，慢的播放会降级和丢弃
+ */
+class lms_memory_manager
+{
+public:
+    lms_memory_manager();
+    ~lms_memory_manager();
+
+    static lms_memory_manager *instance();
+
+    /**
+     * @brief 每秒由主线程调用一次
+     */
+    void check();
+
+    /**
+     * @brief 播放连接实际使用的队列上限，工作线程调用，不加锁
+     */
+    dint64 queue_limit(dint64 queue_size);
+
+    lms_memory_state state();
+
+    static const char *level_name(int level);
+
+private:
+    void set_level(int level);
+    /**
+     * @brief 打印占用内存最多的流，用于定位内存涨上来的原因
+     */
+    void log_top_sources();
+
+private:
+    static lms_memory_manager *m_instance;
+
+private:
+    DSpinLock m_mutex;
+    lms_memory_state m_state;
+
+    // 大于0时限制播放连接的队列
+    volatile dint64 m_queue_cap;
+};
+
+#endif // LMS_MEMORY_HPP
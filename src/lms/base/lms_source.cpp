@@ -6,13 +6,43 @@
 #include "lms_threads_server.hpp"
 #include "DGlobal.hpp"
 #include "lms_edge.hpp"
+#include "lms_config.hpp"
+#include "DDateTime.hpp"
+#include "lms_trace.hpp"
 #include <algorithm>
+#include <math.h>
+
+struct lms_source_memory
+{
+    DString url;
+    lms_source *source;
+    dint64 viewers;
+    dint64 bytes;
+};
+
+// 播放少的在前，播放数相同时占用内存多的在前
+static bool less_watched(const lms_source_memory &a, const lms_source_memory &b)
+{
+    if (a.viewers != b.viewers) {
+        return a.viewers < b.viewers;
+    }
+    return a.bytes > b.bytes;
+}
 
 lms_source::lms_source(kernel_request *req)
     : m_publish(NULL)
     , m_play(NULL)
+    , m_publish_gop_cache(NULL)
     , m_can_publish(true)
     , m_is_edge(false)
+    , m_lingering(false)
+    , m_linger_until(0)
+    , m_popularity(0)
+    , m_popularity_time(0)
+    , m_prewarm_ttl(0)
+    , m_capture(NULL)
+    , m_memory(new DMemAccount())
+    , m_gop_duration(0)
 {
     m_req = new kernel_request();
     m_req->copy(req);
@@ -20,15 +50,22 @@ lms_source::lms_source(kernel_request *req)
     m_gop_cache = new lms_gop_cache();
 
     m_external = new lms_source_external(m_req);
+
+    for (int i = 0; i < CommonMessageCorrectTypes; ++i) {
+        m_jitters[i].set_correct_type(i);
+    }
 }
 
 lms_source::~lms_source()
 {
     DFree(m_req);
     DFree(m_gop_cache);
-    DFree(m_publish);
+    stop_publish();
     DFree(m_play);
     DFree(m_external);
+    stop_capture();
+
+    m_memory->release();
 
     log_warn("-------------> free lms_source");
 }
@@ -47,6 +84,10 @@ void lms_source::reload()
         m_publish->reload();
     }
 
+    for (int i = 0; i < (int)m_forwards.size(); ++i) {
+        m_forwards.at(i)->reload();
+    }
+
     if (m_play) {
         m_play->reload();
     }
@@ -58,6 +99,13 @@ bool lms_source::reset()
 {
     bool ret = m_external->reset();
 
+    DSpinLocker locker(&m_mutex);
+
+    if (m_lingering && DDateTime::currentDate().toMS() >= m_linger_until) {
+        log_trace("edge source linger expired, stop play");
+        stop_play();
+    }
+
     if (m_play || m_publish || !m_conns.empty() || !m_reloads.empty()) {
         ret = false;
     }
@@ -69,11 +117,47 @@ bool lms_source::onPlay(DEvent *event, bool edge)
 {
     DSpinLocker locker(&m_mutex);
 
-    int ret = ERROR_SUCCESS;
-
     m_is_edge = edge;
 
-    if (m_is_edge && !m_play) {
+    if (m_is_edge) {
+        return start_play(event);
+    }
+
+    return true;
+}
+
+bool lms_source::prewarm(DEvent *event, dint64 ttl)
+{
+    DSpinLocker locker(&m_mutex);
+
+    m_is_edge = true;
+
+    if (!start_play(event)) {
+        return false;
+    }
+
+    m_prewarm_ttl = ttl;
+
+    // 已经有播放时，等最后一个播放断开后再开始计时
+    if (m_conns.empty()) {
+        duint64 until = DDateTime::currentDate().toMS() + ttl;
+
+        if (!m_lingering || m_linger_until < until) {
+            m_linger_until = until;
+        }
+        m_lingering = true;
+    }
+
+    log_trace("edge source prewarm, ttl=%lld ms", ttl);
+
+    return true;
+}
+
+bool lms_source::start_play(DEvent *event)
+{
+    int ret = ERROR_SUCCESS;
+
+    if (!m_play) {
         m_play = new lms_edge(this, event, false);
         if ((ret = m_play->start(m_req)) != ERROR_SUCCESS) {
             log_error("edge play start failed. ret=%d", ret);
@@ -100,14 +184,27 @@ bool lms_source::onPublish(DEvent *event, bool edge)
     m_can_publish = false;
 
     if (m_is_edge && !m_publish) {
+        if (!m_publish_gop_cache) {
+            m_publish_gop_cache = new lms_gop_cache();
+            if (m_gop_duration > 0) {
+                m_publish_gop_cache->set_max_duration(m_gop_duration);
+            }
+        }
+
         m_publish = new lms_edge(this, event, true);
+        m_publish->set_gop_cache(m_publish_gop_cache);
+
         if ((ret = m_publish->start(m_req)) != ERROR_SUCCESS) {
             log_error("edge publish start failed. ret=%d", ret);
             DFree(m_publish);
             return false;
         }
+
+        start_forward(event);
     }
 
+    start_capture();
+
     return true;
 }
 
@@ -119,9 +216,75 @@ void lms_source::onUnpublish()
 
     m_gop_cache->clear();
 
-    if (m_is_edge && m_publish) {
-        DFree(m_publish);
+    if (m_is_edge) {
+        stop_publish();
     }
+
+    stop_capture();
+}
+
+void lms_source::start_forward(DEvent *event)
+{
+    int ret = ERROR_SUCCESS;
+
+    lms_server_config_struct *config = lms_config::instance()->get_server(m_req);
+    DAutoFree(lms_server_config_struct, config);
+
+    if (!config) {
+        return;
+    }
+
+    std::vector<DString> forwards = config->get_proxy_forward(m_req);
+
+    for (int i = 0; i < (int)forwards.size(); ++i) {
+        lms_edge *edge = new lms_edge(this, event, true);
+        edge->set_gop_cache(m_publish_gop_cache);
+        edge->set_forward(forwards.at(i));
+
+        if ((ret = edge->start(m_req)) != ERROR_SUCCESS) {
+            log_error("edge forward start failed. host=%s, ret=%d", forwards.at(i).c_str(), ret);
+            DFree(edge);
+            continue;
+        }
+
+        m_forwards.push_back(edge);
+    }
+}
+
+void lms_source::stop_publish()
+{
+    for (int i = 0; i < (int)m_forwards.size(); ++i) {
+        lms_edge *edge = m_forwards.at(i);
+        DFree(edge);
+    }
+    m_forwards.clear();
+
+    DFree(m_publish);
+
+    // 所有推流edge都释放后才能释放共用的gop cache
+    DFree(m_publish_gop_cache);
+}
+
+void lms_source::start_capture()
+{
+    lms_server_config_struct *config = lms_config::instance()->get_server(m_req);
+    DAutoFree(lms_server_config_struct, config);
+
+    if (!config || !config->get_capture(m_req)) {
+        return;
+    }
+
+    stop_capture();
+
+    m_capture = new lms_capture_writer();
+    if (m_capture->open(m_req, config->get_capture_path(m_req)) != ERROR_SUCCESS) {
+        DFree(m_capture);
+    }
+}
+
+void lms_source::stop_capture()
+{
+    DFree(m_capture);
 }
 
 int lms_source::onVideo(CommonMessage *msg)
@@ -134,17 +297,28 @@ int lms_source::onVideo(CommonMessage *msg)
         return ret;
     }
 
-    CommonMessage video(msg);
+    m_stat.sample(msg);
+
+    if (m_capture) {
+        m_capture->write(msg);
+    }
+
+    // gop cache和所有线程共享同一个消息
+    CommonMessage *video = new CommonMessage(msg);
+    correct(video);
+    LMS_TRACE_FANOUT(video, &m_stat);
 
-    m_gop_cache->cache(&video);
+    m_gop_cache->cache(video);
 
     std::map<pthread_t, lms_event_conn*>::iterator it;
     for (it = m_conns.begin(); it != m_conns.end(); ++it) {
         lms_event_conn *conn = it->second;
-        conn->addData(&video);
+        conn->addData(video);
     }
 
-    m_external->onVideo(&video);
+    m_external->onVideo(video);
+
+    video->release();
 
     return ret;
 }
@@ -159,17 +333,28 @@ int lms_source::onAudio(CommonMessage *msg)
         return ret;
     }
 
-    CommonMessage audio(msg);
+    m_stat.sample(msg);
+
+    if (m_capture) {
+        m_capture->write(msg);
+    }
+
+    // gop cache和所有线程共享同一个消息
+    CommonMessage *audio = new CommonMessage(msg);
+    correct(audio);
+    LMS_TRACE_FANOUT(audio, &m_stat);
 
-    m_gop_cache->cache(&audio);
+    m_gop_cache->cache(audio);
 
     std::map<pthread_t, lms_event_conn*>::iterator it;
     for (it = m_conns.begin(); it != m_conns.end(); ++it) {
         lms_event_conn *conn = it->second;
-        conn->addData(&audio);
+        conn->addData(audio);
     }
 
-    m_external->onAudio(&audio);
+    m_external->onAudio(audio);
+
+    audio->release();
 
     return ret;
 }
@@ -184,30 +369,47 @@ int lms_source::onMetadata(CommonMessage *msg)
         return ret;
     }
 
-    CommonMessage metadata(msg);
+    if (m_capture) {
+        m_capture->write(msg);
+    }
+
+    // gop cache和所有线程共享同一个消息
+    CommonMessage *metadata = new CommonMessage(msg);
+    correct(metadata);
 
-    m_gop_cache->cache(&metadata);
+    m_gop_cache->cache(metadata);
 
     std::map<pthread_t, lms_event_conn*>::iterator it;
     for (it = m_conns.begin(); it != m_conns.end(); ++it) {
         lms_event_conn *conn = it->second;
-        conn->addData(&metadata);
+        conn->addData(metadata);
     }
 
-    m_external->onMetadata(&metadata);
+    m_external->onMetadata(metadata);
+
+    metadata->release();
 
     return ret;
 }
 
-bool lms_source::add_connection(lms_conn_base *conn)
+bool lms_source::add_connection(lms_conn_base *conn, int protocol)
 {
     DSpinLocker locker(&m_mutex);
 
     lms_event_conn *ev = NULL;
     std::map<pthread_t, lms_event_conn*>::iterator it = m_conns.find(conn->getThread());
 
+    if (m_conns.empty() && m_lingering) {
+        duint64 now = DDateTime::currentDate().toMS();
+        decay_popularity(now);
+        m_popularity += 1;
+        m_lingering = false;
+
+        log_trace("edge source rejoin while lingering, popularity=%.2f", m_popularity);
+    }
+
     if (it == m_conns.end()) {
-        ev = new lms_event_conn(conn->getEvent());
+        ev = new lms_event_conn(conn->getEvent(), &m_stat);
 
         if (!ev->open()) {
             log_error("event_conn add to event failed");
@@ -222,10 +424,12 @@ bool lms_source::add_connection(lms_conn_base *conn)
 
     ev->addConnection(conn);
 
+    __sync_add_and_fetch(&m_stat.viewers[protocol], 1);
+
     return true;
 }
 
-void lms_source::del_connection(lms_conn_base *conn)
+void lms_source::del_connection(lms_conn_base *conn, int protocol)
 {
     DSpinLocker locker(&m_mutex);
 
@@ -233,7 +437,9 @@ void lms_source::del_connection(lms_conn_base *conn)
 
     if (it != m_conns.end()) {
         lms_event_conn *ev = it->second;
-        ev->delConnection(conn);
+        if (ev->delConnection(conn)) {
+            __sync_sub_and_fetch(&m_stat.viewers[protocol], 1);
+        }
 
         if (ev->empty()) {
             m_conns.erase(it);
@@ -243,15 +449,60 @@ void lms_source::del_connection(lms_conn_base *conn)
 
     if (m_conns.empty()) {
         if (m_is_edge) {
-            m_gop_cache->clear();
+            duint64 now = DDateTime::currentDate().toMS();
+            dint64 linger = linger_time(now);
+
+            // 预热过的流至少保持预热时的ttl
+            linger = DMax(linger, m_prewarm_ttl);
 
-            if (m_is_edge && m_play) {
-                DFree(m_play);
+            if (linger > 0 && m_play) {
+                m_lingering = true;
+                m_linger_until = now + linger;
+
+                log_trace("edge source linger %lld ms, popularity=%.2f", linger, m_popularity);
+            } else {
+                stop_play();
             }
         }
     }
 }
 
+void lms_source::stop_play()
+{
+    m_lingering = false;
+    m_prewarm_ttl = 0;
+
+    m_gop_cache->clear();
+
+    if (m_play) {
+        DFree(m_play);
+    }
+}
+
+dint64 lms_source::linger_time(duint64 now)
+{
+    lms_server_config_struct *config = lms_config::instance()->get_server(m_req);
+    DAutoFree(lms_server_config_struct, config);
+
+    if (!config) {
+        return 0;
+    }
+
+    dint64 linger = config->get_proxy_linger(m_req) * 1000;
+
+    decay_popularity(now);
+
+    return linger + linger * DMin(m_popularity, (double)LMS_SOURCE_POPULARITY_MAX);
+}
+
+void lms_source::decay_popularity(duint64 now)
+{
+    if (m_popularity_time > 0 && now > m_popularity_time) {
+        m_popularity *= pow(0.5, (double)(now - m_popularity_time) / LMS_SOURCE_POPULARITY_HALF_LIFE);
+    }
+    m_popularity_time = now;
+}
+
 int lms_source::proxyMessage(CommonMessage *msg)
 {
     int ret = ERROR_SUCCESS;
@@ -262,12 +513,22 @@ int lms_source::proxyMessage(CommonMessage *msg)
         return ret;
     }
 
-    CommonMessage _msg(msg);
+    CommonMessage *_msg = new CommonMessage(msg);
+    correct(_msg);
 
+    // 所有推流edge共用同一个消息和gop cache，只缓存一次
     if (m_is_edge && m_publish) {
-        m_publish->process(&_msg);
+        m_publish_gop_cache->cache(_msg);
+
+        m_publish->process(_msg);
+
+        for (int i = 0; i < (int)m_forwards.size(); ++i) {
+            m_forwards.at(i)->process(_msg);
+        }
     }
 
+    _msg->release();
+
     return ret;
 }
 
@@ -288,6 +549,62 @@ void lms_source::stop_external()
     m_external->stop();
 }
 
+lms_source_snapshot lms_source::snapshot()
+{
+    lms_source_snapshot snap;
+    snap.url = m_req->get_stream_url();
+    snap.edge = m_is_edge;
+    snap.publishing = !m_can_publish;
+    snap.stat = m_stat;
+    snap.memory = m_memory->bytes();
+    snap.memory_peak = m_memory->peak();
+    snap.gop_duration = m_gop_duration > 0 ? m_gop_duration : GOP_CACHE_MAX_DURATION;
+
+    return snap;
+}
+
+DMemAccount *lms_source::memory()
+{
+    return m_memory;
+}
+
+dint64 lms_source::viewers()
+{
+    dint64 count = 0;
+    for (int i = 0; i < LmsStatProtocol::count; ++i) {
+        count += m_stat.viewers[i];
+    }
+
+    return count;
+}
+
+void lms_source::set_gop_duration(dint64 duration)
+{
+    DSpinLocker locker(&m_mutex);
+
+    m_gop_duration = duration;
+
+    dint64 max_duration = (duration > 0) ? duration : GOP_CACHE_MAX_DURATION;
+
+    m_gop_cache->set_max_duration(max_duration);
+    if (m_publish_gop_cache) {
+        m_publish_gop_cache->set_max_duration(max_duration);
+    }
+}
+
+dint64 lms_source::gop_duration()
+{
+    return m_gop_duration;
+}
+
+void lms_source::correct(CommonMessage *msg)
+{
+    for (int i = 0; i < CommonMessageCorrectTypes; ++i) {
+        msg->correct_dts[i] = m_jitters[i].correct(msg);
+    }
+    msg->corrected = true;
+}
+
 bool lms_source::add_reload_conn(lms_conn_base *base)
 {
     DSpinLocker locker(&m_mutex);
@@ -337,18 +654,27 @@ void lms_source::del_reload_conn(lms_conn_base *base)
 
 lms_source_manager *lms_source_manager::m_instance = new lms_source_manager;
 lms_source_manager::lms_source_manager()
+    : m_sweep_pos(0)
 {
 
 }
 
 lms_source_manager::~lms_source_manager()
 {
-    std::map<DString, lms_source*>::iterator it;
-    for (it = m_sources.begin(); it != m_sources.end(); ++it) {
-        lms_source *source = it->second;
-        DFree(source);
+    for (int i = 0; i < LMS_SOURCE_SHARDS; ++i) {
+        std::map<DString, lms_source_entry> &sources = m_shards[i].sources;
+
+        std::map<DString, lms_source_entry>::iterator it;
+        for (it = sources.begin(); it != sources.end(); ++it) {
+            DFree(it->second.source);
+        }
+        sources.clear();
+    }
+
+    for (int i = 0; i < (int)m_retired.size(); ++i) {
+        DFree(m_retired.at(i).second);
     }
-    m_sources.clear();
+    m_retired.clear();
 }
 
 lms_source_manager *lms_source_manager::instance()
@@ -358,46 +684,195 @@ lms_source_manager *lms_source_manager::instance()
 
 lms_source *lms_source_manager::addSource(kernel_request *req)
 {
-    DSpinLocker locker(&m_mutex);
-
     DString url = req->get_stream_url();
+    duint64 now = DDateTime::currentDate().toMS();
 
-    std::map<DString, lms_source*>::iterator it;
-    it = m_sources.find(url);
-    if (it != m_sources.end()) {
-        return it->second;
+    lms_source_shard *s = shard(url);
+    DSpinLocker locker(&s->mutex);
+
+    std::map<DString, lms_source_entry>::iterator it;
+    it = s->sources.find(url);
+    if (it != s->sources.end()) {
+        it->second.access_time = now;
+        return it->second.source;
     }
 
-    lms_source *source = new lms_source(req);
-    m_sources[url] = source;
+    lms_source_entry entry;
+    entry.source = new lms_source(req);
+    entry.access_time = now;
+    s->sources[url] = entry;
 
-    return source;
+    return entry.source;
 }
 
-void lms_source_manager::reload()
+int lms_source_manager::prewarm(kernel_request *req, DEvent *event, int ttl)
 {
-    DSpinLocker locker(&m_mutex);
+    int ret = ERROR_SUCCESS;
+
+    lms_server_config_struct *config = lms_config::instance()->get_server(req);
+    DAutoFree(lms_server_config_struct, config);
 
-    std::map<DString, lms_source*>::iterator it;
-    for (it = m_sources.begin(); it != m_sources.end(); ++it) {
-        lms_source *source = it->second;
-        source->reload();
+    if (!config || !config->get_proxy_enable(req)) {
+        ret = ERROR_SOURCE_PREWARM;
+        log_error("prewarm stream is not on edge. url=%s, ret=%d", req->get_stream_url().c_str(), ret);
+        return ret;
     }
 
+    lms_source *source = addSource(req);
+
+    if (!source->prewarm(event, (dint64)ttl * 1000)) {
+        ret = ERROR_SOURCE_PREWARM;
+        log_error("source prewarm failed. url=%s, ret=%d", req->get_stream_url().c_str(), ret);
+        return ret;
+    }
+
+    return ret;
+}
+
+std::vector<lms_source_snapshot> lms_source_manager::get_stats()
+{
+    std::vector<lms_source_snapshot> stats;
+
+    for (int i = 0; i < LMS_SOURCE_SHARDS; ++i) {
+        lms_source_shard *s = &m_shards[i];
+        DSpinLocker locker(&s->mutex);
+
+        std::map<DString, lms_source_entry>::iterator it;
+        for (it = s->sources.begin(); it != s->sources.end(); ++it) {
+            stats.push_back(it->second.source->snapshot());
+        }
+    }
+
+    return stats;
+}
+
+int lms_source_manager::shrink_gop_cache(dint64 bytes, dint64 duration)
+{
+    std::vector<lms_source_memory> sources;
+
+    for (int i = 0; i < LMS_SOURCE_SHARDS; ++i) {
+        lms_source_shard *s = &m_shards[i];
+        DSpinLocker locker(&s->mutex);
+
+        std::map<DString, lms_source_entry>::iterator it;
+        for (it = s->sources.begin(); it != s->sources.end(); ++it) {
+            lms_source *source = it->second.source;
+
+            dint64 current = source->gop_duration();
+            if (current > 0 && current <= duration) {
+                continue;
+            }
+
+            lms_source_memory item;
+            item.url = it->first;
+            item.source = source;
+            item.viewers = source->viewers();
+            item.bytes = source->memory()->bytes();
+            sources.push_back(item);
+        }
+    }
+
+    std::sort(sources.begin(), sources.end(), less_watched);
+
+    // 移除的source在reset中延迟释放，和这里都在主线程，不需要再持有分片的锁
+    dint64 total = 0;
+    int count = 0;
+
+    for (int i = 0; i < (int)sources.size() && total < bytes; ++i) {
+        lms_source_memory &item = sources.at(i);
+
+        item.source->set_gop_duration(duration);
+        total += item.bytes;
+        count++;
+
+        log_warn("memory pressure, shrink gop cache to %lld ms. url=%s, viewers=%lld, memory=%lld",
+                 duration, item.url.c_str(), item.viewers, item.bytes);
+    }
+
+    return count;
+}
+
+void lms_source_manager::restore_gop_cache()
+{
+    for (int i = 0; i < LMS_SOURCE_SHARDS; ++i) {
+        lms_source_shard *s = &m_shards[i];
+        DSpinLocker locker(&s->mutex);
+
+        std::map<DString, lms_source_entry>::iterator it;
+        for (it = s->sources.begin(); it != s->sources.end(); ++it) {
+            lms_source *source = it->second.source;
+            if (source->gop_duration() > 0) {
+                source->set_gop_duration(0);
+            }
+        }
+    }
+}
+
+void lms_source_manager::reload()
+{
+    for (int i = 0; i < LMS_SOURCE_SHARDS; ++i) {
+        lms_source_shard *s = &m_shards[i];
+        DSpinLocker locker(&s->mutex);
+
+        std::map<DString, lms_source_entry>::iterator it;
+        for (it = s->sources.begin(); it != s->sources.end(); ++it) {
+            lms_source *source = it->second.source;
+            source->reload();
+        }
+    }
 }
 
 void lms_source_manager::reset()
 {
-    DSpinLocker locker(&m_mutex);
+    duint64 now = DDateTime::currentDate().toMS();
 
-    std::map<DString, lms_source*>::iterator it;
-    for (it = m_sources.begin(); it != m_sources.end();) {
-        lms_source *source = it->second;
-        if (source->reset()) {
-            DFree(source);
-            m_sources.erase(it++);
+    free_retired(now);
+
+    for (int i = 0; i < LMS_SOURCE_SWEEP_SHARDS; ++i) {
+        sweep(&m_shards[m_sweep_pos], now);
+        m_sweep_pos = (m_sweep_pos + 1) & (LMS_SOURCE_SHARDS - 1);
+    }
+}
+
+lms_source_shard *lms_source_manager::shard(const DString &url)
+{
+    // FNV-1a
+    duint32 hash = 2166136261u;
+    for (int i = 0; i < (int)url.size(); ++i) {
+        hash ^= (duint8)url.at(i);
+        hash *= 16777619u;
+    }
+
+    return &m_shards[hash & (LMS_SOURCE_SHARDS - 1)];
+}
+
+void lms_source_manager::sweep(lms_source_shard *shard, duint64 now)
+{
+    DSpinLocker locker(&shard->mutex);
+
+    std::map<DString, lms_source_entry>::iterator it;
+    for (it = shard->sources.begin(); it != shard->sources.end();) {
+        lms_source_entry &entry = it->second;
+
+        // reset每次都要调用，边缘的linger在其中检查是否到期
+        if (entry.source->reset() && (entry.access_time + LMS_SOURCE_IDLE_GRACE <= now)) {
+            m_retired.push_back(std::make_pair(now, entry.source));
+            shard->sources.erase(it++);
         } else {
             it++;
         }
     }
 }
+
+void lms_source_manager::free_retired(duint64 now)
+{
+    while (!m_retired.empty()) {
+        std::pair<duint64, lms_source*> &retired = m_retired.front();
+        if (retired.first + LMS_SOURCE_RETIRE_DELAY > now) {
+            break;
+        }
+
+        DFree(retired.second);
+        m_retired.pop_front();
+    }
+}
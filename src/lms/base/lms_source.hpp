@@ -9,14 +9,23 @@
 #include "lms_reload_conn.hpp"
 #include "lms_stream_writer.hpp"
 #include "lms_source_external.hpp"
+#include "lms_timestamp.hpp"
+#include "lms_stats.hpp"
+#include "lms_capture.hpp"
 
 #include <pthread.h>
 #include <map>
 #include <deque>
+#include <vector>
 
 class kernel_request;
 class lms_edge;
 
+// 流热度的半衰期，单位毫秒
+#define LMS_SOURCE_POPULARITY_HALF_LIFE     (60 * 1000)
+// 热度最多把linger时间延长到几倍
+#define LMS_SOURCE_POPULARITY_MAX           4
+
 class lms_source
 {
 public:
@@ -28,6 +37,10 @@ public:
 
 public:
     bool onPlay(DEvent *event, bool edge);
+    /**
+     * @brief 没有播放时预先回源填充gop cache，ttl毫秒内没有播放则停止回源
+     */
+    bool prewarm(DEvent *event, dint64 ttl);
     bool onPublish(DEvent *event, bool edge);
     void onUnpublish();
 
@@ -35,8 +48,11 @@ public:
     int onAudio(CommonMessage *msg);
     int onMetadata(CommonMessage *msg);
 
-    bool add_connection(lms_conn_base *conn);
-    void del_connection(lms_conn_base *conn);
+    /**
+     * @param protocol 播放协议，LmsStatProtocol::Type，用于按协议统计播放数
+     */
+    bool add_connection(lms_conn_base *conn, int protocol);
+    void del_connection(lms_conn_base *conn, int protocol);
 
     int proxyMessage(CommonMessage *msg);
 
@@ -46,10 +62,57 @@ public:
     void start_external();
     void stop_external();
 
+    /**
+     * @brief 读取统计，不加锁，数值可能比实际略有延迟
+     */
+    lms_source_snapshot snapshot();
+
+    /**
+     * @brief 推流和回源连接的读事件中分配的内存记到这个account上
+     */
+    DMemAccount *memory();
+    /**
+     * @brief 所有协议的播放数
+     */
+    dint64 viewers();
+    /**
+     * @brief 内存紧张时缩小gop cache的时长，立即丢弃超出的gop，单位毫秒，0恢复默认时长
+     */
+    void set_gop_duration(dint64 duration);
+    dint64 gop_duration();
+
 public:
     bool add_reload_conn(lms_conn_base *base);
     void del_reload_conn(lms_conn_base *base);
 
+private:
+    /**
+     * @brief 按所有修正方式计算时间戳保存在消息中，所有连接共用
+     */
+    void correct(CommonMessage *msg);
+
+    bool start_play(DEvent *event);
+
+    /**
+     * @brief 按proxy_forward为每个地址创建一个推流edge，失败的地址只打印日志
+     */
+    void start_forward(DEvent *event);
+    void stop_publish();
+    /**
+     * @brief 按capture配置录制推流的消息，失败只打印日志，不影响推流
+     */
+    void start_capture();
+    void stop_capture();
+    /**
+     * @brief 停止回源，清空gop cache
+     */
+    void stop_play();
+    /**
+     * @brief 根据配置的proxy_linger和热度计算继续回源的时间，单位毫秒
+     */
+    dint64 linger_time(duint64 now);
+    void decay_popularity(duint64 now);
+
 private:
     kernel_request *m_req;
     lms_gop_cache *m_gop_cache;
@@ -57,6 +120,10 @@ private:
     lms_edge *m_publish;
     lms_edge *m_play;
 
+    // proxy_forward的推流edge，和m_publish共用m_publish_gop_cache和消息
+    std::vector<lms_edge*> m_forwards;
+    lms_gop_cache *m_publish_gop_cache;
+
     // 防止同时推一路流，所以加锁控制
     bool m_can_publish;
 
@@ -67,12 +134,58 @@ private:
 
     lms_source_external *m_external;
 
+    // 每种修正方式一个，下标是LmsTimeStamp::CorrectType
+    lms_timestamp m_jitters[CommonMessageCorrectTypes];
+
+    // 边缘最后一个播放断开后继续回源，到m_linger_until为止
+    bool m_lingering;
+    duint64 m_linger_until;
+    // 在linger期间重新播放的次数，按半衰期衰减
+    double m_popularity;
+    duint64 m_popularity_time;
+    // 预热设置的空闲保持时间，单位毫秒，停止回源后清零
+    dint64 m_prewarm_ttl;
+
+    lms_source_stat m_stat;
+
+    // 推流期间开启了capture时不为NULL
+    lms_capture_writer *m_capture;
+
+    DMemAccount *m_memory;
+    // set_gop_duration设置的时长，0表示默认
+    dint64 m_gop_duration;
+
 private:
     std::map<pthread_t, lms_event_conn*> m_conns;
     std::map<int, lms_reload_conn*> m_reloads;
 
 };
 
+// 分片数，必须是2的幂
+#define LMS_SOURCE_SHARDS           64
+// 每次reset检查的分片数，所有分片轮流检查一遍需要 LMS_SOURCE_SHARDS / LMS_SOURCE_SWEEP_SHARDS 秒
+#define LMS_SOURCE_SWEEP_SHARDS     8
+// 最后一次addSource之后至少空闲这么久才会回收，单位毫秒
+#define LMS_SOURCE_IDLE_GRACE       (10 * 1000)
+// 从表中移除后延迟释放的时间，单位毫秒
+#define LMS_SOURCE_RETIRE_DELAY     (10 * 1000)
+
+struct lms_source_entry
+{
+    lms_source *source;
+    duint64 access_time;
+};
+
+struct lms_source_shard
+{
+    DSpinLock mutex;
+    std::map<DString, lms_source_entry> sources;
+};
+
+/**
+ * @brief 按流名的hash分片保存source，每个分片单独加锁，不同流的推拉流互不影响。
+ *        空闲的source分批回收，移除后延迟释放，防止刚取到source的连接访问已释放的内存
+ */
 class lms_source_manager
 {
 public:
@@ -85,16 +198,49 @@ public:
      */
     lms_source *addSource(kernel_request *req);
 
+    /**
+     * @brief 预热边缘上的流，req所在的vhost必须开启了proxy
+     * @param ttl 没有播放时保持回源的时间，单位秒
+     */
+    int prewarm(kernel_request *req, DEvent *event, int ttl);
+
+    /**
+     * @brief 所有source的统计，只持有分片的锁，不加source的锁
+     */
+    std::vector<lms_source_snapshot> get_stats();
+
+    /**
+     * @brief 按播放数从少到多缩小gop cache，直到缩小的流占用的内存达到bytes，
+     *        已经缩小的流跳过，返回这次缩小的流数。只在主线程调用
+     */
+    int shrink_gop_cache(dint64 bytes, dint64 duration);
+    /**
+     * @brief 恢复所有流的gop cache时长
+     */
+    void restore_gop_cache();
+
     void reload();
 
+    /**
+     * @brief 每秒调用一次，每次只检查LMS_SOURCE_SWEEP_SHARDS个分片
+     */
     void reset();
 
+private:
+    lms_source_shard *shard(const DString &url);
+    void sweep(lms_source_shard *shard, duint64 now);
+    void free_retired(duint64 now);
+
 private:
     static lms_source_manager *m_instance;
 
 private:
-    std::map<DString, lms_source*> m_sources;
-    DSpinLock m_mutex;
+    lms_source_shard m_shards[LMS_SOURCE_SHARDS];
+    // 下次reset开始检查的分片
+    int m_sweep_pos;
+
+    // 已经从表中移除，等待释放的source，只在reset中访问
+    std::deque<std::pair<duint64, lms_source*> > m_retired;
 };
 
 #endif // LMS_SOURCE_HPP
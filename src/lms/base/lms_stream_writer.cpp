@@ -3,8 +3,36 @@
 #include "kernel_log.hpp"
 #include "kernel_codec.hpp"
 #include "lms_config.hpp"
+#include "lms_stats.hpp"
+#include "lms_trace.hpp"
+#include "lms_memory.hpp"
+#include "DDateTime.hpp"
 #include "DTcpSocket.hpp"
 
+#include <vector>
+
+// 延迟直方图每个桶的上限，最后一个桶没有上限
+static const dint64 lag_bounds[LMS_LAG_BUCKETS - 1] = { 100, 250, 500, 1000, 2000, 4000, 8000 };
+
+lms_writer_stat::lms_writer_stat()
+    : drop_bytes(0)
+    , max_lag(0)
+    , catchups(0)
+    , catchup_drops(0)
+    , reduce_drops(0)
+    , max_queue(0)
+    , first_frame(-1)
+{
+    for (int i = 0; i < LmsDegrade::count; ++i) {
+        enters[i] = 0;
+        drops[i] = 0;
+    }
+
+    for (int i = 0; i < LMS_LAG_BUCKETS; ++i) {
+        lag[i] = 0;
+    }
+}
+
 lms_stream_writer::lms_stream_writer(kernel_request *req, AVHandler handler, bool edge)
     : m_req(req)
     , m_handler(handler)
@@ -14,34 +42,86 @@ lms_stream_writer::lms_stream_writer(kernel_request *req, AVHandler handler, boo
     , m_cache_size(0)
     , m_fast_enable(false)
     , m_gop_enable(true)
+    , m_socket(NULL)
+    , m_level(LmsDegrade::normal)
+    , m_wait_keyframe(false)
+    , m_target_latency(0)
+    , m_head_dts(0)
+    , m_lag(0)
+    , m_catchup(false)
+    , m_has_video(false)
+    , m_stat_msgs(0)
+    , m_stat_bytes(0)
+    , m_stat_drop_bytes(0)
+    , m_create_time(DDateTime::currentDate().toMS())
+    , m_joined(false)
+#ifdef LMS_ENABLE_TRACE
+    , m_trace_pending(false)
+    , m_trace_handed(0)
+    , m_trace_stat(NULL)
+#endif
 {
-    m_jitter = new lms_timestamp();
+    m_jitter = new lms_timestamp_base();
 
     get_config_value();
+
+    if (!m_is_edge) {
+        lms_stats::instance()->worker()->writers++;
+    }
 }
 
 lms_stream_writer::~lms_stream_writer()
 {
+    if (m_stat.drop_bytes > 0) {
+        log_trace("stream writer degrade. disposable=%lld/%lld, keyframe=%lld/%lld, audio_only=%lld/%lld, wait_keyframe=%lld, drop_bytes=%lld",
+                  m_stat.enters[LmsDegrade::disposable], m_stat.drops[LmsDegrade::disposable],
+                  m_stat.enters[LmsDegrade::keyframe], m_stat.drops[LmsDegrade::keyframe],
+                  m_stat.enters[LmsDegrade::audio_only], m_stat.drops[LmsDegrade::audio_only],
+                  m_stat.drops[LmsDegrade::normal], m_stat.drop_bytes);
+    }
+
+    if (m_socket && !m_is_edge) {
+        log_trace("stream writer lag(ms). <100=%lld, <250=%lld, <500=%lld, <1000=%lld, <2000=%lld, <4000=%lld, <8000=%lld, >=8000=%lld, max=%lld, catchups=%lld/%lld",
+                  m_stat.lag[0], m_stat.lag[1], m_stat.lag[2], m_stat.lag[3],
+                  m_stat.lag[4], m_stat.lag[5], m_stat.lag[6], m_stat.lag[7],
+                  m_stat.max_lag, m_stat.catchups, m_stat.catchup_drops);
+    }
+
     DFree(m_jitter);
 
     clear();
+
+    if (!m_is_edge) {
+        lms_worker_stat *stat = lms_stats::instance()->worker();
+        stat->writers--;
+        stat->queue_msgs -= m_stat_msgs;
+        stat->queue_bytes -= m_stat_bytes;
+    }
 }
 
 int lms_stream_writer::send(CommonMessage *msg)
 {
-    if (m_cache_size >= m_queue_size) {
-        reduce();
-    }
+    dint64 timestamp = m_jitter->correct(msg);
+    dint64 dts = m_correct ? timestamp : msg->dts;
 
-    m_cache_size += msg->payload->length;
+    if (!m_is_edge) {
+        if (msg->is_video()) {
+            m_has_video = true;
+        }
 
-    dint64 timestamp = m_jitter->correct(msg);
+        update_lag(dts);
+        update_level();
 
-    CommonMessage *_msg = new CommonMessage(msg);
-    if (m_correct) {
-        _msg->dts = timestamp;
+        if (catchup(msg) || degrade(msg)) {
+            return flush();
+        }
     }
-    m_msgs.push_back(_msg);
+
+    if (m_cache_size >= lms_memory_manager::instance()->queue_limit(m_queue_size)) {
+        reduce();
+    }
+
+    push_back(msg->retain(), dts);
 
     return flush();
 }
@@ -50,17 +130,52 @@ int lms_stream_writer::flush()
 {
     int ret = ERROR_SUCCESS;
 
-    while (!m_msgs.empty()) {
-        CommonMessage *msg = m_msgs.front();
-        DAutoFree(CommonMessage, msg);
+#ifdef LMS_ENABLE_TRACE
+    trace_check();
+#endif
 
+    while (!m_msgs.empty()) {
+        WriterMessage item = m_msgs.front();
         m_msgs.pop_front();
 
-        if ((ret = m_handler(msg)) != ERROR_SUCCESS) {
+        m_cache_size -= item.msg->payload->length;
+
+        if (item.dts == item.msg->dts) {
+            ret = m_handler(item.msg);
+        } else {
+            // 时间戳不同时在栈上生成一份，只增加payload的引用
+            CommonMessage msg(item.msg);
+            msg.dts = item.dts;
+            ret = m_handler(&msg);
+        }
+
+        item.msg->release();
+
+#ifdef LMS_ENABLE_TRACE
+        if (item.trace_pickup > 0 && (ret == ERROR_SUCCESS || ret == SOCKET_EAGAIN)) {
+            trace_handed(item.trace_stat, item.trace_pickup);
+        }
+#endif
+
+        if (!m_joined && !m_is_edge && (ret == ERROR_SUCCESS || ret == SOCKET_EAGAIN)) {
+            m_joined = true;
+            dint64 join = DDateTime::currentDate().toMS() - m_create_time;
+            lms_stats::instance()->worker()->observe(LmsHistogram::join, join);
+            m_stat.first_frame = join;
+        }
+
+        if (m_socket && !m_is_edge && (ret == ERROR_SUCCESS || ret == SOCKET_EAGAIN)) {
+            duint64 end = m_socket->getTotalWriteSize() + m_socket->getWriteBufferLength();
+            m_inflight.push_back(std::make_pair(end, item.dts));
+        }
+
+        if (ret != ERROR_SUCCESS) {
             break;
         }
     }
 
+    update_worker_stat();
+
     return ret;
 }
 
@@ -78,6 +193,8 @@ void lms_stream_writer::reload()
 
     int queue_size = config->get_queue_size(m_req);
     m_queue_size = queue_size * 1024 * 1024;
+
+    m_target_latency = config->get_target_latency(m_req);
 }
 
 int lms_stream_writer::send_gop_messages(lms_gop_cache *gop, dint64 length)
@@ -93,55 +210,46 @@ int lms_stream_writer::send_gop_messages(lms_gop_cache *gop, dint64 length)
 
     if (!m_gop_enable && !m_fast_enable) {
         for (int i = 0; i < (int)msgs.size(); ++i) {
-            DFree(msgs.at(i));
+            msgs.at(i)->release();
         }
         msgs.clear();
     } else if (!msgs.empty()) {
-        dint64 timestamp = 0;
-        CommonMessage *msg = msgs.back();
+        std::vector<dint64> times(msgs.size());
 
         for (int i = 0; i < (int)msgs.size(); ++i) {
-            msg = msgs.at(i);
-            timestamp = m_jitter->correct(msg);
+            CommonMessage *msg = msgs.at(i);
+            dint64 timestamp = m_jitter->correct(msg);
 
-            if (m_correct) {
-                msg->dts = timestamp;
-            }
+            times[i] = m_correct ? timestamp : msg->dts;
 
             if (i == 0) {
                 first_time = timestamp;
             }
         }
 
-        dint64 audio_start_time = msg->dts - length;
+        dint64 audio_start_time = times.back() - length;
 
         for (int i = 0; i < (int)msgs.size(); ++i) {
-            msg = msgs.at(i);
+            CommonMessage *msg = msgs.at(i);
             if (m_fast_enable) {
-                if (msg->is_audio() && audio_start_time > msg->dts) {
+                if (msg->is_audio() && audio_start_time > times[i]) {
+                    msg->release();
                     continue;
                 }
             }
-            m_msgs.push_back(new CommonMessage(msg));
-        }
-
-        for (int i = 0; i < (int)msgs.size(); ++i) {
-            DFree(msgs.at(i));
+            push_back(msg, times[i]);
         }
         msgs.clear();
     }
 
     if (audio_sh) {
-        audio_sh->dts = first_time;
-        m_msgs.push_front(audio_sh);
+        push_front(audio_sh, first_time);
     }
     if (video_sh) {
-        video_sh->dts = first_time;
-        m_msgs.push_front(video_sh);
+        push_front(video_sh, first_time);
     }
     if (metadata) {
-        metadata->dts = first_time;
-        m_msgs.push_front(metadata);
+        push_front(metadata, first_time);
     }
 
     return flush();
@@ -162,6 +270,8 @@ void lms_stream_writer::get_config_value()
     int queue_size = config->get_queue_size(m_req);
     m_queue_size = queue_size * 1024 * 1024;
 
+    m_target_latency = config->get_target_latency(m_req);
+
     if (!m_is_edge) {
         m_correct = config->get_time_jitter(m_req);
 
@@ -173,7 +283,7 @@ void lms_stream_writer::get_config_value()
 void lms_stream_writer::clear()
 {
     for (int i = 0; i < (int)m_msgs.size(); ++i) {
-        DFree(m_msgs.at(i));
+        m_msgs.at(i).msg->release();
     }
     m_msgs.clear();
 
@@ -182,17 +292,270 @@ void lms_stream_writer::clear()
 
 void lms_stream_writer::reduce()
 {
+    dint64 queue_size = lms_memory_manager::instance()->queue_limit(m_queue_size);
+
     while (!m_msgs.empty()) {
-        CommonMessage *msg = m_msgs.front();
+        CommonMessage *msg = m_msgs.front().msg;
 
         if (msg->is_video() && msg->is_keyframe()) {
-            if (m_cache_size < m_queue_size){
+            if (m_cache_size < queue_size){
                 break;
             }
         }
 
         m_cache_size -= msg->payload->length;
         m_msgs.pop_front();
-        DFree(msg);
+        msg->release();
+
+        m_stat.reduce_drops++;
+    }
+}
+
+void lms_stream_writer::set_socket(DTcpSocket *socket)
+{
+    m_socket = socket;
+}
+
+lms_writer_stat lms_stream_writer::get_stat()
+{
+    return m_stat;
+}
+
+void lms_stream_writer::update_lag(dint64 dts)
+{
+    if (!m_socket) {
+        return;
+    }
+
+    m_head_dts = dts;
+    m_lag = lag();
+
+    int i = 0;
+    while (i < LMS_LAG_BUCKETS - 1 && m_lag >= lag_bounds[i]) {
+        i++;
+    }
+    m_stat.lag[i]++;
+    m_stat.max_lag = DMax(m_stat.max_lag, m_lag);
+
+    if (m_target_latency > 0 && !m_catchup && m_lag > m_target_latency) {
+        log_trace("stream writer lag %lld ms exceeds target %lld ms, skip to next keyframe", m_lag, m_target_latency);
+
+        m_catchup = true;
+        m_stat.catchups++;
+        skip_queue();
+    }
+}
+
+dint64 lms_stream_writer::lag()
+{
+    duint64 written = m_socket->getTotalWriteSize();
+    while (!m_inflight.empty() && m_inflight.front().first <= written) {
+        m_inflight.pop_front();
+    }
+
+    dint64 oldest = m_head_dts;
+    if (!m_inflight.empty()) {
+        oldest = m_inflight.front().second;
+    } else if (!m_msgs.empty()) {
+        oldest = m_msgs.front().dts;
+    }
+
+    return DMax(m_head_dts - oldest, 0);
+}
+
+bool lms_stream_writer::catchup(CommonMessage *msg)
+{
+    if (!m_catchup) {
+        return false;
+    }
+
+    if (msg->is_metadata() || msg->is_sequence_header()) {
+        return false;
+    }
+
+    // 延迟降到目标的一半后从关键帧恢复，纯音频流直接恢复
+    if (m_lag <= m_target_latency / 2) {
+        if ((msg->is_video() && msg->is_keyframe()) || (msg->is_audio() && !m_has_video)) {
+            m_catchup = false;
+            m_wait_keyframe = false;
+            return false;
+        }
+    }
+
+    m_stat.catchup_drops++;
+
+    return true;
+}
+
+void lms_stream_writer::skip_queue()
+{
+    std::deque<WriterMessage> msgs;
+
+    for (int i = 0; i < (int)m_msgs.size(); ++i) {
+        WriterMessage item = m_msgs.at(i);
+        CommonMessage *msg = item.msg;
+
+        if (msg->is_metadata() || msg->is_sequence_header()) {
+            msgs.push_back(item);
+            continue;
+        }
+
+        m_cache_size -= msg->payload->length;
+        m_stat.catchup_drops++;
+        msg->release();
+    }
+
+    m_msgs.swap(msgs);
+}
+
+void lms_stream_writer::update_level()
+{
+    dint64 backlog = m_cache_size;
+    if (m_socket) {
+        backlog += m_socket->getWriteBufferLength();
+    }
+
+    // 内存紧张时按限制后的队列降级
+    dint64 queue_size = lms_memory_manager::instance()->queue_limit(m_queue_size);
+    int level = m_level;
+
+    if (backlog >= queue_size) {
+        level = LmsDegrade::audio_only;
+    } else if (backlog >= queue_size * 3 / 4) {
+        level = DMax(level, (int)LmsDegrade::keyframe);
+    } else if (backlog >= queue_size / 2) {
+        level = DMax(level, (int)LmsDegrade::disposable);
+    } else if (backlog < queue_size / 4) {
+        level = LmsDegrade::normal;
+    }
+
+    if (level == m_level) {
+        return;
+    }
+
+    if (level > m_level) {
+        m_stat.enters[level]++;
+    } else if (m_level >= LmsDegrade::keyframe && level < LmsDegrade::keyframe) {
+        m_wait_keyframe = true;
+    }
+
+    log_trace("stream writer degrade level %d -> %d, backlog=%lld", m_level, level, backlog);
+
+    m_level = level;
+}
+
+bool lms_stream_writer::degrade(CommonMessage *msg)
+{
+    if (!msg->is_video() || msg->is_sequence_header()) {
+        return false;
+    }
+
+    bool drop = false;
+
+    if (m_level >= LmsDegrade::audio_only) {
+        drop = true;
+    } else if (m_level >= LmsDegrade::keyframe || m_wait_keyframe) {
+        drop = !msg->is_keyframe();
+    } else if (m_level >= LmsDegrade::disposable) {
+        drop = kernel_codec::video_is_disposable(msg->payload->data, msg->payload_length);
+    }
+
+    if (!drop) {
+        if (msg->is_keyframe()) {
+            m_wait_keyframe = false;
+        }
+        return false;
+    }
+
+    m_stat.drops[m_level]++;
+    m_stat.drop_bytes += msg->payload->length;
+
+    return true;
+}
+
+void lms_stream_writer::push_back(CommonMessage *msg, dint64 dts)
+{
+    WriterMessage item;
+    item.msg = msg;
+    item.dts = dts;
+#ifdef LMS_ENABLE_TRACE
+    // 只有lms_event_conn分发的采样消息有取出时间，gop cache中的消息不统计
+    item.trace_stat = NULL;
+    item.trace_pickup = m_is_edge ? 0 : lms_trace::pickup_time(msg, &item.trace_stat);
+#endif
+    m_msgs.push_back(item);
+
+    m_cache_size += msg->payload->length;
+    m_stat.max_queue = DMax(m_stat.max_queue, m_cache_size);
+}
+
+void lms_stream_writer::push_front(CommonMessage *msg, dint64 dts)
+{
+    WriterMessage item;
+    item.msg = msg;
+    item.dts = dts;
+#ifdef LMS_ENABLE_TRACE
+    item.trace_pickup = 0;
+    item.trace_stat = NULL;
+#endif
+    m_msgs.push_front(item);
+
+    m_cache_size += msg->payload->length;
+}
+
+void lms_stream_writer::update_worker_stat()
+{
+    if (m_is_edge) {
+        return;
+    }
+
+    lms_worker_stat *stat = lms_stats::instance()->worker();
+
+    dint64 msgs = m_msgs.size();
+    stat->queue_msgs += msgs - m_stat_msgs;
+    stat->queue_bytes += m_cache_size - m_stat_bytes;
+    stat->drop_bytes += m_stat.drop_bytes - m_stat_drop_bytes;
+
+    if (m_cache_size > stat->queue_max) {
+        stat->queue_max = m_cache_size;
+    }
+
+    m_stat_msgs = msgs;
+    m_stat_bytes = m_cache_size;
+    m_stat_drop_bytes = m_stat.drop_bytes;
+}
+
+#ifdef LMS_ENABLE_TRACE
+void lms_stream_writer::trace_handed(lms_source_stat *stat, dint64 pickup)
+{
+    dint64 now = lms_trace::now();
+    lms_trace::record(LmsTrace::queue, now - pickup, stat);
+
+    if (!m_socket || m_trace_pending) {
+        return;
+    }
+
+    if (m_socket->getWriteBufferLength() == 0) {
+        lms_trace::record(LmsTrace::write, 0, stat);
+        return;
+    }
+
+    m_socket->setTraceMark(m_socket->getTotalWriteSize() + m_socket->getWriteBufferLength());
+    m_trace_pending = true;
+    m_trace_handed = now;
+    m_trace_stat = stat;
+}
+
+void lms_stream_writer::trace_check()
+{
+    if (!m_trace_pending) {
+        return;
+    }
+
+    dint64 written = m_socket->traceWritten();
+    if (written > 0) {
+        lms_trace::record(LmsTrace::write, written - m_trace_handed, m_trace_stat);
+        m_trace_pending = false;
     }
 }
+#endif
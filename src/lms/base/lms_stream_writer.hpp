@@ -8,6 +8,46 @@
 #include "DTcpSocket.hpp"
 #include <deque>
 
+struct lms_source_stat;
+
+// 延迟直方图的桶数，上限见lms_stream_writer.cpp中的lag_bounds
+#define LMS_LAG_BUCKETS     8
+
+namespace LmsDegrade {
+    enum Level { normal = 0, disposable, keyframe, audio_only, count };
+}
+
+struct lms_writer_stat
+{
+    lms_writer_stat();
+
+    // 进入每个降级级别的次数
+    dint64 enters[LmsDegrade::count];
+    // 每个级别丢弃的视频帧数，normal表示恢复后等待关键帧时丢弃的
+    dint64 drops[LmsDegrade::count];
+    dint64 drop_bytes;
+
+    // 每个发送的消息采样一次延迟，单位毫秒
+    dint64 lag[LMS_LAG_BUCKETS];
+    dint64 max_lag;
+    // 超过target_latency跳到关键帧的次数，以及跳过的消息数
+    dint64 catchups;
+    dint64 catchup_drops;
+
+    // 队列超过queue_size时reduce丢弃的消息数
+    dint64 reduce_drops;
+    // 队列出现过的最大字节数
+    dint64 max_queue;
+    // 创建到第一个消息交给socket的时间，单位毫秒，-1表示还没有发送
+    dint64 first_frame;
+};
+
+/**
+ * @brief 播放连接发送不过来时逐级降级：队列超过queue_size的1/2丢弃非参考帧，
+ *        超过3/4只发关键帧和音频，超过queue_size只发音频，低于1/4时恢复正常。
+ *        内存接近memory_limit时queue_size会被lms_memory_manager限制得更小。
+ *        配置target_latency时，延迟超过目标后丢弃消息直到延迟降到一半并且收到关键帧
+ */
 class lms_stream_writer
 {
 public:
@@ -21,14 +61,54 @@ public:
 
     int send_gop_messages(lms_gop_cache *gop, dint64 length);
 
+    /**
+     * @brief 设置发送的socket，用socket中未发出的数据计算积压
+     */
+    void set_socket(DTcpSocket *socket);
+
+    lms_writer_stat get_stat();
+
 private:
     void get_config_value();
     void clear();
     void reduce();
 
+    /**
+     * @brief 计算最早没有发出去的消息和最新消息的时间差
+     */
+    void update_lag(dint64 dts);
+    dint64 lag();
+    /**
+     * @brief 追赶延迟时丢弃消息，丢弃返回true
+     */
+    bool catchup(CommonMessage *msg);
+    void skip_queue();
+
+    void update_level();
+    /**
+     * @brief 按当前降级级别判断是否丢弃，丢弃返回true
+     */
+    bool degrade(CommonMessage *msg);
+
+    void push_back(CommonMessage *msg, dint64 dts);
+    void push_front(CommonMessage *msg, dint64 dts);
+
+    /**
+     * @brief 把队列深度的变化累加到当前线程的lms_worker_stat
+     */
+    void update_worker_stat();
+
+#ifdef LMS_ENABLE_TRACE
+    /**
+     * @brief 采样消息交给socket后记录排队时间，并在socket上设置标记统计写入时间
+     */
+    void trace_handed(lms_source_stat *stat, dint64 pickup);
+    void trace_check();
+#endif
+
 private:
     kernel_request *m_req;
-    lms_timestamp *m_jitter;
+    lms_timestamp_base *m_jitter;
     AVHandler m_handler;
 
 private:
@@ -45,7 +125,53 @@ private:
     // gop cache enable
     bool m_gop_enable;
 
-    std::deque<CommonMessage*> m_msgs;
+    DTcpSocket *m_socket;
+
+    // 当前降级级别，LmsDegrade::Level
+    int m_level;
+    // 丢弃过参考帧，恢复后需要从关键帧开始
+    bool m_wait_keyframe;
+    lms_writer_stat m_stat;
+
+    // 目标延迟，单位毫秒，0表示不限制
+    dint64 m_target_latency;
+    // 最新消息的时间戳和当前延迟
+    dint64 m_head_dts;
+    dint64 m_lag;
+    bool m_catchup;
+    bool m_has_video;
+    // 已经交给socket还没有发出去的消息：消息结束时socket的写入总量，时间戳
+    std::deque<std::pair<duint64, dint64> > m_inflight;
+
+    // 消息是共享的引用，修正后的时间戳单独保存
+    typedef struct _WriterMessage
+    {
+        CommonMessage *msg;
+        dint64 dts;
+#ifdef LMS_ENABLE_TRACE
+        // 工作线程取出的时间，不是采样消息为0
+        dint64 trace_pickup;
+        lms_source_stat *trace_stat;
+#endif
+    }WriterMessage;
+
+    std::deque<WriterMessage> m_msgs;
+
+    // 上次累加到lms_worker_stat的队列深度和丢弃字节数
+    dint64 m_stat_msgs;
+    dint64 m_stat_bytes;
+    dint64 m_stat_drop_bytes;
+
+    // 创建的时间，第一个消息交给socket时统计加入时间
+    duint64 m_create_time;
+    bool m_joined;
+
+#ifdef LMS_ENABLE_TRACE
+    // 等待socket写入的采样消息，交给socket的时间
+    bool m_trace_pending;
+    dint64 m_trace_handed;
+    lms_source_stat *m_trace_stat;
+#endif
 
 };
 
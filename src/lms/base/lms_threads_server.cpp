@@ -2,6 +2,7 @@
 #include "lms_config.hpp"
 #include "lms_rtmp_listener.hpp"
 #include "lms_http_listener.hpp"
+#include "lms_stats.hpp"
 
 #include "kernel_errno.hpp"
 #include "DGlobal.hpp"
@@ -27,6 +28,9 @@ void lms_threads_server::reload()
 
 void lms_threads_server::run()
 {
+    // 没有连接的线程也注册统计，看门狗才能检测到
+    lms_stats::instance()->worker()->event = m_server->getEvent();
+
     start_rtmp();
     start_http();
 
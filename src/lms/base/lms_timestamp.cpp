@@ -237,3 +237,67 @@ dint64 lms_timestamp::simple_correct(CommonMessage *msg)
 
     return m_simple_last_correct;
 }
+
+/*********************************************************************/
+
+lms_timestamp_base::lms_timestamp_base()
+    : m_type(LmsTimeStamp::middle)
+    , m_first(true)
+    , m_base(0)
+    , m_jitter(NULL)
+{
+
+}
+
+lms_timestamp_base::~lms_timestamp_base()
+{
+    DFree(m_jitter);
+}
+
+dint64 lms_timestamp_base::correct(CommonMessage *msg)
+{
+    if (m_type < 0 || m_type >= CommonMessageCorrectTypes) {
+        return msg->dts;
+    }
+
+    if (!msg->corrected) {
+        if (!m_jitter) {
+            m_jitter = new lms_timestamp();
+            m_jitter->set_correct_type(m_type);
+        }
+        return m_jitter->correct(msg);
+    }
+
+    dint64 timestamp = msg->correct_dts[m_type];
+
+    // simple保留原始时间戳，不需要基准
+    if (m_type == LmsTimeStamp::simple) {
+        return timestamp;
+    }
+
+    if (m_first) {
+        m_base = timestamp;
+        m_first = false;
+    }
+
+    return DMax(timestamp - m_base, 0);
+}
+
+void lms_timestamp_base::set_correct_type(int type)
+{
+    m_type = type;
+
+    if (m_jitter) {
+        m_jitter->set_correct_type(type);
+    }
+}
+
+void lms_timestamp_base::reset()
+{
+    m_first = true;
+    m_base = 0;
+
+    if (m_jitter) {
+        m_jitter->reset();
+    }
+}
@@ -57,4 +57,29 @@ private:
 
 };
 
+/**
+ * @brief 使用source已经修正好的时间戳(CommonMessage::correct_dts)，只保存第一个消息的基准，
+ *        每个连接不再单独计算。消息没有经过source修正时退回到lms_timestamp
+ */
+class lms_timestamp_base
+{
+public:
+    lms_timestamp_base();
+    ~lms_timestamp_base();
+
+    dint64 correct(CommonMessage *msg);
+
+    void set_correct_type(int type);
+
+    void reset();
+
+private:
+    int m_type;
+
+    bool m_first;
+    dint64 m_base;
+
+    lms_timestamp *m_jitter;
+};
+
 #endif // LMS_TIMESTAMP_HPP
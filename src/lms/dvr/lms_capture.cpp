@@ -0,0 +1,246 @@
+#include "lms_capture.hpp"
+#include "kernel_errno.hpp"
+#include "kernel_log.hpp"
+#include "kernel_request.hpp"
+#include "DDir.hpp"
+#include "DDateTime.hpp"
+#include "DStream.hpp"
+#include <string.h>
+
+static const char capture_magic[4] = { 'L', 'M', 'S', 'C' };
+
+lms_capture_writer::lms_capture_writer()
+    : m_file(NULL)
+    , m_start_time(0)
+{
+
+}
+
+lms_capture_writer::~lms_capture_writer()
+{
+    close();
+}
+
+int lms_capture_writer::open(kernel_request *req, const DString &path)
+{
+    int ret = ERROR_SUCCESS;
+
+    m_start_time = DDateTime::currentDate().toMS();
+
+    m_filename = path;
+    m_filename.replace("[vhost]", req->vhost, true);
+    m_filename.replace("[app]", req->app, true);
+    m_filename.replace("[stream]", req->stream, true);
+    m_filename.replace("[timestamp]", DString::number(m_start_time), true);
+
+    DString dir = DFile::filePath(m_filename);
+    if (!dir.isEmpty() && !DDir::exists(dir) && !DDir::createDir(dir)) {
+        ret = ERROR_CREATE_DIR;
+        log_error("create capture dir %s failed. ret=%d", dir.c_str(), ret);
+        return ret;
+    }
+
+    m_file = new DFile(m_filename);
+    if (!m_file->open("wb")) {
+        ret = ERROR_OPEN_FILE;
+        log_error("open capture file %s failed. ret=%d", m_filename.c_str(), ret);
+        DFree(m_file);
+        return ret;
+    }
+
+    DStream header;
+    header.writeBytes((char*)capture_magic, sizeof(capture_magic));
+    header.write1Bytes(LMS_CAPTURE_VERSION);
+    header.write1Bytes(0);
+    header.write2Bytes(0);
+    header.write8Bytes((dint64)m_start_time);
+
+    if (m_file->write(header.data(), header.size()) != header.size()) {
+        ret = ERROR_WRITE_FILE;
+        log_error("write capture header failed. file=%s, ret=%d", m_filename.c_str(), ret);
+        close();
+        return ret;
+    }
+
+    log_trace("start capture. file=%s", m_filename.c_str());
+
+    return ret;
+}
+
+void lms_capture_writer::close()
+{
+    if (m_file) {
+        log_trace("stop capture. file=%s", m_filename.c_str());
+    }
+
+    DFree(m_file);
+}
+
+int lms_capture_writer::write(CommonMessage *msg)
+{
+    int ret = ERROR_SUCCESS;
+
+    if (!m_file) {
+        return ret;
+    }
+
+    duint8 flags = 0;
+    if (msg->keyframe) {
+        flags |= LMS_CAPTURE_FLAG_KEYFRAME;
+    }
+    if (msg->sequence_header) {
+        flags |= LMS_CAPTURE_FLAG_SEQUENCE_HEADER;
+    }
+
+    DStream header;
+    header.write1Bytes(msg->type);
+    header.write1Bytes(flags);
+    header.write4Bytes((dint32)(DDateTime::currentDate().toMS() - m_start_time));
+    header.write8Bytes(msg->dts);
+    header.write4Bytes((dint32)msg->cts);
+    header.write4Bytes(msg->payload->length);
+
+    if (m_file->write(header.data(), header.size()) != header.size()
+            || m_file->write(msg->payload->data, msg->payload->length) != msg->payload->length) {
+        ret = ERROR_WRITE_FILE;
+        log_error("write capture message failed, stop capture. file=%s, ret=%d", m_filename.c_str(), ret);
+        close();
+        return ret;
+    }
+
+    return ret;
+}
+
+DString lms_capture_writer::filename()
+{
+    return m_filename;
+}
+
+lms_capture_reader::lms_capture_reader()
+    : m_file(NULL)
+    , m_start_time(0)
+{
+
+}
+
+lms_capture_reader::~lms_capture_reader()
+{
+    close();
+}
+
+int lms_capture_reader::open(const DString &filename)
+{
+    int ret = ERROR_SUCCESS;
+
+    m_file = new DFile(filename);
+    if (!m_file->open("rb")) {
+        ret = ERROR_OPEN_FILE;
+        log_error("open capture file %s failed. ret=%d", filename.c_str(), ret);
+        DFree(m_file);
+        return ret;
+    }
+
+    char buf[LMS_CAPTURE_HEADER_SIZE];
+    if (m_file->read(buf, sizeof(buf)) != sizeof(buf) || memcmp(buf, capture_magic, sizeof(capture_magic)) != 0) {
+        ret = ERROR_CAPTURE_FORMAT;
+        log_error("%s is not a capture file. ret=%d", filename.c_str(), ret);
+        close();
+        return ret;
+    }
+
+    DStream header(buf, sizeof(buf));
+    dint8 version = 0;
+    dint64 start_time = 0;
+
+    header.skip(sizeof(capture_magic));
+    header.read1Bytes(version);
+    header.skip(3);
+    header.read8Bytes(start_time);
+
+    if (version != LMS_CAPTURE_VERSION) {
+        ret = ERROR_CAPTURE_FORMAT;
+        log_error("unsupported capture version %d. file=%s, ret=%d", version, filename.c_str(), ret);
+        close();
+        return ret;
+    }
+
+    m_start_time = start_time;
+
+    return ret;
+}
+
+void lms_capture_reader::close()
+{
+    DFree(m_file);
+}
+
+bool lms_capture_reader::read(CommonMessage *msg, dint64 &time, int &ret)
+{
+    ret = ERROR_SUCCESS;
+
+    char buf[LMS_CAPTURE_RECORD_SIZE];
+    dint64 nread = m_file->read(buf, sizeof(buf));
+
+    if (nread == 0) {
+        return false;
+    }
+
+    if (nread != sizeof(buf)) {
+        ret = ERROR_CAPTURE_FORMAT;
+        log_error("capture record header truncated. ret=%d", ret);
+        return false;
+    }
+
+    DStream header(buf, sizeof(buf));
+    dint8 type = 0, flags = 0;
+    dint32 offset = 0, cts = 0, length = 0;
+    dint64 dts = 0;
+
+    header.read1Bytes(type);
+    header.read1Bytes(flags);
+    header.read4Bytes(offset);
+    header.read8Bytes(dts);
+    header.read4Bytes(cts);
+    header.read4Bytes(length);
+
+    if (length < 0) {
+        ret = ERROR_CAPTURE_FORMAT;
+        log_error("capture record length %d is invalid. ret=%d", length, ret);
+        return false;
+    }
+
+    MemoryChunk *chunk = DMemPool::instance()->getMemory(length);
+    msg->payload = DSharedPtr<MemoryChunk>(chunk);
+    msg->payload->length = length;
+
+    if (length > 0 && m_file->read(msg->payload->data, length) != length) {
+        ret = ERROR_CAPTURE_FORMAT;
+        log_error("capture record payload truncated. ret=%d", ret);
+        return false;
+    }
+
+    msg->type = (duint8)type;
+    msg->keyframe = (flags & LMS_CAPTURE_FLAG_KEYFRAME) != 0;
+    msg->sequence_header = (flags & LMS_CAPTURE_FLAG_SEQUENCE_HEADER) != 0;
+    msg->dts = dts;
+    msg->cts = cts;
+    msg->payload_length = length;
+
+    time = offset;
+
+    return true;
+}
+
+int lms_capture_reader::rewind()
+{
+    if (m_file->seek(LMS_CAPTURE_HEADER_SIZE) != LMS_CAPTURE_HEADER_SIZE) {
+        return ERROR_CAPTURE_FORMAT;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+duint64 lms_capture_reader::start_time()
+{
+    return m_start_time;
+}
@@ -0,0 +1,76 @@
+#ifndef LMS_CAPTURE_HPP
+#define LMS_CAPTURE_HPP
+
+#include "DFile.hpp"
+#include "DString.hpp"
+#include "kernel_global.hpp"
+
+class kernel_request;
+
+// 文件头：'L' 'M' 'S' 'C'，版本，3字节保留，开始录制的时间(8字节，毫秒)
+#define LMS_CAPTURE_HEADER_SIZE     16
+#define LMS_CAPTURE_VERSION         1
+// 消息头：type(1) flags(1) 相对开始录制的接收时间(4，毫秒) dts(8) cts(4) length(4)，都是大端
+#define LMS_CAPTURE_RECORD_SIZE     22
+
+#define LMS_CAPTURE_FLAG_KEYFRAME           0x01
+#define LMS_CAPTURE_FLAG_SEQUENCE_HEADER    0x02
+
+/**
+ * @brief 把推流解析后、时间戳修正前的消息写入文件，用于lms-replay复现线上的流
+ */
+class lms_capture_writer
+{
+public:
+    lms_capture_writer();
+    ~lms_capture_writer();
+
+    /**
+     * @param path 支持[vhost] [app] [stream] [timestamp]
+     */
+    int open(kernel_request *req, const DString &path);
+    void close();
+
+    int write(CommonMessage *msg);
+
+    DString filename();
+
+private:
+    DFile *m_file;
+    DString m_filename;
+
+    // 开始录制的时间，单位毫秒
+    duint64 m_start_time;
+};
+
+/**
+ * @brief 顺序读取lms_capture_writer写的文件
+ */
+class lms_capture_reader
+{
+public:
+    lms_capture_reader();
+    ~lms_capture_reader();
+
+    int open(const DString &filename);
+    void close();
+
+    /**
+     * @brief 读取下一个消息，到达文件末尾时返回false，文件损坏时ret不为ERROR_SUCCESS
+     * @param time 相对开始录制的接收时间，单位毫秒
+     */
+    bool read(CommonMessage *msg, dint64 &time, int &ret);
+
+    /**
+     * @brief 回到第一个消息
+     */
+    int rewind();
+
+    duint64 start_time();
+
+private:
+    DFile *m_file;
+    duint64 m_start_time;
+};
+
+#endif // LMS_CAPTURE_HPP
@@ -23,7 +23,7 @@ lms_dvr_flv::lms_dvr_flv()
     , m_audio_sh(NULL)
     , m_metadata(NULL)
 {
-    m_jitter = new lms_timestamp();
+    m_jitter = new lms_timestamp_base();
     m_jitter->set_correct_type(LmsTimeStamp::middle);
 
     m_elapsed = new DElapsedTimer();
@@ -37,7 +37,7 @@ private:
     DElapsedTimer *m_elapsed;
     int m_time_expired;
 
-    lms_timestamp *m_jitter;
+    lms_timestamp_base *m_jitter;
     bool m_correct;
 
     bool m_started;
@@ -18,7 +18,7 @@ lms_hls_product::lms_hls_product()
 {
     m_segment = new lms_hls_segment();
 
-    m_jitter = new lms_timestamp();
+    m_jitter = new lms_timestamp_base();
     m_jitter->set_correct_type(LmsTimeStamp::middle);
 
     m_elapsed = new DElapsedTimer();
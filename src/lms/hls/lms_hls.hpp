@@ -44,7 +44,7 @@ private:
     bool m_has_video;
     bool m_has_audio;
 
-    lms_timestamp *m_jitter;
+    lms_timestamp_base *m_jitter;
     bool m_correct;
 
     bool m_started;
@@ -0,0 +1,809 @@
+#include "lms_http_api.hpp"
+#include "lms_http_server_conn.hpp"
+#include "kernel_log.hpp"
+#include "kernel_errno.hpp"
+#include "lms_config.hpp"
+#include "lms_source.hpp"
+#include "lms_http_utility.hpp"
+#include "lms_global.hpp"
+#include "lms_stats.hpp"
+#include "lms_trace.hpp"
+#include "lms_profiler.hpp"
+#include "lms_memory.hpp"
+#include "lms_watchdog.hpp"
+#include "DHttpHeader.hpp"
+#include "writer.h"
+#include "stringbuffer.h"
+
+using namespace rapidjson;
+
+lms_http_api::lms_http_api(lms_http_server_conn *conn)
+    : m_conn(conn)
+    , m_req(NULL)
+    , m_enable(false)
+    , m_timeout(10 * 1000 * 1000)
+    , m_keep_alive(false)
+    , m_keepalive_timeout(0)
+{
+
+}
+
+lms_http_api::~lms_http_api()
+{
+    DFree(m_req);
+}
+
+int lms_http_api::initialize(DHttpParser *parser)
+{
+    int ret = ERROR_SUCCESS;
+
+    // /api/prewarm 解析为 app=api, stream=prewarm，/metrics 解析为 app为空, stream=metrics
+    m_req = get_http_request(parser, false);
+    if (m_req == NULL) {
+        ret = ERROR_HTTP_GENERATE_REQUEST;
+        log_error("generate http request failed. ret=%d", ret);
+        return ret;
+    }
+
+    get_config_value();
+
+    if (!m_enable) {
+        ret = ERROR_HTTP_API_REJECT;
+        log_error("http api is disabled. vhost=%s, ret=%d", m_req->vhost.c_str(), ret);
+        return ret;
+    }
+
+    bool metrics = m_req->app.isEmpty() && m_req->stream == "metrics";
+    if (!metrics && (m_req->app != "api" || (m_req->stream != "prewarm" && m_req->stream != "stats" && m_req->stream != "profile"))) {
+        ret = ERROR_HTTP_API_UNSUPPORTED;
+        log_error("http api is not supported. api=%s/%s, ret=%d", m_req->app.c_str(), m_req->stream.c_str(), ret);
+        return ret;
+    }
+
+    // 采集会影响整个进程的性能，只允许在本机上操作
+    DString ip = m_conn->get_client_ip();
+    if (m_req->stream == "profile" && ip != "127.0.0.1" && ip != "::1") {
+        ret = ERROR_HTTP_API_REJECT;
+        log_error("http api profile is only allowed from localhost. ip=%s, ret=%d", ip.c_str(), ret);
+        return ret;
+    }
+
+    // 带body的请求不保持连接，body会被当作下一个请求
+    DStringRef length = parser->field(DHttpHeaderContentLength);
+    bool no_body = (length.isEmpty() || length.equals("0")) && parser->field(DHttpHeaderTransferEncoding).isEmpty();
+    m_keep_alive = parser->keepAlive() && no_body && m_keepalive_timeout > 0;
+
+    return ret;
+}
+
+int lms_http_api::start()
+{
+    int ret = ERROR_SUCCESS;
+
+    m_conn->setReadTimeOut(-1);
+    m_conn->setWriteTimeOut(m_timeout);
+
+    DString body;
+    DString type = "application/json";
+    if (m_req->stream == "metrics") {
+        body = api_metrics();
+        type = "text/plain; version=0.0.4";
+    } else if (m_req->stream == "stats") {
+        body = api_stats();
+    } else if (m_req->stream == "profile") {
+        body = api_profile();
+    } else {
+        body = api_prewarm();
+    }
+
+    if ((ret = response_http(body, type)) != ERROR_SUCCESS) {
+        if (ret != SOCKET_EAGAIN) {
+            return ret;
+        }
+        ret = ERROR_SUCCESS;
+    }
+
+    return ret;
+}
+
+int lms_http_api::flush()
+{
+    // 响应在start中已经全部写入socket缓冲区
+    return ERROR_SUCCESS;
+}
+
+bool lms_http_api::eof()
+{
+    return !m_conn->writeEagain();
+}
+
+dint64 lms_http_api::keepalive_timeout()
+{
+    return m_keep_alive ? m_keepalive_timeout : 0;
+}
+
+bool lms_http_api::reload()
+{
+    lms_server_config_struct *config = lms_config::instance()->get_server(m_req);
+    DAutoFree(lms_server_config_struct, config);
+
+    if (!config) {
+        return false;
+    }
+
+    if (!config->get_http_enable(m_req) || !config->get_http_api(m_req)) {
+        return false;
+    }
+
+    return true;
+}
+
+void lms_http_api::release()
+{
+    // nothing to do
+}
+
+void lms_http_api::get_config_value()
+{
+    lms_server_config_struct *config = lms_config::instance()->get_server(m_req);
+    DAutoFree(lms_server_config_struct, config);
+
+    if (!config) {
+        return;
+    }
+
+    int timeout = config->get_http_timeout(m_req);
+    m_timeout = timeout * 1000 * 1000;
+
+    int keepalive_timeout = config->get_http_keepalive_timeout(m_req);
+    m_keepalive_timeout = (dint64)keepalive_timeout * 1000 * 1000;
+
+    if (config->get_http_enable(m_req) && config->get_http_api(m_req)) {
+        m_enable = true;
+    }
+}
+
+int lms_http_api::response_http(const DString &body, const DString &type)
+{
+    int ret = ERROR_SUCCESS;
+
+    DHttpHeader header;
+    header.setServer(LMS_VERSION);
+    header.setContentLength(body.size());
+    header.addValue("Content-Type", type);
+
+    if (m_keep_alive) {
+        header.setConnectionKeepAlive();
+    } else {
+        header.setConnectionClose();
+    }
+
+    DString str = header.getResponseString(200);
+    int size = str.size() + body.size();
+
+    MemoryChunk *chunk = DMemPool::instance()->getMemory(size);
+    DSharedPtr<MemoryChunk> response = DSharedPtr<MemoryChunk>(chunk);
+
+    memcpy(response->data, str.data(), str.size());
+    memcpy(response->data + str.size(), body.data(), body.size());
+    response->length = size;
+
+    if ((ret = m_conn->write(response, size)) != ERROR_SUCCESS) {
+        log_error_eagain(ret, ERROR_HTTP_SEND_RESPONSE_HEADER, "http api write response failed. ret=%d", ret);
+        return ret;
+    }
+
+    return ret;
+}
+
+static void metric_head(DString &out, const char *name, const char *type, const char *help)
+{
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+static void metric_value(DString &out, const char *name, const DString &labels, dint64 value)
+{
+    out.append(name);
+    if (!labels.empty()) {
+        out.append("{").append(labels).append("}");
+    }
+    out.append(" ").append(DString::number(value)).append("\n");
+}
+
+static void metric_seconds(DString &out, const char *name, const DString &labels, double value)
+{
+    out.append(name);
+    if (!labels.empty()) {
+        out.append("{").append(labels).append("}");
+    }
+    out.append(" ").append(DString::number(value)).append("\n");
+}
+
+static DString metric_label(const char *key, DString value)
+{
+    value.replace("\\", "\\\\");
+    value.replace("\"", "\\\"");
+
+    DString label = key;
+    label.append("=\"").append(value).append("\"");
+
+    return label;
+}
+
+/**
+ * @brief 输出直方图，buckets是各线程相加后的计数，不累加，bounds是换算后的上限
+ */
+static void metric_histogram(DString &out, const char *name, const char *help, const dint64 *buckets, int size,
+                             const std::vector<double> &bounds, dint64 count, double sum)
+{
+    metric_head(out, name, "histogram", help);
+
+    dint64 total = 0;
+    for (int i = 0; i < size; ++i) {
+        total += buckets[i];
+
+        DString le = "+Inf";
+        if (i < size - 1) {
+            le = DString::number(bounds.at(i));
+        }
+
+        out.append(name).append("_bucket{le=\"").append(le).append("\"} ").append(DString::number(total)).append("\n");
+    }
+
+    out.append(name).append("_sum ").append(DString::number(sum)).append("\n");
+    out.append(name).append("_count ").append(DString::number(count)).append("\n");
+}
+
+/**
+ * @brief 事件循环的处理时间，以及按handler类型的调用次数和时间，单位微秒
+ */
+static void json_event(Writer<StringBuffer> &writer, DEvent *event)
+{
+    duint64 buckets[EVENT_LOOP_BUCKETS];
+    duint64 max_loop = 0;
+    duint64 max_handler = 0;
+    event->loopStat(buckets, max_loop, max_handler);
+
+    writer.Key("busy_usec");
+    writer.Uint64(event->busyUsec());
+    writer.Key("max_loop_usec");
+    writer.Uint64(max_loop);
+    writer.Key("max_handler_usec");
+    writer.Uint64(max_handler);
+
+    std::map<const char*, DEventHandlerStat> handlers = event->handlerStats();
+    writer.Key("handlers");
+    writer.StartArray();
+    std::map<const char*, DEventHandlerStat>::iterator it;
+    for (it = handlers.begin(); it != handlers.end(); ++it) {
+        writer.StartObject();
+        writer.Key("type");
+        writer.String(lms_watchdog::handler_name(it->first).c_str());
+        writer.Key("calls");
+        writer.Uint64(it->second.calls);
+        writer.Key("usec");
+        writer.Uint64(it->second.usec);
+        writer.Key("max_usec");
+        writer.Uint64(it->second.max_usec);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+#ifdef LMS_ENABLE_TRACE
+/**
+ * @brief 帧延迟跟踪的各阶段，count、sum和每个桶的计数，单位微秒
+ */
+static void json_trace(Writer<StringBuffer> &writer, const lms_histogram *traces)
+{
+    const char *stages[LmsTrace::count] = { "fanout", "handoff", "queue", "write" };
+
+    writer.Key("trace");
+    writer.StartObject();
+    for (int t = 0; t < LmsTrace::count; ++t) {
+        const lms_histogram &h = traces[t];
+
+        writer.Key(stages[t]);
+        writer.StartObject();
+        writer.Key("count");
+        writer.Int64(h.count);
+        writer.Key("sum");
+        writer.Int64(h.sum);
+        writer.Key("buckets");
+        writer.StartArray();
+        for (int i = 0; i < LMS_HISTOGRAM_BUCKETS; ++i) {
+            writer.Int64(h.buckets[i]);
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    writer.EndObject();
+}
+#endif
+
+DString lms_http_api::api_prewarm()
+{
+    int ret = ERROR_SUCCESS;
+
+    kernel_request req;
+    req.vhost = m_req->vhost;
+    req.host = m_req->host;
+    req.port = m_req->port;
+    req.app = m_req->params["app"];
+    req.stream = m_req->params["stream"];
+    req.tcUrl = "rtmp://" + req.vhost + "/" + req.app;
+    req.schema = "rtmp";
+
+    int ttl = lms_config::instance()->get_prewarm_ttl();
+    if (m_req->params.count("ttl") > 0) {
+        ttl = m_req->params["ttl"].toInt();
+    }
+
+    if (req.app.isEmpty() || req.stream.isEmpty() || ttl <= 0) {
+        ret = ERROR_GENERATE_REQUEST;
+        log_error("http api prewarm with invalid param. param=%s, ret=%d", m_req->oriParam.c_str(), ret);
+    } else {
+        ret = lms_source_manager::instance()->prewarm(&req, m_conn->getEvent(), ttl);
+    }
+
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+
+    writer.StartObject();
+    writer.Key("code");
+    writer.Int(ret);
+    writer.Key("url");
+    writer.String(req.get_stream_url().c_str());
+    writer.Key("ttl");
+    writer.Int(ttl);
+    writer.EndObject();
+
+    return buffer.GetString();
+}
+
+DString lms_http_api::api_profile()
+{
+    int ret = ERROR_SUCCESS;
+
+    lms_profiler *profiler = lms_profiler::instance();
+
+    DString type = m_req->params["type"];
+    DString action = m_req->params["action"];
+
+    if (action == "stop") {
+        profiler->stop();
+    } else if (!type.isEmpty()) {
+        int seconds = LMS_PROFILER_SECONDS;
+        if (m_req->params.count("seconds") > 0) {
+            seconds = m_req->params["seconds"].toInt();
+        }
+
+        if ((type != "cpu" && type != "heap") || seconds <= 0 || seconds > LMS_PROFILER_MAX_SECONDS) {
+            ret = ERROR_GENERATE_REQUEST;
+            log_error("http api profile with invalid param. param=%s, ret=%d", m_req->oriParam.c_str(), ret);
+        } else {
+            DString file;
+            ret = profiler->start(type == "cpu" ? LmsProfiler::cpu : LmsProfiler::heap, seconds, m_req->params["thread"], file);
+        }
+    }
+
+    lms_profiler_state state = profiler->state();
+
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+
+    writer.StartObject();
+    writer.Key("code");
+    writer.Int(ret);
+    writer.Key("running");
+    writer.Bool(state.running);
+    if (!state.file.isEmpty()) {
+        writer.Key("type");
+        writer.String(lms_profiler::type_name(state.type));
+        writer.Key("file");
+        writer.String(state.file.c_str());
+        writer.Key("thread");
+        writer.String(state.thread.c_str());
+        writer.Key("start_time");
+        writer.Uint64(state.start_time);
+        writer.Key("stop_time");
+        writer.Uint64(state.stop_time);
+    }
+    writer.EndObject();
+
+    return buffer.GetString();
+}
+
+DString lms_http_api::api_stats()
+{
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+
+    writer.StartObject();
+    writer.Key("code");
+    writer.Int(ERROR_SUCCESS);
+    writer.Key("server");
+    writer.String(LMS_VERSION);
+    writer.Key("now");
+    writer.Uint64(DDateTime::currentDate().toMS());
+
+    DMemPoolStat pool = DMemPool::instance()->stat();
+    writer.Key("mempool");
+    writer.StartObject();
+    writer.Key("block_size");
+    writer.Int(pool.block_size);
+    writer.Key("blocks");
+    writer.Int(pool.blocks);
+    writer.Key("idle_blocks");
+    writer.Int(pool.idle_blocks);
+    writer.Key("chunks");
+    writer.Int64(pool.chunks);
+    writer.Key("chunk_bytes");
+    writer.Int64(pool.chunk_bytes);
+    writer.EndObject();
+
+    lms_memory_state memory = lms_memory_manager::instance()->state();
+    writer.Key("memory");
+    writer.StartObject();
+    writer.Key("limit");
+    writer.Int64(memory.limit);
+    writer.Key("used");
+    writer.Int64(memory.used);
+    writer.Key("level");
+    writer.String(lms_memory_manager::level_name(memory.level));
+    writer.Key("enters");
+    writer.StartObject();
+    for (int i = LmsMemoryLevel::shrink_gop; i < LmsMemoryLevel::count; ++i) {
+        writer.Key(lms_memory_manager::level_name(i));
+        writer.Int64(memory.enters[i]);
+    }
+    writer.EndObject();
+    writer.Key("shrinks");
+    writer.Int64(memory.shrinks);
+    writer.EndObject();
+
+    std::vector<lms_worker_stat> workers = lms_stats::instance()->get_workers();
+    writer.Key("workers");
+    writer.StartArray();
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        lms_worker_stat &w = workers.at(i);
+
+        writer.StartObject();
+        writer.Key("thread");
+        writer.Uint64((duint64)w.thread);
+        writer.Key("connections");
+        writer.Int64(w.connections);
+        writer.Key("accepted");
+        writer.Int64(w.accepted);
+        writer.Key("loops");
+        writer.Uint64(w.event ? w.event->loops() : 0);
+        writer.Key("events");
+        writer.Uint64(w.event ? w.event->events() : 0);
+        if (w.event) {
+            json_event(writer, w.event);
+        }
+        writer.Key("writers");
+        writer.Int64(w.writers);
+        writer.Key("queue_msgs");
+        writer.Int64(w.queue_msgs);
+        writer.Key("queue_bytes");
+        writer.Int64(w.queue_bytes);
+        writer.Key("queue_max");
+        writer.Int64(w.queue_max);
+        writer.Key("drop_bytes");
+        writer.Int64(w.drop_bytes);
+#ifdef LMS_ENABLE_TRACE
+        json_trace(writer, w.traces);
+#endif
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    std::vector<lms_source_snapshot> sources = lms_source_manager::instance()->get_stats();
+    writer.Key("sources");
+    writer.StartArray();
+    for (int i = 0; i < (int)sources.size(); ++i) {
+        lms_source_snapshot &s = sources.at(i);
+
+        writer.StartObject();
+        writer.Key("url");
+        writer.String(s.url.c_str());
+        writer.Key("edge");
+        writer.Bool(s.edge);
+        writer.Key("publishing");
+        writer.Bool(s.publishing);
+        writer.Key("kbps");
+        writer.Int64(s.stat.kbps);
+        writer.Key("fps");
+        writer.Int64(s.stat.fps);
+        writer.Key("gop");
+        writer.Int64(s.stat.gop_size);
+        writer.Key("video_frames");
+        writer.Int64(s.stat.video_frames);
+        writer.Key("audio_frames");
+        writer.Int64(s.stat.audio_frames);
+        writer.Key("keyframes");
+        writer.Int64(s.stat.keyframes);
+        writer.Key("bytes");
+        writer.Int64(s.stat.bytes);
+        writer.Key("memory");
+        writer.Int64(s.memory);
+        writer.Key("memory_peak");
+        writer.Int64(s.memory_peak);
+        writer.Key("gop_duration");
+        writer.Int64(s.gop_duration);
+        writer.Key("viewers");
+        writer.StartObject();
+        writer.Key("rtmp");
+        writer.Int64(s.stat.viewers[LmsStatProtocol::rtmp]);
+        writer.Key("flv");
+        writer.Int64(s.stat.viewers[LmsStatProtocol::flv]);
+        writer.Key("ts");
+        writer.Int64(s.stat.viewers[LmsStatProtocol::ts]);
+        writer.EndObject();
+#ifdef LMS_ENABLE_TRACE
+        json_trace(writer, s.stat.traces);
+#endif
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+
+    return buffer.GetString();
+}
+
+DString lms_http_api::api_metrics()
+{
+    DString out;
+
+    std::vector<lms_worker_stat> workers = lms_stats::instance()->get_workers();
+
+    metric_head(out, "lms_connections", "gauge", "Current connections of the worker.");
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        metric_value(out, "lms_connections", metric_label("worker", DString::number(i)), workers.at(i).connections);
+    }
+
+    metric_head(out, "lms_connections_accepted_total", "counter", "Connections accepted by the worker.");
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        metric_value(out, "lms_connections_accepted_total", metric_label("worker", DString::number(i)), workers.at(i).accepted);
+    }
+
+    metric_head(out, "lms_event_loops_total", "counter", "epoll_wait returns of the worker.");
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        lms_worker_stat &w = workers.at(i);
+        metric_value(out, "lms_event_loops_total", metric_label("worker", DString::number(i)), w.event ? w.event->loops() : 0);
+    }
+
+    metric_head(out, "lms_events_total", "counter", "Events handled by the worker.");
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        lms_worker_stat &w = workers.at(i);
+        metric_value(out, "lms_events_total", metric_label("worker", DString::number(i)), w.event ? w.event->events() : 0);
+    }
+
+    // 事件循环的处理时间，直方图和handler类型在各线程间相加
+    dint64 loop_buckets[EVENT_LOOP_BUCKETS] = { 0 };
+    dint64 loop_count = 0;
+    double loop_sum = 0;
+    std::vector<double> max_loops;
+    std::map<DString, DEventHandlerStat> handlers;
+
+    metric_head(out, "lms_event_loop_busy_seconds_total", "counter", "Time spent handling events, excluding epoll_wait.");
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        lms_worker_stat &w = workers.at(i);
+        if (!w.event) {
+            max_loops.push_back(0);
+            continue;
+        }
+
+        double busy = w.event->busyUsec() / 1000000.0;
+        metric_seconds(out, "lms_event_loop_busy_seconds_total", metric_label("worker", DString::number(i)), busy);
+        loop_sum += busy;
+
+        duint64 buckets[EVENT_LOOP_BUCKETS];
+        duint64 max_loop = 0;
+        duint64 max_handler = 0;
+        w.event->loopStat(buckets, max_loop, max_handler);
+        for (int j = 0; j < EVENT_LOOP_BUCKETS; ++j) {
+            loop_buckets[j] += buckets[j];
+            loop_count += buckets[j];
+        }
+        max_loops.push_back(max_loop / 1000000.0);
+
+        std::map<const char*, DEventHandlerStat> stats = w.event->handlerStats();
+        std::map<const char*, DEventHandlerStat>::iterator it;
+        for (it = stats.begin(); it != stats.end(); ++it) {
+            DEventHandlerStat &h = handlers[lms_watchdog::handler_name(it->first)];
+            h.calls += it->second.calls;
+            h.usec += it->second.usec;
+            h.max_usec = DMax(h.max_usec, it->second.max_usec);
+        }
+    }
+
+    metric_head(out, "lms_event_loop_max_seconds", "gauge", "Longest single loop iteration of the worker.");
+    for (int i = 0; i < (int)max_loops.size(); ++i) {
+        metric_seconds(out, "lms_event_loop_max_seconds", metric_label("worker", DString::number(i)), max_loops.at(i));
+    }
+
+    std::vector<double> loop_bounds;
+    for (int i = 0; i < EVENT_LOOP_BUCKETS - 1; ++i) {
+        loop_bounds.push_back(DEvent::loopBound(i) / 1000000.0);
+    }
+    metric_histogram(out, "lms_event_loop_duration_seconds", "Time of each loop iteration that handled events.", loop_buckets,
+                     EVENT_LOOP_BUCKETS, loop_bounds, loop_count, loop_sum);
+
+    std::map<DString, DEventHandlerStat>::iterator it;
+
+    metric_head(out, "lms_event_handler_calls_total", "counter", "Handler calls by handler type.");
+    for (it = handlers.begin(); it != handlers.end(); ++it) {
+        metric_value(out, "lms_event_handler_calls_total", metric_label("type", it->first), it->second.calls);
+    }
+
+    metric_head(out, "lms_event_handler_seconds_total", "counter", "Handler time by handler type.");
+    for (it = handlers.begin(); it != handlers.end(); ++it) {
+        metric_seconds(out, "lms_event_handler_seconds_total", metric_label("type", it->first), it->second.usec / 1000000.0);
+    }
+
+    metric_head(out, "lms_event_handler_max_seconds", "gauge", "Longest single call by handler type.");
+    for (it = handlers.begin(); it != handlers.end(); ++it) {
+        metric_seconds(out, "lms_event_handler_max_seconds", metric_label("type", it->first), it->second.max_usec / 1000000.0);
+    }
+
+    metric_head(out, "lms_writer_queue_bytes", "gauge", "Bytes queued in player writers of the worker.");
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        metric_value(out, "lms_writer_queue_bytes", metric_label("worker", DString::number(i)), workers.at(i).queue_bytes);
+    }
+
+    metric_head(out, "lms_writer_drop_bytes_total", "counter", "Bytes dropped by writer degrading.");
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        metric_value(out, "lms_writer_drop_bytes_total", metric_label("worker", DString::number(i)), workers.at(i).drop_bytes);
+    }
+
+    // socket的写统计和直方图只在这里把各线程相加
+    DSocketStat socket;
+    memset(&socket, 0, sizeof(DSocketStat));
+    lms_histogram histograms[LmsHistogram::count];
+
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        lms_worker_stat &w = workers.at(i);
+
+        if (w.socket) {
+            socket.writes += w.socket->writes;
+            socket.write_bytes += w.socket->write_bytes;
+            socket.eagains += w.socket->eagains;
+            for (int j = 0; j < SOCKET_WRITE_BUCKETS; ++j) {
+                socket.write_sizes[j] += w.socket->write_sizes[j];
+            }
+        }
+
+        for (int t = 0; t < LmsHistogram::count; ++t) {
+            lms_histogram &h = histograms[t];
+            h.count += w.histograms[t].count;
+            h.sum += w.histograms[t].sum;
+            for (int j = 0; j < LMS_HISTOGRAM_BUCKETS; ++j) {
+                h.buckets[j] += w.histograms[t].buckets[j];
+            }
+        }
+    }
+
+    metric_head(out, "lms_socket_writes_total", "counter", "Successful writev calls.");
+    metric_value(out, "lms_socket_writes_total", "", socket.writes);
+    metric_head(out, "lms_socket_write_eagain_total", "counter", "writev calls returned EAGAIN.");
+    metric_value(out, "lms_socket_write_eagain_total", "", socket.eagains);
+
+    std::vector<double> bounds;
+    for (int i = 0; i < SOCKET_WRITE_BUCKETS - 1; ++i) {
+        bounds.push_back(DTcpSocket::writeSizeBound(i));
+    }
+    dint64 write_sizes[SOCKET_WRITE_BUCKETS];
+    for (int i = 0; i < SOCKET_WRITE_BUCKETS; ++i) {
+        write_sizes[i] = socket.write_sizes[i];
+    }
+    metric_histogram(out, "lms_socket_write_size_bytes", "Bytes of each successful writev.", write_sizes,
+                     SOCKET_WRITE_BUCKETS, bounds, socket.writes, socket.write_bytes);
+
+    const char *names[LmsHistogram::count] = { "lms_join_seconds", "lms_rtmp_handshake_seconds", "lms_fanout_seconds" };
+    const char *helps[LmsHistogram::count] = {
+        "Time from play start to the first message written.",
+        "Time of rtmp handshake.",
+        "Time from source dispatch to worker processed."
+    };
+    // join和handshake的单位是毫秒，fanout是微秒
+    const double scales[LmsHistogram::count] = { 1000.0, 1000.0, 1000000.0 };
+
+    for (int t = 0; t < LmsHistogram::count; ++t) {
+        bounds.clear();
+        for (int i = 0; i < LMS_HISTOGRAM_BUCKETS - 1; ++i) {
+            bounds.push_back(lms_worker_stat::bound(t, i) / scales[t]);
+        }
+
+        lms_histogram &h = histograms[t];
+        metric_histogram(out, names[t], helps[t], h.buckets, LMS_HISTOGRAM_BUCKETS, bounds, h.count, h.sum / scales[t]);
+    }
+
+#ifdef LMS_ENABLE_TRACE
+    const char *stages[LmsTrace::count] = { "fanout", "handoff", "queue", "write" };
+
+    metric_head(out, "lms_trace_seconds", "histogram", "Sampled frame latency of each pipeline stage.");
+    for (int t = 0; t < LmsTrace::count; ++t) {
+        lms_histogram h;
+        for (int i = 0; i < (int)workers.size(); ++i) {
+            const lms_histogram &w = workers.at(i).traces[t];
+            h.count += w.count;
+            h.sum += w.sum;
+            for (int j = 0; j < LMS_HISTOGRAM_BUCKETS; ++j) {
+                h.buckets[j] += w.buckets[j];
+            }
+        }
+
+        dint64 total = 0;
+        for (int j = 0; j < LMS_HISTOGRAM_BUCKETS; ++j) {
+            total += h.buckets[j];
+
+            DString le = "+Inf";
+            if (j < LMS_HISTOGRAM_BUCKETS - 1) {
+                le = DString::number(lms_trace_bound(j) / 1000000.0);
+            }
+
+            out.append("lms_trace_seconds_bucket{stage=\"").append(stages[t]).append("\",le=\"").append(le).append("\"} ");
+            out.append(DString::number(total)).append("\n");
+        }
+        out.append("lms_trace_seconds_sum{stage=\"").append(stages[t]).append("\"} ").append(DString::number(h.sum / 1000000.0)).append("\n");
+        out.append("lms_trace_seconds_count{stage=\"").append(stages[t]).append("\"} ").append(DString::number(h.count)).append("\n");
+    }
+#endif
+
+    DMemPoolStat pool = DMemPool::instance()->stat();
+    metric_head(out, "lms_mempool_blocks", "gauge", "Blocks in the memory pool.");
+    metric_value(out, "lms_mempool_blocks", "", pool.blocks);
+    metric_head(out, "lms_mempool_chunk_bytes", "gauge", "Bytes of chunks in use.");
+    metric_value(out, "lms_mempool_chunk_bytes", "", pool.chunk_bytes);
+
+    lms_memory_state memory = lms_memory_manager::instance()->state();
+    metric_head(out, "lms_memory_limit_bytes", "gauge", "Configured memory_limit, 0 means unlimited.");
+    metric_value(out, "lms_memory_limit_bytes", "", memory.limit);
+    metric_head(out, "lms_memory_level", "gauge", "Memory pressure level: 0 normal, 1 shrink gop cache, 2 cap queues.");
+    metric_value(out, "lms_memory_level", "", memory.level);
+    metric_head(out, "lms_memory_level_enters_total", "counter", "Times the memory pressure level was entered.");
+    for (int i = LmsMemoryLevel::shrink_gop; i < LmsMemoryLevel::count; ++i) {
+        metric_value(out, "lms_memory_level_enters_total", metric_label("level", lms_memory_manager::level_name(i)), memory.enters[i]);
+    }
+    metric_head(out, "lms_memory_gop_shrinks_total", "counter", "Streams whose gop cache was shrunk under memory pressure.");
+    metric_value(out, "lms_memory_gop_shrinks_total", "", memory.shrinks);
+
+    std::vector<lms_source_snapshot> sources = lms_source_manager::instance()->get_stats();
+
+    metric_head(out, "lms_source_kbps", "gauge", "Ingest bitrate of the stream.");
+    for (int i = 0; i < (int)sources.size(); ++i) {
+        metric_value(out, "lms_source_kbps", metric_label("url", sources.at(i).url), sources.at(i).stat.kbps);
+    }
+
+    metric_head(out, "lms_source_fps", "gauge", "Ingest video frame rate of the stream.");
+    for (int i = 0; i < (int)sources.size(); ++i) {
+        metric_value(out, "lms_source_fps", metric_label("url", sources.at(i).url), sources.at(i).stat.fps);
+    }
+
+    metric_head(out, "lms_source_memory_bytes", "gauge", "Memory charged to the stream by ingest, gop cache and muxers.");
+    for (int i = 0; i < (int)sources.size(); ++i) {
+        metric_value(out, "lms_source_memory_bytes", metric_label("url", sources.at(i).url), sources.at(i).memory);
+    }
+
+    metric_head(out, "lms_source_gop_cache_seconds", "gauge", "Gop cache duration of the stream.");
+    for (int i = 0; i < (int)sources.size(); ++i) {
+        metric_seconds(out, "lms_source_gop_cache_seconds", metric_label("url", sources.at(i).url), sources.at(i).gop_duration / 1000.0);
+    }
+
+    const char *protocols[LmsStatProtocol::count] = { "rtmp", "flv", "ts" };
+    metric_head(out, "lms_source_viewers", "gauge", "Viewers of the stream by protocol.");
+    for (int i = 0; i < (int)sources.size(); ++i) {
+        lms_source_snapshot &s = sources.at(i);
+        for (int p = 0; p < LmsStatProtocol::count; ++p) {
+            DString labels = metric_label("url", s.url);
+            labels.append(",").append(metric_label("protocol", protocols[p]));
+            metric_value(out, "lms_source_viewers", labels, s.stat.viewers[p]);
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,65 @@
+#ifndef LMS_HTTP_API_HPP
+#define LMS_HTTP_API_HPP
+
+#include "DHttpParser.hpp"
+#include "kernel_request.hpp"
+#include "lms_http_process_base.hpp"
+
+class lms_http_server_conn;
+
+/**
+ * @brief /api/下的控制接口，由http配置中的api开启，响应json
+ *
+ * GET /api/prewarm?vhost=test.com&app=live&stream=livestream&ttl=300
+ *     边缘预先回源，ttl秒内没有播放则停止，默认使用全局的prewarm_ttl
+ * GET /api/stats
+ *     所有流的码率、帧率、gop和按协议的播放数，每个工作线程的连接、事件循环和各类handler的处理时间、发送队列，内存池使用情况
+ * GET /metrics
+ *     prometheus文本格式，各线程的计数器和直方图在请求时汇总
+ * GET /api/profile?type=cpu&seconds=30&thread=lms-worker-0
+ *     开始cpu或heap采集，seconds秒后自动停止，thread只采集指定名字的线程，只允许本机访问
+ * GET /api/profile?action=stop
+ *     提前停止采集，不带参数时返回当前的采集状态
+ */
+class lms_http_api : public lms_http_process_base
+{
+public:
+    lms_http_api(lms_http_server_conn *conn);
+    virtual ~lms_http_api();
+
+    int initialize(DHttpParser *parser);
+    int start();
+
+    int flush();
+    bool eof();
+
+    bool reload();
+    void release();
+
+    kernel_request *request() { return m_req; }
+
+    dint64 keepalive_timeout();
+
+private:
+    void get_config_value();
+    int response_http(const DString &body, const DString &type);
+
+    DString api_prewarm();
+    DString api_stats();
+    DString api_metrics();
+    DString api_profile();
+
+private:
+    lms_http_server_conn *m_conn;
+    kernel_request *m_req;
+
+    bool m_enable;
+    dint64 m_timeout;
+
+    // 客户端请求保持连接并且配置允许时不为0
+    bool m_keep_alive;
+    dint64 m_keepalive_timeout;
+
+};
+
+#endif // LMS_HTTP_API_HPP
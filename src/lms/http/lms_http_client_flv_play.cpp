@@ -7,6 +7,7 @@
 #include "lms_config.hpp"
 #include "lms_source.hpp"
 #include "DHttpHeader.hpp"
+#include "lms_trace.hpp"
 
 lms_http_client_flv_play::lms_http_client_flv_play(lms_edge *parent, DEvent *event, lms_source *source)
     : DTcpSocket(event)
@@ -189,6 +190,8 @@ int lms_http_client_flv_play::do_start()
 
 int lms_http_client_flv_play::onMessage(CommonMessage *msg)
 {
+    LMS_TRACE_INGEST(msg);
+
     if (msg->is_audio()) {
         return m_source->onAudio(msg);
     } else if (msg->is_video()) {
@@ -7,6 +7,7 @@
 #include "lms_config.hpp"
 #include "lms_source.hpp"
 #include "DHttpHeader.hpp"
+#include "lms_trace.hpp"
 
 lms_http_client_ts_play::lms_http_client_ts_play(lms_edge *parent, DEvent *event, lms_source *source)
     : DTcpSocket(event)
@@ -96,20 +97,8 @@ int lms_http_client_ts_play::onReadProcess()
         }
     }
 
-    while (!m_reader->empty()) {
-        MemoryChunk *chunk = DMemPool::instance()->getMemory(m_pkt_size);
-        DSharedPtr<MemoryChunk> payload = DSharedPtr<MemoryChunk>(chunk);
-        payload->length = m_pkt_size;
-
-        if ((ret = m_reader->readBody(payload->data, m_pkt_size)) != ERROR_SUCCESS) {
-            log_error_eagain(ret, ERROR_TS_READ_BODY, "http client read ts body failed. ret=%d", ret);
-            return ret;
-        }
-
-        if (m_demuxer->demuxer(payload->data) != ERROR_SUCCESS) {
-            ret = ERROR_TS_DEMUXER;
-            return ret;
-        }
+    if (m_demuxer) {
+        ret = m_demuxer->service();
     }
 
     return ret;
@@ -201,9 +190,8 @@ int lms_http_client_ts_play::onHttpParser(DHttpParser *parser)
 
     m_source->start_external();
 
-    m_demuxer = GetCodecTsDemuxer();
-    m_demuxer->initialize(m_pkt_size);
-    m_demuxer->setHandler(TS_DEMUXER_CALLBACK(&lms_http_client_ts_play::onRecvMessage));
+    m_demuxer = new lms_http_ts_demuxer(m_reader);
+    m_demuxer->initialize(m_pkt_size, TS_DEMUXER_CALLBACK(&lms_http_client_ts_play::onRecvMessage));
 
     return ret;
 }
@@ -416,6 +404,8 @@ int lms_http_client_ts_play::create_hevc_message(TsDemuxerPacket &pkt)
 
 int lms_http_client_ts_play::process_message(CommonMessage *msg)
 {
+    LMS_TRACE_INGEST(msg);
+
     if (msg->is_audio()) {
         return m_source->onAudio(msg);
     } else if (msg->is_video()) {
@@ -4,7 +4,7 @@
 #include "DTcpSocket.hpp"
 #include "http_reader.hpp"
 #include "kernel_global.hpp"
-#include "codec.h"
+#include "lms_http_ts_demuxer.hpp"
 
 class kernel_request;
 class lms_edge;
@@ -56,7 +56,7 @@ private:
     kernel_request *m_dst_req;
 
     http_reader *m_reader;
-    CodecTsDemuxer *m_demuxer;
+    lms_http_ts_demuxer *m_demuxer;
 
 private:
     int m_port;
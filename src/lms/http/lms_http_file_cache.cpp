@@ -0,0 +1,183 @@
+#include "lms_http_file_cache.hpp"
+#include "DDateTime.hpp"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+lms_http_file_cache *lms_http_file_cache::m_instance = new lms_http_file_cache;
+
+lms_http_file_cache::lms_http_file_cache()
+    : m_last_sweep(0)
+{
+
+}
+
+lms_http_file_cache::~lms_http_file_cache()
+{
+    std::map<DString, lms_file_cache_entry*>::iterator it;
+    for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+        lms_file_cache_entry *entry = it->second;
+        ::close(entry->fd);
+        DFree(entry);
+    }
+    m_entries.clear();
+}
+
+lms_http_file_cache *lms_http_file_cache::instance()
+{
+    return m_instance;
+}
+
+lms_file_cache_entry *lms_http_file_cache::acquire(const DString &path, int valid)
+{
+    duint64 now = DDateTime::currentDate().toMS();
+
+    {
+        DSpinLocker locker(&m_mutex);
+
+        sweep(now, LMS_FILE_CACHE_IDLE);
+
+        std::map<DString, lms_file_cache_entry*>::iterator it = m_entries.find(path);
+        if (it != m_entries.end()) {
+            lms_file_cache_entry *entry = it->second;
+            if (valid > 0 && now - entry->check_time < (duint64)valid) {
+                entry->ref++;
+                entry->access_time = now;
+                return entry;
+            }
+        }
+    }
+
+    // 系统调用不放在锁里
+    struct stat st;
+    if (::stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode)) {
+        DSpinLocker locker(&m_mutex);
+
+        std::map<DString, lms_file_cache_entry*>::iterator it = m_entries.find(path);
+        if (it != m_entries.end()) {
+            lms_file_cache_entry *entry = it->second;
+            m_entries.erase(it);
+            retire(entry);
+        }
+
+        return NULL;
+    }
+
+    {
+        DSpinLocker locker(&m_mutex);
+
+        std::map<DString, lms_file_cache_entry*>::iterator it = m_entries.find(path);
+        if (it != m_entries.end()) {
+            lms_file_cache_entry *entry = it->second;
+            if (same_file(entry, st)) {
+                entry->ref++;
+                entry->check_time = now;
+                entry->access_time = now;
+                return entry;
+            }
+
+            m_entries.erase(it);
+            retire(entry);
+        }
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    // 以打开的fd为准，防止stat和open之间文件被替换
+    if (::fstat(fd, &st) == -1) {
+        ::close(fd);
+        return NULL;
+    }
+
+    lms_file_cache_entry *entry = new lms_file_cache_entry;
+    entry->path = path;
+    entry->fd = fd;
+    entry->size = st.st_size;
+    entry->dev = st.st_dev;
+    entry->ino = st.st_ino;
+    entry->mtime = st.st_mtim;
+    entry->check_time = now;
+    entry->access_time = now;
+    entry->ref = 1;
+    entry->stale = false;
+
+    DSpinLocker locker(&m_mutex);
+
+    // 其他线程可能已经打开了同一个文件
+    std::map<DString, lms_file_cache_entry*>::iterator it = m_entries.find(path);
+    if (it != m_entries.end()) {
+        lms_file_cache_entry *old = it->second;
+        m_entries.erase(it);
+        retire(old);
+    }
+
+    if ((int)m_entries.size() >= LMS_FILE_CACHE_MAX) {
+        sweep(now, 0);
+    }
+
+    m_entries[path] = entry;
+
+    return entry;
+}
+
+void lms_http_file_cache::release(lms_file_cache_entry *entry)
+{
+    if (!entry) {
+        return;
+    }
+
+    DSpinLocker locker(&m_mutex);
+
+    entry->ref--;
+
+    if (entry->stale && entry->ref <= 0) {
+        ::close(entry->fd);
+        DFree(entry);
+    }
+}
+
+bool lms_http_file_cache::same_file(lms_file_cache_entry *entry, const struct stat &st)
+{
+    return entry->dev == st.st_dev
+            && entry->ino == st.st_ino
+            && entry->size == st.st_size
+            && entry->mtime.tv_sec == st.st_mtim.tv_sec
+            && entry->mtime.tv_nsec == st.st_mtim.tv_nsec;
+}
+
+void lms_http_file_cache::retire(lms_file_cache_entry *entry)
+{
+    // 还有连接在发送这个文件，等release时再关闭
+    if (entry->ref > 0) {
+        entry->stale = true;
+        return;
+    }
+
+    ::close(entry->fd);
+    DFree(entry);
+}
+
+void lms_http_file_cache::sweep(duint64 now, duint64 idle)
+{
+    if (idle > 0 && now - m_last_sweep < LMS_FILE_CACHE_SWEEP) {
+        return;
+    }
+    m_last_sweep = now;
+
+    std::map<DString, lms_file_cache_entry*>::iterator it;
+    for (it = m_entries.begin(); it != m_entries.end();) {
+        lms_file_cache_entry *entry = it->second;
+
+        if (entry->ref <= 0 && now - entry->access_time >= idle) {
+            ::close(entry->fd);
+            DFree(entry);
+            m_entries.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
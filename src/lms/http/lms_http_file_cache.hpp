@@ -0,0 +1,73 @@
+#ifndef LMS_HTTP_FILE_CACHE_HPP
+#define LMS_HTTP_FILE_CACHE_HPP
+
+#include "DString.hpp"
+#include "DSpinLock.hpp"
+
+#include <map>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// 缓存的最大文件数，超出时先清理没有使用的文件
+#define LMS_FILE_CACHE_MAX          4096
+// 多久没有使用的文件会被关闭，单位毫秒
+#define LMS_FILE_CACHE_IDLE         (10 * 1000)
+// 清理空闲文件的间隔，单位毫秒
+#define LMS_FILE_CACHE_SWEEP        1000
+
+struct lms_file_cache_entry
+{
+    DString path;
+    int fd;
+    dint64 size;
+
+    // 用于判断文件是否被替换或修改
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+
+    // 上次stat检查的时间
+    duint64 check_time;
+    duint64 access_time;
+
+    int ref;
+    // 文件已经变化，从缓存中移除，引用为0时关闭
+    bool stale;
+};
+
+/**
+ * @brief 缓存打开的文件fd，避免每个请求都exists、open、stat。
+ *        文件被rename替换或修改后，下次检查时重新打开，所有线程共用
+ */
+class lms_http_file_cache
+{
+public:
+    lms_http_file_cache();
+    ~lms_http_file_cache();
+
+    static lms_http_file_cache *instance();
+
+public:
+    /**
+     * @brief 获取文件，引用计数加1，用完后调用release。文件不存在返回NULL
+     * @param valid 距离上次检查超过这个时间(毫秒)才重新stat，0表示每次都检查
+     */
+    lms_file_cache_entry *acquire(const DString &path, int valid);
+    void release(lms_file_cache_entry *entry);
+
+private:
+    bool same_file(lms_file_cache_entry *entry, const struct stat &st);
+    void retire(lms_file_cache_entry *entry);
+    void sweep(duint64 now, duint64 idle);
+
+private:
+    static lms_http_file_cache *m_instance;
+
+private:
+    std::map<DString, lms_file_cache_entry*> m_entries;
+    DSpinLock m_mutex;
+
+    duint64 m_last_sweep;
+};
+
+#endif // LMS_HTTP_FILE_CACHE_HPP
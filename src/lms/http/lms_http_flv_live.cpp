@@ -6,6 +6,7 @@
 #include "lms_http_server_conn.hpp"
 #include "DHttpHeader.hpp"
 #include "lms_global.hpp"
+#include "lms_verify_token.hpp"
 
 lms_http_flv_live::lms_http_flv_live(lms_http_server_conn *conn)
     : m_conn(conn)
@@ -47,9 +48,16 @@ int lms_http_flv_live::initialize(DHttpParser *parser)
         return ret;
     }
 
+    lms_verify_token token;
+    if (!token.check(m_req, false, m_conn->get_client_ip())) {
+        ret = ERROR_HTTP_TOKEN_REJECT;
+        log_warn("http token verify refused. ret=%d", ret);
+        return ret;
+    }
+
     m_source = lms_source_manager::instance()->addSource(m_req);
 
-    if (!m_source->add_connection(m_conn)) {
+    if (!m_source->add_connection(m_conn, LmsStatProtocol::flv)) {
         ret = ERROR_SOURCE_ADD_CONNECTION;
         return ret;
     }
@@ -65,6 +73,7 @@ int lms_http_flv_live::initialize(DHttpParser *parser)
     }
 
     m_writer = new lms_stream_writer(m_req, AV_Handler_Callback(&lms_http_flv_live::onSendMessage), false);
+    m_writer->set_socket(m_conn);
 
     m_flv = new http_flv_writer(m_conn);
     m_flv->set_chunked(m_chunked);
@@ -146,7 +155,7 @@ bool lms_http_flv_live::reload()
 void lms_http_flv_live::release()
 {
     if (m_source) {
-        m_source->del_connection(m_conn);
+        m_source->del_connection(m_conn, LmsStatProtocol::flv);
         m_source->del_reload_conn(m_conn);
     }
 }
@@ -26,6 +26,7 @@ public:
     void release();
 
     kernel_request *request() { return m_req; }
+    lms_stream_writer *writer() { return m_writer; }
 
 private:
     void get_config_value();
@@ -6,6 +6,8 @@
 #include "lms_http_server_conn.hpp"
 #include "DHttpHeader.hpp"
 #include "lms_global.hpp"
+#include "lms_verify_token.hpp"
+#include "lms_trace.hpp"
 
 lms_http_flv_recv::lms_http_flv_recv(lms_http_server_conn *conn)
     : m_conn(conn)
@@ -44,6 +46,13 @@ int lms_http_flv_recv::initialize(DHttpParser *parser)
         return ret;
     }
 
+    lms_verify_token token;
+    if (!token.check(m_req, true, m_conn->get_client_ip())) {
+        ret = ERROR_HTTP_TOKEN_REJECT;
+        log_warn("http token verify refused. ret=%d", ret);
+        return ret;
+    }
+
     m_source = lms_source_manager::instance()->addSource(m_req);
 
     if (!m_source->add_reload_conn(m_conn)) {
@@ -56,6 +65,9 @@ int lms_http_flv_recv::initialize(DHttpParser *parser)
         return ret;
     }
 
+    // 推流收到的数据记到流上
+    m_conn->setMemoryAccount(m_source->memory());
+
     m_source->start_external();
 
     m_flv = new http_flv_reader(m_conn->reader(), AV_Handler_Callback(&lms_http_flv_recv::onRecvMessage));
@@ -161,6 +173,8 @@ int lms_http_flv_recv::onRecvMessage(CommonMessage *msg)
 {
     int ret = ERROR_SUCCESS;
 
+    LMS_TRACE_INGEST(msg);
+
     if (m_is_edge) {
         return m_source->proxyMessage(msg);
     } else if (msg->is_audio()) {
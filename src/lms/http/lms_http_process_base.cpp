@@ -45,6 +45,16 @@ kernel_request *lms_http_process_base::request()
     return NULL;
 }
 
+lms_stream_writer *lms_http_process_base::writer()
+{
+    return NULL;
+}
+
+dint64 lms_http_process_base::keepalive_timeout()
+{
+    return 0;
+}
+
 int lms_http_process_base::process(CommonMessage *msg)
 {
     return 0;
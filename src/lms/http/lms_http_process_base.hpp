@@ -5,6 +5,8 @@
 #include "kernel_global.hpp"
 #include "DHttpParser.hpp"
 
+class lms_stream_writer;
+
 class lms_http_process_base
 {
 public:
@@ -22,6 +24,15 @@ public:
     virtual void release();
 
     virtual kernel_request *request();
+    /**
+     * @brief 播放请求的writer，用于结束时汇总发送质量，其他请求为NULL
+     */
+    virtual lms_stream_writer *writer();
+
+    /**
+     * @brief 响应完成后保持连接的时间，单位微秒，0表示关闭连接
+     */
+    virtual dint64 keepalive_timeout();
 
     virtual int process(CommonMessage *msg);
     virtual int service();
@@ -4,7 +4,6 @@
 #include "kernel_errno.hpp"
 #include "lms_config.hpp"
 #include "lms_http_utility.hpp"
-#include "DFile.hpp"
 #include "lms_global.hpp"
 #include "DHttpHeader.hpp"
 
@@ -12,8 +11,12 @@ lms_http_send_file::lms_http_send_file(lms_http_server_conn *conn)
     : m_conn(conn)
     , m_req(NULL)
     , m_sendfile(NULL)
+    , m_file(NULL)
     , m_enable(false)
     , m_timeout(10 * 1000 * 1000)
+    , m_keep_alive(false)
+    , m_keepalive_timeout(0)
+    , m_file_cache_valid(0)
 {
 
 }
@@ -22,6 +25,8 @@ lms_http_send_file::~lms_http_send_file()
 {
     DFree(m_req);
     DFree(m_sendfile);
+
+    lms_http_file_cache::instance()->release(m_file);
 }
 
 int lms_http_send_file::initialize(DHttpParser *parser)
@@ -42,19 +47,25 @@ int lms_http_send_file::initialize(DHttpParser *parser)
         return ret;
     }
 
-    DString url = parser->getUrl();
-    size_t pos = std::string::npos;
-    if ((pos = url.find("?")) != std::string::npos) {
-        url = url.substr(0, pos);
+    DStringRef url = parser->url();
+    int pos = url.find('?');
+    if (pos >= 0) {
+        url = url.mid(0, pos);
     }
-    m_filePath = m_root + url;
+    m_filePath = m_root + url.toString();
 
-    if (!DFile::exists(m_filePath)) {
+    m_file = lms_http_file_cache::instance()->acquire(m_filePath, m_file_cache_valid);
+    if (!m_file) {
         ret = ERROR_FILE_NOT_EXIST;
         log_error("file is not exist. filePath=%s, ret=%d", m_filePath.c_str(), ret);
         return ret;
     }
 
+    // 带body的请求不保持连接，body会被当作下一个请求
+    DStringRef length = parser->field(DHttpHeaderContentLength);
+    bool no_body = (length.isEmpty() || length.equals("0")) && parser->field(DHttpHeaderTransferEncoding).isEmpty();
+    m_keep_alive = parser->keepAlive() && no_body && m_keepalive_timeout > 0;
+
     return ret;
 }
 
@@ -67,7 +78,7 @@ int lms_http_send_file::start()
 
     m_sendfile = new DSendFile(m_conn->GetDescriptor());
 
-    if (m_sendfile->open(m_filePath) != ERROR_SUCCESS) {
+    if (m_sendfile->attach(m_file->fd, m_file->size) != ERROR_SUCCESS) {
         ret = ERROR_OPEN_FILE;
         log_error("http send file open failed. filePath=%s, ret=%d", m_filePath.c_str(), ret);
         return ret;
@@ -92,6 +103,11 @@ int lms_http_send_file::flush()
             return ret;
         }
 
+        // http header还在socket缓冲区中，等发送完再发文件
+        if (m_conn->writeEagain()) {
+            return ret;
+        }
+
         if (m_sendfile->sendFile() != ERROR_SUCCESS) {
             ret = ERROR_SEND_FILE;
             log_error("http send file send process failed. ret=%d", ret);
@@ -107,6 +123,11 @@ bool lms_http_send_file::eof()
     return m_sendfile->eof();
 }
 
+dint64 lms_http_send_file::keepalive_timeout()
+{
+    return m_keep_alive ? m_keepalive_timeout : 0;
+}
+
 bool lms_http_send_file::reload()
 {
     lms_server_config_struct *config = lms_config::instance()->get_server(m_req);
@@ -145,6 +166,11 @@ void lms_http_send_file::get_config_value()
 
     m_root = config->get_http_root(m_req);
 
+    int keepalive_timeout = config->get_http_keepalive_timeout(m_req);
+    m_keepalive_timeout = (dint64)keepalive_timeout * 1000 * 1000;
+
+    m_file_cache_valid = config->get_http_file_cache_valid(m_req);
+
     if (config->get_http_enable(m_req)) {
         m_enable = true;
     }
@@ -166,7 +192,11 @@ int lms_http_send_file::response_http_header()
         header.setContentType(type);
     }
 
-    header.setConnectionClose();
+    if (m_keep_alive) {
+        header.setConnectionKeepAlive();
+    } else {
+        header.setConnectionClose();
+    }
 
     DString str = header.getResponseString(200);
 
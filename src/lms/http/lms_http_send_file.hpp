@@ -5,6 +5,7 @@
 #include "DHttpParser.hpp"
 #include "kernel_request.hpp"
 #include "lms_http_process_base.hpp"
+#include "lms_http_file_cache.hpp"
 
 class lms_http_server_conn;
 
@@ -25,6 +26,8 @@ public:
 
     kernel_request *request() { return m_req; }
 
+    dint64 keepalive_timeout();
+
 private:
     void get_config_value();
     int response_http_header();
@@ -33,11 +36,18 @@ private:
     lms_http_server_conn *m_conn;
     kernel_request *m_req;
     DSendFile *m_sendfile;
+    // 从文件缓存中获取，析构时释放
+    lms_file_cache_entry *m_file;
 
     bool m_enable;
     dint64 m_timeout;
     DString m_root;
 
+    // 客户端请求保持连接并且配置允许时不为0
+    bool m_keep_alive;
+    dint64 m_keepalive_timeout;
+    int m_file_cache_valid;
+
     DString m_filePath;
 
 };
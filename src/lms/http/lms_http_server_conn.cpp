@@ -7,12 +7,14 @@
 #include "lms_global.hpp"
 #include "DDateTime.hpp"
 #include "DMd5.hpp"
+#include "lms_access_log.hpp"
 
 lms_http_server_conn::lms_http_server_conn(DThread *parent, DEvent *ev, int fd)
     : lms_conn_base(parent, ev, fd)
     , m_type(HttpType::Default)
     , m_process(NULL)
     , m_code(200)
+    , m_requests(0)
 {
     dint64 timeout = 10 * 1000 * 1000;
     setWriteTimeOut(timeout);
@@ -55,6 +57,7 @@ int lms_http_server_conn::onReadProcess()
         ret = m_process->service();
         break;
     case HttpType::SendFile:
+    case HttpType::Api:
     case HttpType::FlvLive:
     case HttpType::TsLive:
         clear_http_body();
@@ -80,11 +83,30 @@ int lms_http_server_conn::onWriteProcess()
         ret = m_process->flush();
         break;
     case HttpType::SendFile:
-        if ((ret = m_process->flush()) != ERROR_SUCCESS) {
-            return ret;
-        }
-        if (m_process->eof()) {
-            release();
+    case HttpType::Api:
+        while (true) {
+            if ((ret = m_process->flush()) != ERROR_SUCCESS) {
+                return ret;
+            }
+            if (!m_process->eof()) {
+                break;
+            }
+            if (m_process->keepalive_timeout() <= 0) {
+                release();
+                break;
+            }
+
+            if ((ret = next_request()) != ERROR_SUCCESS) {
+                if (ret != SOCKET_EAGAIN) {
+                    return ret;
+                }
+                ret = ERROR_SUCCESS;
+            }
+
+            // 下一个请求也是文件或api时直接开始发送，不会再有write事件
+            if (m_type != HttpType::SendFile && m_type != HttpType::Api) {
+                break;
+            }
         }
         break;
     case HttpType::TsRecv:
@@ -132,6 +154,7 @@ int lms_http_server_conn::Process(CommonMessage *msg)
         break;
     case HttpType::FlvRecv:
     case HttpType::SendFile:
+    case HttpType::Api:
     case HttpType::TsRecv:
         break;
     default:
@@ -143,18 +166,24 @@ int lms_http_server_conn::Process(CommonMessage *msg)
 
 void lms_http_server_conn::reload()
 {
-    if (!m_process->reload()) {
+    if (m_process && !m_process->reload()) {
         release();
     }
 }
 
 void lms_http_server_conn::release()
 {
-    if (m_code == 200) {
-        http_access_log_end(m_process->request(), m_client_ip, m_md5);
-    }
+    // 保持连接等待下一个请求时没有m_process
+    if (m_process) {
+        if (m_code == 200) {
+            lms_access_qos qos;
+            get_qos(qos, m_process->writer());
 
-    m_process->release();
+            http_access_log_end(m_process->request(), m_client_ip, m_md5, qos);
+        }
+
+        m_process->release();
+    }
 
     global_context->delete_id(m_fd);
 
@@ -165,20 +194,24 @@ int lms_http_server_conn::onHttpParser(DHttpParser *parser)
 {
     int ret = ERROR_SUCCESS;
 
-    DString method = parser->method();
-    DString url = parser->getUrl();
-    DString uri = url;
-    DString param;
+    // url和参数都直接指向parser中的header，不拷贝
+    DStringRef url = parser->url();
+    DStringRef uri = url;
+    DStringRef param;
 
-    size_t pos = std::string::npos;
-    if ((pos = url.find("?")) != std::string::npos) {
-        uri = url.substr(0, pos);
-        param = url.substr(pos + 1);
+    int pos = url.find('?');
+    if (pos >= 0) {
+        uri = url.mid(0, pos);
+        param = url.mid(pos + 1);
     }
 
-    if (method == "GET") {
-        DString val = getParam(param, "type");
-        if (val == "live") {
+    int method = parser->methodId();
+
+    bool api = uri.mid(0, 5).equals("/api/") || uri.equals("/metrics");
+    if (api && (method == LMS_HTTP_METHOD_GET || method == LMS_HTTP_METHOD_POST)) {
+        m_type = HttpType::Api;
+    } else if (method == LMS_HTTP_METHOD_GET) {
+        if (getParam(param, "type").equals("live")) {
             if (uri.endWith(".flv")) {
                 m_type = HttpType::FlvLive;
             } else if (uri.endWith(".ts")) {
@@ -186,12 +219,12 @@ int lms_http_server_conn::onHttpParser(DHttpParser *parser)
             } else {
                 m_code = 403;
                 ret = ERROR_HTTP_REQUEST_UNSUPPORTED;
-                log_error("get uri(%s) is not supported. ret=%d", uri.c_str(), ret);
+                log_error("get uri(%s) is not supported. ret=%d", uri.toString().c_str(), ret);
             }
         } else {
             m_type = HttpType::SendFile;
         }
-    } else if (method == "POST") {
+    } else if (method == LMS_HTTP_METHOD_POST) {
         if (uri.endWith(".flv")) {
             m_type = HttpType::FlvRecv;
         } else if (uri.endWith(".ts")) {
@@ -199,19 +232,19 @@ int lms_http_server_conn::onHttpParser(DHttpParser *parser)
         } else {
             m_code = 403;
             ret = ERROR_HTTP_REQUEST_UNSUPPORTED;
-            log_error("post uri(%s) is not supported. ret=%d", uri.c_str(), ret);
+            log_error("post uri(%s) is not supported. ret=%d", uri.toString().c_str(), ret);
         }
     } else {
         m_code = 403;
         ret = ERROR_HTTP_INVALID_METHOD;
-        log_error("method(%s) is not supported. ret=%d", method.c_str(), ret);
+        log_error("method(%s) is not supported. ret=%d", parser->method().c_str(), ret);
     }
 
     if (m_code != 200) {
         response_http_header(m_code);
 
         // write access log to file
-        http_access_log_begin(parser, m_code, m_begin_time, m_client_ip, m_md5, true);
+        http_access_log_begin(parser, NULL, m_code, m_begin_time, m_client_ip, m_md5, true);
 
         return ret;
     }
@@ -219,19 +252,24 @@ int lms_http_server_conn::onHttpParser(DHttpParser *parser)
     return do_process(parser);
 }
 
-DString lms_http_server_conn::getParam(const DString &param, const DString &key)
+DStringRef lms_http_server_conn::getParam(const DStringRef &param, const char *key)
 {
-    DString value;
-    DString _param = param;
-    DStringList args = _param.split("&");
-
-    for (int i = 0; i < (int)args.size(); ++i) {
-        DStringList temp = args.at(i).split("=");
-        if (temp.size() == 2) {
-            if (temp.at(0) == key) {
-                value = temp.at(1);
-            }
+    DStringRef value;
+
+    int start = 0;
+    while (start < param.length) {
+        int end = param.find('&', start);
+        if (end < 0) {
+            end = param.length;
         }
+
+        DStringRef arg = param.mid(start, end - start);
+        int eq = arg.find('=');
+        if (eq > 0 && arg.mid(0, eq).equals(key)) {
+            value = arg.mid(eq + 1);
+        }
+
+        start = end + 1;
     }
 
     return value;
@@ -257,6 +295,9 @@ int lms_http_server_conn::do_process(DHttpParser *parser)
     case HttpType::TsRecv:
         m_process = new lms_http_ts_recv(this);
         break;
+    case HttpType::Api:
+        m_process = new lms_http_api(this);
+        break;
     default:
         break;
     }
@@ -272,6 +313,8 @@ int lms_http_server_conn::do_process(DHttpParser *parser)
         case ERROR_HTTP_SEND_FILE_REJECT:
         case ERROR_HTTP_TS_LIVE_REJECT:
         case ERROR_HTTP_TS_RECV_REJECT:
+        case ERROR_HTTP_API_REJECT:
+        case ERROR_HTTP_TOKEN_REJECT:
             m_code = 403;
             break;
         default:         
@@ -281,16 +324,52 @@ int lms_http_server_conn::do_process(DHttpParser *parser)
         response_http_header(m_code);
 
         // write access log to file
-        http_access_log_begin(parser, m_code, m_begin_time, m_client_ip, m_md5, true);
+        http_access_log_begin(parser, m_process->request(), m_code, m_begin_time, m_client_ip, m_md5, true);
 
         return ret;
     }
 
-    http_access_log_begin(parser, 200, m_begin_time, m_client_ip, m_md5, false);
+    http_access_log_begin(parser, m_process->request(), 200, m_begin_time, m_client_ip, m_md5, false);
+
+    // 没有body的请求，后面的数据是下一个请求，响应完成前不读取
+    if (m_process->keepalive_timeout() > 0) {
+        m_reader->hold();
+    }
 
     return m_process->start();
 }
 
+int lms_http_server_conn::next_request()
+{
+    dint64 timeout = m_process->keepalive_timeout();
+
+    lms_access_qos qos;
+    get_qos(qos, m_process->writer());
+
+    http_access_log_end(m_process->request(), m_client_ip, m_md5, qos);
+
+    m_process->release();
+    DFree(m_process);
+
+    reset_qos();
+    // 推流结束后，下一个请求的内存记回连接自己
+    setMemoryAccount(NULL);
+
+    m_type = HttpType::Default;
+    m_code = 200;
+    m_requests++;
+
+    m_begin_time = DDateTime::currentDate().toString("yyyy-MM-dd hh:mm:ss.ms");
+    m_md5 = DMd5::md5(m_client_ip + m_begin_time + DString::number(m_fd) + DString::number(m_requests));
+
+    setWriteTimeOut(-1);
+    setReadTimeOut(timeout);
+
+    m_reader->reset();
+
+    return onReadProcess();
+}
+
 void lms_http_server_conn::response_http_header(int code)
 {
     DHttpHeader header;
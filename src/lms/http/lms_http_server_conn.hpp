@@ -10,6 +10,7 @@
 #include "lms_http_send_file.hpp"
 #include "lms_http_ts_live.hpp"
 #include "lms_http_ts_recv.hpp"
+#include "lms_http_api.hpp"
 #include "lms_http_process_base.hpp"
 
 class lms_source;
@@ -22,6 +23,8 @@ public:
 
     http_reader *reader();
 
+    DString get_client_ip() { return m_client_ip; }
+
 public:
     // Inherited from DTcpSocket
     virtual int  onReadProcess();
@@ -39,10 +42,15 @@ public:
 
 private:
     int onHttpParser(DHttpParser *parser);
-    DString getParam(const DString &param, const DString &key);
+    DStringRef getParam(const DStringRef &param, const char *key);
 
     int do_process(DHttpParser *parser);
 
+    /**
+     * @brief 保持连接时，结束当前请求并处理下一个，流水线的请求可能已经在缓冲区中
+     */
+    int next_request();
+
     void response_http_header(int code);
 
     void clear_http_body();
@@ -61,6 +69,9 @@ private:
     DString m_md5;
 
     int m_code;
+
+    // 当前连接上已经处理的请求数
+    int m_requests;
 };
 
 #endif // LMS_HTTP_SERVER_CONN_HPP
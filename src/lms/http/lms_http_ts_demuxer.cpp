@@ -0,0 +1,101 @@
+#include "lms_http_ts_demuxer.hpp"
+#include "kernel_errno.hpp"
+#include "kernel_log.hpp"
+
+#include <string.h>
+
+lms_http_ts_demuxer::lms_http_ts_demuxer(http_reader *reader)
+    : m_reader(reader)
+    , m_demuxer(NULL)
+    , m_pkt_size(188)
+    , m_buffer(NULL)
+    , m_null_packets(0)
+    , m_resyncs(0)
+{
+
+}
+
+lms_http_ts_demuxer::~lms_http_ts_demuxer()
+{
+    if (m_resyncs > 0) {
+        log_warn("ts demuxer lost sync %lld times, skip %lld null packets", m_resyncs, m_null_packets);
+    }
+
+    DFree(m_demuxer);
+    DFree(m_buffer);
+}
+
+void lms_http_ts_demuxer::initialize(int pkt_size, TsDemuxerHandler handler)
+{
+    m_pkt_size = pkt_size;
+
+    m_demuxer = GetCodecTsDemuxer();
+    m_demuxer->initialize(m_pkt_size);
+    m_demuxer->setHandler(handler);
+
+    DFree(m_buffer);
+    m_buffer = DMemPool::instance()->getMemory(m_pkt_size * LMS_TS_BATCH_PACKETS);
+    m_buffer->length = 0;
+}
+
+int lms_http_ts_demuxer::service()
+{
+    int ret = ERROR_SUCCESS;
+
+    while (!m_reader->empty()) {
+        int len = DMin(m_reader->getLength(), m_buffer->size - m_buffer->length);
+
+        if ((ret = m_reader->readBody(m_buffer->data + m_buffer->length, len)) != ERROR_SUCCESS) {
+            log_error_eagain(ret, ERROR_TS_READ_BODY, "http read ts body failed. ret=%d", ret);
+            return ret;
+        }
+        m_buffer->length += len;
+
+        int consumed = demux(m_buffer->data, m_buffer->length);
+        if (consumed < 0) {
+            ret = ERROR_TS_DEMUXER;
+            return ret;
+        }
+
+        // 不完整的包移到开头，和下次读取的数据拼接
+        int rest = m_buffer->length - consumed;
+        if (rest > 0 && consumed > 0) {
+            memmove(m_buffer->data, m_buffer->data + consumed, rest);
+        }
+        m_buffer->length = rest;
+    }
+
+    return ret;
+}
+
+int lms_http_ts_demuxer::demux(char *data, int len)
+{
+    char *p = data;
+    char *end = data + len;
+
+    while (end - p >= m_pkt_size) {
+        if ((duint8)p[0] != LMS_TS_SYNC_BYTE) {
+            m_resyncs++;
+
+            char *sync = (char*)memchr(p + 1, LMS_TS_SYNC_BYTE, end - p - 1);
+            if (!sync) {
+                p = end;
+                break;
+            }
+
+            p = sync;
+            continue;
+        }
+
+        int pid = ((p[1] & 0x1F) << 8) | (duint8)p[2];
+        if (pid == LMS_TS_NULL_PID) {
+            m_null_packets++;
+        } else if (m_demuxer->demuxer(p) != ERROR_SUCCESS) {
+            return -1;
+        }
+
+        p += m_pkt_size;
+    }
+
+    return p - data;
+}
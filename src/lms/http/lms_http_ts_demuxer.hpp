@@ -0,0 +1,51 @@
+#ifndef LMS_HTTP_TS_DEMUXER_HPP
+#define LMS_HTTP_TS_DEMUXER_HPP
+
+#include "http_reader.hpp"
+#include "DMemPool.hpp"
+#include "codec.h"
+
+#define LMS_TS_SYNC_BYTE            0x47
+#define LMS_TS_NULL_PID             0x1FFF
+// 每次从http body中读取的最大包数，188字节的包约64K
+#define LMS_TS_BATCH_PACKETS        348
+
+/**
+ * @brief 从http body中按块读取ts数据，在同一块缓冲区中逐包解复用，不再为每个包分配内存。
+ *        跳过空包，丢失同步时用memchr查找下一个同步字节
+ */
+class lms_http_ts_demuxer
+{
+public:
+    lms_http_ts_demuxer(http_reader *reader);
+    ~lms_http_ts_demuxer();
+
+public:
+    void initialize(int pkt_size, TsDemuxerHandler handler);
+
+    /**
+     * @brief 读取reader中所有的body数据并解复用，不足一个包的数据留到下次
+     */
+    int service();
+
+private:
+    /**
+     * @brief 解复用data中完整的包，返回处理的字节数，出错返回-1
+     */
+    int demux(char *data, int len);
+
+private:
+    http_reader *m_reader;
+    CodecTsDemuxer *m_demuxer;
+
+    int m_pkt_size;
+
+    // 读取缓冲区，开头是上次剩余的不完整包
+    MemoryChunk *m_buffer;
+
+    // 跳过的空包数和重新同步的次数
+    dint64 m_null_packets;
+    dint64 m_resyncs;
+};
+
+#endif // LMS_HTTP_TS_DEMUXER_HPP
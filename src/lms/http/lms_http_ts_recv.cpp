@@ -5,7 +5,9 @@
 #include "lms_http_server_conn.hpp"
 #include "lms_http_utility.hpp"
 #include "lms_global.hpp"
+#include "lms_verify_token.hpp"
 #include "DHttpHeader.hpp"
+#include "lms_trace.hpp"
 
 #define DEFAULT_TS_PACKET_SIZE      188
 
@@ -48,6 +50,13 @@ int lms_http_ts_recv::initialize(DHttpParser *parser)
         return ret;
     }
 
+    lms_verify_token token;
+    if (!token.check(m_req, true, m_conn->get_client_ip())) {
+        ret = ERROR_HTTP_TOKEN_REJECT;
+        log_warn("http token verify refused. ret=%d", ret);
+        return ret;
+    }
+
     m_source = lms_source_manager::instance()->addSource(m_req);
 
     if (!m_source->add_reload_conn(m_conn)) {
@@ -60,11 +69,13 @@ int lms_http_ts_recv::initialize(DHttpParser *parser)
         return ret;
     }
 
+    // 推流收到的数据记到流上
+    m_conn->setMemoryAccount(m_source->memory());
+
     m_source->start_external();
 
-    m_demuxer = GetCodecTsDemuxer();
-    m_demuxer->initialize(m_pkt_size);
-    m_demuxer->setHandler(TS_DEMUXER_CALLBACK(&lms_http_ts_recv::onRecvMessage));
+    m_demuxer = new lms_http_ts_demuxer(m_reader);
+    m_demuxer->initialize(m_pkt_size, TS_DEMUXER_CALLBACK(&lms_http_ts_recv::onRecvMessage));
 
     return ret;
 }
@@ -87,25 +98,7 @@ int lms_http_ts_recv::start()
 
 int lms_http_ts_recv::service()
 {
-    int ret = ERROR_SUCCESS;
-
-    while (!m_reader->empty()) {
-        MemoryChunk *chunk = DMemPool::instance()->getMemory(m_pkt_size);
-        DSharedPtr<MemoryChunk> payload = DSharedPtr<MemoryChunk>(chunk);
-        payload->length = m_pkt_size;
-
-        if ((ret = m_reader->readBody(payload->data, m_pkt_size)) != ERROR_SUCCESS) {
-            log_error_eagain(ret, ERROR_TS_READ_BODY, "http read ts body failed. ret=%d", ret);
-            return ret;
-        }
-
-        if (m_demuxer->demuxer(payload->data) != ERROR_SUCCESS) {
-            ret = ERROR_TS_DEMUXER;
-            return ret;
-        }
-    }
-
-    return ret;
+    return m_demuxer->service();
 }
 
 bool lms_http_ts_recv::reload()
@@ -342,6 +335,8 @@ int lms_http_ts_recv::process_message(CommonMessage *msg)
 {
     int ret = ERROR_SUCCESS;
 
+    LMS_TRACE_INGEST(msg);
+
     if (m_is_edge) {
         return m_source->proxyMessage(msg);
     } else if (msg->is_audio()) {
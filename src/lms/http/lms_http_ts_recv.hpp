@@ -5,7 +5,7 @@
 #include "lms_source.hpp"
 #include "kernel_request.hpp"
 #include "http_reader.hpp"
-#include "codec.h"
+#include "lms_http_ts_demuxer.hpp"
 #include "lms_http_process_base.hpp"
 
 class lms_http_server_conn;
@@ -42,7 +42,7 @@ private:
     lms_http_server_conn *m_conn;
     kernel_request *m_req;
     lms_source *m_source;
-    CodecTsDemuxer *m_demuxer;
+    lms_http_ts_demuxer *m_demuxer;
     http_reader *m_reader;
 
     bool m_enable;
@@ -6,11 +6,7 @@ kernel_request *get_http_request(DHttpParser *parser, bool del_suffix)
 {
     kernel_request *req = new kernel_request();
 
-    DString _url = parser->getUrl();
-    DString _host = parser->feild("Host");
-    DString _refer = parser->feild("Referer");
-
-    req->set_http_url(_host, _url, _refer, del_suffix);
+    req->set_http_url(parser->field(DHttpHeaderHost), parser->url(), parser->field(DHttpHeaderReferer), del_suffix);
 
     if (req->vhost.isEmpty() || req->stream.isEmpty()) {
         DFree(req);
@@ -19,27 +15,24 @@ kernel_request *get_http_request(DHttpParser *parser, bool del_suffix)
     return req;
 }
 
-void http_access_log_begin(DHttpParser *parser, int status, const DString &timestamp,
+void http_access_log_begin(DHttpParser *parser, kernel_request *req, int status, const DString &timestamp,
                            const DString &ip, const DString &md5, bool end)
 {
-    kernel_request *req = new kernel_request();
-    DAutoFree(kernel_request, req);
-
-    DString _url = parser->getUrl();
-    DString _host = parser->feild("Host");
-    DString _refer = parser->feild("Referer");
-    DString _agent = parser->feild("User-Agent");
-    DString _method = parser->method();
-
-    req->set_http_url(_host, _url, _refer, true);
+    kernel_request *temp = NULL;
+    if (!req) {
+        temp = new kernel_request();
+        temp->set_http_url(parser->field(DHttpHeaderHost), parser->url(), parser->field(DHttpHeaderReferer), true);
+        req = temp;
+    }
+    DAutoFree(kernel_request, temp);
 
     lms_access_log_info info;
     info.ip = ip;
     info.status = DString::number(status);
     info.timestamp = timestamp;
-    info.agent = _agent;
-    info.method = _method;
-    info.referer = _refer;
+    info.agent = parser->field(DHttpHeaderUserAgent).toString();
+    info.method = parser->method();
+    info.referer = req->pageUrl;
     info.vhost = req->vhost;
     info.app = req->app;
     info.stream = req->stream;
@@ -55,7 +48,7 @@ void http_access_log_begin(DHttpParser *parser, int status, const DString &times
     lms_access_log::instance()->writeToFile(info);
 }
 
-void http_access_log_end(kernel_request *req, const DString &ip, const DString &md5)
+void http_access_log_end(kernel_request *req, const DString &ip, const DString &md5, const lms_access_qos &qos)
 {
     DString timestamp = DDateTime::currentDate().toString("yyyy-MM-dd hh:mm:ss.ms");
 
@@ -71,6 +64,7 @@ void http_access_log_end(kernel_request *req, const DString &ip, const DString &
     info.ip = ip;
     info.timestamp = timestamp;
     info.number = DString::number(1);
+    info.qos = &qos;
 
     lms_access_log::instance()->writeToFile(info);
 }
@@ -5,6 +5,8 @@
 #include "DGlobal.hpp"
 #include "kernel_request.hpp"
 
+struct lms_access_qos;
+
 namespace HttpType {
 enum OperateType
 {
@@ -13,16 +15,20 @@ enum OperateType
     TsLive,
     FlvRecv,
     TsRecv,
-    SendFile
+    SendFile,
+    Api
 };
 
 }
 
 kernel_request *get_http_request(DHttpParser *parser, bool del_suffix = true);
 
-void http_access_log_begin(DHttpParser *parser, int status, const DString &timestamp,
+/**
+ * @brief req为已经解析好的请求，为NULL时从parser中解析
+ */
+void http_access_log_begin(DHttpParser *parser, kernel_request *req, int status, const DString &timestamp,
                            const DString &ip, const DString &md5, bool end = false);
 
-void http_access_log_end(kernel_request *req, const DString &ip, const DString &md5);
+void http_access_log_end(kernel_request *req, const DString &ip, const DString &md5, const lms_access_qos &qos);
 
 #endif // LMS_HTTP_UTILITY_HPP
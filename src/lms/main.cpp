@@ -9,8 +9,12 @@
 #include "lms_source.hpp"
 #include "lms_global.hpp"
 #include "lms_access_log.hpp"
+#include "lms_profiler.hpp"
+#include "lms_watchdog.hpp"
+#include "lms_memory.hpp"
 
 #include "kernel_log.hpp"
+#include "kernel_request.hpp"
 #include "DMemPool.hpp"
 #include "DEvent.hpp"
 #include "DTimer.hpp"
@@ -26,6 +30,9 @@
 
 std::vector<lms_threads_server*> servers;
 
+// 主线程的事件循环，配置的预热流在这里回源
+DEvent *main_event = NULL;
+
 kernel_context* global_context = new kernel_context();
 
 void parse_options(int argc, char** argv)
@@ -89,18 +96,55 @@ void init_access_log()
     lms_access_log::instance()->setType(type);
 }
 
+/**
+ * @brief 预热配置中的流，格式为vhost/app/stream，app中可以带/
+ */
+void start_prewarm()
+{
+    std::vector<DString> streams = lms_config::instance()->get_prewarm();
+    int ttl = lms_config::instance()->get_prewarm_ttl();
+
+    for (int i = 0; i < (int)streams.size(); ++i) {
+        DString url = streams.at(i);
+
+        size_t first = url.find('/');
+        size_t last = url.rfind('/');
+        if (first == std::string::npos || first == last) {
+            log_error("prewarm stream is invalid. stream=%s", url.c_str());
+            continue;
+        }
+
+        kernel_request req;
+        req.vhost = url.substr(0, first);
+        req.host = req.vhost;
+        req.app = url.substr(first + 1, last - first - 1);
+        req.stream = url.substr(last + 1);
+        req.tcUrl = "rtmp://" + req.vhost + "/" + req.app;
+        req.schema = "rtmp";
+
+        lms_source_manager::instance()->prewarm(&req, main_event, ttl);
+    }
+}
+
 void onTimer()
 {
 #if 0
     DMemPool::instance()->print();
 #endif
     lms_source_manager::instance()->reset();
+
+    lms_profiler::instance()->check();
+
+    lms_memory_manager::instance()->check();
 }
 
 void onSignal()
 {
     log_trace("SIGINT");
 
+    // 运行中开启的采集在退出前写入文件
+    lms_profiler::instance()->stop();
+
 #ifdef ENABLE_GPERF
     log_trace("ProfilerStop");
     ProfilerStop();
@@ -125,6 +169,8 @@ void onReload()
     for (int i = 0; i < (int)servers.size(); ++i) {
         servers.at(i)->reload();
     }
+
+    start_prewarm();
 }
 
 void onReopen()
@@ -143,6 +189,9 @@ void start_server()
         lms_threads_server *srv = new lms_threads_server();
         servers.push_back(srv);
 
+        // 线程名用于top -H和/api/profile的thread参数
+        srv->setThreadName("lms-worker-" + DString::number(i));
+
         int ret = srv->start();
         if (ret != 0) {
             log_error("thread create and start failed");
@@ -151,6 +200,18 @@ void start_server()
     }
 }
 
+void start_watchdog()
+{
+    lms_watchdog *watchdog = lms_watchdog::instance();
+    watchdog->setThreadName("lms-watchdog");
+    watchdog->set_detach(true);
+
+    if (watchdog->start() != 0) {
+        log_error("watchdog thread create and start failed");
+        ::exit(-1);
+    }
+}
+
 void start_signal(DEvent *event)
 {
     // 处理SIGINT信号
@@ -224,6 +285,7 @@ int main(int argc, char *argv[])
 
     // 初始化epoll
     DEvent *event = new DEvent;
+    main_event = event;
 
     // 启动信号监听
     start_signal(event);
@@ -234,6 +296,12 @@ int main(int argc, char *argv[])
     // 启动server
     start_server();
 
+    // 检测工作线程的事件循环卡顿
+    start_watchdog();
+
+    // 边缘预热配置中的流
+    start_prewarm();
+
     event->start();
 
     return 0;
@@ -4,6 +4,23 @@
 #include "lms_config.hpp"
 #include "DDir.hpp"
 
+lms_access_qos::lms_access_qos()
+    : duration(0)
+    , send_bytes(0)
+    , recv_bytes(0)
+    , avg_kbps(0)
+    , peak_kbps(0)
+    , first_frame(-1)
+    , reduce_drops(0)
+    , degrade_drops(0)
+    , stalls(0)
+    , stall_ms(0)
+    , max_queue(0)
+    , mem_peak(0)
+{
+
+}
+
 lms_access_log* lms_access_log::m_instance = new lms_access_log;
 
 lms_access_log::lms_access_log()
@@ -96,6 +113,10 @@ void lms_access_log::writeToFile(const lms_access_log_info &info)
     } else {
         data += "\"" + info.agent + "\"";
     }
+
+    if (info.qos) {
+        append_qos(data, *info.qos);
+    }
     data += "\n";
 
     bool ret = true;
@@ -157,6 +178,29 @@ void lms_access_log::reopen()
     open_file();
 }
 
+void lms_access_log::append_qos(DString &data, const lms_access_qos &qos)
+{
+    data += " duration=" + DString::number(qos.duration);
+    data += " sent=" + DString::number(qos.send_bytes);
+    data += " recv=" + DString::number(qos.recv_bytes);
+    data += " avg_kbps=" + DString::number(qos.avg_kbps);
+    data += " peak_kbps=" + DString::number(qos.peak_kbps);
+
+    data += " ttff=";
+    if (qos.first_frame < 0) {
+        data += "-";
+    } else {
+        data += DString::number(qos.first_frame);
+    }
+
+    data += " reduce_drops=" + DString::number(qos.reduce_drops);
+    data += " degrade_drops=" + DString::number(qos.degrade_drops);
+    data += " stalls=" + DString::number(qos.stalls);
+    data += " stall_ms=" + DString::number(qos.stall_ms);
+    data += " max_queue=" + DString::number(qos.max_queue);
+    data += " mem_peak=" + DString::number(qos.mem_peak);
+}
+
 bool lms_access_log::open_file()
 {
     DString dir = DFile::filePath(m_path);
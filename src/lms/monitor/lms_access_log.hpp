@@ -7,8 +7,38 @@
 
 #define DEFAULT_ACCESS_VALUE    "-"
 
+/**
+ * @brief 一次会话的发送质量，连接或者http请求结束时在连接上汇总一次
+ */
+struct lms_access_qos
+{
+    lms_access_qos();
+
+    // 会话时长，单位毫秒
+    dint64 duration;
+    dint64 send_bytes;
+    dint64 recv_bytes;
+    // 平均和按秒计算的最高发送码率
+    dint64 avg_kbps;
+    dint64 peak_kbps;
+    // 开始播放到第一个消息交给socket的时间，单位毫秒，-1表示没有播放或者没有发送
+    dint64 first_frame;
+    // 队列满时reduce丢弃的消息数，降级和追赶延迟丢弃的消息数
+    dint64 reduce_drops;
+    dint64 degrade_drops;
+    // 发送遇到EAGAIN的次数和累计等待可写的时间，单位毫秒
+    dint64 stalls;
+    dint64 stall_ms;
+    // 发送队列出现过的最大字节数
+    dint64 max_queue;
+    // 连接记账的内存出现过的最大字节数，推流是所推的流
+    dint64 mem_peak;
+};
+
 typedef struct _lms_access_log_info
 {
+    _lms_access_log_info() : qos(NULL) {}
+
     DString ip;
     DString timestamp;
     // http | rtmp
@@ -32,6 +62,8 @@ typedef struct _lms_access_log_info
     DString number;
     // md5(ip + time + fd)
     DString md5;
+    // 只有结束的记录有
+    const lms_access_qos *qos;
 }lms_access_log_info;
 
 class lms_access_log
@@ -54,6 +86,8 @@ public:
 private:
     bool open_file();
 
+    void append_qos(DString &data, const lms_access_qos &qos);
+
 private:
     static lms_access_log *m_instance;
 
@@ -0,0 +1,208 @@
+#include "lms_profiler.hpp"
+#include "kernel_errno.hpp"
+#include "kernel_log.hpp"
+#include "DDir.hpp"
+#include "DFile.hpp"
+#include "DDateTime.hpp"
+
+#include <gperftools/profiler.h>
+#include <gperftools/heap-profiler.h>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// 只采集一个线程时的线程id，在SIGPROF的处理函数中比较，只能用async-signal-safe的方式读取
+static volatile pid_t profile_tid = 0;
+
+static int profile_filter(void *arg)
+{
+    return (pid_t)syscall(SYS_gettid) == profile_tid;
+}
+
+lms_profiler_state::lms_profiler_state()
+    : running(false)
+    , type(LmsProfiler::cpu)
+    , start_time(0)
+    , stop_time(0)
+{
+
+}
+
+lms_profiler *lms_profiler::m_instance = new lms_profiler;
+
+lms_profiler::lms_profiler()
+{
+
+}
+
+lms_profiler::~lms_profiler()
+{
+
+}
+
+lms_profiler *lms_profiler::instance()
+{
+    return m_instance;
+}
+
+int lms_profiler::start(int type, int seconds, const DString &thread, DString &file)
+{
+    int ret = ERROR_SUCCESS;
+
+    DSpinLocker locker(&m_mutex);
+
+    if (m_state.running) {
+        ret = ERROR_PROFILER_BUSY;
+        log_error("profiler is running. type=%s, file=%s, ret=%d", type_name(m_state.type), m_state.file.c_str(), ret);
+        return ret;
+    }
+
+    // 编译时开启ENABLE_GPERF会在整个进程运行期间采集
+    struct ProfilerState cpu_state;
+    ProfilerGetCurrentState(&cpu_state);
+    if ((type == LmsProfiler::cpu && cpu_state.enabled) || (type == LmsProfiler::heap && IsHeapProfilerRunning())) {
+        ret = ERROR_PROFILER_BUSY;
+        log_error("%s profiler is already started outside. ret=%d", type_name(type), ret);
+        return ret;
+    }
+
+    if (!DDir::exists(LMS_PROFILER_DIR) && !DDir::createDir(LMS_PROFILER_DIR)) {
+        ret = ERROR_CREATE_DIR;
+        log_error("create profile dir %s failed. ret=%d", LMS_PROFILER_DIR, ret);
+        return ret;
+    }
+
+    duint64 now = DDateTime::currentDate().toMS();
+
+    file = DString(LMS_PROFILER_DIR) + "/lms_" + type_name(type) + "_" + DString::number(now);
+    if (!thread.isEmpty()) {
+        file.append("_").append(thread);
+    }
+
+    if (type == LmsProfiler::cpu) {
+        file.append(".prof");
+
+        struct ProfilerOptions options;
+        memset(&options, 0, sizeof(options));
+
+        if (!thread.isEmpty()) {
+            pid_t tid = 0;
+            if (!find_thread(thread, tid)) {
+                ret = ERROR_PROFILER_THREAD;
+                log_error("profile thread %s is not found. ret=%d", thread.c_str(), ret);
+                return ret;
+            }
+
+            profile_tid = tid;
+            options.filter_in_thread = profile_filter;
+        }
+
+        if (!ProfilerStartWithOptions(file.c_str(), &options)) {
+            ret = ERROR_PROFILER_START;
+            log_error("start cpu profiler failed. file=%s, ret=%d", file.c_str(), ret);
+            return ret;
+        }
+    } else {
+        // heap按线程区分没有意义，只按进程采集
+        HeapProfilerStart(file.c_str());
+    }
+
+    m_state.running = true;
+    m_state.type = type;
+    m_state.file = file;
+    m_state.thread = thread;
+    m_state.start_time = now;
+    m_state.stop_time = now + (duint64)seconds * 1000;
+
+    log_trace("start %s profiler for %d seconds. file=%s, thread=%s", type_name(type), seconds, file.c_str(), thread.c_str());
+
+    return ret;
+}
+
+void lms_profiler::stop()
+{
+    DSpinLocker locker(&m_mutex);
+
+    do_stop();
+}
+
+void lms_profiler::check()
+{
+    DSpinLocker locker(&m_mutex);
+
+    if (m_state.running && DDateTime::currentDate().toMS() >= m_state.stop_time) {
+        do_stop();
+    }
+}
+
+lms_profiler_state lms_profiler::state()
+{
+    DSpinLocker locker(&m_mutex);
+
+    return m_state;
+}
+
+const char *lms_profiler::type_name(int type)
+{
+    const char *names[LmsProfiler::count] = { "cpu", "heap" };
+
+    if (type < 0 || type >= LmsProfiler::count) {
+        return "unknown";
+    }
+
+    return names[type];
+}
+
+bool lms_profiler::find_thread(const DString &name, pid_t &tid)
+{
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) {
+        return false;
+    }
+
+    bool found = false;
+
+    struct dirent *entry;
+    while (!found && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        DFile comm(DString("/proc/self/task/") + entry->d_name + "/comm");
+        if (!comm.open("r")) {
+            continue;
+        }
+
+        if (comm.readLine(64).trimmed() == name) {
+            tid = atoi(entry->d_name);
+            found = true;
+        }
+    }
+
+    closedir(dir);
+
+    return found;
+}
+
+void lms_profiler::do_stop()
+{
+    if (!m_state.running) {
+        return;
+    }
+
+    if (m_state.type == LmsProfiler::cpu) {
+        ProfilerStop();
+        profile_tid = 0;
+    } else {
+        HeapProfilerDump("window");
+        HeapProfilerStop();
+    }
+
+    m_state.running = false;
+    m_state.stop_time = DDateTime::currentDate().toMS();
+
+    log_trace("stop %s profiler. file=%s", type_name(m_state.type), m_state.file.c_str());
+}
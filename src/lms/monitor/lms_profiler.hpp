@@ -0,0 +1,81 @@
+#ifndef LMS_PROFILER_HPP
+#define LMS_PROFILER_HPP
+
+#include "DString.hpp"
+#include "DSpinLock.hpp"
+#include "kernel_global.hpp"
+
+#include <sys/types.h>
+
+// 采集文件保存的目录，相对于工作目录
+#define LMS_PROFILER_DIR            "profile"
+// 一次采集的默认时长和最大时长，单位秒
+#define LMS_PROFILER_SECONDS        30
+#define LMS_PROFILER_MAX_SECONDS    600
+
+namespace LmsProfiler {
+    enum Type { cpu = 0, heap, count };
+}
+
+struct lms_profiler_state
+{
+    lms_profiler_state();
+
+    bool running;
+    // LmsProfiler::Type
+    int type;
+    DString file;
+    // 只采集这个线程，为空表示所有线程
+    DString thread;
+    // 开始和结束的时间，单位毫秒
+    duint64 start_time;
+    duint64 stop_time;
+};
+
+/**
+ * @brief 运行中开始、停止gperftools的cpu和heap采集，每次只能有一个采集，
+ *        到时间后由主线程的定时器停止，不需要重新编译和重启
+ */
+class lms_profiler
+{
+public:
+    lms_profiler();
+    ~lms_profiler();
+
+    static lms_profiler *instance();
+
+    /**
+     * @param thread 线程名，只对cpu有效，为空采集所有线程
+     * @param file 返回写入的文件，heap是文件名的前缀
+     */
+    int start(int type, int seconds, const DString &thread, DString &file);
+    /**
+     * @brief 停止当前的采集并写入文件，没有采集时什么都不做
+     */
+    void stop();
+    /**
+     * @brief 每秒调用一次，到时间后停止
+     */
+    void check();
+
+    lms_profiler_state state();
+
+    static const char *type_name(int type);
+
+private:
+    /**
+     * @brief 按prctl设置的线程名在/proc/self/task中查找线程id
+     */
+    bool find_thread(const DString &name, pid_t &tid);
+
+    void do_stop();
+
+private:
+    static lms_profiler *m_instance;
+
+private:
+    DSpinLock m_mutex;
+    lms_profiler_state m_state;
+};
+
+#endif // LMS_PROFILER_HPP
@@ -0,0 +1,208 @@
+#include "lms_stats.hpp"
+#include "DDateTime.hpp"
+
+// 线程退出时不释放，工作线程和进程的生命周期相同
+static __thread lms_worker_stat *worker_stat = NULL;
+
+static const dint64 histogram_bounds[LmsHistogram::count][LMS_HISTOGRAM_BUCKETS - 1] = {
+    // join，毫秒
+    { 50, 100, 200, 500, 1000, 2000, 3000, 5000, 10000 },
+    // handshake，毫秒
+    { 5, 10, 25, 50, 100, 250, 500, 1000, 3000 },
+    // fanout，微秒
+    { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000 }
+};
+
+#ifdef LMS_ENABLE_TRACE
+// 各阶段共用，微秒
+static const dint64 trace_bounds[LMS_HISTOGRAM_BUCKETS - 1] = {
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000
+};
+
+static int trace_bucket(dint64 usec)
+{
+    int index = 0;
+    while (index < LMS_HISTOGRAM_BUCKETS - 1 && usec > trace_bounds[index]) {
+        index++;
+    }
+
+    return index;
+}
+
+dint64 lms_trace_bound(int index)
+{
+    return trace_bounds[index];
+}
+#endif
+
+lms_histogram::lms_histogram()
+    : count(0)
+    , sum(0)
+{
+    for (int i = 0; i < LMS_HISTOGRAM_BUCKETS; ++i) {
+        buckets[i] = 0;
+    }
+}
+
+lms_worker_stat::lms_worker_stat()
+    : thread(0)
+    , event(NULL)
+    , socket(NULL)
+    , connections(0)
+    , accepted(0)
+    , writers(0)
+    , queue_msgs(0)
+    , queue_bytes(0)
+    , queue_max(0)
+    , drop_bytes(0)
+{
+
+}
+
+void lms_worker_stat::observe(int type, dint64 value)
+{
+    const dint64 *bounds = histogram_bounds[type];
+
+    int index = 0;
+    while (index < LMS_HISTOGRAM_BUCKETS - 1 && value > bounds[index]) {
+        index++;
+    }
+
+    lms_histogram &h = histograms[type];
+    h.buckets[index]++;
+    h.count++;
+    h.sum += value;
+}
+
+dint64 lms_worker_stat::bound(int type, int index)
+{
+    return histogram_bounds[type][index];
+}
+
+#ifdef LMS_ENABLE_TRACE
+void lms_worker_stat::observe_trace(int stage, dint64 usec)
+{
+    lms_histogram &h = traces[stage];
+    h.buckets[trace_bucket(usec)]++;
+    h.count++;
+    h.sum += usec;
+}
+#endif
+
+lms_source_stat::lms_source_stat()
+    : video_frames(0)
+    , audio_frames(0)
+    , bytes(0)
+    , keyframes(0)
+    , gop_size(0)
+    , gop_frames(0)
+    , kbps(0)
+    , fps(0)
+    , sample_time(0)
+    , sample_bytes(0)
+    , sample_frames(0)
+{
+    for (int i = 0; i < LmsStatProtocol::count; ++i) {
+        viewers[i] = 0;
+    }
+}
+
+void lms_source_stat::sample(CommonMessage *msg)
+{
+    bytes += msg->payload->length;
+
+    if (msg->is_video()) {
+        video_frames++;
+
+        if (msg->is_keyframe() && !msg->is_sequence_header()) {
+            keyframes++;
+            if (gop_frames > 0) {
+                gop_size = gop_frames;
+            }
+            gop_frames = 0;
+        }
+        gop_frames++;
+    } else {
+        audio_frames++;
+    }
+
+    duint64 now = DDateTime::currentDate().toMS();
+
+    if (sample_time == 0) {
+        sample_time = now;
+        sample_bytes = bytes;
+        sample_frames = video_frames;
+        return;
+    }
+
+    if (now < sample_time + 1000) {
+        return;
+    }
+
+    duint64 elapsed = now - sample_time;
+
+    kbps = (bytes - sample_bytes) * 8 / (dint64)elapsed;
+    fps = (video_frames - sample_frames) * 1000 / (dint64)elapsed;
+
+    sample_time = now;
+    sample_bytes = bytes;
+    sample_frames = video_frames;
+}
+
+#ifdef LMS_ENABLE_TRACE
+void lms_source_stat::observe_trace(int stage, dint64 usec)
+{
+    lms_histogram &h = traces[stage];
+    __sync_add_and_fetch(&h.buckets[trace_bucket(usec)], 1);
+    __sync_add_and_fetch(&h.count, 1);
+    __sync_add_and_fetch(&h.sum, usec);
+}
+#endif
+
+/**************************************************************/
+
+lms_stats *lms_stats::m_instance = new lms_stats;
+
+lms_stats::lms_stats()
+{
+
+}
+
+lms_stats::~lms_stats()
+{
+
+}
+
+lms_stats *lms_stats::instance()
+{
+    return m_instance;
+}
+
+lms_worker_stat *lms_stats::worker()
+{
+    if (worker_stat) {
+        return worker_stat;
+    }
+
+    worker_stat = new lms_worker_stat();
+    worker_stat->thread = pthread_self();
+    worker_stat->socket = DTcpSocket::threadStat();
+
+    DSpinLocker locker(&m_mutex);
+    m_workers.push_back(worker_stat);
+
+    return worker_stat;
+}
+
+std::vector<lms_worker_stat> lms_stats::get_workers()
+{
+    DSpinLocker locker(&m_mutex);
+
+    std::vector<lms_worker_stat> workers;
+
+    for (int i = 0; i < (int)m_workers.size(); ++i) {
+        workers.push_back(*m_workers.at(i));
+    }
+
+    return workers;
+}
@@ -0,0 +1,193 @@
+#ifndef LMS_STATS_HPP
+#define LMS_STATS_HPP
+
+#include "DString.hpp"
+#include "DSpinLock.hpp"
+#include "DEvent.hpp"
+#include "DTcpSocket.hpp"
+#include "kernel_global.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+namespace LmsStatProtocol {
+    enum Type { rtmp = 0, flv, ts, count };
+}
+
+// 防止不同线程的计数器在同一个cache line
+#define LMS_STAT_CACHE_LINE     64
+// 直方图的桶数，上限见lms_stats.cpp中的histogram_bounds，最后一个桶没有上限
+#define LMS_HISTOGRAM_BUCKETS   10
+
+namespace LmsHistogram {
+    enum Type {
+        // 播放开始到第一个消息交给socket，单位毫秒
+        join = 0,
+        // rtmp握手时间，单位毫秒
+        handshake,
+        // 消息从source分发到工作线程处理完的时间，单位微秒
+        fanout,
+        count
+    };
+}
+
+#ifdef LMS_ENABLE_TRACE
+// 帧延迟跟踪的阶段，单位微秒，见lms_trace.hpp
+namespace LmsTrace {
+    enum Stage {
+        // ingest到source分发
+        fanout = 0,
+        // source分发到工作线程取出
+        handoff,
+        // 取出到交给socket，即lms_stream_writer中排队的时间
+        queue,
+        // 交给socket到全部写入
+        write,
+        count
+    };
+}
+
+/**
+ * @brief 跟踪直方图第index个桶的上限，各阶段相同
+ */
+dint64 lms_trace_bound(int index);
+#endif
+
+struct lms_histogram
+{
+    lms_histogram();
+
+    // 每个桶的计数，不累加
+    dint64 buckets[LMS_HISTOGRAM_BUCKETS];
+    dint64 count;
+    dint64 sum;
+};
+
+/**
+ * @brief 每个工作线程一份计数器，只由所属线程修改，/api/stats读取时不加锁
+ */
+struct lms_worker_stat
+{
+    lms_worker_stat();
+
+    void observe(int type, dint64 value);
+
+    /**
+     * @brief 直方图第index个桶的上限
+     */
+    static dint64 bound(int type, int index);
+
+#ifdef LMS_ENABLE_TRACE
+    void observe_trace(int stage, dint64 usec);
+#endif
+
+    char head_pad[LMS_STAT_CACHE_LINE];
+
+    pthread_t thread;
+    // 线程的事件循环，由第一个连接设置
+    DEvent *event;
+    // 线程的socket写统计，线程局部变量
+    DSocketStat *socket;
+
+    // 当前连接数和累计接受的连接数
+    dint64 connections;
+    dint64 accepted;
+
+    // 播放连接的lms_stream_writer数，以及所有writer队列中的消息数和字节数
+    dint64 writers;
+    dint64 queue_msgs;
+    dint64 queue_bytes;
+    // 单个writer出现过的最大队列字节数
+    dint64 queue_max;
+    // writer降级丢弃的字节数
+    dint64 drop_bytes;
+
+    lms_histogram histograms[LmsHistogram::count];
+
+#ifdef LMS_ENABLE_TRACE
+    lms_histogram traces[LmsTrace::count];
+#endif
+
+    char tail_pad[LMS_STAT_CACHE_LINE];
+};
+
+/**
+ * @brief 流的统计，由推流线程在onVideo、onAudio中更新，每秒计算一次码率和帧率
+ */
+struct lms_source_stat
+{
+    lms_source_stat();
+
+    void sample(CommonMessage *msg);
+
+#ifdef LMS_ENABLE_TRACE
+    /**
+     * @brief 推流线程和各工作线程都会调用，原子累加
+     */
+    void observe_trace(int stage, dint64 usec);
+#endif
+
+    dint64 video_frames;
+    dint64 audio_frames;
+    dint64 bytes;
+    dint64 keyframes;
+
+    // 最近一个完整gop的视频帧数，当前gop已经收到的视频帧数
+    dint64 gop_size;
+    dint64 gop_frames;
+
+    // 上一个采样周期的码率和视频帧率
+    dint64 kbps;
+    dint64 fps;
+
+    duint64 sample_time;
+    dint64 sample_bytes;
+    dint64 sample_frames;
+
+    // 按协议的播放数，下标是LmsStatProtocol::Type，不同线程加入和离开时原子增减
+    volatile dint64 viewers[LmsStatProtocol::count];
+
+#ifdef LMS_ENABLE_TRACE
+    lms_histogram traces[LmsTrace::count];
+#endif
+};
+
+struct lms_source_snapshot
+{
+    DString url;
+    bool edge;
+    bool publishing;
+    lms_source_stat stat;
+
+    // 记到流上的内存：推流和回源收到的数据、gop cache、hls等，单位字节
+    dint64 memory;
+    dint64 memory_peak;
+    // gop cache的时长，单位毫秒
+    dint64 gop_duration;
+};
+
+class lms_stats
+{
+public:
+    lms_stats();
+    ~lms_stats();
+
+    static lms_stats *instance();
+
+    /**
+     * @brief 当前线程的计数器，第一次调用时创建并注册，之后只访问线程局部变量
+     */
+    lms_worker_stat *worker();
+
+    std::vector<lms_worker_stat> get_workers();
+
+private:
+    static lms_stats *m_instance;
+
+    // 只在注册和读取时加锁
+    DSpinLock m_mutex;
+    std::vector<lms_worker_stat*> m_workers;
+
+};
+
+#endif // LMS_STATS_HPP
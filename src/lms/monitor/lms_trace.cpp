@@ -0,0 +1,91 @@
+#include "lms_trace.hpp"
+
+#ifdef LMS_ENABLE_TRACE
+
+#include "DDateTime.hpp"
+
+struct lms_trace_context
+{
+    CommonMessage *msg;
+    dint64 pickup;
+    lms_source_stat *stat;
+};
+
+// 采样计数和正在处理的消息，都只在所属线程访问
+static __thread duint32 trace_count = 0;
+static __thread lms_trace_context trace_context = { NULL, 0, NULL };
+
+dint64 lms_trace::now()
+{
+    struct timespec ts = DDateTime::monotonic();
+    return (dint64)ts.tv_sec * 1000 * 1000 + ts.tv_nsec / 1000;
+}
+
+void lms_trace::ingest(CommonMessage *msg)
+{
+    if (!msg->is_video() && !msg->is_audio()) {
+        return;
+    }
+
+    if (++trace_count % LMS_TRACE_SAMPLE != 0) {
+        return;
+    }
+
+    msg->trace_ingest = now();
+}
+
+void lms_trace::fanout(CommonMessage *msg, lms_source_stat *stat)
+{
+    if (msg->trace_ingest == 0) {
+        return;
+    }
+
+    msg->trace_fanout = now();
+    record(LmsTrace::fanout, msg->trace_fanout - msg->trace_ingest, stat);
+}
+
+void lms_trace::pickup(CommonMessage *msg, lms_source_stat *stat)
+{
+    if (msg->trace_fanout == 0) {
+        return;
+    }
+
+    dint64 usec = now();
+    record(LmsTrace::handoff, usec - msg->trace_fanout, stat);
+
+    trace_context.msg = msg;
+    trace_context.pickup = usec;
+    trace_context.stat = stat;
+}
+
+void lms_trace::pickup_end()
+{
+    trace_context.msg = NULL;
+    trace_context.pickup = 0;
+    trace_context.stat = NULL;
+}
+
+dint64 lms_trace::pickup_time(CommonMessage *msg, lms_source_stat **stat)
+{
+    if (trace_context.msg != msg) {
+        return 0;
+    }
+
+    *stat = trace_context.stat;
+    return trace_context.pickup;
+}
+
+void lms_trace::record(int stage, dint64 usec, lms_source_stat *stat)
+{
+    if (usec < 0) {
+        usec = 0;
+    }
+
+    lms_stats::instance()->worker()->observe_trace(stage, usec);
+
+    if (stat) {
+        stat->observe_trace(stage, usec);
+    }
+}
+
+#endif
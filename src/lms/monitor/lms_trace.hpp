@@ -0,0 +1,63 @@
+#ifndef LMS_TRACE_HPP
+#define LMS_TRACE_HPP
+
+#include "kernel_global.hpp"
+#include "lms_stats.hpp"
+
+/**
+ * 帧延迟跟踪，cmake -DENABLE_TRACE=TRUE 时定义LMS_ENABLE_TRACE，
+ * 否则下面的宏都为空，CommonMessage等结构中也没有跟踪的字段
+ *
+ * 每个线程每LMS_TRACE_SAMPLE个音视频消息采样一个，在各阶段记录单调时钟：
+ *   ingest  rtmp消息接收完整、ts的PES组装完成、flv tag解析完成
+ *   fanout  lms_source分发给各线程
+ *   pickup  工作线程的lms_event_conn取出消息
+ *   written 消息全部写入socket
+ */
+#ifdef LMS_ENABLE_TRACE
+
+#define LMS_TRACE_SAMPLE        32
+
+#define LMS_TRACE_INGEST(msg)           lms_trace::ingest(msg)
+#define LMS_TRACE_FANOUT(msg, stat)     lms_trace::fanout(msg, stat)
+#define LMS_TRACE_PICKUP(msg, stat)     lms_trace::pickup(msg, stat)
+#define LMS_TRACE_PICKUP_END()          lms_trace::pickup_end()
+
+class lms_trace
+{
+public:
+    /**
+     * @brief 单调时钟，单位微秒
+     */
+    static dint64 now();
+
+    static void ingest(CommonMessage *msg);
+    /**
+     * @brief msg还没有共享给其他线程，记录分发时间和ingest到分发的延迟
+     */
+    static void fanout(CommonMessage *msg, lms_source_stat *stat);
+    /**
+     * @brief 记录分发到取出的延迟，并保存为当前线程正在处理的消息，
+     *        lms_stream_writer入队时用来取得取出时间和流的统计
+     */
+    static void pickup(CommonMessage *msg, lms_source_stat *stat);
+    static void pickup_end();
+
+    /**
+     * @brief msg是当前线程正在处理的采样消息时返回取出时间，否则返回0
+     */
+    static dint64 pickup_time(CommonMessage *msg, lms_source_stat **stat);
+
+    static void record(int stage, dint64 usec, lms_source_stat *stat);
+};
+
+#else
+
+#define LMS_TRACE_INGEST(msg)
+#define LMS_TRACE_FANOUT(msg, stat)
+#define LMS_TRACE_PICKUP(msg, stat)
+#define LMS_TRACE_PICKUP_END()
+
+#endif
+
+#endif // LMS_TRACE_HPP
@@ -0,0 +1,172 @@
+#include "lms_watchdog.hpp"
+#include "lms_stats.hpp"
+#include "lms_config.hpp"
+#include "kernel_log.hpp"
+#include "DEvent.hpp"
+#include "DDateTime.hpp"
+
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 等待卡住的线程保存堆栈的时间，单位毫秒
+#define LMS_WATCHDOG_STACK_WAIT     100
+
+// 信号处理函数中只能访问这些静态变量，同一时间只有一个线程在保存
+static void *stack_frames[LMS_WATCHDOG_MAX_FRAMES];
+static volatile int stack_size = 0;
+static volatile sig_atomic_t stack_ready = 0;
+
+static inline int stack_signal()
+{
+    return SIGRTMIN;
+}
+
+static inline dint64 monotonic_usec()
+{
+    struct timespec now = DDateTime::monotonic();
+    return (dint64)now.tv_sec * 1000 * 1000 + now.tv_nsec / 1000;
+}
+
+lms_watchdog *lms_watchdog::m_instance = new lms_watchdog;
+
+lms_watchdog::lms_watchdog()
+{
+
+}
+
+lms_watchdog::~lms_watchdog()
+{
+
+}
+
+lms_watchdog *lms_watchdog::instance()
+{
+    return m_instance;
+}
+
+DString lms_watchdog::handler_name(const char *type)
+{
+    if (!type) {
+        return "unknown";
+    }
+
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(type, NULL, NULL, &status);
+
+    DString name = (status == 0 && demangled) ? demangled : type;
+    free(demangled);
+
+    return name;
+}
+
+void lms_watchdog::run()
+{
+    // backtrace第一次调用时会加载libgcc，不能放到信号处理函数中
+    void *frames[2];
+    backtrace(frames, 2);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onStackSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(stack_signal(), &action, NULL) != 0) {
+        log_error("watchdog install signal handler failed");
+        return;
+    }
+
+    while (true) {
+        // 每次都读取配置，reload后生效
+        dint64 threshold = lms_config::instance()->get_watchdog_threshold();
+        if (threshold <= 0) {
+            usleep(LMS_WATCHDOG_IDLE_INTERVAL * 1000);
+            continue;
+        }
+
+        check(threshold * 1000);
+
+        usleep(DMax(threshold / 4, (dint64)LMS_WATCHDOG_MIN_INTERVAL) * 1000);
+    }
+}
+
+void lms_watchdog::check(dint64 threshold)
+{
+    std::vector<lms_worker_stat> workers = lms_stats::instance()->get_workers();
+
+    for (int i = 0; i < (int)workers.size(); ++i) {
+        lms_worker_stat &stat = workers.at(i);
+        if (!stat.event) {
+            continue;
+        }
+
+        const char *handler = NULL;
+        dint64 handler_start = 0;
+        dint64 loop_start = stat.event->current(handler, handler_start);
+
+        // 在epoll_wait中等待
+        if (loop_start == 0) {
+            continue;
+        }
+
+        dint64 now = monotonic_usec();
+        if (now - loop_start < threshold) {
+            continue;
+        }
+
+        std::map<DEvent*, dint64>::iterator it = m_reported.find(stat.event);
+        if (it != m_reported.end() && it->second == loop_start) {
+            continue;
+        }
+        m_reported[stat.event] = loop_start;
+
+        report(stat.thread, handler, now - loop_start, handler_start > 0 ? now - handler_start : 0);
+    }
+}
+
+void lms_watchdog::report(pthread_t thread, const char *handler, dint64 elapsed, dint64 handler_elapsed)
+{
+    char name[32] = { 0 };
+    pthread_getname_np(thread, name, sizeof(name));
+
+    DString type = handler_name(handler);
+
+    log_warn("event loop blocked. thread=%s, elapsed=%lldms, handler=%s, handler_elapsed=%lldms",
+             name, elapsed / 1000, type.c_str(), handler_elapsed / 1000);
+
+    stack_ready = 0;
+    if (pthread_kill(thread, stack_signal()) != 0) {
+        log_error("watchdog send signal to thread %s failed", name);
+        return;
+    }
+
+    for (int i = 0; i < LMS_WATCHDOG_STACK_WAIT && !stack_ready; ++i) {
+        usleep(1000);
+    }
+
+    if (!stack_ready) {
+        log_warn("thread %s stack is not captured in %dms", name, LMS_WATCHDOG_STACK_WAIT);
+        return;
+    }
+
+    char **symbols = backtrace_symbols(stack_frames, stack_size);
+    if (!symbols) {
+        return;
+    }
+
+    for (int i = 0; i < stack_size; ++i) {
+        log_warn("thread %s #%d %s", name, i, symbols[i]);
+    }
+
+    free(symbols);
+}
+
+void lms_watchdog::onStackSignal(int signo)
+{
+    stack_size = backtrace(stack_frames, LMS_WATCHDOG_MAX_FRAMES);
+    stack_ready = 1;
+}
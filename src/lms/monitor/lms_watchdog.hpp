@@ -0,0 +1,55 @@
+#ifndef LMS_WATCHDOG_HPP
+#define LMS_WATCHDOG_HPP
+
+#include "DThread.hpp"
+#include "kernel_global.hpp"
+
+#include <map>
+
+class DEvent;
+
+// 检测的最小间隔，单位毫秒
+#define LMS_WATCHDOG_MIN_INTERVAL   10
+// 关闭时重新读取配置的间隔，单位毫秒
+#define LMS_WATCHDOG_IDLE_INTERVAL  1000
+// 堆栈的最大层数
+#define LMS_WATCHDOG_MAX_FRAMES     64
+
+/**
+ * @brief 独立线程定时检查各工作线程的事件循环，一轮处理超过watchdog_threshold时，
+ *        发送信号让卡住的线程自己取出堆栈，和handler类型一起打印到日志，每轮只打印一次
+ */
+class lms_watchdog : public DThread
+{
+public:
+    lms_watchdog();
+    virtual ~lms_watchdog();
+
+    static lms_watchdog *instance();
+
+    /**
+     * @brief DEvent中handler的typeid名字转成类名
+     */
+    static DString handler_name(const char *type);
+
+protected:
+    virtual void run();
+
+private:
+    void check(dint64 threshold);
+    void report(pthread_t thread, const char *handler, dint64 elapsed, dint64 handler_elapsed);
+
+    /**
+     * @brief 在卡住的线程中执行，只把返回地址保存到静态缓冲区
+     */
+    static void onStackSignal(int signo);
+
+private:
+    static lms_watchdog *m_instance;
+
+private:
+    // 每个事件循环已经打印过的那一轮的开始时间
+    std::map<DEvent*, dint64> m_reported;
+};
+
+#endif // LMS_WATCHDOG_HPP
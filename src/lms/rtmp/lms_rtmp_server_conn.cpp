@@ -5,10 +5,13 @@
 #include "lms_config.hpp"
 #include "lms_verify_hooks.hpp"
 #include "lms_verify_refer.hpp"
+#include "lms_verify_token.hpp"
 #include "lms_source.hpp"
 #include "DDateTime.hpp"
 #include "DMd5.hpp"
 #include "lms_rtmp_utility.hpp"
+#include "lms_stats.hpp"
+#include "lms_access_log.hpp"
 
 lms_rtmp_server_conn::lms_rtmp_server_conn(DThread *parent, DEvent *ev, int fd)
     : lms_conn_base(parent, ev, fd)
@@ -176,7 +179,7 @@ void lms_rtmp_server_conn::release()
         }
     } else if (m_type == Play){
         if (m_source) {
-            m_source->del_connection(this);
+            m_source->del_connection(this, LmsStatProtocol::rtmp);
         }
 
         if (!m_stop_url.empty()) {
@@ -191,7 +194,16 @@ void lms_rtmp_server_conn::release()
         m_source = NULL;
     }
 
-    rtmp_access_log_end(m_req, m_client_ip, m_md5);
+    if (m_type == Play) {
+        RtmpChunkStat stat = m_rtmp->get_chunk_stat();
+        log_trace("rtmp play chunk stat. out_chunk_size=%d, chunk_size_changes=%d, messages=%lld, chunks=%lld, bytes=%lld",
+                  stat.out_chunk_size, stat.chunk_size_changes, stat.send_messages, stat.send_chunks, stat.send_bytes);
+    }
+
+    lms_access_qos qos;
+    get_qos(qos, m_writer);
+
+    rtmp_access_log_end(m_req, m_client_ip, m_md5, qos);
 
     global_context->delete_id(m_fd);
 
@@ -210,6 +222,11 @@ void lms_rtmp_server_conn::onConnect(kernel_request *req)
     }
     m_type = Connect;
 
+    dint64 handshake = m_rtmp->get_handshake_time();
+    if (handshake >= 0) {
+        lms_stats::instance()->worker()->observe(LmsHistogram::handshake, handshake);
+    }
+
     verify_connect(req);
 }
 
@@ -260,10 +277,11 @@ bool lms_rtmp_server_conn::onPlayStart(kernel_request *req)
     }
 
     m_writer = new lms_stream_writer(req, Rtmp_AV_Handler_Callback(&lms_rtmp_server_conn::onSendMessage), false);
+    m_writer->set_socket(this);
 
     dint64 length = m_rtmp->get_player_buffer_length();
 
-    if (!m_source->add_connection(this)) {
+    if (!m_source->add_connection(this, LmsStatProtocol::rtmp)) {
         return false;
     }
 
@@ -365,13 +383,21 @@ void lms_rtmp_server_conn::verify_publish(kernel_request *req)
         return;
     }
 
+    // 验证签名url，签名通过后hook只做通知
+    lms_verify_token token;
+    if (!token.check(req, true, m_client_ip)) {
+        log_warn("rtmp publish token verify refused");
+        release();
+        return;
+    }
+
     if (m_publish_pattern.empty() || m_publish_url.empty()) {
         onVerifyPublishFinished(true);
     } else {
         lms_verify_hooks *hook = new lms_verify_hooks(m_event);
         hook->set_timeout(m_hook_timeout);
 
-        if (m_publish_pattern == "verify") {
+        if (m_publish_pattern == "verify" && !token.verified()) {
             m_hooking = true;
             hook->set_handler(HOOK_CALLBACK(&lms_rtmp_server_conn::onVerifyPublishFinished));
         } else {
@@ -406,6 +432,9 @@ void lms_rtmp_server_conn::onVerifyPublishFinished(bool value)
             return;
         }
 
+        // 推流收到的数据记到流上
+        setMemoryAccount(m_source->memory());
+
         m_source->start_external();
     }
 
@@ -429,13 +458,21 @@ void lms_rtmp_server_conn::verify_play(kernel_request *req)
         return;
     }
 
+    // 验证签名url，签名通过后hook只做通知
+    lms_verify_token token;
+    if (!token.check(req, false, m_client_ip)) {
+        log_warn("rtmp play token verify refused");
+        release();
+        return;
+    }
+
     if (m_play_pattern.empty() || m_play_url.empty()) {
         onVerifyPlayFinished(true);
     } else {
         lms_verify_hooks *hook = new lms_verify_hooks(m_event);
         hook->set_timeout(m_hook_timeout);
 
-        if (m_play_pattern == "verify") {
+        if (m_play_pattern == "verify" && !token.verified()) {
             m_hooking = true;
             hook->set_handler(HOOK_CALLBACK(&lms_rtmp_server_conn::onVerifyPlayFinished));
         } else {
@@ -491,6 +528,12 @@ void lms_rtmp_server_conn::get_config_value()
     int in_ack_size = config->get_rtmp_in_ack_size(m_req);
     m_rtmp->set_in_ack_size(in_ack_size);
 
+    int aggregate_duration = config->get_rtmp_aggregate_duration(m_req);
+    m_rtmp->set_aggregate_duration(aggregate_duration);
+
+    int chunk_size_max = config->get_rtmp_chunk_size_max(m_req);
+    m_rtmp->set_chunk_size_max(chunk_size_max);
+
     m_publish_pattern = config->get_hook_rtmp_publish_pattern(m_req);
     m_publish_url = config->get_hook_rtmp_publish(m_req);
 
@@ -27,7 +27,7 @@ void rtmp_access_log_begin(kernel_request *req, const DString &timestamp,
     lms_access_log::instance()->writeToFile(info);
 }
 
-void rtmp_access_log_end(kernel_request *req, const DString &ip, const DString &md5)
+void rtmp_access_log_end(kernel_request *req, const DString &ip, const DString &md5, const lms_access_qos &qos)
 {
     DString timestamp = DDateTime::currentDate().toString("yyyy-MM-dd hh:mm:ss.ms");
 
@@ -44,6 +44,7 @@ void rtmp_access_log_end(kernel_request *req, const DString &ip, const DString &
     info.ip = ip;
     info.timestamp = timestamp;
     info.number = DString::number(1);
+    info.qos = &qos;
 
     lms_access_log::instance()->writeToFile(info);
 }
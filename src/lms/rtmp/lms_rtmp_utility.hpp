@@ -4,11 +4,13 @@
 #include "DString.hpp"
 #include "kernel_request.hpp"
 
+struct lms_access_qos;
+
 void rtmp_access_log_begin(kernel_request *req, const DString &timestamp,
                            const DString &ip, const DString &md5, const DString &method,
                            bool end = false);
 
-void rtmp_access_log_end(kernel_request *req, const DString &ip, const DString &md5);
+void rtmp_access_log_end(kernel_request *req, const DString &ip, const DString &md5, const lms_access_qos &qos);
 
 
 #endif // LMS_RTMP_UTILITY_HPP
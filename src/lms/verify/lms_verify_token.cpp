@@ -0,0 +1,108 @@
+#include "lms_verify_token.hpp"
+#include "kernel_log.hpp"
+
+#include <time.h>
+#include <stdio.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+lms_verify_token::lms_verify_token()
+    : m_verified(false)
+{
+
+}
+
+lms_verify_token::~lms_verify_token()
+{
+
+}
+
+bool lms_verify_token::check(kernel_request *req, bool publish, const DString &ip)
+{
+    lms_server_config_struct *config = lms_config::instance()->get_server(req);
+    DAutoFree(lms_server_config_struct, config);
+    if (!config) {
+        return false;
+    }
+
+    if (!config->get_token_enable(req)) {
+        return true;
+    }
+
+    if (publish && !config->get_token_publish(req)) {
+        return true;
+    }
+
+    if (!publish && !config->get_token_play(req)) {
+        return true;
+    }
+
+    std::map<DString, DString>::iterator it = req->params.find("token");
+    if (it == req->params.end()) {
+        log_warn("token verify failed, no token. stream=%s", req->get_stream_url().c_str());
+        return false;
+    }
+    DString token = it->second;
+
+    it = req->params.find("expire");
+    if (it == req->params.end()) {
+        log_warn("token verify failed, no expire. stream=%s", req->get_stream_url().c_str());
+        return false;
+    }
+    DString expire = it->second;
+
+    if (expire.toInt64() < (dint64)::time(NULL)) {
+        log_warn("token verify failed, expired. stream=%s, expire=%s", req->get_stream_url().c_str(), expire.c_str());
+        return false;
+    }
+
+    DString data = "/" + req->app + "/" + req->stream + ":" + expire;
+    if (config->get_token_check_ip(req)) {
+        data.append(":" + ip);
+    }
+
+    std::vector<DString> keys = config->get_token_keys(req);
+    for (int i = 0; i < (int)keys.size(); ++i) {
+        if (equals(sign(keys.at(i), data), token)) {
+            m_verified = true;
+            return true;
+        }
+    }
+
+    log_warn("token verify failed, signature mismatch. stream=%s, ip=%s", req->get_stream_url().c_str(), ip.c_str());
+
+    return false;
+}
+
+DString lms_verify_token::sign(const DString &key, const DString &data)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int size = 0;
+
+    if (!HMAC(EVP_sha256(), key.data(), key.size(), (const unsigned char *)data.data(), data.size(), digest, &size)) {
+        return "";
+    }
+
+    char hex[EVP_MAX_MD_SIZE * 2 + 1];
+    for (unsigned int i = 0; i < size; ++i) {
+        sprintf(hex + i * 2, "%02x", digest[i]);
+    }
+
+    return DString(hex, size * 2);
+}
+
+bool lms_verify_token::equals(const DString &a, const DString &b)
+{
+    if (a.empty() || a.size() != b.size()) {
+        return false;
+    }
+
+    // 比较时间与内容无关，防止逐字节猜测签名
+    unsigned char diff = 0;
+    for (int i = 0; i < (int)a.size(); ++i) {
+        diff |= (unsigned char)(a.at(i) ^ b.at(i));
+    }
+
+    return diff == 0;
+}
@@ -0,0 +1,36 @@
+#ifndef LMS_VERIFY_TOKEN_HPP
+#define LMS_VERIFY_TOKEN_HPP
+
+#include "kernel_request.hpp"
+#include "lms_config.hpp"
+
+/**
+ * @brief 本地验证签名url，不需要请求hook服务器
+ *
+ * url参数为 expire=过期时间(unix秒)&token=签名，签名为
+ * hex(HMAC-SHA256(key, "/app/stream:expire"))，开启check_ip时为 "/app/stream:expire:ip"。
+ * 配置多个key时依次尝试，用于key轮换
+ */
+class lms_verify_token
+{
+public:
+    lms_verify_token();
+    ~lms_verify_token();
+
+    bool check(kernel_request *req, bool publish, const DString &ip);
+    /**
+     * @brief check时确实验证了签名并且通过，此时hook只需要做通知
+     */
+    bool verified() { return m_verified; }
+
+    static DString sign(const DString &key, const DString &data);
+
+private:
+    bool equals(const DString &a, const DString &b);
+
+private:
+    bool m_verified;
+
+};
+
+#endif // LMS_VERIFY_TOKEN_HPP
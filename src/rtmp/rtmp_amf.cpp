@@ -599,3 +599,303 @@ bool AmfWriteEcmaArray(DStream &buffer, AMF0Object &var)
 
     return true;
 }
+
+/**********************************************************************/
+
+bool AMF0StringRef::equals(const char *str) const
+{
+    int len = strlen(str);
+    if (len != length) {
+        return false;
+    }
+
+    return memcmp(data, str, len) == 0;
+}
+
+DString AMF0StringRef::toString() const
+{
+    if (length <= 0) {
+        return "";
+    }
+
+    return DString(data, length);
+}
+
+bool AmfReadStringRef(const char *data, int len, AMF0StringRef &var)
+{
+    if (len < 3 || data[0] != AMF0_SHORT_STRING) {
+        return false;
+    }
+
+    const duint8 *p = (const duint8*)(data + 1);
+    int size = (p[0] << 8) | p[1];
+
+    if (len - 3 < size) {
+        return false;
+    }
+
+    var.data = data + 3;
+    var.length = size;
+
+    return true;
+}
+
+AMF0Reader::AMF0Reader()
+    : m_count(0)
+    , m_pos(NULL)
+    , m_end(NULL)
+{
+
+}
+
+AMF0Reader::~AMF0Reader()
+{
+
+}
+
+bool AMF0Reader::decode(const char *data, int len)
+{
+    clear();
+
+    m_pos = data;
+    m_end = data + len;
+
+    AMF0StringRef key;
+    while (m_pos < m_end) {
+        if (!readAny(key, 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void AMF0Reader::clear()
+{
+    m_count = 0;
+    m_pos = m_end = NULL;
+}
+
+int AMF0Reader::count()
+{
+    return m_count;
+}
+
+AMF0Node *AMF0Reader::node(int index)
+{
+    if (index < 0 || index >= m_count) {
+        return NULL;
+    }
+
+    return &m_nodes[index];
+}
+
+bool AMF0Reader::findString(int num, AMF0StringRef &value)
+{
+    int count = 1;
+    num = (num <= 0) ? 1 : num;
+
+    for (int i = 0; i < m_count; ++i) {
+        AMF0Node &n = m_nodes[i];
+        if (n.depth == 0 && n.type == AMF0_SHORT_STRING) {
+            if (num == count) {
+                value = n.str;
+                return true;
+            }
+            count++;
+        }
+    }
+
+    return false;
+}
+
+bool AMF0Reader::findDouble(int num, double &value)
+{
+    int count = 1;
+    num = (num <= 0) ? 1 : num;
+
+    for (int i = 0; i < m_count; ++i) {
+        AMF0Node &n = m_nodes[i];
+        if (n.depth == 0 && n.type == AMF0_NUMBER) {
+            if (num == count) {
+                value = n.number;
+                return true;
+            }
+            count++;
+        }
+    }
+
+    return false;
+}
+
+bool AMF0Reader::findString(const char *name, AMF0StringRef &value)
+{
+    for (int i = 0; i < m_count; ++i) {
+        AMF0Node &n = m_nodes[i];
+        if (n.depth > 0 && n.type == AMF0_SHORT_STRING && n.key.equals(name)) {
+            value = n.str;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool AMF0Reader::findDouble(const char *name, double &value)
+{
+    for (int i = 0; i < m_count; ++i) {
+        AMF0Node &n = m_nodes[i];
+        if (n.depth > 0 && n.type == AMF0_NUMBER && n.key.equals(name)) {
+            value = n.number;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool AMF0Reader::readAny(const AMF0StringRef &key, int depth)
+{
+    if (m_pos >= m_end || depth > AMF0_READER_MAX_DEPTH) {
+        return false;
+    }
+
+    char marker = *m_pos++;
+
+    AMF0Node *n = append(marker, key, depth);
+    if (!n) {
+        return false;
+    }
+
+    switch (marker) {
+    case AMF0_NUMBER:
+    {
+        if (m_end - m_pos < 8) {
+            return false;
+        }
+        char *pp = (char*)&n->number;
+        for (int i = 0; i < 8; ++i) {
+            pp[7 - i] = m_pos[i];
+        }
+        m_pos += 8;
+        return true;
+    }
+    case AMF0_BOOLEAN:
+    {
+        if (m_pos >= m_end) {
+            return false;
+        }
+        n->boolean = (*m_pos++ != 0);
+        return true;
+    }
+    case AMF0_SHORT_STRING:
+        return readString(n->str);
+    case AMF0_NULL:
+    case AMF0_UNDEFINED:
+        return true;
+    case AMF0_OBJECT:
+        return readProperties(depth + 1);
+    case AMF0_ECMA_ARRAY:
+    {
+        // ecma count，以object end为准
+        if (m_end - m_pos < 4) {
+            return false;
+        }
+        m_pos += 4;
+        return readProperties(depth + 1);
+    }
+    case AMF0_STRICT_ARRAY:
+    {
+        if (m_end - m_pos < 4) {
+            return false;
+        }
+        const duint8 *p = (const duint8*)m_pos;
+        duint32 count = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        m_pos += 4;
+
+        AMF0StringRef empty;
+        for (duint32 i = 0; i < count && m_pos < m_end; ++i) {
+            if (!readAny(empty, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case AMF0_DATE:
+    {
+        if (m_end - m_pos < 10) {
+            return false;
+        }
+        m_pos += 10;
+        return true;
+    }
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+bool AMF0Reader::readProperties(int depth)
+{
+    while (m_pos < m_end) {
+        if (m_end - m_pos < 3) {
+            return false;
+        }
+
+        if (m_pos[0] == 0x00 && m_pos[1] == 0x00 && m_pos[2] == AMF0_OBJECT_END) {
+            m_pos += 3;
+            return true;
+        }
+
+        AMF0StringRef key;
+        if (!readString(key)) {
+            return false;
+        }
+
+        if (!readAny(key, depth)) {
+            return false;
+        }
+    }
+
+    // 和AmfReadObject保持一致，缺少object end时读到payload结束
+    return true;
+}
+
+bool AMF0Reader::readString(AMF0StringRef &var)
+{
+    if (m_end - m_pos < 2) {
+        return false;
+    }
+
+    const duint8 *p = (const duint8*)m_pos;
+    int len = (p[0] << 8) | p[1];
+    m_pos += 2;
+
+    if (m_end - m_pos < len) {
+        return false;
+    }
+
+    var.data = m_pos;
+    var.length = len;
+    m_pos += len;
+
+    return true;
+}
+
+AMF0Node *AMF0Reader::append(char type, const AMF0StringRef &key, int depth)
+{
+    if (m_count >= AMF0_READER_MAX_NODES) {
+        return NULL;
+    }
+
+    AMF0Node *n = &m_nodes[m_count++];
+    n->type = type;
+    n->depth = depth;
+    n->key = key;
+    n->str = AMF0StringRef();
+    n->number = 0;
+    n->boolean = false;
+
+    return n;
+}
@@ -190,4 +190,83 @@ bool AmfWriteAny(DStream &buffer, AMF0Any *any);
  */
 bool AmfWriteEcmaArray(DStream &buffer, AMF0Object &var);
 
+/*********************************************************/
+
+/**
+ * @brief 指向原始payload的字符串，不拷贝数据，payload释放后失效
+ */
+struct AMF0StringRef
+{
+    AMF0StringRef() : data(NULL), length(0) {}
+
+    bool equals(const char *str) const;
+    DString toString() const;
+
+    const char *data;
+    int length;
+};
+
+/**
+ * @brief AMF0Reader解码出的节点，object/ecma array按先序展开
+ */
+struct AMF0Node
+{
+    char type;
+    // 嵌套深度，顶层为0
+    int depth;
+    // object/ecma array中的属性名，顶层为空
+    AMF0StringRef key;
+    AMF0StringRef str;
+    double number;
+    bool boolean;
+};
+
+/**
+ * @brief 读取data开头的short string，不拷贝数据，用于取命令名
+ */
+bool AmfReadStringRef(const char *data, int len, AMF0StringRef &var);
+
+// 命令消息的节点数一般不超过30，超出时返回失败，由调用者走AMF0Any解码
+#define AMF0_READER_MAX_NODES   128
+#define AMF0_READER_MAX_DEPTH   16
+
+/**
+ * @brief 不分配内存的AMF0解码，所有节点保存在固定数组中，字符串直接指向payload。
+ *        可重复使用，每次decode会清空上一次的结果
+ */
+class AMF0Reader
+{
+public:
+    AMF0Reader();
+    ~AMF0Reader();
+
+public:
+    bool decode(const char *data, int len);
+    void clear();
+
+    int count();
+    AMF0Node *node(int index);
+
+    // 查找顶层的第num个值，num从1开始
+    bool findString(int num, AMF0StringRef &value);
+    bool findDouble(int num, double &value);
+
+    // 查找 object | ecmaArray | strictArray 中的属性
+    bool findString(const char *name, AMF0StringRef &value);
+    bool findDouble(const char *name, double &value);
+
+private:
+    bool readAny(const AMF0StringRef &key, int depth);
+    bool readProperties(int depth);
+    bool readString(AMF0StringRef &var);
+    AMF0Node *append(char type, const AMF0StringRef &key, int depth);
+
+private:
+    AMF0Node m_nodes[AMF0_READER_MAX_NODES];
+    int m_count;
+
+    const char *m_pos;
+    const char *m_end;
+};
+
 #endif // RTMP_AMF_HPP
@@ -15,6 +15,9 @@ RtmpChunk::RtmpChunk(DTcpSocket *socket)
     , m_is_first_chunk_of_msg(true)
     , m_in_chunk_size(128)
     , m_out_chunk_size(128)
+    , m_send_messages(0)
+    , m_send_chunks(0)
+    , m_send_bytes(0)
     , m_type(BasicLength_1)
 {
 
@@ -35,6 +38,17 @@ bool RtmpChunk::entired()
     return m_entire;
 }
 
+RtmpChunkStat RtmpChunk::get_stat()
+{
+    RtmpChunkStat stat;
+    stat.out_chunk_size = m_out_chunk_size;
+    stat.send_messages = m_send_messages;
+    stat.send_chunks = m_send_chunks;
+    stat.send_bytes = m_send_bytes;
+
+    return stat;
+}
+
 int RtmpChunk::send_message(RtmpMessage *msg)
 {
     int ret = ERROR_SUCCESS;
@@ -146,12 +160,17 @@ int RtmpChunk::encode_chunk(RtmpMessage *msg)
         m_socket->add(out_header_cache, header_size, 0);
         m_socket->add(msg->payload, payload_size, p - msg->payload->data);
 
+        m_send_chunks++;
+        m_send_bytes += header_size + payload_size;
+
         // consume sendout bytes when not empty packet.
         if (msg->payload->data && msg->payload->length > 0) {
             p += payload_size;
         }
     } while (p < (char*)msg->payload->data + msg->payload->length);
 
+    m_send_messages++;
+
     return ret;
 }
 
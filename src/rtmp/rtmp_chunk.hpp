@@ -31,6 +31,25 @@ public:
     RtmpMessage *msg;
 };
 
+struct RtmpChunkStat
+{
+    RtmpChunkStat()
+        : out_chunk_size(0)
+        , chunk_size_changes(0)
+        , send_messages(0)
+        , send_chunks(0)
+        , send_bytes(0)
+    {
+    }
+
+    dint32 out_chunk_size;
+    // 会话中调整out chunk size的次数
+    dint32 chunk_size_changes;
+    dint64 send_messages;
+    dint64 send_chunks;
+    dint64 send_bytes;
+};
+
 class RtmpChunk
 {
 public:
@@ -52,6 +71,12 @@ public:
 
     void set_in_chunk_size(dint32 in_chunk_size) { m_in_chunk_size = in_chunk_size; }
     void set_out_chunk_size(dint32 out_chunk_size) { m_out_chunk_size = out_chunk_size; }
+    dint32 get_out_chunk_size() { return m_out_chunk_size; }
+
+    /**
+     * @brief 发送统计，用于观察chunk size的效果
+     */
+    RtmpChunkStat get_stat();
 
 public:
     int send_message(RtmpMessage *msg);
@@ -92,6 +117,11 @@ private:
     dint32 m_in_chunk_size;
     dint32 m_out_chunk_size;
 
+    // 发送的消息数、chunk数和字节数(包含chunk header)
+    dint64 m_send_messages;
+    dint64 m_send_chunks;
+    dint64 m_send_bytes;
+
     bool m_copy_header;
 
     int mh_size;
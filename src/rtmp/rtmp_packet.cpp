@@ -1,6 +1,7 @@
 #include "rtmp_packet.hpp"
 #include "kernel_errno.hpp"
 #include "kernel_log.hpp"
+#include <pthread.h>
 
 RtmpPacket::RtmpPacket()
 {
@@ -1539,3 +1540,233 @@ int OnMetaDataPacket::encode_body()
 
     return ret;
 }
+
+/**********************************************************************/
+
+struct RtmpPayloadTemplate
+{
+    RtmpPayloadTemplate()
+        : transaction_id_offset(-1)
+        , number_offset(-1)
+        , message_type(0)
+        , perfer_cid(0)
+    {
+    }
+
+    DSharedPtr<MemoryChunk> payload;
+    // 需要修改的8字节double在payload中的位置，-1表示没有
+    int transaction_id_offset;
+    int number_offset;
+
+    dint8 message_type;
+    dint32 perfer_cid;
+};
+
+static RtmpPayloadTemplate rtmp_templates[RtmpTemplateMax];
+static pthread_once_t rtmp_templates_once = PTHREAD_ONCE_INIT;
+
+// marker(1) + length(2) + string
+static int amf0_string_size(const char *str)
+{
+    return 1 + 2 + strlen(str);
+}
+
+static void save_template(RtmpTemplateType type, RtmpMessage *pkt, int transaction_id_offset, int number_offset)
+{
+    if (pkt->encode() != ERROR_SUCCESS) {
+        return;
+    }
+
+    RtmpPayloadTemplate &tpl = rtmp_templates[type];
+    tpl.payload = pkt->payload;
+    tpl.transaction_id_offset = transaction_id_offset;
+    tpl.number_offset = number_offset;
+    tpl.message_type = pkt->header.message_type;
+    tpl.perfer_cid = pkt->header.perfer_cid;
+}
+
+static void init_templates()
+{
+    // connect _result，objectEncoding是info中最后一个属性，后面只有object end(3)
+    if (true) {
+        ConnectAppResPacket pkt;
+        pkt.props.setValue("fmsVer", new AMF0String("FMS/"RTMP_SIG_FMS_VER));
+        pkt.props.setValue("capabilities", new AMF0Number(127));
+        pkt.props.setValue("mode", new AMF0Number(1));
+
+        pkt.info.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
+        pkt.info.setValue(StatusCode, new AMF0String(StatusCodeConnectSuccess));
+        pkt.info.setValue(StatusDescription, new AMF0String("Connection succeeded"));
+        pkt.info.setValue("objectEncoding", new AMF0Number(0));
+
+        if (pkt.encode() == ERROR_SUCCESS) {
+            save_template(RtmpTemplateConnectResult, &pkt, -1, pkt.payload->length - 3 - 8);
+        }
+    }
+
+    int result_offset = amf0_string_size(RTMP_AMF0_COMMAND_RESULT) + 1;
+
+    // createStream _result，stream_id在最后
+    if (true) {
+        CreateStreamResPacket pkt(0, 1);
+        if (pkt.encode() == ERROR_SUCCESS) {
+            save_template(RtmpTemplateCreateStreamResult, &pkt, result_offset, pkt.payload->length - 8);
+        }
+    }
+
+    if (true) {
+        FmleStartResPacket pkt(0);
+        save_template(RtmpTemplateFmleStartResult, &pkt, result_offset, -1);
+    }
+
+    // onFCPublish(NetStream.Publish.Start)
+    if (true) {
+        OnStatusCallPacket pkt;
+        pkt.command_name = RTMP_AMF0_COMMAND_ON_FC_PUBLISH;
+        pkt.data.setValue(StatusCode, new AMF0String(StatusCodePublishStart));
+        pkt.data.setValue(StatusDescription, new AMF0String("Started publishing stream."));
+        save_template(RtmpTemplateOnFCPublishStart, &pkt, -1, -1);
+    }
+
+    // onStatus(NetStream.Publish.Start)
+    if (true) {
+        OnStatusCallPacket pkt;
+        pkt.data.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
+        pkt.data.setValue(StatusCode, new AMF0String(StatusCodePublishStart));
+        pkt.data.setValue(StatusDescription, new AMF0String("Started publishing stream."));
+        pkt.data.setValue(StatusClientId, new AMF0String(RTMP_SIG_CLIENT_ID));
+        save_template(RtmpTemplatePublishStart, &pkt, -1, -1);
+    }
+
+    // onStatus(NetStream.Play.Reset)
+    if (true) {
+        OnStatusCallPacket pkt;
+        pkt.data.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
+        pkt.data.setValue(StatusCode, new AMF0String(StatusCodeStreamReset));
+        pkt.data.setValue(StatusDescription, new AMF0String("Playing and resetting stream."));
+        pkt.data.setValue(StatusDetails, new AMF0String("stream"));
+        pkt.data.setValue(StatusClientId, new AMF0String(RTMP_SIG_CLIENT_ID));
+        save_template(RtmpTemplatePlayReset, &pkt, -1, -1);
+    }
+
+    // onStatus(NetStream.Play.Start)
+    if (true) {
+        OnStatusCallPacket pkt;
+        pkt.data.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
+        pkt.data.setValue(StatusCode, new AMF0String(StatusCodeStreamStart));
+        pkt.data.setValue(StatusDescription, new AMF0String("Started playing stream."));
+        pkt.data.setValue(StatusDetails, new AMF0String("stream"));
+        pkt.data.setValue(StatusClientId, new AMF0String(RTMP_SIG_CLIENT_ID));
+        save_template(RtmpTemplatePlayStart, &pkt, -1, -1);
+    }
+
+    // |RtmpSampleAccess(true, true)
+    if (true) {
+        SampleAccessPacket pkt;
+        pkt.audio_sample_access = true;
+        pkt.video_sample_access = true;
+        save_template(RtmpTemplateSampleAccess, &pkt, -1, -1);
+    }
+
+    // onStatus(NetStream.Data.Start)
+    if (true) {
+        OnStatusDataPacket pkt;
+        pkt.data.setValue(StatusCode, new AMF0String(StatusCodeDataStart));
+        save_template(RtmpTemplateDataStart, &pkt, -1, -1);
+    }
+
+    // onFCUnpublish(NetStream.unpublish.Success)
+    if (true) {
+        OnStatusCallPacket pkt;
+        pkt.command_name = RTMP_AMF0_COMMAND_ON_FC_UNPUBLISH;
+        pkt.data.setValue(StatusCode, new AMF0String(StatusCodeUnpublishSuccess));
+        pkt.data.setValue(StatusDescription, new AMF0String("Stop publishing stream."));
+        save_template(RtmpTemplateOnFCUnpublish, &pkt, -1, -1);
+    }
+
+    // onStatus(NetStream.Unpublish.Success)
+    if (true) {
+        OnStatusCallPacket pkt;
+        pkt.data.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
+        pkt.data.setValue(StatusCode, new AMF0String(StatusCodeUnpublishSuccess));
+        pkt.data.setValue(StatusDescription, new AMF0String("Stream is now unpublished"));
+        pkt.data.setValue(StatusClientId, new AMF0String(RTMP_SIG_CLIENT_ID));
+        save_template(RtmpTemplateUnpublishSuccess, &pkt, -1, -1);
+    }
+}
+
+static void write_double(char *p, double value)
+{
+    char *pp = (char*)&value;
+    for (int i = 0; i < 8; ++i) {
+        p[i] = pp[7 - i];
+    }
+}
+
+RtmpTemplatePacket::RtmpTemplatePacket(RtmpTemplateType type)
+    : m_type(type)
+    , m_has_transaction_id(false)
+    , m_transaction_id(0)
+    , m_has_number(false)
+    , m_number(0)
+{
+    pthread_once(&rtmp_templates_once, init_templates);
+
+    RtmpPayloadTemplate &tpl = rtmp_templates[m_type];
+    header.message_type = tpl.message_type;
+    header.perfer_cid = tpl.perfer_cid;
+}
+
+RtmpTemplatePacket::~RtmpTemplatePacket()
+{
+
+}
+
+int RtmpTemplatePacket::encode()
+{
+    int ret = ERROR_SUCCESS;
+
+    RtmpPayloadTemplate &tpl = rtmp_templates[m_type];
+    if (tpl.payload.get() == NULL) {
+        ret = ERROR_RTMP_AMF0_ANY_ENCODE;
+        log_error("rtmp response template is not initialized. type=%d, ret=%d", m_type, ret);
+        return ret;
+    }
+
+    bool patch_transaction_id = m_has_transaction_id && tpl.transaction_id_offset >= 0;
+    bool patch_number = m_has_number && tpl.number_offset >= 0;
+
+    // 模板payload只读，不需要修改时直接共用
+    if (!patch_transaction_id && !patch_number) {
+        payload = tpl.payload;
+        return ret;
+    }
+
+    int len = tpl.payload->length;
+    MemoryChunk *chunk = DMemPool::instance()->getMemory(len);
+    memcpy(chunk->data, tpl.payload->data, len);
+    chunk->length = len;
+
+    if (patch_transaction_id) {
+        write_double(chunk->data + tpl.transaction_id_offset, m_transaction_id);
+    }
+    if (patch_number) {
+        write_double(chunk->data + tpl.number_offset, m_number);
+    }
+
+    payload = DSharedPtr<MemoryChunk>(chunk);
+
+    return ret;
+}
+
+void RtmpTemplatePacket::set_transaction_id(double id)
+{
+    m_has_transaction_id = true;
+    m_transaction_id = id;
+}
+
+void RtmpTemplatePacket::set_number(double value)
+{
+    m_has_number = true;
+    m_number = value;
+}
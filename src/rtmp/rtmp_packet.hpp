@@ -488,4 +488,55 @@ public:
     int num;
 };
 
+/**
+ * 服务端固定的响应消息，第一次使用时序列化一次，之后所有连接共用
+ */
+enum RtmpTemplateType
+{
+    RtmpTemplateConnectResult = 0,
+    RtmpTemplateCreateStreamResult,
+    RtmpTemplateFmleStartResult,
+    RtmpTemplateOnFCPublishStart,
+    RtmpTemplatePublishStart,
+    RtmpTemplatePlayReset,
+    RtmpTemplatePlayStart,
+    RtmpTemplateSampleAccess,
+    RtmpTemplateDataStart,
+    RtmpTemplateOnFCUnpublish,
+    RtmpTemplateUnpublishSuccess,
+    RtmpTemplateMax
+};
+
+/**
+ * @brief 使用预先序列化好的payload发送固定响应，不生成AMF0对象。
+ *        不需要修改时直接引用模板的payload，否则拷贝一份后只修改transaction_id等数值
+ */
+class RtmpTemplatePacket : public RtmpMessage
+{
+public:
+    RtmpTemplatePacket(RtmpTemplateType type);
+    ~RtmpTemplatePacket();
+
+public:
+    int encode();
+
+    /**
+     * @brief connect _result不支持修改，固定为1
+     */
+    void set_transaction_id(double id);
+    /**
+     * @brief connect _result为objectEncoding，createStream _result为stream_id
+     */
+    void set_number(double value);
+
+private:
+    RtmpTemplateType m_type;
+
+    bool m_has_transaction_id;
+    double m_transaction_id;
+
+    bool m_has_number;
+    double m_number;
+};
+
 #endif // RTMP_PACKET_HPP
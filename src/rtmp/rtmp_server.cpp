@@ -2,6 +2,20 @@
 #include "DGlobal.hpp"
 #include "kernel_errno.hpp"
 #include "kernel_log.hpp"
+#include "kernel_codec.hpp"
+#include "DDateTime.hpp"
+
+// aggregate中每个消息的tag header(11)和previous tag size(4)
+#define RTMP_AGGREGATE_TAG_OVERHEAD     15
+// 只合并小于此大小的帧，大帧合并带来的拷贝比省下的chunk header更多
+#define RTMP_AGGREGATE_MAX_FRAME_SIZE   (16 * 1024)
+// 单个aggregate消息的最大大小
+#define RTMP_AGGREGATE_MAX_SIZE         (64 * 1024)
+
+// out chunk size的上限，部分客户端不支持更大的chunk
+#define RTMP_MAX_OUT_CHUNK_SIZE         65536
+// 每统计这么多个视频帧，计算一次平均帧大小
+#define RTMP_CHUNK_SIZE_SAMPLES         64
 
 rtmp_server::rtmp_server(DTcpSocket *socket)
     : m_socket(socket)
@@ -9,7 +23,14 @@ rtmp_server::rtmp_server(DTcpSocket *socket)
     , m_out_chunk_size(128)
     , m_player_buffer_length(1000)
     , m_objectEncoding(0)
+    , m_aggregate_duration(0)
+    , m_aggregate_size(0)
+    , m_chunk_size_max(0)
+    , m_chunk_size_changes(0)
+    , m_sample_count(0)
+    , m_sample_bytes(0)
     , m_stream_id(1)
+    , m_handshake_time(-1)
     , m_av_handler(NULL)
     , m_metadata_handler(NULL)
     , m_connect_notify_handler(NULL)
@@ -21,10 +42,14 @@ rtmp_server::rtmp_server(DTcpSocket *socket)
     m_hs = new rtmp_handshake(m_socket);
     m_ch = new RtmpChunk(m_socket);
     m_req = new kernel_request();
+
+    m_create_time = DDateTime::currentDate().toMS();
 }
 
 rtmp_server::~rtmp_server()
 {
+    clear_aggregate();
+
     DFree(m_hs);
     DFree(m_ch);
     DFree(m_req);
@@ -64,6 +89,29 @@ void rtmp_server::set_in_ack_size(int ack_size)
     in_ack_size.window = ack_size;
 }
 
+void rtmp_server::set_aggregate_duration(dint32 duration)
+{
+    m_aggregate_duration = duration;
+}
+
+void rtmp_server::set_chunk_size_max(dint32 chunk_size_max)
+{
+    m_chunk_size_max = DMin(chunk_size_max, RTMP_MAX_OUT_CHUNK_SIZE);
+}
+
+RtmpChunkStat rtmp_server::get_chunk_stat()
+{
+    RtmpChunkStat stat = m_ch->get_stat();
+    stat.chunk_size_changes = m_chunk_size_changes;
+
+    return stat;
+}
+
+dint64 rtmp_server::get_handshake_time()
+{
+    return m_handshake_time;
+}
+
 kernel_request *rtmp_server::get_request()
 {
     return m_req;
@@ -75,12 +123,37 @@ int rtmp_server::send_av_data(RtmpMessage *msg)
 
     msg->header.stream_id = m_stream_id;
 
-    if ((ret = m_ch->send_message(msg)) != ERROR_SUCCESS) {
-        log_error_eagain(ret, ret, "send rtmp video/audio message failed. type=%d, ret=%d", msg->header.message_type, ret);
-        return ret;
+    if (m_aggregate_duration > 0) {
+        if (can_aggregate(msg)) {
+            // 时间戳回退或者超出大小时，先把缓存的发出去
+            if (!m_aggregate_msgs.empty()) {
+                RtmpMessage *first = m_aggregate_msgs.front();
+                if (msg->header.timestamp < first->header.timestamp
+                        || m_aggregate_size + msg->payload->length + RTMP_AGGREGATE_TAG_OVERHEAD > RTMP_AGGREGATE_MAX_SIZE) {
+                    if ((ret = send_aggregate()) != ERROR_SUCCESS) {
+                        return ret;
+                    }
+                }
+            }
+
+            m_aggregate_msgs.push_back(new RtmpMessage(msg));
+            m_aggregate_size += msg->payload->length + RTMP_AGGREGATE_TAG_OVERHEAD;
+
+            RtmpMessage *first = m_aggregate_msgs.front();
+            if (msg->header.timestamp - first->header.timestamp >= m_aggregate_duration) {
+                return send_aggregate();
+            }
+
+            return ret;
+        }
+
+        // 不能合并的消息，先发送缓存的消息，保证顺序
+        if ((ret = send_aggregate()) != ERROR_SUCCESS) {
+            return ret;
+        }
     }
 
-    return ret;
+    return send_av_message(msg);
 }
 
 void rtmp_server::set_av_handler(RtmpAVHandler handler)
@@ -190,30 +263,19 @@ int rtmp_server::response_publish(bool allow)
     m_ch->set_out_chunk_size(m_out_chunk_size);
 
     // onFCPublish(NetStream.Publish.Start)
-    OnStatusCallPacket* pkt1 = new OnStatusCallPacket();
-    DAutoFree(OnStatusCallPacket, pkt1);
+    RtmpTemplatePacket pkt1(RtmpTemplateOnFCPublishStart);
+    pkt1.header.stream_id = m_stream_id;
 
-    pkt1->command_name = RTMP_AMF0_COMMAND_ON_FC_PUBLISH;
-    pkt1->header.stream_id = m_stream_id;
-    pkt1->data.setValue(StatusCode, new AMF0String(StatusCodePublishStart));
-    pkt1->data.setValue(StatusDescription, new AMF0String("Started publishing stream."));
-
-    if ((ret = send_message(pkt1)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt1)) != ERROR_SUCCESS) {
         log_error("send rtmp onFCPublish(NetStream.Publish.Start) packet failed. ret=%d", ret);
         return ret;
     }
 
     // onStatus(NetStream.Publish.Start)
-    OnStatusCallPacket* pkt2 = new OnStatusCallPacket();
-    DAutoFree(OnStatusCallPacket, pkt2);
+    RtmpTemplatePacket pkt2(RtmpTemplatePublishStart);
+    pkt2.header.stream_id = m_stream_id;
 
-    pkt2->header.stream_id = m_stream_id;
-    pkt2->data.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
-    pkt2->data.setValue(StatusCode, new AMF0String(StatusCodePublishStart));
-    pkt2->data.setValue(StatusDescription, new AMF0String("Started publishing stream."));
-    pkt2->data.setValue(StatusClientId, new AMF0String(RTMP_SIG_CLIENT_ID));
-
-    if ((ret = send_message(pkt2)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt2)) != ERROR_SUCCESS) {
         log_error("send rtmp onStatus(NetStream.Publish.Start) packet failed. ret=%d", ret);
         return ret;
     }
@@ -250,60 +312,37 @@ int rtmp_server::response_play(bool allow)
     }
 
     // onStatus(NetStream.Play.Reset)
-    OnStatusCallPacket* pkt2 = new OnStatusCallPacket();
-    DAutoFree(OnStatusCallPacket, pkt2);
-
-    pkt2->header.stream_id = m_stream_id;
-
-    pkt2->data.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
-    pkt2->data.setValue(StatusCode, new AMF0String(StatusCodeStreamReset));
-    pkt2->data.setValue(StatusDescription, new AMF0String("Playing and resetting stream."));
-    pkt2->data.setValue(StatusDetails, new AMF0String("stream"));
-    pkt2->data.setValue(StatusClientId, new AMF0String(RTMP_SIG_CLIENT_ID));
+    RtmpTemplatePacket pkt2(RtmpTemplatePlayReset);
+    pkt2.header.stream_id = m_stream_id;
 
-    if ((ret = send_message(pkt2)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt2)) != ERROR_SUCCESS) {
         log_error("send rtmp onStatus(NetStream.Play.Reset) packet failed. ret=%d", ret);
         return ret;
     }
 
     // onStatus(NetStream.Play.Start)
-    OnStatusCallPacket* pkt3 = new OnStatusCallPacket();
-    DAutoFree(OnStatusCallPacket, pkt3);
+    RtmpTemplatePacket pkt3(RtmpTemplatePlayStart);
+    pkt3.header.stream_id = m_stream_id;
 
-    pkt3->header.stream_id = m_stream_id;
-
-    pkt3->data.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
-    pkt3->data.setValue(StatusCode, new AMF0String(StatusCodeStreamStart));
-    pkt3->data.setValue(StatusDescription, new AMF0String("Started playing stream."));
-    pkt3->data.setValue(StatusDetails, new AMF0String("stream"));
-    pkt3->data.setValue(StatusClientId, new AMF0String(RTMP_SIG_CLIENT_ID));
-
-    if ((ret = send_message(pkt3)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt3)) != ERROR_SUCCESS) {
         log_error("send rtmp onStatus(NetStream.Play.Start) packet failed. ret=%d", ret);
         return ret;
     }
 
-    // |RtmpSampleAccess(false, false)
-    SampleAccessPacket *pkt4 = new SampleAccessPacket();
-    DAutoFree(SampleAccessPacket, pkt4);
-
-    pkt4->header.stream_id = m_stream_id;
-    pkt4->audio_sample_access = true;
-    pkt4->video_sample_access = true;
+    // |RtmpSampleAccess(true, true)
+    RtmpTemplatePacket pkt4(RtmpTemplateSampleAccess);
+    pkt4.header.stream_id = m_stream_id;
 
-    if ((ret = send_message(pkt4)) != ERROR_SUCCESS) {
-        log_error("send rtmp |RtmpSampleAccess(false, false) packet failed. ret=%d", ret);
+    if ((ret = send_message(&pkt4)) != ERROR_SUCCESS) {
+        log_error("send rtmp |RtmpSampleAccess(true, true) packet failed. ret=%d", ret);
         return ret;
     }
 
     // onStatus(NetStream.Data.Start)
-    OnStatusDataPacket* pkt5 = new OnStatusDataPacket();
-    DAutoFree(OnStatusDataPacket, pkt5);
+    RtmpTemplatePacket pkt5(RtmpTemplateDataStart);
+    pkt5.header.stream_id = m_stream_id;
 
-    pkt5->header.stream_id = m_stream_id;
-    pkt5->data.setValue(StatusCode, new AMF0String(StatusCodeDataStart));
-
-    if ((ret = send_message(pkt5)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt5)) != ERROR_SUCCESS) {
         log_error("send rtmp onStatus(NetStream.Data.Start) packet failed. ret=%d", ret);
         return ret;
     }
@@ -337,6 +376,7 @@ int rtmp_server::handshake()
 
     if (m_hs->completed()) {
         log_info("handshake with client success");
+        m_handshake_time = DDateTime::currentDate().toMS() - m_create_time;
         m_type = RecvChunk;
         DFree(m_hs);
     }
@@ -381,27 +421,27 @@ int rtmp_server::decode_message()
             len = msg->payload->length - 1;
         }
 
-        DString command;
+        AMF0StringRef command;
         if ((ret = get_command_name(data, len, command)) != ERROR_SUCCESS) {
             log_error("get rtmp amf0/amf3 command name failed. ret=%d", ret);
             return ret;
         }
 
-        if (command == RTMP_AMF0_COMMAND_CONNECT) {
+        if (command.equals(RTMP_AMF0_COMMAND_CONNECT)) {
             return process_connect_app(msg);
-        } else if (command == RTMP_AMF0_COMMAND_CREATE_STREAM) {
+        } else if (command.equals(RTMP_AMF0_COMMAND_CREATE_STREAM)) {
             return process_create_stream(msg);
-        } else if (command == RTMP_AMF0_COMMAND_PUBLISH) {
+        } else if (command.equals(RTMP_AMF0_COMMAND_PUBLISH)) {
             return process_publish(msg);
-        } else if (command == RTMP_AMF0_COMMAND_RELEASE_STREAM) {
+        } else if (command.equals(RTMP_AMF0_COMMAND_RELEASE_STREAM)) {
             return process_release_stream(msg);
-        } else if (command == RTMP_AMF0_COMMAND_FC_PUBLISH) {
+        } else if (command.equals(RTMP_AMF0_COMMAND_FC_PUBLISH)) {
             return process_FCPublish(msg);
-        } else if (command == RTMP_AMF0_COMMAND_PLAY) {
+        } else if (command.equals(RTMP_AMF0_COMMAND_PLAY)) {
             return process_play(msg);
-        } else if (command == RTMP_AMF0_COMMAND_CLOSE_STREAM) {
+        } else if (command.equals(RTMP_AMF0_COMMAND_CLOSE_STREAM)) {
             return process_close_stream(msg);
-        } else if (command == RTMP_AMF0_COMMAND_UNPUBLISH) {
+        } else if (command.equals(RTMP_AMF0_COMMAND_UNPUBLISH)) {
             return process_FCUnpublish(msg);
         }
     } else if (msg->is_amf0_data() || msg->is_amf3_data()) {
@@ -413,13 +453,13 @@ int rtmp_server::decode_message()
             len = msg->payload->length - 1;
         }
 
-        DString command;
+        AMF0StringRef command;
         if ((ret = get_command_name(data, len, command)) != ERROR_SUCCESS) {
             log_error("get rtmp amf data name failed. ret=%d", ret);
             return ret;
         }
 
-        if(command == RTMP_AMF0_DATA_SET_DATAFRAME || command == RTMP_AMF0_DATA_ON_METADATA) {
+        if(command.equals(RTMP_AMF0_DATA_SET_DATAFRAME) || command.equals(RTMP_AMF0_DATA_ON_METADATA)) {
             return process_metadata(msg);
         }
     } else if (msg->is_set_chunk_size()) {
@@ -443,20 +483,39 @@ int rtmp_server::process_connect_app(RtmpMessage *msg)
 
     log_info("recv connect app");
 
-    ConnectAppPacket *pkt = new ConnectAppPacket();
-    DAutoFree(ConnectAppPacket, pkt);
-    pkt->copy(msg);
+    double transaction_id = 0;
+    AMF0StringRef tcUrl;
+
+    if (decode_amf0(msg) && m_amf.findDouble(1, transaction_id) && transaction_id == 1.0
+            && m_amf.findString("tcUrl", tcUrl)) {
+        AMF0StringRef pageUrl;
+        AMF0StringRef swfUrl;
+        double objectEncoding = 0;
+
+        m_amf.findDouble("objectEncoding", objectEncoding);
+        m_amf.findString("pageUrl", pageUrl);
+        m_amf.findString("swfUrl", swfUrl);
+
+        m_req->set_tcUrl(tcUrl.toString());
+        m_req->pageUrl = pageUrl.toString();
+        m_req->swfUrl = swfUrl.toString();
+        m_objectEncoding = objectEncoding;
+    } else {
+        ConnectAppPacket *pkt = new ConnectAppPacket();
+        DAutoFree(ConnectAppPacket, pkt);
+        pkt->copy(msg);
+
+        if ((ret = pkt->decode()) != ERROR_SUCCESS) {
+            log_error("decode rtmp connect packet failed. ret=%d", ret);
+            return ret;
+        }
 
-    if ((ret = pkt->decode()) != ERROR_SUCCESS) {
-        log_error("decode rtmp connect packet failed. ret=%d", ret);
-        return ret;
+        m_req->set_tcUrl(pkt->tcUrl);
+        m_req->pageUrl = pkt->pageUrl;
+        m_req->swfUrl = pkt->swfUrl;
+        m_objectEncoding = pkt->objectEncoding;
     }
 
-    m_req->set_tcUrl(pkt->tcUrl);
-    m_req->pageUrl = pkt->pageUrl;
-    m_req->swfUrl = pkt->swfUrl;
-    m_objectEncoding = pkt->objectEncoding;
-
     if (m_connect_notify_handler) {
         m_connect_notify_handler(m_req);
     }
@@ -470,19 +529,25 @@ int rtmp_server::process_create_stream(RtmpMessage *msg)
 
     log_trace("start create createStream");
 
-    CreateStreamPacket *pkt  = new CreateStreamPacket();
-    DAutoFree(CreateStreamPacket, pkt);
-    pkt->copy(msg);
+    double transaction_id = 0;
+    if (!decode_amf0(msg) || !m_amf.findDouble(1, transaction_id)) {
+        CreateStreamPacket *pkt  = new CreateStreamPacket();
+        DAutoFree(CreateStreamPacket, pkt);
+        pkt->copy(msg);
 
-    if ((ret = pkt->decode()) != ERROR_SUCCESS) {
-        log_error("decode rtmp createStream packet failed. ret=%d", ret);
-        return ret;
+        if ((ret = pkt->decode()) != ERROR_SUCCESS) {
+            log_error("decode rtmp createStream packet failed. ret=%d", ret);
+            return ret;
+        }
+
+        transaction_id = pkt->transaction_id;
     }
 
-    CreateStreamResPacket *res_pkt = new CreateStreamResPacket(pkt->transaction_id, m_stream_id);
-    DAutoFree(CreateStreamResPacket, res_pkt);
+    RtmpTemplatePacket res_pkt(RtmpTemplateCreateStreamResult);
+    res_pkt.set_transaction_id(transaction_id);
+    res_pkt.set_number(m_stream_id);
 
-    if ((ret = send_message(res_pkt)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&res_pkt)) != ERROR_SUCCESS) {
         log_error("send rtmp createStream response packet failed. ret=%d", ret);
         return ret;
     }
@@ -497,20 +562,29 @@ int rtmp_server::process_publish(RtmpMessage *msg)
     int ret = ERROR_SUCCESS;
 
     // publish的payload需要解出流名
-    PublishPacket *pkt  = new PublishPacket();
-    DAutoFree(PublishPacket, pkt);
-    pkt->copy(msg);
+    DString stream_name;
+    AMF0StringRef name;
+
+    if (decode_amf0(msg) && m_amf.findString(2, name) && name.length > 0) {
+        stream_name = name.toString();
+    } else {
+        PublishPacket *pkt  = new PublishPacket();
+        DAutoFree(PublishPacket, pkt);
+        pkt->copy(msg);
+
+        if ((ret = pkt->decode()) != ERROR_SUCCESS) {
+            log_error("decode rtmp publish packet failed. ret=%d", ret);
+            return ret;
+        }
 
-    if ((ret = pkt->decode()) != ERROR_SUCCESS) {
-        log_error("decode rtmp publish packet failed. ret=%d", ret);
-        return ret;
+        stream_name = pkt->stream_name;
     }
 
-    if (m_stream_id != pkt->header.stream_id) {
-        log_warn("rtmp publish stream_id must be %d, actual=%d", m_stream_id, pkt->header.stream_id);
+    if (m_stream_id != msg->header.stream_id) {
+        log_warn("rtmp publish stream_id must be %d, actual=%d", m_stream_id, msg->header.stream_id);
     }
 
-    m_req->set_stream(pkt->stream_name);
+    m_req->set_stream(stream_name);
 
     if (m_publish_verify_handler) {
         m_publish_verify_handler(m_req);
@@ -526,20 +600,29 @@ int rtmp_server::process_play(RtmpMessage *msg)
     log_trace("start play");
 
     // play的payload需要解出流名
-    PlayPacket *pkt  = new PlayPacket();
-    DAutoFree(PlayPacket, pkt);
-    pkt->copy(msg);
+    DString stream_name;
+    AMF0StringRef name;
+
+    if (decode_amf0(msg) && m_amf.findString(2, name) && name.length > 0) {
+        stream_name = name.toString();
+    } else {
+        PlayPacket *pkt  = new PlayPacket();
+        DAutoFree(PlayPacket, pkt);
+        pkt->copy(msg);
+
+        if ((ret = pkt->decode()) != ERROR_SUCCESS) {
+            log_error("decode rtmp play packet failed. ret=%d", ret);
+            return ret;
+        }
 
-    if ((ret = pkt->decode()) != ERROR_SUCCESS) {
-        log_error("decode rtmp play packet failed. ret=%d", ret);
-        return ret;
+        stream_name = pkt->stream_name;
     }
 
-    if (m_stream_id != pkt->header.stream_id) {
-        log_warn("rtmp play stream_id must be %d, actual=%d", m_stream_id, pkt->header.stream_id);
+    if (m_stream_id != msg->header.stream_id) {
+        log_warn("rtmp play stream_id must be %d, actual=%d", m_stream_id, msg->header.stream_id);
     }
 
-    m_req->set_stream(pkt->stream_name);
+    m_req->set_stream(stream_name);
 
     if (m_play_verify_handler) {
         m_play_verify_handler(m_req);
@@ -554,19 +637,24 @@ int rtmp_server::process_release_stream(RtmpMessage *msg)
 
     log_trace("start create releaseStream");
 
-    FmleStartPacket *pkt = new FmleStartPacket();
-    DAutoFree(FmleStartPacket, pkt);
-    pkt->copy(msg);
+    double transaction_id = 0;
+    if (!decode_amf0(msg) || !m_amf.findDouble(1, transaction_id)) {
+        FmleStartPacket *pkt = new FmleStartPacket();
+        DAutoFree(FmleStartPacket, pkt);
+        pkt->copy(msg);
 
-    if ((ret = pkt->decode()) != ERROR_SUCCESS) {
-        log_error("decode rtmp releaseStream packet failed. ret=%d", ret);
-        return ret;
+        if ((ret = pkt->decode()) != ERROR_SUCCESS) {
+            log_error("decode rtmp releaseStream packet failed. ret=%d", ret);
+            return ret;
+        }
+
+        transaction_id = pkt->transaction_id;
     }
 
-    FmleStartResPacket *pkt1 = new FmleStartResPacket(pkt->transaction_id);
-    DAutoFree(FmleStartResPacket, pkt1);
+    RtmpTemplatePacket pkt1(RtmpTemplateFmleStartResult);
+    pkt1.set_transaction_id(transaction_id);
 
-    if ((ret = send_message(pkt1)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt1)) != ERROR_SUCCESS) {
         log_error("send rtmp releaseStream response packet failed. ret=%d", ret);
         return ret;
     }
@@ -582,19 +670,24 @@ int rtmp_server::process_FCPublish(RtmpMessage *msg)
 
     log_trace("start FCPublish");
 
-    FmleStartPacket *pkt = new FmleStartPacket();
-    DAutoFree(FmleStartPacket, pkt);
-    pkt->copy(msg);
+    double transaction_id = 0;
+    if (!decode_amf0(msg) || !m_amf.findDouble(1, transaction_id)) {
+        FmleStartPacket *pkt = new FmleStartPacket();
+        DAutoFree(FmleStartPacket, pkt);
+        pkt->copy(msg);
 
-    if ((ret = pkt->decode()) != ERROR_SUCCESS) {
-        log_error("decode rtmp FCPublish packet failed. ret=%d", ret);
-        return ret;
+        if ((ret = pkt->decode()) != ERROR_SUCCESS) {
+            log_error("decode rtmp FCPublish packet failed. ret=%d", ret);
+            return ret;
+        }
+
+        transaction_id = pkt->transaction_id;
     }
 
-    FmleStartResPacket *pkt1 = new FmleStartResPacket(pkt->transaction_id);
-    DAutoFree(FmleStartResPacket, pkt1);
+    RtmpTemplatePacket pkt1(RtmpTemplateFmleStartResult);
+    pkt1.set_transaction_id(transaction_id);
 
-    if ((ret = send_message(pkt1)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt1)) != ERROR_SUCCESS) {
         log_error("send FCPublish response packet failed. ret=%d", ret);
         return ret;
     }
@@ -608,33 +701,33 @@ int rtmp_server::process_FCUnpublish(RtmpMessage *msg)
 {
     int ret = ERROR_SUCCESS;
 
-    FmleStartPacket *pkt = new FmleStartPacket();
-    DAutoFree(FmleStartPacket, pkt);
-    pkt->copy(msg);
+    double transaction_id = 0;
+    if (!decode_amf0(msg) || !m_amf.findDouble(1, transaction_id)) {
+        FmleStartPacket *pkt = new FmleStartPacket();
+        DAutoFree(FmleStartPacket, pkt);
+        pkt->copy(msg);
 
-    if ((ret = pkt->decode()) != ERROR_SUCCESS) {
-        log_error("decode rtmp FCUnpublish failed. ret=%d", ret);
-        return ret;
+        if ((ret = pkt->decode()) != ERROR_SUCCESS) {
+            log_error("decode rtmp FCUnpublish failed. ret=%d", ret);
+            return ret;
+        }
+
+        transaction_id = pkt->transaction_id;
     }
 
     // response onFCUnpublish(NetStream.unpublish.Success)
-    OnStatusCallPacket* pkt1 = new OnStatusCallPacket();
-    DAutoFree(OnStatusCallPacket, pkt1);
-
-    pkt1->command_name = RTMP_AMF0_COMMAND_ON_FC_UNPUBLISH;
-    pkt1->data.setValue(StatusCode, new AMF0String(StatusCodeUnpublishSuccess));
-    pkt1->data.setValue(StatusDescription, new AMF0String("Stop publishing stream."));
+    RtmpTemplatePacket pkt1(RtmpTemplateOnFCUnpublish);
 
-    if ((ret = send_message(pkt1)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt1)) != ERROR_SUCCESS) {
         log_error("send rtmp onFCUnpublish(NetStream.unpublish.Success) packet failed. ret=%d", ret);
         return ret;
     }
 
     // FCUnpublish response
-    FmleStartResPacket *pkt2 = new FmleStartResPacket(pkt->transaction_id);
-    DAutoFree(FmleStartResPacket, pkt2);
+    RtmpTemplatePacket pkt2(RtmpTemplateFmleStartResult);
+    pkt2.set_transaction_id(transaction_id);
 
-    if ((ret = send_message(pkt2)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt2)) != ERROR_SUCCESS) {
         log_error("send rmtp FCUnpublish response packet failed. ret=%d", ret);
         return ret;
     }
@@ -646,25 +739,22 @@ int rtmp_server::process_close_stream(RtmpMessage *msg)
 {
     int ret = ERROR_SUCCESS;
 
-    CloseStreamPacket *pkt = new CloseStreamPacket();
-    DAutoFree(CloseStreamPacket, pkt);
-    pkt->copy(msg);
+    double transaction_id = 0;
+    if (!decode_amf0(msg) || !m_amf.findDouble(1, transaction_id)) {
+        CloseStreamPacket *pkt = new CloseStreamPacket();
+        DAutoFree(CloseStreamPacket, pkt);
+        pkt->copy(msg);
 
-    if ((ret = pkt->decode()) != ERROR_SUCCESS) {
-        log_error("decode rtmp closeStream packet failed. ret=%d", ret);
-        return ret;
+        if ((ret = pkt->decode()) != ERROR_SUCCESS) {
+            log_error("decode rtmp closeStream packet failed. ret=%d", ret);
+            return ret;
+        }
     }
 
     // response onStatus(NetStream.Unpublish.Success)
-    OnStatusCallPacket* pkt1 = new OnStatusCallPacket();
-    DAutoFree(OnStatusCallPacket, pkt1);
-
-    pkt1->data.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
-    pkt1->data.setValue(StatusCode, new AMF0String(StatusCodeUnpublishSuccess));
-    pkt1->data.setValue(StatusDescription, new AMF0String("Stream is now unpublished"));
-    pkt1->data.setValue(StatusClientId, new AMF0String(RTMP_SIG_CLIENT_ID));
+    RtmpTemplatePacket pkt1(RtmpTemplateUnpublishSuccess);
 
-    if ((ret = send_message(pkt1)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt1)) != ERROR_SUCCESS) {
         log_error("send rtmp onStatus(NetStream.Unpublish.Success) packet failed. ret=%d", ret);
         return ret;
     }
@@ -865,19 +955,10 @@ int rtmp_server::send_connect_response()
 {
     int ret = ERROR_SUCCESS;
 
-    ConnectAppResPacket *pkt = new ConnectAppResPacket();
-    DAutoFree(ConnectAppResPacket, pkt);
+    RtmpTemplatePacket pkt(RtmpTemplateConnectResult);
+    pkt.set_number(m_objectEncoding);
 
-    pkt->props.setValue("fmsVer", new AMF0String("FMS/"RTMP_SIG_FMS_VER));
-    pkt->props.setValue("capabilities", new AMF0Number(127));
-    pkt->props.setValue("mode", new AMF0Number(1));
-
-    pkt->info.setValue(StatusLevel, new AMF0String(StatusLevelStatus));
-    pkt->info.setValue(StatusCode, new AMF0String(StatusCodeConnectSuccess));
-    pkt->info.setValue(StatusDescription, new AMF0String("Connection succeeded"));
-    pkt->info.setValue("objectEncoding", new AMF0Number(m_objectEncoding));
-
-    if ((ret = send_message(pkt)) != ERROR_SUCCESS) {
+    if ((ret = send_message(&pkt)) != ERROR_SUCCESS) {
         log_error("send connect response packet failed. ret=%d", ret);
         return ret;
     }
@@ -970,22 +1051,196 @@ int rtmp_server::send_acknowledgement()
     return ret;
 }
 
-int rtmp_server::get_command_name(char *data, int len, DString &name)
+bool rtmp_server::can_aggregate(RtmpMessage *msg)
+{
+    if (!msg->is_video() && !msg->is_audio()) {
+        return false;
+    }
+
+    int size = msg->payload->length;
+    if (size <= 0 || size > RTMP_AGGREGATE_MAX_FRAME_SIZE) {
+        return false;
+    }
+
+    // sequence header单独发送，部分播放器不处理aggregate中的sequence header
+    if (msg->is_video() && kernel_codec::video_is_sequence_header(msg->payload->data, size)) {
+        return false;
+    }
+    if (msg->is_audio() && kernel_codec::audio_is_sequence_header(msg->payload->data, size)) {
+        return false;
+    }
+
+    return true;
+}
+
+int rtmp_server::send_aggregate()
+{
+    int ret = ERROR_SUCCESS;
+
+    if (m_aggregate_msgs.empty()) {
+        return ret;
+    }
+
+    // 只有一个消息时不需要合并
+    if (m_aggregate_msgs.size() == 1) {
+        RtmpMessage *msg = m_aggregate_msgs.front();
+        m_aggregate_msgs.clear();
+        m_aggregate_size = 0;
+        DAutoFree(RtmpMessage, msg);
+
+        return send_av_message(msg);
+    }
+
+    MemoryChunk *chunk = DMemPool::instance()->getMemory(m_aggregate_size);
+    DSharedPtr<MemoryChunk> payload = DSharedPtr<MemoryChunk>(chunk);
+
+    char *p = payload->data;
+    dint64 base_time = m_aggregate_msgs.front()->header.timestamp;
+
+    for (int i = 0; i < (int)m_aggregate_msgs.size(); ++i) {
+        RtmpMessage *msg = m_aggregate_msgs.at(i);
+        duint32 size = msg->payload->length;
+        duint32 timestamp = (duint32)msg->header.timestamp;
+
+        // type(1) + size(3) + timestamp(3) + timestamp extended(1) + stream_id(3)
+        *p++ = msg->header.message_type;
+        *p++ = (size >> 16) & 0xFF;
+        *p++ = (size >> 8) & 0xFF;
+        *p++ = size & 0xFF;
+        *p++ = (timestamp >> 16) & 0xFF;
+        *p++ = (timestamp >> 8) & 0xFF;
+        *p++ = timestamp & 0xFF;
+        *p++ = (timestamp >> 24) & 0xFF;
+        *p++ = 0x00;
+        *p++ = 0x00;
+        *p++ = 0x00;
+
+        memcpy(p, msg->payload->data, size);
+        p += size;
+
+        // previous tag size
+        duint32 tag_size = size + 11;
+        *p++ = (tag_size >> 24) & 0xFF;
+        *p++ = (tag_size >> 16) & 0xFF;
+        *p++ = (tag_size >> 8) & 0xFF;
+        *p++ = tag_size & 0xFF;
+    }
+
+    payload->length = p - payload->data;
+
+    clear_aggregate();
+
+    RtmpMessage msg;
+    msg.header.message_type = RTMP_MSG_AggregateMessage;
+    msg.header.perfer_cid = RTMP_CID_Video;
+    msg.header.stream_id = m_stream_id;
+    msg.header.timestamp = base_time;
+    msg.header.payload_length = payload->length;
+    msg.payload = payload;
+
+    return send_av_message(&msg);
+}
+
+void rtmp_server::clear_aggregate()
+{
+    for (int i = 0; i < (int)m_aggregate_msgs.size(); ++i) {
+        DFree(m_aggregate_msgs.at(i));
+    }
+    m_aggregate_msgs.clear();
+
+    m_aggregate_size = 0;
+}
+
+int rtmp_server::send_av_message(RtmpMessage *msg)
+{
+    int ret = ERROR_SUCCESS;
+
+    if ((ret = adapt_chunk_size(msg)) != ERROR_SUCCESS) {
+        return ret;
+    }
+
+    if ((ret = m_ch->send_message(msg)) != ERROR_SUCCESS) {
+        log_error_eagain(ret, ret, "send rtmp video/audio message failed. type=%d, ret=%d", msg->header.message_type, ret);
+        return ret;
+    }
+
+    return ret;
+}
+
+int rtmp_server::adapt_chunk_size(RtmpMessage *msg)
 {
     int ret = ERROR_SUCCESS;
 
-    RtmpPacket *pkt = new RtmpPacket();
-    DAutoFree(RtmpPacket, pkt);
-    if (pkt->decode_packet(data, len) != ERROR_SUCCESS) {
+    if (m_chunk_size_max <= m_out_chunk_size) {
+        return ret;
+    }
+
+    // 音频帧很小，只按视频帧和aggregate消息统计
+    if (!msg->is_video() && !msg->is_aggregate()) {
+        return ret;
+    }
+
+    m_sample_count++;
+    m_sample_bytes += msg->payload->length;
+
+    if (m_sample_count < RTMP_CHUNK_SIZE_SAMPLES) {
+        return ret;
+    }
+
+    dint64 average = m_sample_bytes / m_sample_count;
+    m_sample_count = 0;
+    m_sample_bytes = 0;
+
+    // 按2倍增长到不小于平均帧大小，使大部分帧用一个chunk发完，只增大不减小
+    dint32 chunk_size = m_out_chunk_size;
+    while (chunk_size < average && chunk_size < m_chunk_size_max) {
+        chunk_size *= 2;
+    }
+    chunk_size = DMin(chunk_size, m_chunk_size_max);
+
+    if (chunk_size <= m_out_chunk_size) {
+        return ret;
+    }
+
+    // set chunk size在消息之间发送，之后的消息都使用新的chunk size
+    if ((ret = send_chunk_size(chunk_size)) != ERROR_SUCCESS) {
         return ret;
     }
-    if (!pkt->findString(1, name)) {
+    m_ch->set_out_chunk_size(chunk_size);
+
+    log_trace("rtmp adapt out chunk size. %d -> %d, average frame size=%lld", m_out_chunk_size, chunk_size, average);
+
+    m_out_chunk_size = chunk_size;
+    m_chunk_size_changes++;
+
+    return ret;
+}
+
+int rtmp_server::get_command_name(char *data, int len, AMF0StringRef &name)
+{
+    int ret = ERROR_SUCCESS;
+
+    // 命令名固定为第一个值，只读取这个字符串，不解码整个消息
+    if (!AmfReadStringRef(data, len, name)) {
         return ERROR_RTMP_COMMAND_NAME_NOTFOUND;
     }
 
     return ret;
 }
 
+bool rtmp_server::decode_amf0(RtmpMessage *msg)
+{
+    char *data = msg->payload->data;
+    int len = msg->payload->length;
+
+    if (msg->is_amf3_command() && msg->payload->length >= 1) {
+        data = msg->payload->data + 1;
+        len = msg->payload->length - 1;
+    }
+
+    return m_amf.decode(data, len);
+}
+
 int rtmp_server::send_message(RtmpMessage *msg)
 {
     int ret = ERROR_SUCCESS;
@@ -8,6 +8,8 @@
 #include "rtmp_packet.hpp"
 #include "rtmp_global.hpp"
 
+#include <vector>
+
 class rtmp_server
 {
 public:
@@ -22,6 +24,24 @@ public:
 
     void set_in_ack_size(int ack_size);
 
+    /**
+     * @brief 设置合并为aggregate消息发送的时间窗口，单位毫秒，0表示不合并
+     */
+    void set_aggregate_duration(dint32 duration);
+
+    /**
+     * @brief 设置自适应chunk size的上限，0表示不调整，最大65536。
+     *        播放过程中根据视频帧的平均大小增大out chunk size
+     */
+    void set_chunk_size_max(dint32 chunk_size_max);
+
+    RtmpChunkStat get_chunk_stat();
+
+    /**
+     * @brief 从创建到握手完成的时间，单位毫秒，握手没有完成时返回-1
+     */
+    dint64 get_handshake_time();
+
     kernel_request *get_request();
     /**
      * @brief 发送音视频数据，只是将数据组合成chunk，放到socket的缓冲区中
@@ -92,8 +112,23 @@ private:
     int send_chunk_size(dint32 chunk_size);
     int send_acknowledgement();
 
+    bool can_aggregate(RtmpMessage *msg);
+    /**
+     * @brief 将缓存的音视频打包成一个aggregate消息发送
+     */
+    int send_aggregate();
+    void clear_aggregate();
+
+    /**
+     * @brief 发送音视频消息前根据帧大小调整out chunk size
+     */
+    int send_av_message(RtmpMessage *msg);
+    int adapt_chunk_size(RtmpMessage *msg);
+
 private:
-    int get_command_name(char *data, int len, DString &name);
+    int get_command_name(char *data, int len, AMF0StringRef &name);
+    // 将命令消息解码到m_amf中，失败时由调用者使用packet重新解码
+    bool decode_amf0(RtmpMessage *msg);
     int send_message(RtmpMessage *msg);
 
 private:
@@ -104,6 +139,9 @@ private:
 
     RtmpChunk *m_ch;
 
+    // 命令消息的解码结果，每个消息复用，不分配内存
+    AMF0Reader m_amf;
+
     // 对方发包的chunk size
     dint32 m_in_chunk_size;
     // 我向外发包的chunk size
@@ -116,9 +154,26 @@ private:
 
     double m_objectEncoding;
 
+    // 合并发送的时间窗口，单位毫秒，0表示不合并
+    dint32 m_aggregate_duration;
+    // 等待合并的音视频消息，和原始消息共用payload
+    std::vector<RtmpMessage*> m_aggregate_msgs;
+    // 合并后payload的大小
+    dint32 m_aggregate_size;
+
+    // 自适应chunk size的上限，不大于m_out_chunk_size时不调整
+    dint32 m_chunk_size_max;
+    dint32 m_chunk_size_changes;
+    // 当前统计窗口内的视频帧数和总大小
+    dint32 m_sample_count;
+    dint64 m_sample_bytes;
+
     // 响应createStream时，发送给客户端，后面的数据全部使用此值，固定为1
     int m_stream_id;
 
+    duint64 m_create_time;
+    dint64 m_handshake_time;
+
 private:
     // 处理video、Audio
     RtmpAVHandler m_av_handler;